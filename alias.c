@@ -95,6 +95,8 @@ static bool print_alias(const wchar_t *name, const alias_T *alias, bool prefix);
 
 /* Hashtable mapping alias names (wide strings) to alias_T's. */
 hashtable_T aliases;
+/* Incremented each time an alias is defined or removed. */
+unsigned long alias_generation = 0;
 
 
 /* Initializes the alias module. */
@@ -104,6 +106,12 @@ void init_alias(void)
     ht_init(&aliases, hashwcs, htwcscmp);
 }
 
+/* Returns true iff any alias is defined. */
+bool have_aliases(void)
+{
+    return aliases.count > 0;
+}
+
 /* Returns true iff `c' is a character that can be used in an alias name. */
 bool is_alias_name_char(wchar_t c)
 {
@@ -148,6 +156,7 @@ void define_alias(
     alias->value[namelen + valuelen + 1] = L'\0';
 
     vfreealias(ht_set(&aliases, alias->value + valuelen + 1, alias));
+    alias_generation++;
 }
 
 /* Removes the alias definition with the specified name if any.
@@ -159,6 +168,7 @@ bool remove_alias(const wchar_t *name)
 
     if (alias != NULL) {
 	free_alias(alias);
+	alias_generation++;
 	return true;
     } else {
 	return false;
@@ -169,6 +179,7 @@ bool remove_alias(const wchar_t *name)
 void remove_all_aliases(void)
 {
     ht_clear(&aliases, vfreealias);
+    alias_generation++;
 }
 
 /* Returns the value of the specified alias (or null if there is no such). */
@@ -31,7 +31,11 @@ typedef enum {
     AF_NOEOF     = 1 << 1,
 } substaliasflags_T;
 
+extern unsigned long alias_generation;
+
 extern void init_alias(void);
+extern _Bool have_aliases(void)
+    __attribute__((pure));
 extern const wchar_t *get_alias_value(const wchar_t *aliasname)
     __attribute__((nonnull,pure));
 extern void destroy_aliaslist(struct aliaslist_T *list);
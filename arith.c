@@ -27,9 +27,11 @@
 #include <stdbool.h>
 #include <stdint.h>
 #include <stdlib.h>
+#include <string.h>
 #include <wchar.h>
 #include <sys/types.h>
 #include <wctype.h>
+#include "hashtable.h"
 #include "option.h"
 #include "strbuf.h"
 #include "util.h"
@@ -39,6 +41,7 @@
 typedef struct word_T {
     const wchar_t *contents;
     size_t length;
+    struct varsymbol_T *symbol;  /* interned name in compiled code, or NULL */
 } word_T;
 
 typedef enum valuetype_T {
@@ -82,15 +85,99 @@ typedef struct evalinfo_T {
     size_t index;        /* index of next token */
     atoken_T atoken;     /* current token */
     bool parseonly;      /* only parse the expression: don't calculate */
+    bool quiet;          /* don't print syntax error messages */
     bool error;          /* true if there is an error */
     char *savelocale;    /* original LC_NUMERIC locale */
 } evalinfo_T;
 
-static void evaluate(
-	const wchar_t *exp, value_T *result, evalinfo_T *info, bool coerce)
+/* An arithmetic expression can be compiled into a sequence of instructions
+ * that operate on a stack of values. Instructions pop their operands from the
+ * stack and push the results. The operators are applied by the same functions
+ * as those used in parsing, so the compiled expression yields the same result
+ * and side effects as parsing the expression. */
+typedef enum aopcode_T {
+    AO_VALUE,    /* push `ai_value' */
+    AO_BINARY,   /* apply binary operator `ai_ttype' to the top two values */
+    AO_COMPARE,  /* apply comparison operator `ai_ttype' to the top two */
+    AO_ASSIGN,   /* apply assignment operator `ai_ttype' to the top two */
+    AO_PREFIX,   /* apply prefix operator `ai_ttype' to the top value */
+    AO_POSTFIX,  /* apply postfix operator `ai_ttype' to the top value */
+    AO_BOOL,     /* convert the top value into 0 or 1 */
+    AO_AND,      /* pop the top value if true, or replace it with 0 and jump */
+    AO_OR,       /* pop the top value if false, or replace it with 1 and jump */
+    AO_TEST,     /* jump if the top value is invalid */
+    AO_BRANCH,   /* pop the top value and jump if it is false */
+    AO_JUMP,     /* jump unconditionally */
+} aopcode_T;
+typedef struct ainstr_T {
+    aopcode_T ai_opcode;
+    atokentype_T ai_ttype;
+    union {
+	value_T value;
+	size_t target;  /* index of the instruction to jump to */
+    } operand;
+} ainstr_T;
+#define ai_value  operand.value
+#define ai_target operand.target
+/* The AO_AND, AO_OR, and AO_TEST instructions leave the invalid top value on
+ * the stack and jump if the value is invalid. */
+
+typedef struct arithcode_T {
+    wchar_t *source;  /* expression text, which variable names point into */
+    bool posix;       /* value of `posixly_correct' at compilation */
+    size_t length;    /* number of instructions, or 0 if not compilable */
+    size_t depth;     /* maximum number of values on the stack */
+    ainstr_T code[];
+} arithcode_T;
+
+typedef struct acompiler_T {
+    evalinfo_T info;  /* `info.exp' is the expression being compiled */
+    ainstr_T *code;
+    size_t length, capacity, depth;
+} acompiler_T;
+
+/* The maximum number of compiled expressions cached. */
+#ifndef ARITH_CACHE_MAX
+#define ARITH_CACHE_MAX 256
+#endif
+
+static void evaluate(const wchar_t *exp, value_T *result, evalinfo_T *info,
+	bool coerce, bool cache)
+    __attribute__((nonnull));
+static const arithcode_T *get_arith_code(const wchar_t *exp)
+    __attribute__((nonnull));
+static void free_arith_code(kvpair_T kv);
+static void release_symbols(const ainstr_T *code, size_t length);
+static arithcode_T *compile_arith(wchar_t *exp)
+    __attribute__((nonnull,malloc,warn_unused_result));
+static size_t emit(acompiler_T *ac, aopcode_T opcode, atokentype_T ttype)
+    __attribute__((nonnull));
+static void emit_value(acompiler_T *ac, const value_T *value)
+    __attribute__((nonnull));
+static void compile_assignment(acompiler_T *ac)
+    __attribute__((nonnull));
+static void compile_conditional(acompiler_T *ac)
+    __attribute__((nonnull));
+static void compile_logical(acompiler_T *ac, atokentype_T ttype)
+    __attribute__((nonnull));
+static void compile_binary(acompiler_T *ac, int level)
+    __attribute__((nonnull));
+static int binary_level(atokentype_T ttype)
+    __attribute__((const));
+static void compile_prefix(acompiler_T *ac)
+    __attribute__((nonnull));
+static void compile_postfix(acompiler_T *ac)
+    __attribute__((nonnull));
+static void compile_primary(acompiler_T *ac)
+    __attribute__((nonnull));
+static void run_arith_code(
+	const arithcode_T *code, value_T *result, evalinfo_T *info)
     __attribute__((nonnull));
 static void parse_assignment(evalinfo_T *info, value_T *result)
     __attribute__((nonnull));
+static void apply_assignment(
+	evalinfo_T *info, atokentype_T ttype, value_T *lhs, value_T *rhs)
+    __attribute__((nonnull));
 static bool do_assignment(const word_T *word, const value_T *value)
     __attribute__((nonnull));
 static wchar_t *value_to_string(const value_T *value)
@@ -111,6 +198,9 @@ static bool do_double_calculation(
 	atokentype_T ttype, double v1, double v2, double *result)
     __attribute__((nonnull,warn_unused_result));
 static long do_double_comparison(atokentype_T ttype, double v1, double v2);
+static void apply_comparison(
+	evalinfo_T *info, atokentype_T ttype, value_T *lhs, value_T *rhs)
+    __attribute__((nonnull));
 static void parse_conditional(evalinfo_T *info, value_T *result)
     __attribute__((nonnull));
 static void parse_logical_or(evalinfo_T *info, value_T *result)
@@ -135,16 +225,25 @@ static void parse_multiplicative(evalinfo_T *info, value_T *result)
     __attribute__((nonnull));
 static void parse_prefix(evalinfo_T *info, value_T *result)
     __attribute__((nonnull));
+static void apply_prefix(evalinfo_T *info, atokentype_T ttype, value_T *value)
+    __attribute__((nonnull));
 static void parse_postfix(evalinfo_T *info, value_T *result)
     __attribute__((nonnull));
+static void apply_postfix(evalinfo_T *info, atokentype_T ttype, value_T *value)
+    __attribute__((nonnull));
 static bool do_increment_or_decrement(atokentype_T ttype, value_T *value)
     __attribute__((nonnull,warn_unused_result));
 static void parse_primary(evalinfo_T *info, value_T *result)
     __attribute__((nonnull));
 static void parse_as_number(evalinfo_T *info, value_T *result)
     __attribute__((nonnull));
+static bool convert_number_literal(
+	const wchar_t *s, const char *savelocale, value_T *result)
+    __attribute__((nonnull,warn_unused_result));
 static void coerce_number(evalinfo_T *info, value_T *value)
     __attribute__((nonnull));
+static int coerce_boolean(evalinfo_T *info, value_T *value)
+    __attribute__((nonnull));
 static void coerce_integer(evalinfo_T *info, value_T *value)
     __attribute__((nonnull));
 static valuetype_T coerce_type(evalinfo_T *info,
@@ -158,15 +257,18 @@ static bool long_mul_will_overflow(long v1, long v2)
 
 /* Evaluates the specified string as an arithmetic expression.
  * The argument string is freed in this function.
+ * If `cache' is true, the expression is compiled and cached so that it can be
+ * evaluated faster next time. It should be true for expressions that are
+ * likely to be evaluated again.
  * The result is converted into a string and returned as a newly-malloced
  * string. On error, an error message is printed to the standard error and NULL
  * is returned. */
-wchar_t *evaluate_arithmetic(wchar_t *exp)
+wchar_t *evaluate_arithmetic(wchar_t *exp, bool cache)
 {
     value_T result;
     evalinfo_T info;
 
-    evaluate(exp, &result, &info, posixly_correct);
+    evaluate(exp, &result, &info, posixly_correct, cache);
 
     wchar_t *resultstr;
     if (info.error) {
@@ -184,15 +286,16 @@ wchar_t *evaluate_arithmetic(wchar_t *exp)
 
 /* Evaluates the specified string as an arithmetic expression.
  * The argument string is freed in this function.
+ * `cache' is the same as that of `evaluate_arithmetic'.
  * The expression must yield a valid integer value, which is assigned to
  * `*valuep'. Otherwise, an error message is printed.
  * Returns true iff successful. */
-bool evaluate_index(wchar_t *exp, ssize_t *valuep)
+bool evaluate_index(wchar_t *exp, bool cache, ssize_t *valuep)
 {
     value_T result;
     evalinfo_T info;
 
-    evaluate(exp, &result, &info, true);
+    evaluate(exp, &result, &info, true, cache);
 
     bool ok;
     if (info.error) {
@@ -224,21 +327,430 @@ bool evaluate_index(wchar_t *exp, ssize_t *valuep)
     return ok;
 }
 
-void evaluate(
-	const wchar_t *exp, value_T *result, evalinfo_T *info, bool coerce)
+/* Evaluates the specified string as an arithmetic expression.
+ * The expression is evaluated by the compiled code if `cache' is true and the
+ * expression can be compiled. Otherwise, it is parsed and evaluated at once.
+ * Either way, `info->atoken' is the token that ended parsing. */
+void evaluate(const wchar_t *exp, value_T *result, evalinfo_T *info,
+	bool coerce, bool cache)
 {
-    info->exp = exp;
-    info->index = 0;
     info->parseonly = false;
+    info->quiet = false;
     info->error = false;
-    info->savelocale = xstrdup(setlocale(LC_NUMERIC, NULL));
 
-    next_token(info);
-    parse_assignment(info, result);
+    const arithcode_T *code = cache ? get_arith_code(exp) : NULL;
+    if (code != NULL && code->length > 0) {
+	info->atoken.type = TT_NULL;
+	run_arith_code(code, result, info);
+    } else {
+	info->exp = exp;
+	info->index = 0;
+	info->savelocale = xstrdup(setlocale(LC_NUMERIC, NULL));
+
+	next_token(info);
+	parse_assignment(info, result);
+
+	free(info->savelocale);
+    }
     if (coerce)
 	coerce_number(info, result);
+}
+
+/* cache of compiled expressions whose keys are the expression strings */
+static hashtable_T arith_cache;
+/* true if the cached expressions may have been compiled in another locale */
+static bool arith_cache_stale = false;
+
+/* Discards all the compiled expressions that have been cached.
+ * This function must be called whenever the LC_CTYPE locale is changed because
+ * tokenization depends on it. The cache is actually cleared before the next
+ * expression is compiled. */
+void reset_arith_cache(void)
+{
+    arith_cache_stale = true;
+}
+
+/* Returns the compiled code of the specified expression, compiling and caching
+ * it if not yet cached. The `length' of the result is zero if the expression
+ * could not be compiled, in which case it should be parsed and evaluated to
+ * print error messages. */
+const arithcode_T *get_arith_code(const wchar_t *exp)
+{
+    if (arith_cache.capacity == 0)
+	ht_init(&arith_cache, hashwcs, htwcscmp);
+    if (arith_cache_stale || arith_cache.count >= ARITH_CACHE_MAX) {
+	ht_clear(&arith_cache, free_arith_code);
+	arith_cache_stale = false;
+    }
+
+    arithcode_T *code = ht_get(&arith_cache, exp).value;
+    if (code != NULL) {
+	if (code->posix == posixly_correct)
+	    return code;
+	ht_remove(&arith_cache, exp);
+	free_arith_code((kvpair_T) { code->source, code });
+    }
+
+    code = compile_arith(xwcsdup(exp));
+    ht_set(&arith_cache, code->source, code);
+    return code;
+}
+
+/* Frees a compiled expression that is an entry of `arith_cache'. */
+void free_arith_code(kvpair_T kv)
+{
+    arithcode_T *code = kv.value;
+    release_symbols(code->code, code->length);
+    free(code->source);
+    free(code);
+}
+
+/* Releases the variable names interned in the specified instructions. */
+void release_symbols(const ainstr_T *code, size_t length)
+{
+    for (size_t i = 0; i < length; i++)
+	if (code[i].ai_opcode == AO_VALUE && code[i].ai_value.type == VT_VAR)
+	    release_variable_name(code[i].ai_value.v_var.symbol);
+}
+
+/* Compiles the specified arithmetic expression.
+ * `exp' must be a newly-malloced string, which is used as the `source' of the
+ * result. */
+arithcode_T *compile_arith(wchar_t *exp)
+{
+    acompiler_T ac;
+    ac.info.exp = exp;
+    ac.info.index = 0;
+    ac.info.parseonly = false;
+    ac.info.quiet = true;
+    ac.info.error = false;
+    ac.info.savelocale = xstrdup(setlocale(LC_NUMERIC, NULL));
+    ac.code = NULL;
+    ac.length = ac.capacity = ac.depth = 0;
+
+    next_token(&ac.info);
+    compile_assignment(&ac);
+    if (ac.info.atoken.type != TT_NULL)
+	ac.info.error = true;
+    if (ac.info.error) {
+	release_symbols(ac.code, ac.length);
+	ac.length = 0;
+    }
+
+    free(ac.info.savelocale);
+
+    arithcode_T *code = xmallocs(sizeof *code, ac.length, sizeof *code->code);
+    code->source = exp;
+    code->posix = posixly_correct;
+    code->length = ac.length;
+    code->depth = ac.depth;
+    if (ac.length > 0)
+	memcpy(code->code, ac.code, ac.length * sizeof *code->code);
+    free(ac.code);
+    return code;
+}
+
+/* Appends an instruction to the code being compiled.
+ * Returns the index of the appended instruction. */
+size_t emit(acompiler_T *ac, aopcode_T opcode, atokentype_T ttype)
+{
+    if (ac->length == ac->capacity) {
+	ac->capacity = ac->capacity * 2 + 8;
+	ac->code = xreallocn(ac->code, ac->capacity, sizeof *ac->code);
+    }
+    ac->code[ac->length].ai_opcode = opcode;
+    ac->code[ac->length].ai_ttype = ttype;
+    return ac->length++;
+}
+
+/* Appends an instruction that pushes the specified value. */
+void emit_value(acompiler_T *ac, const value_T *value)
+{
+    size_t index = emit(ac, AO_VALUE, TT_NULL);
+    ac->code[index].ai_value = *value;
+    ac->depth++;
+}
+
+/* Compiles an assignment expression. See `parse_assignment'. */
+void compile_assignment(acompiler_T *ac)
+{
+    compile_conditional(ac);
+
+    atokentype_T ttype = ac->info.atoken.type;
+    switch (ttype) {
+	case TT_EQUAL:          case TT_PLUSEQUAL:   case TT_MINUSEQUAL:
+	case TT_ASTEREQUAL:     case TT_SLASHEQUAL:  case TT_PERCENTEQUAL:
+	case TT_LESSLESSEQUAL:  case TT_GREATERGREATEREQUAL:
+	case TT_AMPEQUAL:       case TT_HATEQUAL:    case TT_PIPEEQUAL:
+	    next_token(&ac->info);
+	    compile_assignment(ac);
+	    emit(ac, AO_ASSIGN, ttype);
+	    break;
+	default:
+	    break;
+    }
+}
+
+/* Compiles a conditional expression. See `parse_conditional'. */
+void compile_conditional(acompiler_T *ac)
+{
+    compile_logical(ac, TT_PIPEPIPE);
+    if (ac->info.atoken.type != TT_QUESTION)
+	return;
+    next_token(&ac->info);
+
+    size_t test = emit(ac, AO_TEST, TT_NULL);
+    size_t branch = emit(ac, AO_BRANCH, TT_NULL);
+    compile_assignment(ac);
+    if (ac->info.atoken.type != TT_COLON) {
+	ac->info.error = true;
+	return;
+    }
+    next_token(&ac->info);
+
+    size_t jump = emit(ac, AO_JUMP, TT_NULL);
+    ac->code[branch].ai_target = ac->length;
+    compile_conditional(ac);
+    ac->code[test].ai_target = ac->code[jump].ai_target = ac->length;
+}
+
+/* Compiles a logical OR expression if `ttype' is TT_PIPEPIPE or a logical AND
+ * expression if TT_AMPAMP. See `parse_logical_or' and `parse_logical_and'. */
+void compile_logical(acompiler_T *ac, atokentype_T ttype)
+{
+    if (ttype == TT_PIPEPIPE)
+	compile_logical(ac, TT_AMPAMP);
+    else
+	compile_binary(ac, 0);
+
+    while (ac->info.atoken.type == ttype) {
+	next_token(&ac->info);
+
+	size_t jump = emit(ac, ttype == TT_PIPEPIPE ? AO_OR : AO_AND, TT_NULL);
+	if (ttype == TT_PIPEPIPE)
+	    compile_logical(ac, TT_AMPAMP);
+	else
+	    compile_binary(ac, 0);
+	emit(ac, AO_BOOL, TT_NULL);
+	ac->code[jump].ai_target = ac->length;
+    }
+}
+
+/* Compiles a binary expression whose operators have the specified precedence
+ * level. Level 0 is the inclusive OR expression and level 7 is the
+ * multiplicative expression. See `parse_inclusive_or' to
+ * `parse_multiplicative'. */
+void compile_binary(acompiler_T *ac, int level)
+{
+    if (level > 7) {
+	compile_prefix(ac);
+	return;
+    }
+
+    compile_binary(ac, level + 1);
+    while (binary_level(ac->info.atoken.type) == level) {
+	atokentype_T ttype = ac->info.atoken.type;
+	next_token(&ac->info);
+	compile_binary(ac, level + 1);
+	emit(ac, (level == 3 || level == 4) ? AO_COMPARE : AO_BINARY, ttype);
+    }
+}
+
+/* Returns the precedence level of the specified binary operator token, or -1
+ * if the token is not a binary operator. */
+int binary_level(atokentype_T ttype)
+{
+    switch (ttype) {
+	case TT_PIPE:
+	    return 0;
+	case TT_HAT:
+	    return 1;
+	case TT_AMP:
+	    return 2;
+	case TT_EQUALEQUAL:  case TT_EXCLEQUAL:
+	    return 3;
+	case TT_LESS:  case TT_LESSEQUAL:  case TT_GREATER:  case TT_GREATEREQUAL:
+	    return 4;
+	case TT_LESSLESS:  case TT_GREATERGREATER:
+	    return 5;
+	case TT_PLUS:  case TT_MINUS:
+	    return 6;
+	case TT_ASTER:  case TT_SLASH:  case TT_PERCENT:
+	    return 7;
+	default:
+	    return -1;
+    }
+}
+
+/* Compiles a prefix expression. See `parse_prefix'. */
+void compile_prefix(acompiler_T *ac)
+{
+    atokentype_T ttype = ac->info.atoken.type;
+    switch (ttype) {
+	case TT_PLUSPLUS:
+	case TT_MINUSMINUS:
+	    /* The operators are rejected in parsing in the POSIXly-correct
+	     * mode, so the error must be printed by the parser. */
+	    if (posixly_correct)
+		ac->info.error = true;
+	    /* falls thru! */
+	case TT_PLUS:
+	case TT_MINUS:
+	case TT_TILDE:
+	case TT_EXCL:
+	    next_token(&ac->info);
+	    compile_prefix(ac);
+	    emit(ac, AO_PREFIX, ttype);
+	    break;
+	default:
+	    compile_postfix(ac);
+	    break;
+    }
+}
+
+/* Compiles a postfix expression. See `parse_postfix'. */
+void compile_postfix(acompiler_T *ac)
+{
+    compile_primary(ac);
+    for (;;) {
+	atokentype_T ttype = ac->info.atoken.type;
+	switch (ttype) {
+	    case TT_PLUSPLUS:
+	    case TT_MINUSMINUS:
+		if (posixly_correct)
+		    ac->info.error = true;
+		emit(ac, AO_POSTFIX, ttype);
+		next_token(&ac->info);
+		break;
+	    default:
+		return;
+	}
+    }
+}
+
+/* Compiles a primary expression. See `parse_primary'. */
+void compile_primary(acompiler_T *ac)
+{
+    value_T value;
+
+    switch (ac->info.atoken.type) {
+	case TT_LPAREN:
+	    next_token(&ac->info);
+	    compile_assignment(ac);
+	    if (ac->info.atoken.type == TT_RPAREN)
+		next_token(&ac->info);
+	    else
+		ac->info.error = true;
+	    break;
+	case TT_NUMBER:
+	    {
+		word_T *word = &ac->info.atoken.word;
+		wchar_t wordstr[word->length + 1];
+		wcsncpy(wordstr, word->contents, word->length);
+		wordstr[word->length] = L'\0';
+		if (convert_number_literal(
+			    wordstr, ac->info.savelocale, &value))
+		    emit_value(ac, &value);
+		else
+		    ac->info.error = true;
+	    }
+	    next_token(&ac->info);
+	    break;
+	case TT_IDENTIFIER:
+	    value.type = VT_VAR;
+	    value.v_var = ac->info.atoken.word;
+	    {
+		wchar_t name[value.v_var.length + 1];
+		wmemcpy(name, value.v_var.contents, value.v_var.length);
+		name[value.v_var.length] = L'\0';
+		value.v_var.symbol = intern_variable_name(name);
+	    }
+	    emit_value(ac, &value);
+	    next_token(&ac->info);
+	    break;
+	default:
+	    ac->info.error = true;
+	    break;
+    }
+}
+
+/* Runs the specified compiled expression.
+ * The resultant value is assigned to `*result'. */
+void run_arith_code(const arithcode_T *code, value_T *result, evalinfo_T *info)
+{
+    value_T stack[code->depth];
+    size_t sp = 0, pc = 0;
+
+    while (pc < code->length) {
+	const ainstr_T *in = &code->code[pc++];
+	value_T *top = &stack[sp - 1];
+	switch (in->ai_opcode) {
+	    case AO_VALUE:
+		stack[sp++] = in->ai_value;
+		break;
+	    case AO_BINARY:
+		sp--;
+		do_binary_calculation(info, in->ai_ttype, &top[-1], top,
+			&top[-1]);
+		break;
+	    case AO_COMPARE:
+		sp--;
+		apply_comparison(info, in->ai_ttype, &top[-1], top);
+		break;
+	    case AO_ASSIGN:
+		sp--;
+		apply_assignment(info, in->ai_ttype, &top[-1], top);
+		break;
+	    case AO_PREFIX:
+		apply_prefix(info, in->ai_ttype, top);
+		break;
+	    case AO_POSTFIX:
+		apply_postfix(info, in->ai_ttype, top);
+		break;
+	    case AO_BOOL:
+		switch (coerce_boolean(info, top)) {
+		    case 0:  top->type = VT_LONG, top->v_long = 0;  break;
+		    case 1:  top->type = VT_LONG, top->v_long = 1;  break;
+		}
+		break;
+	    case AO_AND:
+		switch (coerce_boolean(info, top)) {
+		    case -1:  pc = in->ai_target;  break;
+		    case 0:
+			top->type = VT_LONG, top->v_long = 0;
+			pc = in->ai_target;
+			break;
+		    case 1:   sp--;  break;
+		}
+		break;
+	    case AO_OR:
+		switch (coerce_boolean(info, top)) {
+		    case -1:  pc = in->ai_target;  break;
+		    case 0:   sp--;  break;
+		    case 1:
+			top->type = VT_LONG, top->v_long = 1;
+			pc = in->ai_target;
+			break;
+		}
+		break;
+	    case AO_TEST:
+		coerce_number(info, top);
+		if (top->type == VT_INVALID)
+		    pc = in->ai_target;
+		break;
+	    case AO_BRANCH:
+		sp--;
+		if (!coerce_boolean(info, top))
+		    pc = in->ai_target;
+		break;
+	    case AO_JUMP:
+		pc = in->ai_target;
+		break;
+	}
+    }
 
-    free(info->savelocale);
+    assert(sp == 1);
+    *result = stack[0];
 }
 
 /* Parses an assignment expression.
@@ -258,20 +770,7 @@ void parse_assignment(evalinfo_T *info, value_T *result)
 		value_T rhs;
 		next_token(info);
 		parse_assignment(info, &rhs);
-		if (result->type == VT_VAR) {
-		    word_T saveword = result->v_var;
-		    if (!do_binary_calculation(
-				info, ttype, result, &rhs, result))
-			break;
-		    if (!do_assignment(&saveword, result))
-			info->error = true, result->type = VT_INVALID;
-		} else if (result->type != VT_INVALID) {
-		    /* TRANSLATORS: This error message is shown when the target
-		     * of an assignment is not a variable. */
-		    xerror(0, Ngt("arithmetic: cannot assign to a number"));
-		    info->error = true;
-		    result->type = VT_INVALID;
-		}
+		apply_assignment(info, ttype, result, &rhs);
 		break;
 	    }
 	default:
@@ -279,6 +778,26 @@ void parse_assignment(evalinfo_T *info, value_T *result)
     }
 }
 
+/* Applies the assignment operator defined by token `ttype' to operands `lhs'
+ * and `rhs'. The result is assigned to `*lhs'. */
+void apply_assignment(
+	evalinfo_T *info, atokentype_T ttype, value_T *lhs, value_T *rhs)
+{
+    if (lhs->type == VT_VAR) {
+	word_T saveword = lhs->v_var;
+	if (!do_binary_calculation(info, ttype, lhs, rhs, lhs))
+	    return;
+	if (!do_assignment(&saveword, lhs))
+	    info->error = true, lhs->type = VT_INVALID;
+    } else if (lhs->type != VT_INVALID) {
+	/* TRANSLATORS: This error message is shown when the target
+	 * of an assignment is not a variable. */
+	xerror(0, Ngt("arithmetic: cannot assign to a number"));
+	info->error = true;
+	lhs->type = VT_INVALID;
+    }
+}
+
 /* Assigns the specified `value' to the variable specified by `word'.
  * Returns false on error. */
 bool do_assignment(const word_T *word, const value_T *value)
@@ -286,6 +805,8 @@ bool do_assignment(const word_T *word, const value_T *value)
     wchar_t *vstr = value_to_string(value);
     if (vstr == NULL)
 	return false;
+    if (word->symbol != NULL)
+	return set_variable_sym(word->symbol, vstr, SCOPE_GLOBAL, false);
 
     wchar_t name[word->length + 1];
     wmemcpy(name, word->contents, word->length);
@@ -309,9 +830,10 @@ wchar_t *value_to_string(const value_T *value)
 		wchar_t name[value->v_var.length + 1];
 		wmemcpy(name, value->v_var.contents, value->v_var.length);
 		name[value->v_var.length] = L'\0';
-		const wchar_t *var = getvar(name);
+		wchar_t *var = (value->v_var.symbol != NULL)
+		    ? getvar_sym_dup(value->v_var.symbol) : getvar_dup(name);
 		if (var != NULL)
-		    return xwcsdup(var);
+		    return var;
 		if (shopt_unset)
 		    return malloc_wprintf(L"%ld", 0L);
 		xerror(0, Ngt("arithmetic: parameter `%ls' is not set"), name);
@@ -759,22 +1281,7 @@ void parse_equality(evalinfo_T *info, value_T *result)
 	    case TT_EXCLEQUAL:
 		next_token(info);
 		parse_relational(info, &rhs);
-		switch (coerce_type(info, result, &rhs)) {
-		    case VT_LONG:
-			result->v_long = do_long_comparison(ttype,
-				result->v_long, rhs.v_long);
-			break;
-		    case VT_DOUBLE:
-			result->v_long = do_double_comparison(ttype,
-				result->v_double, rhs.v_double);
-			result->type = VT_LONG;
-			break;
-		    case VT_INVALID:
-			result->type = VT_INVALID;
-			break;
-		    case VT_VAR:
-			assert(false);
-		}
+		apply_comparison(info, ttype, result, &rhs);
 		break;
 	    default:
 		return;
@@ -782,6 +1289,28 @@ void parse_equality(evalinfo_T *info, value_T *result)
     }
 }
 
+/* Applies the comparison operator defined by token `ttype' to operands `lhs'
+ * and `rhs'. The result is assigned to `*lhs'. */
+void apply_comparison(
+	evalinfo_T *info, atokentype_T ttype, value_T *lhs, value_T *rhs)
+{
+    switch (coerce_type(info, lhs, rhs)) {
+	case VT_LONG:
+	    lhs->v_long = do_long_comparison(ttype, lhs->v_long, rhs->v_long);
+	    break;
+	case VT_DOUBLE:
+	    lhs->v_long =
+		do_double_comparison(ttype, lhs->v_double, rhs->v_double);
+	    lhs->type = VT_LONG;
+	    break;
+	case VT_INVALID:
+	    lhs->type = VT_INVALID;
+	    break;
+	case VT_VAR:
+	    assert(false);
+    }
+}
+
 /* Parses a relational expression.
  *   RelationalExp := ShiftExp
  *                  | RelationalExp "<" ShiftExp
@@ -801,22 +1330,7 @@ void parse_relational(evalinfo_T *info, value_T *result)
 	    case TT_GREATEREQUAL:
 		next_token(info);
 		parse_shift(info, &rhs);
-		switch (coerce_type(info, result, &rhs)) {
-		    case VT_LONG:
-			result->v_long = do_long_comparison(ttype,
-				result->v_long, rhs.v_long);
-			break;
-		    case VT_DOUBLE:
-			result->v_long = do_double_comparison(ttype,
-				result->v_double, rhs.v_double);
-			result->type = VT_LONG;
-			break;
-		    case VT_INVALID:
-			result->type = VT_INVALID;
-			break;
-		    case VT_VAR:
-			assert(false);
-		}
+		apply_comparison(info, ttype, result, &rhs);
 		break;
 	    default:
 		return;
@@ -905,70 +1419,82 @@ void parse_prefix(evalinfo_T *info, value_T *result)
     switch (ttype) {
 	case TT_PLUSPLUS:
 	case TT_MINUSMINUS:
+	case TT_PLUS:
+	case TT_MINUS:
+	case TT_TILDE:
+	case TT_EXCL:
 	    next_token(info);
 	    parse_prefix(info, result);
+	    apply_prefix(info, ttype, result);
+	    break;
+	default:
+	    parse_postfix(info, result);
+	    break;
+    }
+}
+
+/* Applies the prefix operator defined by token `ttype' to `value'. */
+void apply_prefix(evalinfo_T *info, atokentype_T ttype, value_T *value)
+{
+    switch (ttype) {
+	case TT_PLUSPLUS:
+	case TT_MINUSMINUS:
 	    if (posixly_correct) {
 		xerror(0, Ngt("arithmetic: operator `%ls' is not supported"),
 			(ttype == TT_PLUSPLUS) ? L"++" : L"--");
 		info->error = true;
-		result->type = VT_INVALID;
-	    } else if (result->type == VT_VAR) {
-		word_T saveword = result->v_var;
-		coerce_number(info, result);
-		if (!do_increment_or_decrement(ttype, result) ||
-			!do_assignment(&saveword, result))
-		    info->error = true, result->type = VT_INVALID;
-	    } else if (result->type != VT_INVALID) {
+		value->type = VT_INVALID;
+	    } else if (value->type == VT_VAR) {
+		word_T saveword = value->v_var;
+		coerce_number(info, value);
+		if (!do_increment_or_decrement(ttype, value) ||
+			!do_assignment(&saveword, value))
+		    info->error = true, value->type = VT_INVALID;
+	    } else if (value->type != VT_INVALID) {
 		/* TRANSLATORS: This error message is shown when the operand of
 		 * the "++" or "--" operator is not a variable. */
 		xerror(0, Ngt("arithmetic: operator `%ls' requires a variable"),
-			(info->atoken.type == TT_PLUSPLUS) ? L"++" : L"--");
+			(ttype == TT_PLUSPLUS) ? L"++" : L"--");
 		info->error = true;
-		result->type = VT_INVALID;
+		value->type = VT_INVALID;
 	    }
 	    break;
 	case TT_PLUS:
 	case TT_MINUS:
-	    next_token(info);
-	    parse_prefix(info, result);
-	    coerce_number(info, result);
+	    coerce_number(info, value);
 	    if (ttype == TT_MINUS) {
-		switch (result->type) {
+		switch (value->type) {
 		case VT_LONG:
 #if LONG_MIN < -LONG_MAX
-		    if (result->v_long == LONG_MIN) {
+		    if (value->v_long == LONG_MIN) {
 			xerror(0, Ngt("arithmetic: overflow"));
 			info->error = true;
-			result->type = VT_INVALID;
+			value->type = VT_INVALID;
 			break;
 		    }
 #endif
-		    result->v_long = -result->v_long;
+		    value->v_long = -value->v_long;
 		    break;
-		case VT_DOUBLE:   result->v_double = -result->v_double;  break;
+		case VT_DOUBLE:   value->v_double = -value->v_double;  break;
 		case VT_INVALID:  break;
 		default:          assert(false);
 		}
 	    }
 	    break;
 	case TT_TILDE:
-	    next_token(info);
-	    parse_prefix(info, result);
-	    coerce_integer(info, result);
-	    if (result->type == VT_LONG)
-		result->v_long = ~result->v_long;
+	    coerce_integer(info, value);
+	    if (value->type == VT_LONG)
+		value->v_long = ~value->v_long;
 	    break;
 	case TT_EXCL:
-	    next_token(info);
-	    parse_prefix(info, result);
-	    coerce_number(info, result);
-	    switch (result->type) {
+	    coerce_number(info, value);
+	    switch (value->type) {
 		case VT_LONG:
-		    result->v_long = !result->v_long;
+		    value->v_long = !value->v_long;
 		    break;
 		case VT_DOUBLE:
-		    result->type = VT_LONG;
-		    result->v_long = !result->v_double;
+		    value->type = VT_LONG;
+		    value->v_long = !value->v_double;
 		    break;
 		case VT_INVALID:
 		    break;
@@ -977,8 +1503,7 @@ void parse_prefix(evalinfo_T *info, value_T *result)
 	    }
 	    break;
 	default:
-	    parse_postfix(info, result);
-	    break;
+	    assert(false);
     }
 }
 
@@ -992,28 +1517,7 @@ void parse_postfix(evalinfo_T *info, value_T *result)
 	switch (info->atoken.type) {
 	    case TT_PLUSPLUS:
 	    case TT_MINUSMINUS:
-		if (posixly_correct) {
-		    xerror(0,
-			    Ngt("arithmetic: operator `%ls' is not supported"),
-			    (info->atoken.type == TT_PLUSPLUS) ? L"++" : L"--");
-		    info->error = true;
-		    result->type = VT_INVALID;
-		} else if (result->type == VT_VAR) {
-		    word_T saveword = result->v_var;
-		    coerce_number(info, result);
-		    value_T value = *result;
-		    if (!do_increment_or_decrement(info->atoken.type, &value) ||
-			    !do_assignment(&saveword, &value)) {
-			info->error = true;
-			result->type = VT_INVALID;
-		    }
-		} else if (result->type != VT_INVALID) {
-		    xerror(0, Ngt("arithmetic: "
-				"operator `%ls' requires a variable"),
-			    (info->atoken.type == TT_PLUSPLUS) ? L"++" : L"--");
-		    info->error = true;
-		    result->type = VT_INVALID;
-		}
+		apply_postfix(info, info->atoken.type, result);
 		next_token(info);
 		break;
 	    default:
@@ -1022,6 +1526,31 @@ void parse_postfix(evalinfo_T *info, value_T *result)
     }
 }
 
+/* Applies the postfix operator defined by token `ttype' to `value'. */
+void apply_postfix(evalinfo_T *info, atokentype_T ttype, value_T *value)
+{
+    if (posixly_correct) {
+	xerror(0, Ngt("arithmetic: operator `%ls' is not supported"),
+		(ttype == TT_PLUSPLUS) ? L"++" : L"--");
+	info->error = true;
+	value->type = VT_INVALID;
+    } else if (value->type == VT_VAR) {
+	word_T saveword = value->v_var;
+	coerce_number(info, value);
+	value_T newvalue = *value;
+	if (!do_increment_or_decrement(ttype, &newvalue) ||
+		!do_assignment(&saveword, &newvalue)) {
+	    info->error = true;
+	    value->type = VT_INVALID;
+	}
+    } else if (value->type != VT_INVALID) {
+	xerror(0, Ngt("arithmetic: operator `%ls' requires a variable"),
+		(ttype == TT_PLUSPLUS) ? L"++" : L"--");
+	info->error = true;
+	value->type = VT_INVALID;
+    }
+}
+
 /* Increment or decrement the specified value.
  * `ttype' must be either TT_PLUSPLUS or TT_MINUSMINUS and the `value' must be
  * `coerce_number'ed.
@@ -1101,29 +1630,40 @@ void parse_as_number(evalinfo_T *info, value_T *result)
     wcsncpy(wordstr, word->contents, word->length);
     wordstr[word->length] = L'\0';
 
+    if (!convert_number_literal(wordstr, info->savelocale, result)) {
+	xerror(0, Ngt("arithmetic: `%ls' is not a valid number"), wordstr);
+	info->error = true;
+	result->type = VT_INVALID;
+    }
+}
+
+/* Converts number literal `s' into a number.
+ * `savelocale' is the name of the current LC_NUMERIC locale.
+ * Returns false if `s' is not a valid number. */
+bool convert_number_literal(
+	const wchar_t *s, const char *savelocale, value_T *result)
+{
     long longresult;
-    if (xwcstol(wordstr, 0, &longresult)) {
+    if (xwcstol(s, 0, &longresult)) {
 	result->type = VT_LONG;
 	result->v_long = longresult;
-	return;
+	return true;
     }
     if (!posixly_correct) {
 	double doubleresult;
 	wchar_t *end;
 	setlocale(LC_NUMERIC, "C");
 	errno = 0;
-	doubleresult = wcstod(wordstr, &end);
+	doubleresult = wcstod(s, &end);
 	bool ok = (errno == 0 && *end == L'\0');
-	setlocale(LC_NUMERIC, info->savelocale);
+	setlocale(LC_NUMERIC, savelocale);
 	if (ok) {
 	    result->type = VT_DOUBLE;
 	    result->v_double = doubleresult;
-	    return;
+	    return true;
 	}
     }
-    xerror(0, Ngt("arithmetic: `%ls' is not a valid number"), wordstr);
-    info->error = true;
-    result->type = VT_INVALID;
+    return false;
 }
 
 /* If the value is of the VT_VAR type, change it into VT_LONG/VT_DOUBLE.
@@ -1134,13 +1674,14 @@ void coerce_number(evalinfo_T *info, value_T *value)
     if (value->type != VT_VAR)
 	return;
 
-    const wchar_t *varvalue;
+    wchar_t *varvalue;
     {
 	word_T *name = &value->v_var;
 	wchar_t namestr[name->length + 1];
 	wmemcpy(namestr, name->contents, name->length);
 	namestr[name->length] = L'\0';
-	varvalue = getvar(namestr);
+	varvalue = (name->symbol != NULL)
+	    ? getvar_sym_dup(name->symbol) : getvar_dup(namestr);
 
 	if (varvalue == NULL && !shopt_unset) {
 	    xerror(0, Ngt("arithmetic: parameter `%ls' is not set"), namestr);
@@ -1152,14 +1693,14 @@ void coerce_number(evalinfo_T *info, value_T *value)
     if (varvalue == NULL || varvalue[0] == L'\0') {
 	value->type = VT_LONG;
 	value->v_long = 0;
-	return;
+	goto done;
     }
 
     long longresult;
     if (xwcstol(varvalue, 0, &longresult)) {
 	value->type = VT_LONG;
 	value->v_long = longresult;
-	return;
+	goto done;
     }
     if (!posixly_correct) {
 	double doubleresult;
@@ -1169,13 +1710,28 @@ void coerce_number(evalinfo_T *info, value_T *value)
 	if (errno == 0 && *end == L'\0') {
 	    value->type = VT_DOUBLE;
 	    value->v_double = doubleresult;
-	    return;
+	    goto done;
 	}
     }
     xerror(0, Ngt("arithmetic: `%ls' is not a valid number"), varvalue);
     info->error = true;
     value->type = VT_INVALID;
-    return;
+done:
+    free(varvalue);
+}
+
+/* Does `coerce_number' and returns the truth value of the result: 1 if the
+ * value is non-zero, 0 if zero, or -1 if invalid. */
+int coerce_boolean(evalinfo_T *info, value_T *value)
+{
+    coerce_number(info, value);
+    switch (value->type) {
+	case VT_INVALID:  return -1;
+	case VT_LONG:     return value->v_long != 0;
+	case VT_DOUBLE:   return value->v_double != 0.0;
+	case VT_VAR:      assert(false);
+    }
+    assert(false);
 }
 
 /* Does `coerce_number' and if the result is of VT_DOUBLE, converts into
@@ -1432,6 +1988,7 @@ parse_num:
 		info->atoken.type = TT_NUMBER;
 		info->atoken.word.contents = &info->exp[startindex];
 		info->atoken.word.length = info->index - startindex;
+		info->atoken.word.symbol = NULL;
 	    } else if (iswalpha(c)) {
 parse_identifier:;
 		size_t startindex = info->index;
@@ -1441,9 +1998,11 @@ parse_identifier:;
 		info->atoken.type = TT_IDENTIFIER;
 		info->atoken.word.contents = &info->exp[startindex];
 		info->atoken.word.length = info->index - startindex;
+		info->atoken.word.symbol = NULL;
 	    } else {
-		xerror(0, Ngt("arithmetic: `%lc' is not "
-			    "a valid number or operator"), (wint_t) c);
+		if (!info->quiet)
+		    xerror(0, Ngt("arithmetic: `%lc' is not "
+				"a valid number or operator"), (wint_t) c);
 		info->error = true;
 		info->atoken.type = TT_INVALID;
 	    }
@@ -23,10 +23,11 @@
 #include <sys/types.h>
 
 
-extern wchar_t *evaluate_arithmetic(wchar_t *exp)
+extern wchar_t *evaluate_arithmetic(wchar_t *exp, _Bool cache)
     __attribute__((nonnull,malloc,warn_unused_result));
-extern _Bool evaluate_index(wchar_t *exp, ssize_t *valuep)
+extern _Bool evaluate_index(wchar_t *exp, _Bool cache, ssize_t *valuep)
     __attribute__((nonnull));
+extern void reset_arith_cache(void);
 
 
 #endif /* YASH_ARITH_H */
@@ -0,0 +1,46 @@
+# arith.sh: benchmark of arithmetic expansion
+# (C) 2026 magicant
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 2 of the License, or
+# (at your option) any later version.
+# 
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+# 
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+# usage: arith.sh [constant|dynamic] [count]
+# Performs arithmetic expansion in a loop of `count' (default: 1000000)
+# iterations.
+# In the "constant" variant (default), the expressions contain no
+# parameter expansion, so the shell can compile them only once.
+# In the "dynamic" variant, the expressions contain parameter expansions,
+# so the shell has to parse them every time.
+
+variant="${1:-constant}" count="${2:-1000000}"
+
+i=0 x=0
+case "$variant" in
+    (constant)
+	while [ "$i" -lt "$count" ]; do
+	    x=$(( (x * 31 + i) % 1000003 ))
+	    i=$((i + 1))
+	done
+	;;
+    (dynamic)
+	while [ "$i" -lt "$count" ]; do
+	    x=$(( ($x * 31 + $i) % 1000003 ))
+	    i=$(($i + 1))
+	done
+	;;
+    (*)
+	printf 'arith.sh: unknown variant %s\n' "$variant" >&2
+	exit 2
+	;;
+esac
+printf '%s\n' "$x"
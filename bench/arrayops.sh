@@ -0,0 +1,69 @@
+# arrayops.sh: benchmark of adding and removing array elements
+# (C) 2026 magicant
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 2 of the License, or
+# (at your option) any later version.
+# 
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+# 
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+# usage: arrayops.sh [append|prepend|shift|shiftarray] [count]
+# Grows or shrinks an array of `count' (default: 100000) elements one element
+# at a time.
+# The "append" variant (default) appends elements by "array -i".
+# The "prepend" variant inserts elements at the head by "array -i".
+# The "shift" variant removes the positional parameters by "shift".
+# The "shiftarray" variant removes array elements by "shift -A".
+
+variant="${1:-append}" count="${2:-100000}"
+
+i=0
+case "$variant" in
+    (append)
+	a=()
+	while [ "$i" -lt "$count" ]; do
+	    array -i a -1 "$i"
+	    i=$((i + 1))
+	done
+	;;
+    (prepend)
+	a=()
+	while [ "$i" -lt "$count" ]; do
+	    array -i a 0 "$i"
+	    i=$((i + 1))
+	done
+	;;
+    (shift|shiftarray)
+	a=()
+	while [ "$i" -lt "$count" ]; do
+	    array -i a -1 "$i"
+	    i=$((i + 1))
+	done
+	set -- "$a"
+	i=0
+	if [ "$variant" = shift ]; then
+	    while [ "$#" -gt 0 ]; do
+		shift
+		i=$((i + 1))
+	    done
+	else
+	    while [ "${a[#]}" -gt 0 ]; do
+		shift -A a
+		i=$((i + 1))
+	    done
+	fi
+	;;
+    (*)
+	printf 'arrayops.sh: unknown variant %s\n' "$variant" >&2
+	exit 2
+	;;
+esac
+
+printf '%s\n' "$i"
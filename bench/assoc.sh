@@ -0,0 +1,51 @@
+# assoc.sh: benchmark of maps of strings to strings
+# (C) 2026 magicant
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 2 of the License, or
+# (at your option) any later version.
+# 
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+# 
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+# usage: assoc.sh [assoc|eval] [count] [keys]
+# Runs a loop of `count' (default: 200000) iterations that updates one of
+# `keys' (default: 1000) entries of a map and reads it back.
+# In the "assoc" variant (default), the map is an associative array.
+# In the "eval" variant, each entry of the map is a separate variable whose
+# name is made from the key and accessed by the eval built-in.
+
+variant="${1:-assoc}" count="${2:-200000}" keys="${3:-1000}"
+
+i=0
+case "$variant" in
+    (assoc)
+	typeset -A map
+	while [ "$i" -lt "$count" ]; do
+	    key=k$((i % keys))
+	    array -s map "$key" "${map[$key]-}x"
+	    value=${map[$key]}
+	    i=$((i + 1))
+	done
+	;;
+    (eval)
+	while [ "$i" -lt "$count" ]; do
+	    key=k$((i % keys))
+	    eval "map_$key=\${map_$key-}x"
+	    eval "value=\$map_$key"
+	    i=$((i + 1))
+	done
+	;;
+    (*)
+	printf 'assoc.sh: unknown variant %s\n' "$variant" >&2
+	exit 2
+	;;
+esac
+
+printf '%s\n' "$i" "${#value}"
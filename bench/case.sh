@@ -0,0 +1,57 @@
+# case.sh: benchmark of the case command
+# (C) 2026 magicant
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 2 of the License, or
+# (at your option) any later version.
+# 
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+# 
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+# usage: case.sh [constant|dynamic] [count]
+# Executes a case command that has 50 branches `count' (default: 1000000)
+# times. The word of the case command cycles through the branches.
+# In the "constant" variant (default), the patterns contain no expansion, so
+# the shell can compile them only once.
+# In the "dynamic" variant, the patterns contain parameter expansions whose
+# values never change, so the shell has to expand them every time but can
+# still reuse the compiled patterns.
+
+variant="${1:-constant}" count="${2:-1000000}"
+
+case "$variant" in
+    (constant) key='key' alt='alt' ;;
+    (dynamic)  key='"$key"' alt='$alt' ;;
+    (*)
+	printf 'case.sh: unknown variant %s\n' "$variant" >&2
+	exit 2
+	;;
+esac
+
+# Define function f that contains the case command
+branches='' n=0
+while [ "$n" -lt 50 ]; do
+    branches="$branches
+	(${key}_$n|${alt}[0-9]*_$n) r=$n ;;"
+    n=$((n + 1))
+done
+eval "f() {
+    case \$1 in $branches
+	(*) r=none ;;
+    esac
+}"
+key='key' alt='alt'
+
+i=0 n=0
+while [ "$i" -lt "$count" ]; do
+    f "key_$n"
+    i=$((i + 1)) n=$((n + 1))
+    if [ "$n" -ge 50 ]; then n=0; fi
+done
+printf '%s\n' "$r"
@@ -0,0 +1,60 @@
+# cmdsub.sh: benchmark of command substitution
+# (C) 2026 magicant
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 2 of the License, or
+# (at your option) any later version.
+# 
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+# 
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+# usage: cmdsub.sh [builtin|function|subshell] [count]
+# Performs a command substitution `count' (default: 10000) times.
+# In the "builtin" variant (default), the substitution runs the "printf"
+# built-in, which the shell executes without forking.
+# In the "function" variant, the substitution calls a shell function that
+# modifies its local variables, which the shell executes without forking
+# but with the variables saved and restored.
+# In the "subshell" variant, the substitution contains a subshell, which
+# always makes the shell fork itself.
+
+variant="${1:-builtin}" count="${2:-10000}"
+
+f() {
+    local n="$1"
+    n=$((n * 2))
+    printf '%d\n' "$n"
+}
+
+i=0
+case "$variant" in
+    (builtin)
+	while [ "$i" -lt "$count" ]; do
+	    x="$(printf '%d\n' "$i")"
+	    i=$((i + 1))
+	done
+	;;
+    (function)
+	while [ "$i" -lt "$count" ]; do
+	    x="$(f "$i")"
+	    i=$((i + 1))
+	done
+	;;
+    (subshell)
+	while [ "$i" -lt "$count" ]; do
+	    x="$( (printf '%d\n' "$i") )"
+	    i=$((i + 1))
+	done
+	;;
+    (*)
+	printf 'cmdsub.sh: unknown variant %s\n' "$variant" >&2
+	exit 2
+	;;
+esac
+printf '%s\n' "$x"
@@ -0,0 +1,55 @@
+# dot.sh: benchmark of reading a script with the dot built-in
+# (C) 2026 magicant
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 2 of the License, or
+# (at your option) any later version.
+# 
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+# 
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+# usage: dot.sh [cache|nocache] [count] [functions]
+# Generates a library script that defines `functions' (default: 200) functions
+# and reads it with the dot built-in `count' (default: 2000) times.
+# In the "cache" variant (default), the commands parsed from the script are
+# reused while the script is unchanged (the "parsecache" option).
+# In the "nocache" variant, the script is parsed every time it is read.
+
+variant="${1:-cache}" count="${2:-2000}" functions="${3:-200}"
+
+case "$variant" in
+    (cache)   set -o parsecache ;;
+    (nocache) set +o parsecache ;;
+    (*)
+	printf 'dot.sh: unknown variant %s\n' "$variant" >&2
+	exit 2
+	;;
+esac
+
+lib="${TMPDIR:-/tmp}/yash-bench-dot.$$"
+trap 'rm -f "$lib"' EXIT
+
+i=0
+while [ "$i" -lt "$functions" ]; do
+    printf 'f%d() {\n' "$i"
+    printf '    case $1 in\n'
+    printf '\t(-*) printf "%%s\\n" "${1#-}" ;;\n'
+    printf '\t(*) [ -n "$2" ] && echo "$2" ;;\n'
+    printf '    esac\n'
+    printf '}\n'
+    i=$((i + 1))
+done >"$lib"
+
+i=0
+while [ "$i" -lt "$count" ]; do
+    . "$lib"
+    i=$((i + 1))
+done
+
+printf '%s\n' "$i"
@@ -0,0 +1,41 @@
+# export.sh: benchmark of assignments to exported variables
+# (C) 2026 magicant
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 2 of the License, or
+# (at your option) any later version.
+# 
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+# 
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+# usage: export.sh [exported|plain] [count]
+# Increments a counter variable `count' (default: 1000000) times and runs an
+# external command every 10000 increments.
+# In the "exported" variant (default), the counter is exported.
+# In the "plain" variant, the counter is not exported.
+
+variant="${1:-exported}" count="${2:-1000000}"
+
+case "$variant" in
+    (exported) export i ;;
+    (plain)    ;;
+    (*)
+	printf 'export.sh: unknown variant %s\n' "$variant" >&2
+	exit 2
+	;;
+esac
+
+i=0 n=0
+while [ "$i" -lt "$count" ]; do
+    i=$((i + 1)) n=$((n + 1))
+    if [ "$n" -ge 10000 ]; then
+	n=0
+	sh -c 'printf "%s\n" "${i-}"'
+    fi
+done
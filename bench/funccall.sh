@@ -0,0 +1,62 @@
+# funccall.sh: benchmark of shell function calls
+# (C) 2026 magicant
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 2 of the License, or
+# (at your option) any later version.
+# 
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+# 
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+# usage: funccall.sh [call|local|inline] [count]
+# Calls a trivial function `count' (default: 1000000) times.
+# In the "call" variant (default), the function does nothing but the null
+# command, and is called with two operands.
+# In the "local" variant, the function also declares a local variable.
+# In the "inline" variant, the null command is run directly with the same
+# operands instead of calling the function, which shows the cost of the loop
+# itself.
+
+variant="${1:-call}" count="${2:-1000000}"
+
+f() {
+    :
+}
+
+g() {
+    local x="$1"
+}
+
+i=0
+case "$variant" in
+    (call)
+	while [ "$i" -lt "$count" ]; do
+	    f foo bar
+	    i=$((i + 1))
+	done
+	;;
+    (local)
+	while [ "$i" -lt "$count" ]; do
+	    g foo bar
+	    i=$((i + 1))
+	done
+	;;
+    (inline)
+	while [ "$i" -lt "$count" ]; do
+	    : foo bar
+	    i=$((i + 1))
+	done
+	;;
+    (*)
+	printf 'funccall.sh: unknown variant %s\n' "$variant" >&2
+	exit 2
+	;;
+esac
+
+printf '%s\n' "$i"
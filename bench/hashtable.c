@@ -0,0 +1,94 @@
+// This is a benchmark tool, not part of yash
+//   (cd .. && make hashtable.o util.o)
+//   c99 -O2 -I.. -o hashtable hashtable.c ../hashtable.o ../util.o
+//   ./hashtable [count] [rounds]
+// To compare two implementations of the hashtable, build this tool with the
+// hashtable.o of each implementation and run both with the same operands.
+// The tool creates a hashtable of `count' (default: 1000) wide-string keys
+// and measures the CPU time of inserting, looking up (both existing and
+// non-existing keys), iterating and removing the keys, each repeated `rounds'
+// (default: 2000) times.
+#include "common.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <wchar.h>
+#include "hashtable.h"
+#include "util.h"
+
+static wchar_t **make_keys(size_t count, const wchar_t *prefix)
+{
+    wchar_t **keys = xmallocn(count, sizeof *keys);
+    for (size_t i = 0; i < count; i++) {
+	wchar_t buf[64];
+	swprintf(buf, sizeof buf / sizeof *buf, L"%ls%zu", prefix, i);
+	keys[i] = xwcsdup(buf);
+    }
+    return keys;
+}
+
+static void report(const char *name, clock_t start, size_t ops)
+{
+    double sec = (double) (clock() - start) / CLOCKS_PER_SEC;
+    printf("%-8s %8.3f s  %7.2f ns/op\n", name, sec, sec * 1e9 / ops);
+}
+
+int main(int argc, char **argv)
+{
+    size_t count = (argc > 1) ? strtoul(argv[1], NULL, 10) : 1000;
+    size_t rounds = (argc > 2) ? strtoul(argv[2], NULL, 10) : 2000;
+    wchar_t **keys = make_keys(count, L"VARIABLE_");
+    wchar_t **misses = make_keys(count, L"MISSING_");
+    hashtable_T ht;
+    size_t found = 0;
+    clock_t start;
+
+    start = clock();
+    for (size_t r = 0; r < rounds; r++) {
+	ht_init(&ht, hashwcs, htwcscmp);
+	for (size_t i = 0; i < count; i++)
+	    ht_set(&ht, keys[i], keys[i]);
+	ht_destroy(&ht);
+    }
+    report("insert", start, count * rounds);
+
+    ht_init(&ht, hashwcs, htwcscmp);
+    for (size_t i = 0; i < count; i++)
+	ht_set(&ht, keys[i], keys[i]);
+
+    start = clock();
+    for (size_t r = 0; r < rounds; r++)
+	for (size_t i = 0; i < count; i++)
+	    found += ht_get(&ht, keys[i]).value != NULL;
+    report("hit", start, count * rounds);
+
+    start = clock();
+    for (size_t r = 0; r < rounds; r++)
+	for (size_t i = 0; i < count; i++)
+	    found += ht_get(&ht, misses[i]).value != NULL;
+    report("miss", start, count * rounds);
+
+    start = clock();
+    for (size_t r = 0; r < rounds; r++) {
+	size_t index = 0;
+	kvpair_T kv;
+	while ((kv = ht_next(&ht, &index)).key != NULL)
+	    found++;
+    }
+    report("iterate", start, count * rounds);
+
+    start = clock();
+    for (size_t r = 0; r < rounds; r++) {
+	for (size_t i = 0; i < count; i++)
+	    ht_remove(&ht, keys[i]);
+	for (size_t i = 0; i < count; i++)
+	    ht_set(&ht, keys[i], keys[i]);
+    }
+    report("churn", start, count * rounds * 2);
+
+    ht_destroy(&ht);
+    if (found != count * rounds * 2)
+	return 1;
+    return 0;
+}
@@ -0,0 +1,53 @@
+# heredoc.sh: benchmark of here-documents
+# (C) 2026 magicant
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 2 of the License, or
+# (at your option) any later version.
+# 
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+# 
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+# usage: heredoc.sh [small|medium|large] [count]
+# Feeds a here-document to a "while read" loop `count' (default: 2000) times.
+# The here-document has 10 lines (about 300 bytes) in the "small" variant
+# (default), 1000 lines (about 30 kilobytes) in the "medium" variant, and
+# 10000 lines (about 300 kilobytes) in the "large" variant. In the "large"
+# variant, the default count is 200.
+
+variant="${1:-small}"
+case "$variant" in
+    (small)  lines=10    count="${2:-2000}" ;;
+    (medium) lines=1000  count="${2:-2000}" ;;
+    (large)  lines=10000 count="${2:-200}"  ;;
+    (*)
+	printf 'heredoc.sh: unknown variant %s\n' "$variant" >&2
+	exit 2
+	;;
+esac
+
+line='abcdefghijklmnopqrstuvwxyz0123'
+contents=''
+i=0
+while [ "$i" -lt "$lines" ]; do
+    contents="$contents$line
+"
+    i=$((i + 1))
+done
+
+i=0 total=0
+while [ "$i" -lt "$count" ]; do
+    while IFS= read -r l; do
+	total=$((total + 1))
+    done <<END
+$contents
+END
+    i=$((i + 1))
+done
+printf '%d\n' "$total"
@@ -0,0 +1,75 @@
+# input.sh: benchmark of reading a script
+# (C) 2026 magicant
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 2 of the License, or
+# (at your option) any later version.
+# 
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+# 
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+# usage: input.sh shell [pipe|file|script] [lines]
+# Generates a script of `lines' (default: 100000) lines and runs `shell -n'
+# on the script, so that the script is read and parsed but not executed.
+# The shell to be measured must be specified as the first operand, e.g.:
+#     sh run.sh ../yash input.sh ../yash pipe
+# In the "pipe" variant (default), the script is fed through a pipe, from
+# which the shell must not read beyond the line it is parsing.
+# In the "file" variant, the standard input is redirected from the script
+# file, which the shell can read ahead and rewind.
+# In the "script" variant, the script file is specified as an operand, so the
+# shell can read the whole file at once.
+
+if [ $# -lt 1 ]; then
+    printf 'usage: %s shell [pipe|file|script] [lines]\n' "$0" >&2
+    exit 2
+fi
+
+shell="$1" variant="${2:-pipe}" lines="${3:-100000}"
+
+case "$variant" in
+    (pipe|file|script) ;;
+    (*)
+	printf 'input.sh: unknown variant %s\n' "$variant" >&2
+	exit 2
+	;;
+esac
+
+script="${TMPDIR:-/tmp}/yash-bench-input.$$"
+trap 'rm -f "$script" "$script.1" "$script.2"' EXIT
+
+{
+    printf '%s\n' 'x=$((x+1)); echo "value ${x} of $#" >/dev/null 2>&1'
+    printf '%s\n' 'if [ "$x" -gt 0 ]; then y=${x#1}; else y=$(echo "$x"); fi'
+    printf '%s\n' "case \$y in (1*|2*) z='one' ;; (*) z=other ;; esac"
+    printf '%s\n' 'for a in "$@"; do : "$a" | cat; done'
+} >"$script.1"
+
+# Concatenate copies of the 4 lines, doubling them at each step, so that the
+# generation does not dominate the benchmark.
+: >"$script"
+n="$((lines / 4))"
+while [ "$n" -gt 0 ]; do
+    if [ "$((n % 2))" -eq 1 ]; then
+	cat "$script.1" >>"$script"
+    fi
+    n=$((n / 2))
+    if [ "$n" -gt 0 ]; then
+	cat "$script.1" "$script.1" >"$script.2"
+	mv -f "$script.2" "$script.1"
+    fi
+done
+
+case "$variant" in
+    (pipe) cat "$script" | "$shell" -n ;;
+    (file) "$shell" -n <"$script" ;;
+    (script) "$shell" -n "$script" ;;
+esac
+
+printf '%s\n' "$lines"
@@ -0,0 +1,72 @@
+# interactive.sh: benchmark of interactive shell startup
+# (C) 2026 magicant
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 2 of the License, or
+# (at your option) any later version.
+# 
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+# 
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+# usage: interactive.sh shell [nocache|cold|warm] [count]
+# Runs `shell -i -c exit' `count' (default: 100) times. The shell reads the
+# default initialization script from the "share" directory next to this
+# directory since $HOME is set to an empty directory. The shell to be measured
+# must be specified as the first operand, e.g.:
+#     sh run.sh ../yash interactive.sh ../yash warm
+# In the "nocache" variant, $YASH_PARSECACHE_DIR is not set, so the
+# initialization scripts are parsed every time.
+# In the "cold" variant, $YASH_PARSECACHE_DIR names a new empty directory each
+# time, so the scripts are parsed and the parsed commands are saved.
+# In the "warm" variant (default), $YASH_PARSECACHE_DIR names a directory that
+# already contains the saved commands.
+
+if [ $# -lt 1 ]; then
+    printf 'usage: %s shell [nocache|cold|warm] [count]\n' "$0" >&2
+    exit 2
+fi
+
+shell="$1" variant="${2:-warm}" count="${3:-100}"
+
+case "$variant" in
+    (nocache|cold|warm) ;;
+    (*)
+	printf 'interactive.sh: unknown variant %s\n' "$variant" >&2
+	exit 2
+	;;
+esac
+
+dir="${TMPDIR:-/tmp}/yash-bench-interactive.$$"
+trap 'rm -rf "$dir"' EXIT
+mkdir -m 700 "$dir" "$dir/home" "$dir/cache"
+
+export HOME="$dir/home" YASH_LOADPATH="$(cd -P .. && pwd)/share"
+unset YASH_PARSECACHE_DIR
+if [ "$variant" = warm ]; then
+    YASH_PARSECACHE_DIR="$dir/cache" "$shell" -i -c exit 2>/dev/null
+fi
+
+i=0
+while [ "$i" -lt "$count" ]; do
+    case "$variant" in
+	(nocache)
+	    "$shell" -i -c exit 2>/dev/null
+	    ;;
+	(cold)
+	    rm -f "$dir/cache/"*
+	    YASH_PARSECACHE_DIR="$dir/cache" "$shell" -i -c exit 2>/dev/null
+	    ;;
+	(warm)
+	    YASH_PARSECACHE_DIR="$dir/cache" "$shell" -i -c exit 2>/dev/null
+	    ;;
+    esac
+    i=$((i + 1))
+done
+
+printf '%s\n' "$i"
@@ -0,0 +1,77 @@
+# parse.sh: benchmark of parsing a large script
+# (C) 2026 magicant
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 2 of the License, or
+# (at your option) any later version.
+# 
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+# 
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+# usage: parse.sh [skip|define] [blocks]
+# Generates a script of `blocks' (default: 1000) times 100 lines of typical
+# commands and reads it with the dot built-in. The parsecache option is
+# disabled so that the whole script is parsed.
+# In the "skip" variant (default), every 100 lines are enclosed in an if
+# command whose condition is false, so that nothing but parsing is done.
+# In the "define" variant, each line redefines a function, so the commands
+# parsed from a line are kept as the function body until the next line is
+# executed.
+
+variant="${1:-skip}" blocks="${2:-1000}"
+
+case "$variant" in
+    (skip)   head='if false; then' tail='fi' prefix='' suffix='' ;;
+    (define) head='' tail='' prefix='f() { ' suffix='; }' ;;
+    (*)
+	printf 'parse.sh: unknown variant %s\n' "$variant" >&2
+	exit 2
+	;;
+esac
+set +o parsecache
+
+lib="${TMPDIR:-/tmp}/yash-bench-parse.$$"
+trap 'rm -f "$lib" "$lib.1" "$lib.2"' EXIT
+
+{
+    printf '%s\n' "$head"
+    i=0
+    while [ "$i" -lt 25 ]; do
+	printf '%s%s%s\n' "$prefix" \
+	    'x=$((x+1)); echo "value ${x} of $#" >/dev/null 2>&1' "$suffix"
+	printf '%s%s%s\n' "$prefix" \
+	    'if [ "$x" -gt 0 ]; then y=${x#1}; else y=$(echo "$x"); fi' \
+	    "$suffix"
+	printf '%s%s%s\n' "$prefix" \
+	    "case \$y in (1*|2*) z='one' ;; (*) z=other ;; esac" "$suffix"
+	printf '%s%s%s\n' "$prefix" \
+	    'for a in "$@"; do : "$a" | cat; done' "$suffix"
+	i=$((i + 1))
+    done
+    printf '%s\n' "$tail"
+} >"$lib.1"
+
+# Concatenate copies of the block, doubling them at each step, so that the
+# generation does not dominate the benchmark.
+: >"$lib"
+n="$blocks"
+while [ "$n" -gt 0 ]; do
+    if [ "$((n % 2))" -eq 1 ]; then
+	cat "$lib.1" >>"$lib"
+    fi
+    n=$((n / 2))
+    if [ "$n" -gt 0 ]; then
+	cat "$lib.1" "$lib.1" >"$lib.2"
+	mv -f "$lib.2" "$lib.1"
+    fi
+done
+
+. "$lib"
+
+printf '%s\n' "$blocks"
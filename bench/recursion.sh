@@ -0,0 +1,53 @@
+# recursion.sh: benchmark of variable lookup in nested function calls
+# (C) 2026 magicant
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 2 of the License, or
+# (at your option) any later version.
+# 
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+# 
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+# usage: recursion.sh [deep|shallow] [count]
+# Calls a recursive function that defines a local variable at each level and,
+# at the deepest level, reads global variables in a loop of `count' (default:
+# 200000) iterations.
+# In the "deep" variant (default), the recursion is 500 levels deep.
+# In the "shallow" variant, the recursion is only 1 level deep, which shows the
+# cost of the same loop without nesting.
+
+variant="${1:-deep}" count="${2:-200000}"
+
+case "$variant" in
+    (deep)    depth=500 ;;
+    (shallow) depth=1 ;;
+    (*)
+	printf 'recursion.sh: unknown variant %s\n' "$variant" >&2
+	exit 2
+	;;
+esac
+
+a=1 b=2 c=3 sum=0
+
+f() {
+    local level="$1"
+    if [ "$level" -gt 1 ]; then
+	f "$((level - 1))"
+	return
+    fi
+
+    i=0
+    while [ "$i" -lt "$count" ]; do
+	sum=$((sum + a + b + c))
+	i=$((i + 1))
+    done
+}
+
+f "$depth"
+printf '%s\n' "$sum"
@@ -0,0 +1,50 @@
+# regex.sh: benchmark of regular expression and pattern matching
+# (C) 2026 magicant
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 2 of the License, or
+# (at your option) any later version.
+# 
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+# 
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+# usage: regex.sh [regex|pattern|param] [count]
+# Matches a string against one of 10 patterns `count' (default: 300000) times.
+# In the "regex" variant (default), the =~ operator of the double-bracket
+# command is used with extended regular expressions.
+# In the "pattern" variant, the == operator of the double-bracket command is
+# used with pathname matching patterns.
+# In the "param" variant, the patterns are used in the ${...#...} parameter
+# expansion.
+
+variant="${1:-regex}" count="${2:-300000}"
+
+case "$variant" in
+    (regex|pattern|param) ;;
+    (*)
+	printf 'regex.sh: unknown variant %s\n' "$variant" >&2
+	exit 2
+	;;
+esac
+
+i=0 n=0 r=0
+while [ "$i" -lt "$count" ]; do
+    case "$variant" in
+	(regex)
+	    [[ "item_$n.txt" =~ ^item_$n\.[a-z]+$ ]] && r=$((r + 1)) ;;
+	(pattern)
+	    [[ "item_$n.txt" == item_$n.[a-z]* ]] && r=$((r + 1)) ;;
+	(param)
+	    s="item_$n.txt"
+	    [ "${s#item_$n.[a-z]}" = xt ] && r=$((r + 1)) ;;
+    esac
+    i=$((i + 1)) n=$((n + 1))
+    if [ "$n" -ge 10 ]; then n=0; fi
+done
+printf '%s\n' "$r"
@@ -0,0 +1,45 @@
+# run.sh: runs a benchmark script and reports its CPU time
+# (C) 2026 magicant
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 2 of the License, or
+# (at your option) any later version.
+# 
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+# 
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+# This script expects two or more operands.
+# The first is the pathname to the shell that runs the benchmark.
+# The second is the pathname to the benchmark script.
+# The remaining operands are passed to the benchmark script.
+# The CPU time consumed by the benchmark is printed to the standard output.
+
+set -Ceu
+
+if [ $# -lt 2 ]; then
+    printf 'usage: %s shell script [operand...]\n' "$0" >&2
+    exit 2
+fi
+
+shell="$1" script="$2"
+shift 2
+
+"$shell" "$script" "$@" >/dev/null
+
+# The "times" built-in must be run in this shell process (not in a subshell)
+# to report the CPU time of the child processes.
+tmp="${TMPDIR:-/tmp}/yash-bench.$$"
+trap 'rm -f "$tmp"' EXIT
+times >|"$tmp"
+{
+    read -r _ _
+    read -r user sys
+} <"$tmp"
+
+printf '%s %s: user %s sys %s\n' "${script##*/}" "$*" "$user" "$sys"
@@ -0,0 +1,55 @@
+# spawn.sh: benchmark of external command invocation
+# (C) 2026 magicant
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 2 of the License, or
+# (at your option) any later version.
+# 
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+# 
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+# usage: spawn.sh [spawn|fork] [count] [heap_megabytes]
+# Runs an external command `count' (default: 2000) times.
+# In the "spawn" variant (default), the command is run as a simple command,
+# which the shell starts by posix_spawn if possible.
+# In the "fork" variant, the command is run in a subshell, which always makes
+# the shell fork itself before the command is exec'ed.
+# Before the loop, a variable of `heap_megabytes' (default: 64) megabytes is
+# created to enlarge the shell's heap, which makes the cost of duplicating the
+# address space in fork visible.
+
+variant="${1:-spawn}" count="${2:-2000}" heap="${3:-64}"
+true="$(command -v true)"
+case "$true" in
+    (/*) ;;
+    (*)  true=/bin/true ;;
+esac
+
+heap="$(dd if=/dev/zero bs=1024 count="$((heap * 1024))" 2>/dev/null |
+    tr '\0' x)"
+
+i=0
+case "$variant" in
+    (spawn)
+	while [ "$i" -lt "$count" ]; do
+	    "$true"
+	    i=$((i + 1))
+	done
+	;;
+    (fork)
+	while [ "$i" -lt "$count" ]; do
+	    ("$true")
+	    i=$((i + 1))
+	done
+	;;
+    (*)
+	printf 'spawn.sh: unknown variant %s\n' "$variant" >&2
+	exit 2
+	;;
+esac
@@ -0,0 +1,49 @@
+# startup.sh: benchmark of starting the shell with a large environment
+# (C) 2026 magicant
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 2 of the License, or
+# (at your option) any later version.
+# 
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+# 
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+# usage: startup.sh shell [count] [variables] [length]
+# Runs `shell -c true' `count' (default: 200) times with `variables'
+# (default: 400) extra environment variables of `length' (default: 4000)
+# characters each. The shell to be measured must be specified as the first
+# operand, e.g.:
+#     sh run.sh ../yash startup.sh ../yash
+
+if [ $# -lt 1 ]; then
+    printf 'usage: %s shell [count] [variables] [length]\n' "$0" >&2
+    exit 2
+fi
+
+shell="$1" count="${2:-200}" variables="${3:-400}" length="${4:-4000}"
+
+value=x
+while [ "${#value}" -lt "$length" ]; do
+    value="$value$value"
+done
+value="${value[1,length]}"
+
+i=0
+while [ "$i" -lt "$variables" ]; do
+    export "BENCH_STARTUP_$i=$value"
+    i=$((i + 1))
+done
+
+i=0
+while [ "$i" -lt "$count" ]; do
+    "$shell" -c true
+    i=$((i + 1))
+done
+
+printf '%s\n' "$i"
@@ -0,0 +1,72 @@
+# tailcall.sh: benchmark of function calls in tail position
+# (C) 2026 magicant
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 2 of the License, or
+# (at your option) any later version.
+# 
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+# 
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+# usage: tailcall.sh [tail|local|loop] [count]
+# Counts down from `count' (default: 100000) to zero and prints the resident
+# set size that the shell grew by while counting, as reported by "ps".
+# In the "tail" variant (default), a function counts down by calling itself in
+# tail position with the decremented count.
+# In the "local" variant, the function also declares a local variable, which
+# must remain visible to the function it calls.
+# In the "loop" variant, a while loop counts down instead, which shows the cost
+# of counting without nested calls.
+# Unlike most of the other benchmarks, this script reports its result to the
+# standard output, so run it directly rather than by run.sh.
+
+variant="${1:-tail}" count="${2:-100000}"
+
+rss() {
+    ps -o rss= -p "$$"
+}
+
+count_tail() {
+    if [ "$1" -gt 0 ]; then
+	count_tail "$(($1 - 1))"
+    else
+	after="$(rss)"
+    fi
+}
+
+count_local() {
+    typeset level="$1"
+    if [ "$level" -gt 0 ]; then
+	count_local "$((level - 1))"
+    else
+	after="$(rss)"
+    fi
+}
+
+count_loop() {
+    i="$1"
+    while [ "$i" -gt 0 ]; do
+	i=$((i - 1))
+    done
+    after="$(rss)"
+}
+
+before="$(rss)"
+case "$variant" in
+    (tail|local|loop)
+	"count_$variant" "$count"
+	;;
+    (*)
+	printf 'tailcall.sh: unknown variant %s\n' "$variant" >&2
+	exit 2
+	;;
+esac
+
+printf '%s: %d levels: the shell grew by %d KiB\n' \
+    "$variant" "$count" "$((after - before))"
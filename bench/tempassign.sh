@@ -0,0 +1,63 @@
+# tempassign.sh: benchmark of temporary assignments
+# (C) 2026 magicant
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 2 of the License, or
+# (at your option) any later version.
+# 
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+# 
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+# usage: tempassign.sh [read|plainread|true|plaintrue] [count]
+# Reads `count' (default: 1000000) lines, or runs a built-in `count' times.
+# The "read" variant (default) reads each line by "IFS= read -r", which makes
+# a temporary assignment for every line.
+# The "plainread" variant reads each line by "read -r" for comparison.
+# The "true" variant runs "IFS= true" to measure the temporary assignment
+# alone, and the "plaintrue" variant runs "true" for comparison.
+
+variant="${1:-read}" count="${2:-1000000}"
+
+i=0
+case "$variant" in
+    (read)
+	yes | head -n "$count" | {
+	    while IFS= read -r line; do
+		i=$((i + 1))
+	    done
+	    printf '%s\n' "$i"
+	}
+	;;
+    (plainread)
+	yes | head -n "$count" | {
+	    while read -r line; do
+		i=$((i + 1))
+	    done
+	    printf '%s\n' "$i"
+	}
+	;;
+    (true)
+	while [ "$i" -lt "$count" ]; do
+	    IFS= true
+	    i=$((i + 1))
+	done
+	printf '%s\n' "$i"
+	;;
+    (plaintrue)
+	while [ "$i" -lt "$count" ]; do
+	    true
+	    i=$((i + 1))
+	done
+	printf '%s\n' "$i"
+	;;
+    (*)
+	printf 'tempassign.sh: unknown variant %s\n' "$variant" >&2
+	exit 2
+	;;
+esac
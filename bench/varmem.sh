@@ -0,0 +1,58 @@
+# varmem.sh: measurement of the memory used by variable values
+# (C) 2026 magicant
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 2 of the License, or
+# (at your option) any later version.
+# 
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+# 
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+# usage: varmem.sh [ascii|latin1|wide] [count] [length]
+# Assigns a value of `length' (default: 10000) characters to each of `count'
+# (default: 1000) variables and prints the resident set size that the shell
+# grew by per variable, as reported by "ps".
+# The "ascii" variant (default) uses values that consist of ASCII characters.
+# The "latin1" variant uses non-ASCII characters less than U+0100.
+# The "wide" variant uses characters outside Latin-1. The "latin1" and "wide"
+# variants must be run in a UTF-8 locale.
+# Unlike the other benchmarks, this script reports its result to the standard
+# output, so run it directly rather than by run.sh.
+
+variant="${1:-ascii}" count="${2:-1000}" length="${3:-10000}"
+
+case "$variant" in
+    (ascii)  s='x' ;;
+    (latin1) s='é' ;;
+    (wide)   s='語' ;;
+    (*)
+	printf 'varmem.sh: unknown variant %s\n' "$variant" >&2
+	exit 2
+	;;
+esac
+while [ "${#s}" -lt "$length" ]; do
+    s="$s$s"
+done
+s="${s[1,length]}"
+
+rss() {
+    ps -o rss= -p "$$"
+}
+
+before="$(rss)"
+i=0
+while [ "$i" -lt "$count" ]; do
+    eval "v$i=\${s}"
+    i=$((i + 1))
+done
+after="$(rss)"
+
+printf '%s: %d variables of %d characters: %d bytes per variable\n' \
+    "$variant" "$count" "$length" \
+    "$(( (after - before) * 1024 / count ))"
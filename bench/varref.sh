@@ -0,0 +1,50 @@
+# varref.sh: benchmark of variable references and assignments
+# (C) 2026 magicant
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 2 of the License, or
+# (at your option) any later version.
+# 
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+# 
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+# usage: varref.sh [param|arith] [count]
+# Runs a loop of `count' (default: 500000) iterations that reads and assigns
+# variables with fairly long names.
+# In the "param" variant (default), the variables are referenced by parameter
+# expansions and assigned by assignment words.
+# In the "arith" variant, the variables are referenced and assigned in an
+# arithmetic expansion.
+
+variant="${1:-param}" count="${2:-500000}"
+
+loop_counter_variable=0
+first_operand_variable=foo second_operand_variable=bar
+accumulated_result_variable=0
+case "$variant" in
+    (param)
+	while [ "$loop_counter_variable" -lt "$count" ]; do
+	    concatenated_result_variable=$first_operand_variable
+	    concatenated_result_variable=$concatenated_result_variable$second_operand_variable
+	    loop_counter_variable=$((loop_counter_variable + 1))
+	done
+	;;
+    (arith)
+	while [ "$loop_counter_variable" -lt "$count" ]; do
+	    : $((accumulated_result_variable += loop_counter_variable))
+	    : $((loop_counter_variable += 1))
+	done
+	;;
+    (*)
+	printf 'varref.sh: unknown variant %s\n' "$variant" >&2
+	exit 2
+	;;
+esac
+
+printf '%s\n' "$loop_counter_variable" "$accumulated_result_variable"
@@ -0,0 +1,52 @@
+# wait.sh: benchmark of job management
+# (C) 2026 magicant
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 2 of the License, or
+# (at your option) any later version.
+# 
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+# 
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+# usage: wait.sh [all|pid] [count]
+# Starts `count' (default: 10000) asynchronous commands and waits for them.
+# In the "all" variant (default), the "wait" built-in is run without operands
+# to wait for all the jobs at once.
+# In the "pid" variant, the "wait" built-in is run for each job with the
+# process ID of the job.
+# The time to start the jobs grows with the number of existing jobs if the
+# shell handles each job in time proportional to the size of the job list.
+
+variant="${1:-all}" count="${2:-10000}"
+
+i=0
+case "$variant" in
+    (all)
+	while [ "$i" -lt "$count" ]; do
+	    : &
+	    i=$((i + 1))
+	done
+	wait
+	;;
+    (pid)
+	pids=()
+	while [ "$i" -lt "$count" ]; do
+	    : &
+	    array -i pids "$i" "$!"
+	    i=$((i + 1))
+	done
+	for pid in "${pids}"; do
+	    wait "$pid"
+	done
+	;;
+    (*)
+	printf 'wait.sh: unknown variant %s\n' "$variant" >&2
+	exit 2
+	;;
+esac
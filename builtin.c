@@ -298,7 +298,7 @@ int too_many_operands_error(size_t max_accepted_operand_count)
 
 /* This function is called when an error occurred while executing a special
  * built-in. If `posixly_correct' and `special_builtin_executed' are true and
- * `is_interactive_now' is false, `exit_shell_with_status' is called with
+ * `is_interactive_now' is false, `exit_subshell_with_status' is called with
  * `exitstatus'. Otherwise, this function just returns `exitstatus'. */
 /* Even though this function is called only while executing a special built-in,
  * checking `special_builtin_executed' is necessary because
@@ -307,7 +307,7 @@ int too_many_operands_error(size_t max_accepted_operand_count)
 int special_builtin_error(int exitstatus)
 {
     if (posixly_correct && special_builtin_executed && !is_interactive_now)
-	exit_shell_with_status(exitstatus);
+	exit_subshell_with_status(exitstatus);
     return exitstatus;
 }
 
@@ -30,6 +30,9 @@
 # include <paths.h>
 #endif
 #include <signal.h>
+#if HAVE_POSIX_SPAWN
+# include <spawn.h>
+#endif
 #include <stdbool.h>
 #include <stdint.h>
 #include <stdio.h>
@@ -65,6 +68,20 @@
 # include "lineedit/lineedit.h"
 #endif
 
+#if HAVE_POSIX_SPAWN_TCSETPGRP && \
+	!defined(posix_spawn_file_actions_addtcsetpgrp_np)
+extern int posix_spawn_file_actions_addtcsetpgrp_np(
+	posix_spawn_file_actions_t *fa, int tcfd);
+#endif
+#if HAVE_MEMFD_CREATE
+extern int memfd_create(const char *name, unsigned int flags);
+#endif
+
+
+/* minimum size of a read from the pipe of a command substitution */
+#ifndef CMDSUB_READ_SIZE
+#define CMDSUB_READ_SIZE 4096
+#endif
 
 /* type of command execution */
 typedef enum {
@@ -127,7 +144,10 @@ typedef enum exception_T {
     E_RETURN,
     E_BREAK_ITERATION,
     E_CONTINUE_ITERATION,
+    E_EXIT,
 } exception_T;
+/* E_EXIT is used to abort a command substitution executed in the shell
+ * process. See `exit_subshell_with_status'. */
 
 /* state of currently executed loop */
 typedef struct execstate_T {
@@ -137,6 +157,21 @@ typedef struct execstate_T {
     bool iterating;         /* true when iterative execution is ongoing */
 } execstate_T;
 
+/* function call deferred to the caller of the current function */
+typedef struct tailcall_T {
+    bool allowed;     /* true if calls in tail position may be deferred */
+    command_T *body;  /* body of the function to call next, or NULL */
+    void **args;      /* arguments to the function */
+    int status;       /* value of `laststatus' when the call was made */
+} tailcall_T;
+
+/* state of the check by `is_self_executable_and_or' */
+typedef struct selfcheck_T {
+    plist_T functions;        /* bodies of functions already checked */
+    bool modifies_variables;  /* true if variables may be modified */
+    bool reads_random;        /* true if $RANDOM may be expanded */
+} selfcheck_T;
+
 static void exec_pipelines(const pipeline_T *p, bool finally_exit);
 static void exec_pipelines_async(const pipeline_T *p)
     __attribute__((nonnull));
@@ -181,6 +216,14 @@ static wchar_t **invoke_simple_command(const commandinfo_T *ci,
 static void exec_external_program(
 	const char *path, int argc, char *argv0, void **argv, char **envs)
     __attribute__((nonnull));
+static void convert_argv_to_mbs(
+	int argc, char **restrict mbsargv, char *argv0, void *const *argv)
+    __attribute__((nonnull));
+#if HAVE_POSIX_SPAWN
+static fork_and_wait_T spawn_and_wait(
+	const char *path, int argc, char *argv0, void **argv)
+    __attribute__((nonnull,warn_unused_result));
+#endif
 static inline int xexecve(
 	const char *path, char *const *argv, char *const *envp)
     __attribute__((nonnull(1)));
@@ -188,7 +231,7 @@ static void exec_fall_back_on_sh(
 	int argc, char *const *argv, char *const *env, const char *path)
     __attribute__((nonnull(2,3,4)));
 static void exec_function_body(
-	command_T *body, void *const *args, bool finally_exit, bool complete)
+	command_T *body, void **args, bool finally_exit, bool complete)
     __attribute__((nonnull));
 
 static void exec_nonsimple_command(command_T *c, bool finally_exit)
@@ -202,13 +245,58 @@ static void exec_while(const command_T *c, bool finally_exit)
     __attribute__((nonnull));
 static void exec_case(const command_T *c, bool finally_exit)
     __attribute__((nonnull));
+static casepattern_T *new_case_pattern_cache(void *const *patterns)
+    __attribute__((nonnull,malloc,warn_unused_result));
+static bool is_constant_pattern(const wordunit_T *w)
+    __attribute__((pure));
+static bool compile_case_pattern(const wordunit_T *w, casepattern_T *cp)
+    __attribute__((nonnull(2),warn_unused_result));
 static void exec_funcdef(const command_T *c, bool finally_exit)
     __attribute__((nonnull));
+static void mark_tail_calls(command_T *c)
+    __attribute__((nonnull));
+static void mark_tail_calls_in_and_or(and_or_T *a);
 
 static fork_and_wait_T fork_and_wait(sigtype_T sigtype)
     __attribute__((warn_unused_result));
 static void become_child(sigtype_T sigtype);
 
+static wchar_t *convert_cmdsub_output(xstrbuf_T *mbsbuf)
+    __attribute__((nonnull,malloc,warn_unused_result));
+static void read_all_from_fd(int fd, xstrbuf_T *buf)
+    __attribute__((nonnull));
+static bool exec_cmdsub_in_shell_process(
+	const and_or_T *commands, xstrbuf_T *output)
+    __attribute__((nonnull,warn_unused_result));
+static int open_cmdsub_memfd(void);
+static void close_cmdsub_memfd(int fd);
+static bool is_self_executable_and_or(const and_or_T *a, selfcheck_T *sc)
+    __attribute__((nonnull(2)));
+static bool is_self_executable_command(const command_T *c, selfcheck_T *sc)
+    __attribute__((nonnull));
+static bool is_self_executable_simple_command(
+	const command_T *c, selfcheck_T *sc)
+    __attribute__((nonnull));
+static bool is_self_executable_builtin(
+	const wchar_t *name, const wordunit_T *arg1, selfcheck_T *sc)
+    __attribute__((nonnull(1,3)));
+static bool is_self_executable_redirs(const redir_T *r, selfcheck_T *sc)
+    __attribute__((nonnull(2)));
+static bool is_literal_command_name(const wchar_t *s)
+    __attribute__((nonnull,pure));
+static void check_words_side_effects(void *const *words, selfcheck_T *sc)
+    __attribute__((nonnull));
+static void check_word_side_effects(const wordunit_T *w, selfcheck_T *sc)
+    __attribute__((nonnull(2)));
+static void check_arith_side_effects(const wordunit_T *w, selfcheck_T *sc)
+    __attribute__((nonnull(2)));
+static bool contains_name(const wchar_t *s, const wchar_t *name)
+    __attribute__((nonnull,pure));
+#if YASH_ENABLE_DOUBLE_BRACKET
+static void check_dbexp_side_effects(const dbexp_T *e, selfcheck_T *sc)
+    __attribute__((nonnull));
+#endif
+
 static int exec_iteration(void *const *commands, const char *codename)
     __attribute__((nonnull));
 
@@ -224,6 +312,15 @@ int exitstatus = -1;  // -1 if not executing the EXIT trap
 /* the process ID of the last asynchronous list */
 pid_t lastasyncpid;
 
+/* true while a command substitution is executed in the shell process */
+static bool executing_cmdsub_in_shell = false;
+/* exit status of the command substitution aborted by
+ * `exit_subshell_with_status' */
+static int cmdsub_exit_status;
+/* memory file kept for the next command substitution executed in the shell
+ * process (-1 if none) */
+static int cmdsub_memfd = -1;
+
 /* This flag is set to true while the shell is executing the condition of an if-
  * statement, an and-or list, etc. to suppress the effect of the "errexit" and
  * "errreturn" options. */
@@ -233,6 +330,8 @@ static bool suppresserrexit = false, suppresserrreturn = false;
 static execstate_T execstate;
 /* exceptional jump to be done (other than "break") */
 static exception_T exception;
+/* function call in tail position of the currently executed function */
+static tailcall_T tailcall;
 
 /* This flag is set when a special built-in is executed as such. */
 bool special_builtin_executed;
@@ -302,6 +401,24 @@ bool need_break(void)
 	|| is_interrupted();
 }
 
+/* Exits the shell with the specified exit status by calling
+ * `exit_shell_with_status'.
+ * While a command substitution is executed in the shell process, however,
+ * this function returns without exiting: The command substitution is aborted
+ * as if the subshell exited, that is, `need_break' returns true until the
+ * command substitution finishes, whose exit status will be `status' (or
+ * `laststatus' if `status' is negative). */
+void exit_subshell_with_status(int status)
+{
+    if (!executing_cmdsub_in_shell)
+	exit_shell_with_status(status);
+
+    if (status >= 0)
+	laststatus = status;
+    cmdsub_exit_status = laststatus;
+    exception = E_EXIT;
+}
+
 
 /* Executes the and-or lists.
  * If `finally_exit' is true, the shell exits after execution. */
@@ -371,7 +488,6 @@ void exec_pipelines_async(const pipeline_T *p)
 	job->j_pgid = doing_job_control_now ? cpid : 0;
 	job->j_status = JS_RUNNING;
 	job->j_statuschanged = true;
-	job->j_legacy = false;
 	job->j_nonotify = false;
 	job->j_pcount = 1;
 
@@ -455,7 +571,6 @@ exec_one_command: /* child process */
     job->j_pgid = doing_job_control_now ? pgid : 0;
     job->j_status = JS_RUNNING;
     job->j_statuschanged = true;
-    job->j_legacy = false;
     job->j_nonotify = false;
     job->j_pcount = count;
     set_active_job(job);
@@ -503,8 +618,8 @@ size_t number_of_commands_in_pipeline(const command_T *c)
 void apply_errexit_errreturn(const command_T *c)
 {
     if (is_errexit_condition() && is_err_condition_for(c))
-	exit_shell_with_status(laststatus);
-    if (is_errreturn_condition() && is_err_condition_for(c))
+	exit_subshell_with_status(laststatus);
+    else if (is_errreturn_condition() && is_err_condition_for(c))
 	exception = E_RETURN;
 }
 
@@ -684,7 +799,7 @@ done1:
     plfree(argv, free);
 done:
     if (finally_exit)
-	exit_shell();
+	exit_subshell_with_status(-1);
 }
 
 /* Executes the simple command that has no expanded words.
@@ -785,9 +900,26 @@ bool exec_simple_command_with_words(
 	}
     }
 
+    /* A function called in tail position is not executed here but by
+     * `exec_function_body' after the current function returns. If the current
+     * function cannot defer the call because it finally exits the shell, the
+     * called function is made not to exit so that it can defer its own tail
+     * calls. */
+    bool tail = c->c_tailcall && cmdinfo.type == CT_FUNCTION;
+    assert(!tail || (!temp && savefd == NULL));
+    if (tail && tailcall.allowed) {
+	tailcall.body = comsdup(cmdinfo.ci_function);
+	tailcall.args = xmallocn(argc, sizeof *tailcall.args);
+	memcpy(tailcall.args, &argv[1], argc * sizeof *tailcall.args);
+	argv[1] = NULL;
+	tailcall.status = laststatus;
+	laststatus = Exit_SUCCESS;
+	goto done1;
+    }
+
     /* execute! */
     wchar_t **namep = invoke_simple_command(&cmdinfo, argc, argv0, argv,
-	    finally_exit && /* !temp && */ savefd == NULL);
+	    finally_exit && !tail && /* !temp && */ savefd == NULL);
     if (namep != NULL)
 	*namep = command_to_wcs(c, false);
 
@@ -1006,7 +1138,10 @@ bool command_not_found_handler(void *const *argv)
 }
 
 /* Invokes the simple command. */
-/* `argv0' is the multibyte version of `argv[0]' */
+/* `argv0' is the multibyte version of `argv[0]'.
+ * If the command is a function, the strings in `argv' except `argv[0]' are
+ * moved to the positional parameters and `argv[1]' is set to NULL (see
+ * `exec_function_body'). */
 wchar_t **invoke_simple_command(
 	const commandinfo_T *ci, int argc, char *argv0, void **argv,
 	bool finally_exit)
@@ -1022,12 +1157,18 @@ wchar_t **invoke_simple_command(
 	break;
     case CT_EXTERNALPROGRAM:
 	if (!finally_exit) {
+#if HAVE_POSIX_SPAWN
+	    faw = spawn_and_wait(ci->ci_path, argc, argv0, argv);
+	    if (faw.cpid > 0)
+		break;
+#endif
 	    faw = fork_and_wait(t_leave);
 	    if (faw.cpid != 0)
 		break;
 	    finally_exit = true;
 	}
-	exec_external_program(ci->ci_path, argc, argv0, argv, environ);
+	exec_external_program(
+		ci->ci_path, argc, argv0, argv, flush_environment());
 	break;
     case CT_ELECTIVEBUILTIN:
 	if (posixly_correct) {
@@ -1070,13 +1211,7 @@ void exec_external_program(
 	const char *path, int argc, char *argv0, void **argv, char **envs)
 {
     char *mbsargv[argc + 1];
-    mbsargv[0] = argv0;
-    for (int i = 1; i < argc; i++) {
-	mbsargv[i] = malloc_wcstombs(argv[i]);
-	if (mbsargv[i] == NULL)
-	    mbsargv[i] = xstrdup("");
-    }
-    mbsargv[argc] = NULL;
+    convert_argv_to_mbs(argc, mbsargv, argv0, argv);
 
     restore_signals(true);
 
@@ -1101,6 +1236,103 @@ void exec_external_program(
 	free(mbsargv[i]);
 }
 
+/* Converts the wide-string arguments into a NULL-terminated array of
+ * multibyte strings, which are assigned to `mbsargv[0]'...`mbsargv[argc]'.
+ * `argv0' is used as `mbsargv[0]' without conversion. The other elements are
+ * newly malloced and must be freed by the caller. */
+void convert_argv_to_mbs(
+	int argc, char **restrict mbsargv, char *argv0, void *const *argv)
+{
+    mbsargv[0] = argv0;
+    for (int i = 1; i < argc; i++) {
+	mbsargv[i] = malloc_wcstombs(argv[i]);
+	if (mbsargv[i] == NULL)
+	    mbsargv[i] = xstrdup("");
+    }
+    mbsargv[argc] = NULL;
+}
+
+#if HAVE_POSIX_SPAWN
+
+/* Starts the external program by `posix_spawn' and waits for it to finish.
+ * This is a fast path for `fork_and_wait(t_leave)' followed by
+ * `exec_external_program' that avoids duplicating the whole shell process.
+ * The child only needs to reset signal handlers, set its process group and
+ * become the foreground if job control is active; redirections have already
+ * been opened in the shell process and the shell's own file descriptors are
+ * closed on exec.
+ * If the settings cannot be expressed by `posix_spawn' or the spawn fails for
+ * any reason, this function returns without doing anything and the `cpid'
+ * member of the result is zero. The caller should then fall back on `fork' so
+ * that the error is reported in the usual way (including `ENOEXEC', for which
+ * the program is executed by a new shell).
+ * Otherwise, the result is the same as that of `fork_and_wait' in the parent
+ * process. */
+fork_and_wait_T spawn_and_wait(
+	const char *path, int argc, char *argv0, void **argv)
+{
+    fork_and_wait_T result = { 0, NULL };
+
+#if !HAVE_POSIX_SPAWN_TCSETPGRP
+    if (doing_job_control_now)
+	return result;
+#endif
+
+    posix_spawnattr_t attr;
+    sigset_t defaults, mask;
+    if (!get_spawn_signal_settings(&defaults, &mask))
+	return result;
+    if (posix_spawnattr_init(&attr) != 0)
+	return result;
+
+    short flags = POSIX_SPAWN_SETSIGDEF | POSIX_SPAWN_SETSIGMASK;
+    posix_spawnattr_setsigdefault(&attr, &defaults);
+    posix_spawnattr_setsigmask(&attr, &mask);
+
+    posix_spawn_file_actions_t actions, *actionsp = NULL;
+#if HAVE_POSIX_SPAWN_TCSETPGRP
+    if (doing_job_control_now) {
+	flags |= POSIX_SPAWN_SETPGROUP;
+	posix_spawnattr_setpgroup(&attr, 0);
+	if (posix_spawn_file_actions_init(&actions) != 0)
+	    goto done1;
+	actionsp = &actions;
+	if (posix_spawn_file_actions_addtcsetpgrp_np(actionsp, ttyfd) != 0)
+	    goto done;
+    }
+#endif
+    posix_spawnattr_setflags(&attr, flags);
+
+    {
+	char *mbsargv[argc + 1];
+	convert_argv_to_mbs(argc, mbsargv, argv0, argv);
+
+	pid_t cpid;
+	int err = posix_spawn(
+		&cpid, path, actionsp, &attr, mbsargv, flush_environment());
+
+	for (int i = 1; i < argc; i++)
+	    free(mbsargv[i]);
+
+	if (err == 0) {
+	    result.cpid = cpid;
+	    result.namep = wait_for_child(cpid,
+		    doing_job_control_now ? cpid : 0, doing_job_control_now);
+	}
+    }
+
+#if HAVE_POSIX_SPAWN_TCSETPGRP
+done:
+    if (actionsp != NULL)
+	posix_spawn_file_actions_destroy(actionsp);
+done1:
+#endif
+    posix_spawnattr_destroy(&attr);
+    return result;
+}
+
+#endif /* HAVE_POSIX_SPAWN */
+
 /* Calls `execve' until it doesn't return EINTR. */
 int xexecve(const char *path, char *const *argv, char *const *envp)
 {
@@ -1152,20 +1384,32 @@ void exec_fall_back_on_sh(
 
 /* Executes the specified command as a function.
  * `args' are the arguments to the function, which are wide strings cast to
- * (void *).
+ * (void *). The strings are moved to the positional parameters rather than
+ * copied, and `args[0]' is set to NULL (see `move_positional_parameters').
  * If `complete' is true, `set_completion_variables' will be called after a new
- * variable environment was opened before the function body is executed. */
+ * variable environment was opened before the function body is executed.
+ * A function called in tail position of the body (see `mark_tail_calls') is
+ * executed in this stack frame after the body returns, so that tail-recursive
+ * functions do not exhaust the stack. The variable environment of the body is
+ * reused for the called function unless it has local variables, which must
+ * remain visible to the called function. */
 void exec_function_body(
-	command_T *body, void *const *args, bool finally_exit, bool complete)
+	command_T *body, void **args, bool finally_exit, bool complete)
 {
-    execstate_T *saveexecstate = save_execstate();
+    /* The state is saved in this stack frame rather than by `save_execstate'
+     * since a function call must not need to allocate memory for it. */
+    execstate_T saveexecstate = execstate;
     reset_execstate(false);
 
     bool saveser = suppresserrreturn;
     suppresserrreturn = false;
 
+    tailcall_T savetailcall = tailcall;
+    tailcall.allowed = !finally_exit;
+    tailcall.body = NULL;
+
     open_new_environment(false);
-    set_positional_parameters(args);
+    move_positional_parameters(args);
 #if YASH_ENABLE_LINEEDIT
     if (complete)
 	set_completion_variables();
@@ -1173,11 +1417,36 @@ void exec_function_body(
     (void) complete;
 #endif
     exec_commands(body, finally_exit ? E_SELF : E_NORMAL);
-    close_current_environment();
+
+    size_t envcount = 1;
+    while (tailcall.body != NULL) {
+	body = tailcall.body;
+	args = tailcall.args;
+	tailcall.body = NULL;
+
+	if (!need_break()) {
+	    if (has_local_variables()) {
+		open_new_environment(false);
+		envcount++;
+	    }
+	    move_positional_parameters(args);
+	    reset_execstate(false);
+	    suppresserrreturn = false;
+	    laststatus = tailcall.status;
+	    exec_commands(body, E_NORMAL);
+	}
+
+	plfree(args, free);
+	comsfree(body);
+    }
+    do
+	close_current_environment();
+    while (--envcount > 0);
 
     cancel_return();
+    tailcall = savetailcall;
     suppresserrreturn = saveser;
-    restore_execstate(saveexecstate);
+    execstate = saveexecstate;
 }
 
 /* Executes the specified command whose type is not `CT_SIMPLE'.
@@ -1332,7 +1601,7 @@ done:
 finish:
     execstate.loopnest--;
     if (finally_exit)
-	exit_shell();
+	exit_subshell_with_status(-1);
 }
 
 /* Executes the while/until command. */
@@ -1382,15 +1651,17 @@ void exec_case(const command_T *c, bool finally_exit)
     if (word == NULL)
 	goto fail;
 
-    for (const caseitem_T *ci = c->c_casitems; ci != NULL; ci = ci->next) {
-	for (void **pats = ci->ci_patterns; *pats != NULL; pats++) {
-	    wchar_t *pattern =
-		expand_single(*pats, TT_SINGLE, Q_WORD, ES_QUOTED);
-	    if (pattern == NULL)
+    for (caseitem_T *ci = c->c_casitems; ci != NULL; ci = ci->next) {
+	if (ci->ci_compiled == NULL)
+	    ci->ci_compiled = new_case_pattern_cache(ci->ci_patterns);
+
+	casepattern_T *cp = ci->ci_compiled;
+	for (void **pats = ci->ci_patterns; *pats != NULL; pats++, cp++) {
+	    if (!compile_case_pattern(*pats, cp))
 		goto fail;
 
-	    bool match = match_pattern(word, pattern);
-	    free(pattern);
+	    bool match = cp->cp_xfnm != NULL &&
+		xfnm_wmatch(cp->cp_xfnm, word).start != (size_t) -1;
 	    if (match) {
 		if (ci->ci_commands != NULL) {
 		    exec_and_or_lists(ci->ci_commands, finally_exit);
@@ -1415,6 +1686,64 @@ fail:
     goto done;
 }
 
+/* Allocates a new cache for the specified case patterns.
+ * `patterns' is a NULL-terminated array of pointers to `wordunit_T's. */
+casepattern_T *new_case_pattern_cache(void *const *patterns)
+{
+    size_t count = plcount(patterns);
+    casepattern_T *cps = xmallocn(count, sizeof *cps);
+    for (size_t i = 0; i < count; i++) {
+	cps[i] = (casepattern_T) {
+	    .cp_text = NULL,
+	    .cp_xfnm = NULL,
+	    .cp_generation = 0,
+	    .cp_constant = is_constant_pattern(patterns[i]),
+	};
+    }
+    return cps;
+}
+
+/* Returns true if the expansion of the specified case pattern always yields
+ * the same result, that is, the pattern contains no parameter expansion,
+ * command substitution, arithmetic expansion, or tilde expansion. */
+bool is_constant_pattern(const wordunit_T *w)
+{
+    if (w != NULL && w->wu_type == WT_STRING && w->wu_string[0] == L'~')
+	return false;
+    for (; w != NULL; w = w->next)
+	if (w->wu_type != WT_STRING)
+	    return false;
+    return true;
+}
+
+/* Expands case pattern `w' and compiles it into `cp'.
+ * The pattern is not expanded again if it is constant, and not compiled again
+ * if the expansion result is the same as the last one and the locale has not
+ * been changed since the last compilation.
+ * Returns false if the expansion failed. */
+bool compile_case_pattern(const wordunit_T *w, casepattern_T *cp)
+{
+    if (!cp->cp_constant || cp->cp_text == NULL) {
+	wchar_t *pattern = expand_single(w, TT_SINGLE, Q_WORD, ES_QUOTED);
+	if (pattern == NULL)
+	    return false;
+	if (cp->cp_text == NULL || wcscmp(pattern, cp->cp_text) != 0) {
+	    free(cp->cp_text);
+	    cp->cp_text = pattern;
+	    goto compile;
+	}
+	free(pattern);
+    }
+    if (cp->cp_generation == xfnm_locale_generation)
+	return true;
+
+compile:
+    xfnm_free(cp->cp_xfnm);
+    cp->cp_xfnm = xfnm_compile(cp->cp_text, XFNM_HEADONLY | XFNM_TAILONLY);
+    cp->cp_generation = xfnm_locale_generation;
+    return true;
+}
+
 /* Executes the function definition. */
 void exec_funcdef(const command_T *c, bool finally_exit)
 {
@@ -1423,6 +1752,7 @@ void exec_funcdef(const command_T *c, bool finally_exit)
     wchar_t *funcname =
 	expand_single(c->c_funcname, TT_SINGLE, Q_WORD, ES_NONE);
     if (funcname != NULL) {
+	mark_tail_calls(c->c_funcbody);
 	if (define_function(funcname, c->c_funcbody))
 	    laststatus = Exit_SUCCESS;
 	else
@@ -1436,6 +1766,53 @@ void exec_funcdef(const command_T *c, bool finally_exit)
 	exit_shell();
 }
 
+/* Marks the simple commands in tail position of the specified function body,
+ * that is, the commands after which the function returns without undoing
+ * redirections, examining the exit status, or executing anything else. The
+ * functions called by the marked commands are executed by
+ * `exec_function_body'. */
+void mark_tail_calls(command_T *c)
+{
+    if (c->next != NULL || c->c_redirs != NULL)
+	return;
+
+    switch (c->c_type) {
+	case CT_SIMPLE:
+	    c->c_tailcall = (c->c_assigns == NULL);
+	    break;
+	case CT_GROUP:
+	    mark_tail_calls_in_and_or(c->c_subcmds);
+	    break;
+	case CT_IF:
+	    for (ifcommand_T *ic = c->c_ifcmds; ic != NULL; ic = ic->next)
+		mark_tail_calls_in_and_or(ic->ic_commands);
+	    break;
+	case CT_CASE:
+	    for (caseitem_T *ci = c->c_casitems; ci != NULL; ci = ci->next)
+		mark_tail_calls_in_and_or(ci->ci_commands);
+	    break;
+	default:
+	    break;
+    }
+}
+
+/* Marks the commands in tail position of the specified and-or lists. */
+void mark_tail_calls_in_and_or(and_or_T *a)
+{
+    if (a == NULL)
+	return;
+    while (a->next != NULL)
+	a = a->next;
+    if (a->ao_async)
+	return;
+
+    pipeline_T *p = a->ao_pipelines;
+    while (p->next != NULL)
+	p = p->next;
+    if (!p->pl_neg)
+	mark_tail_calls(p->pl_commands);
+}
+
 /* Forks a new child process and wait for it to finish.
  * `sigtype' is passed to `fork_and_reset'.
  * In the parent process, this function updates `laststatus' to the exit status
@@ -1543,10 +1920,19 @@ void become_child(sigtype_T sigtype)
 	    ignore_sigtstp();
 
     restore_signals(sigtype & t_leave);  /* signal mask is restored here */
+#if HAVE_TEE
+    close_peek_pipe();
+#endif
     clear_shellfds(sigtype & t_leave);
     is_interactive_now = false;
     suppresserrreturn = false;
     exitstatus = -1;
+
+    /* The child is a real subshell even if forked from a command substitution
+     * executed in the shell process. */
+    executing_cmdsub_in_shell = false;
+    cmdsub_memfd = -1;
+    defer_traps(false);
 }
 
 /* Executes the command substitution and returns the string to substitute with.
@@ -1557,12 +1943,19 @@ wchar_t *exec_command_substitution(const embedcmd_T *cmdsub)
 {
     int pipefd[2];
     pid_t cpid;
+    xstrbuf_T mbsbuf;
 
     if (cmdsub->is_preparsed
 	    ? cmdsub->value.preparsed == NULL
 	    : cmdsub->value.unparsed[0] == L'\0')  /* empty command */
 	return xwcsdup(L"");
 
+    /* If the command consists only of built-ins and functions, execute it
+     * without forking. */
+    if (cmdsub->is_preparsed)
+	if (exec_cmdsub_in_shell_process(cmdsub->value.preparsed, &mbsbuf))
+	    return convert_cmdsub_output(&mbsbuf);
+
     /* open a pipe to receive output from the command */
     if (pipe(pipefd) < 0) {
 	xerror(errno, Ngt("cannot open a pipe for the command substitution"));
@@ -1581,25 +1974,11 @@ wchar_t *exec_command_substitution(const embedcmd_T *cmdsub)
 	return NULL;
     } else if (cpid > 0) {
 	/* parent process */
-	FILE *f;
-
 	xclose(pipefd[PIPE_OUT]);
-	f = fdopen(pipefd[PIPE_IN], "r");
-	if (f == NULL) {
-	    xerror(errno,
-		    Ngt("cannot open a pipe for the command substitution"));
-	    xclose(pipefd[PIPE_IN]);
-	    lastcmdsubstatus = Exit_NOEXEC;
-	    return NULL;
-	}
 
 	/* read output from the command */
-	xwcsbuf_T buf;
-	wint_t c;
-	wb_init(&buf);
-	while ((c = fgetwc(f)) != WEOF)
-	    wb_wccat(&buf, c);
-	fclose(f);
+	read_all_from_fd(pipefd[PIPE_IN], &mbsbuf);
+	xclose(pipefd[PIPE_IN]);
 
 	/* wait for the child to finish */
 	int savelaststatus = laststatus;
@@ -1607,11 +1986,7 @@ wchar_t *exec_command_substitution(const embedcmd_T *cmdsub)
 	lastcmdsubstatus = laststatus;
 	laststatus = savelaststatus;
 
-	/* trim trailing newlines and return */
-	size_t len = buf.length;
-	while (len > 0 && buf.contents[len - 1] == L'\n')
-	    len--;
-	return wb_towcs(wb_truncate(&buf, len));
+	return convert_cmdsub_output(&mbsbuf);
     } else {
 	/* child process */
 	xclose(pipefd[PIPE_IN]);
@@ -1629,6 +2004,497 @@ wchar_t *exec_command_substitution(const embedcmd_T *cmdsub)
     }
 }
 
+/* Converts the output of a command substitution to a wide string and removes
+ * trailing newlines. `mbsbuf' is destroyed in this function.
+ * The conversion stops at an invalid byte sequence, if any. */
+wchar_t *convert_cmdsub_output(xstrbuf_T *mbsbuf)
+{
+    xwcsbuf_T buf;
+    wb_initwithmax(&buf, mbsbuf->length);
+    wb_mbsncat(&buf, mbsbuf->contents, mbsbuf->length);
+    sb_destroy(mbsbuf);
+
+    size_t len = buf.length;
+    while (len > 0 && buf.contents[len - 1] == L'\n')
+	len--;
+    return wb_towcs(wb_truncate(&buf, len));
+}
+
+/* Reads all the data from the specified file descriptor until EOF and assigns
+ * it to `buf', which is initialized in this function. The buffer grows
+ * geometrically so that large output can be read by a small number of `read'
+ * calls. If a read error occurs, the data read so far is left in the buffer. */
+void read_all_from_fd(int fd, xstrbuf_T *buf)
+{
+    sb_initwithmax(buf, CMDSUB_READ_SIZE);
+    for (;;) {
+	sb_ensuremax(buf, add(buf->length, CMDSUB_READ_SIZE));
+
+	ssize_t count = read(fd, &buf->contents[buf->length],
+		buf->maxlength - buf->length);
+	if (count < 0) {
+	    if (errno == EINTR)
+		continue;
+	    break;
+	}
+	if (count == 0)
+	    break;
+	buf->length += (size_t) count;
+    }
+    buf->contents[buf->length] = '\0';
+}
+
+/* Executes the commands of a command substitution in the shell process, that
+ * is, without forking a subshell. This is possible only if the commands
+ * consist of built-ins and functions that do not affect the shell state other
+ * than variables (see `is_self_executable_and_or').
+ * The standard output of the commands is redirected to a memory file. The
+ * variables, `execstate' and other state of the shell are saved before the
+ * execution and restored afterwards, and trap actions are deferred until
+ * the commands finish, so that the commands behave as if executed in a
+ * subshell.
+ * If the commands cannot be executed in the shell process, this function
+ * returns false without executing anything. Otherwise, the output of the
+ * commands is assigned to `*output', which is initialized in this function,
+ * `lastcmdsubstatus' is updated, and true is returned. */
+bool exec_cmdsub_in_shell_process(const and_or_T *commands, xstrbuf_T *output)
+{
+    selfcheck_T sc;
+    pl_init(&sc.functions);
+    sc.modifies_variables = false;
+    sc.reads_random = false;
+    bool ok = is_self_executable_and_or(commands, &sc);
+    pl_destroy(&sc.functions);
+    /* Expanding $RANDOM advances the random number generator, whose state
+     * cannot be saved and restored. */
+    if (!ok || sc.reads_random)
+	return false;
+
+    int fd = open_cmdsub_memfd();
+    if (fd < 0)
+	return false;
+
+    fflush(stdout);
+    savefd_T *savefd;
+    if (!redirect_stdout(fd, &savefd)) {
+	undo_redirections(savefd);
+	close_cmdsub_memfd(fd);
+	return false;
+    }
+
+    /* save the state and make it look like a subshell */
+    struct varsave_T *varsave =
+	sc.modifies_variables ? save_variables() : NULL;
+    execstate_T *saveexecstate = save_execstate();
+    reset_execstate(true);
+    exception_T saveexception = exception;
+    int savelaststatus = laststatus, saveexitstatus = exitstatus;
+    unsigned long savelineno = get_lineno();
+    bool saveinteractive = is_interactive_now;
+    bool savesee = suppresserrexit, saveser = suppresserrreturn;
+    bool savesbe = special_builtin_executed;
+    bool saveself = executing_cmdsub_in_shell;
+    bool savedefer = defer_traps(true);
+    xwcsbuf_T savextrace = xtrace_buffer;
+    xtrace_buffer.contents = NULL;
+    is_interactive_now = false;
+    suppresserrreturn = false;
+    exitstatus = -1;
+    executing_cmdsub_in_shell = true;
+
+    exec_and_or_lists(commands, false);
+    int status = (exception == E_EXIT) ? cmdsub_exit_status : laststatus;
+    fflush(stdout);
+
+    /* restore the state */
+    if (xtrace_buffer.contents != NULL)
+	wb_destroy(&xtrace_buffer);
+    xtrace_buffer = savextrace;
+    defer_traps(savedefer);
+    executing_cmdsub_in_shell = saveself;
+    special_builtin_executed = savesbe;
+    suppresserrexit = savesee, suppresserrreturn = saveser;
+    is_interactive_now = saveinteractive;
+    exitstatus = saveexitstatus;
+    laststatus = savelaststatus;
+    exception = saveexception;
+    restore_execstate(saveexecstate);
+    if (varsave != NULL)
+	restore_variables(varsave);
+    update_lineno(savelineno);
+    undo_redirections(savefd);
+
+    /* read the output from the memory file */
+    if (lseek(fd, 0, SEEK_SET) == 0)
+	read_all_from_fd(fd, output);
+    else
+	sb_init(output);
+    close_cmdsub_memfd(fd);
+
+    lastcmdsubstatus = status;
+    return true;
+}
+
+/* Returns a file descriptor for an empty memory file that receives the output
+ * of a command substitution executed in the shell process.
+ * The file descriptor is a shell FD and should be passed to
+ * `close_cmdsub_memfd' after use. Returns -1 if no memory file is
+ * available, in which case the command substitution should fork. A file in a
+ * file system is not used because creating one may fail for reasons that have
+ * nothing to do with the command substitution. */
+int open_cmdsub_memfd(void)
+{
+#if HAVE_MEMFD_CREATE
+    int fd = cmdsub_memfd;
+    if (fd >= 0) {
+	cmdsub_memfd = -1;
+	return fd;
+    }
+
+    fd = memfd_create("yash-cmdsub", 0);
+    if (fd < 0)
+	return -1;
+    return move_to_shellfd(fd);
+#else
+    return -1;
+#endif
+}
+
+/* Empties the memory file and keeps it for reuse or closes it. */
+void close_cmdsub_memfd(int fd)
+{
+    if (cmdsub_memfd < 0
+	    && ftruncate(fd, 0) == 0 && lseek(fd, 0, SEEK_SET) == 0) {
+	cmdsub_memfd = fd;
+    } else {
+	remove_shellfd(fd);
+	xclose(fd);
+    }
+}
+
+/* Checks if the specified and-or lists can be executed in the shell process
+ * in place of a subshell. They can if every command in them is one of:
+ *  - a simple command that invokes a built-in that only prints something or
+ *    modifies variables, or a function whose body can be executed as well,
+ *  - a grouping, if, for, while/until, case or double-bracket command whose
+ *    contents can be executed as well.
+ * External commands, asynchronous lists, pipelines, subshells, function
+ * definitions, and built-ins that may affect the state of the shell other
+ * than variables (e.g., "exec", "cd", "set", "trap", "eval" and the job
+ * control built-ins) cannot be executed in the shell process.
+ * If the commands may modify variables, `sc->modifies_variables' is set to
+ * true. If they may expand $RANDOM, `sc->reads_random' is set to true. */
+bool is_self_executable_and_or(const and_or_T *a, selfcheck_T *sc)
+{
+    for (; a != NULL; a = a->next) {
+	if (a->ao_async)
+	    return false;
+	for (const pipeline_T *p = a->ao_pipelines; p != NULL; p = p->next) {
+	    if (p->pl_commands->next != NULL)
+		return false;
+	    if (!is_self_executable_command(p->pl_commands, sc))
+		return false;
+	}
+    }
+    return true;
+}
+
+/* Checks if the specified command can be executed in the shell process.
+ * See `is_self_executable_and_or'. */
+bool is_self_executable_command(const command_T *c, selfcheck_T *sc)
+{
+    if (!is_self_executable_redirs(c->c_redirs, sc))
+	return false;
+
+    switch (c->c_type) {
+    case CT_SIMPLE:
+	return is_self_executable_simple_command(c, sc);
+    case CT_GROUP:
+	return is_self_executable_and_or(c->c_subcmds, sc);
+    case CT_IF:
+	for (const ifcommand_T *ic = c->c_ifcmds; ic != NULL; ic = ic->next)
+	    if (!is_self_executable_and_or(ic->ic_condition, sc)
+		    || !is_self_executable_and_or(ic->ic_commands, sc))
+		return false;
+	return true;
+    case CT_FOR:
+	sc->modifies_variables = true;
+	if (c->c_forwords != NULL)
+	    check_words_side_effects(c->c_forwords, sc);
+	return is_self_executable_and_or(c->c_forcmds, sc);
+    case CT_WHILE:
+	return is_self_executable_and_or(c->c_whlcond, sc)
+	    && is_self_executable_and_or(c->c_whlcmds, sc);
+    case CT_CASE:
+	check_word_side_effects(c->c_casword, sc);
+	for (const caseitem_T *ci = c->c_casitems; ci != NULL; ci = ci->next) {
+	    check_words_side_effects(ci->ci_patterns, sc);
+	    if (!is_self_executable_and_or(ci->ci_commands, sc))
+		return false;
+	}
+	return true;
+#if YASH_ENABLE_DOUBLE_BRACKET
+    case CT_BRACKET:
+	check_dbexp_side_effects(c->c_dbexp, sc);
+	return true;
+#endif
+    case CT_SUBSHELL:
+    case CT_FUNCDEF:
+	return false;
+    }
+    assert(false);
+}
+
+/* Checks if the specified simple command can be executed in the shell process.
+ * See `is_self_executable_and_or'. */
+bool is_self_executable_simple_command(const command_T *c, selfcheck_T *sc)
+{
+    assert(c->c_type == CT_SIMPLE);
+
+    for (const assign_T *a = c->c_assigns; a != NULL; a = a->next) {
+	sc->modifies_variables = true;
+	switch (a->a_type) {
+	    case A_SCALAR:
+		check_word_side_effects(a->a_scalar, sc);
+		break;
+	    case A_ARRAY:
+		check_words_side_effects(a->a_array, sc);
+		break;
+	}
+    }
+
+    /* Redirections without a command word are performed in a subshell. */
+    if (c->c_words[0] == NULL)
+	return c->c_redirs == NULL;
+
+    check_words_side_effects(c->c_words, sc);
+
+    /* We must know which command is invoked before executing it, so the
+     * command name must be a literal. */
+    const wordunit_T *w = c->c_words[0];
+    if (w->next != NULL || w->wu_type != WT_STRING
+	    || !is_literal_command_name(w->wu_string))
+	return false;
+
+    char *name = malloc_wcstombs(w->wu_string);
+    if (name == NULL)
+	return false;
+    commandinfo_T ci;
+    search_command(name, w->wu_string, &ci,
+	    SCT_EXTERNAL | SCT_BUILTIN | SCT_FUNCTION);
+    free(name);
+
+    switch (ci.type) {
+	case CT_SPECIALBUILTIN:
+	case CT_MANDATORYBUILTIN:
+	case CT_ELECTIVEBUILTIN:
+	case CT_EXTENSIONBUILTIN:
+	case CT_SUBSTITUTIVEBUILTIN:
+	    return is_self_executable_builtin(
+		    w->wu_string, c->c_words[1], sc);
+	case CT_FUNCTION:
+	    /* Functions cannot be redefined in the shell process, so the body
+	     * checked now is the one that is executed. */
+	    for (size_t i = 0; i < sc->functions.length; i++)
+		if (sc->functions.contents[i] == ci.ci_function)
+		    return true;
+	    pl_add(&sc->functions, ci.ci_function);
+	    return is_self_executable_command(ci.ci_function, sc);
+	case CT_NONE:
+	case CT_EXTERNALPROGRAM:
+	    return false;
+    }
+    assert(false);
+}
+
+/* Checks if the built-in of the specified name can be executed in the shell
+ * process. `arg1' is the first argument word of the built-in or NULL. */
+bool is_self_executable_builtin(
+	const wchar_t *name, const wordunit_T *arg1, selfcheck_T *sc)
+{
+    static const wchar_t *const output_only_builtins[] = {
+	L":", L"[", L"break", L"continue", L"echo", L"false", L"printf",
+	L"pwd", L"return", L"test", L"true", L"type", NULL,
+    };
+
+    for (const wchar_t *const *b = output_only_builtins; *b != NULL; b++)
+	if (wcscmp(name, *b) == 0)
+	    return true;
+
+    if (wcscmp(name, L"local") == 0 || wcscmp(name, L"shift") == 0) {
+	sc->modifies_variables = true;
+	return true;
+    }
+
+    /* "command -v" and "command -V" only print info about commands. */
+    if (wcscmp(name, L"command") == 0)
+	return arg1 != NULL && arg1->next == NULL
+	    && arg1->wu_type == WT_STRING
+	    && (wcscmp(arg1->wu_string, L"-v") == 0
+		    || wcscmp(arg1->wu_string, L"-V") == 0);
+
+    return false;
+}
+
+/* Checks if the specified redirections can be performed in the shell process.
+ * Redirections that start another process cannot. */
+bool is_self_executable_redirs(const redir_T *r, selfcheck_T *sc)
+{
+    for (; r != NULL; r = r->next) {
+	switch (r->rd_type) {
+	    case RT_PIPE:
+	    case RT_PROCIN:
+	    case RT_PROCOUT:
+		return false;
+	    case RT_HERE:
+	    case RT_HERERT:
+		check_word_side_effects(r->rd_herecontent, sc);
+		break;
+	    default:
+		check_word_side_effects(r->rd_filename, sc);
+		break;
+	}
+    }
+    return true;
+}
+
+/* Checks if the specified string is a command name that is not changed by
+ * the word expansion. */
+bool is_literal_command_name(const wchar_t *s)
+{
+    if (wcscmp(s, L"[") == 0)
+	return true;
+    if (*s == L'\0')
+	return false;
+    for (; *s != L'\0'; s++) {
+	if (L'a' <= *s && *s <= L'z')
+	    continue;
+	if (L'A' <= *s && *s <= L'Z')
+	    continue;
+	if (L'0' <= *s && *s <= L'9')
+	    continue;
+	if (wcschr(L"_-.:", *s) == NULL)
+	    return false;
+    }
+    return true;
+}
+
+/* Sets `sc->modifies_variables' to true if the expansion of any of the
+ * specified words may assign a variable, and `sc->reads_random' to true if it
+ * may expand $RANDOM. */
+void check_words_side_effects(void *const *words, selfcheck_T *sc)
+{
+    for (; *words != NULL; words++)
+	check_word_side_effects(*words, sc);
+}
+
+/* Sets `sc->modifies_variables' to true if the expansion of the specified
+ * word may assign a variable, and `sc->reads_random' to true if it may expand
+ * $RANDOM. Command substitutions in the word are not
+ * checked because they are executed in (real or pretended) subshells. */
+void check_word_side_effects(const wordunit_T *w, selfcheck_T *sc)
+{
+    for (; w != NULL; w = w->next) {
+	switch (w->wu_type) {
+	    case WT_STRING:
+	    case WT_CMDSUB:
+		break;
+	    case WT_PARAM:;
+		const paramexp_T *p = w->wu_param;
+		if ((p->pe_type & PT_MASK) == PT_ASSIGN)
+		    sc->modifies_variables = true;
+		if (p->pe_type & PT_NEST)
+		    check_word_side_effects(p->pe_nest, sc);
+		else if (wcscmp(p->pe_name, L VAR_RANDOM) == 0)
+		    sc->reads_random = true;
+		check_arith_side_effects(p->pe_start, sc);
+		check_arith_side_effects(p->pe_end, sc);
+		check_word_side_effects(p->pe_match, sc);
+		check_word_side_effects(p->pe_subst, sc);
+		break;
+	    case WT_ARITH:
+		check_arith_side_effects(w->wu_arith, sc);
+		break;
+	}
+    }
+}
+
+/* Sets `sc->modifies_variables' to true if the arithmetic evaluation of the
+ * specified word may assign a variable, that is, if the word contains an
+ * assignment or increment/decrement operator or an expansion whose result may
+ * contain one. Sets `sc->reads_random' to true if the evaluation may expand
+ * $RANDOM, that is, if the word contains the name or an expansion. */
+void check_arith_side_effects(const wordunit_T *w, selfcheck_T *sc)
+{
+    for (; w != NULL; w = w->next) {
+	if (w->wu_type != WT_STRING) {
+	    sc->modifies_variables = true;
+	    sc->reads_random = true;
+	    return;
+	}
+
+	const wchar_t *s = w->wu_string;
+	if (contains_name(s, L VAR_RANDOM))
+	    sc->reads_random = true;
+	if (wcsstr(s, L"++") != NULL || wcsstr(s, L"--") != NULL) {
+	    sc->modifies_variables = true;
+	    continue;
+	}
+	for (size_t i = 0; s[i] != L'\0'; i++) {
+	    if (s[i] != L'=')
+		continue;
+	    if (s[i + 1] == L'=') {  /* "==" */
+		i++;
+		continue;
+	    }
+	    if (i > 0 && s[i - 1] == L'!')  /* "!=" */
+		continue;
+	    if (i > 0 && (s[i - 1] == L'<' || s[i - 1] == L'>')
+		    && !(i > 1 && s[i - 2] == s[i - 1]))  /* "<=" or ">=" */
+		continue;
+	    sc->modifies_variables = true;
+	    break;
+	}
+    }
+}
+
+/* Returns true iff the string contains the specified name as a whole word,
+ * that is, not as part of a longer name. */
+bool contains_name(const wchar_t *s, const wchar_t *name)
+{
+    size_t len = wcslen(name);
+    for (const wchar_t *p = s; (p = wcsstr(p, name)) != NULL; p++)
+	if ((p == s || !is_name_char(p[-1])) && !is_name_char(p[len]))
+	    return true;
+    return false;
+}
+
+#if YASH_ENABLE_DOUBLE_BRACKET
+
+/* Sets `sc->modifies_variables' to true if the expansion of any of the words
+ * in the specified double-bracket expression may assign a variable. */
+void check_dbexp_side_effects(const dbexp_T *e, selfcheck_T *sc)
+{
+    switch (e->type) {
+	case DBE_OR:
+	case DBE_AND:
+	    check_dbexp_side_effects(e->lhs.subexp, sc);
+	    /* falls thru! */
+	case DBE_NOT:
+	    check_dbexp_side_effects(e->rhs.subexp, sc);
+	    break;
+	case DBE_BINARY:
+	    check_word_side_effects(e->lhs.word, sc);
+	    /* falls thru! */
+	case DBE_UNARY:
+	case DBE_STRING:
+	    check_word_side_effects(e->rhs.word, sc);
+	    break;
+    }
+}
+
+#endif /* YASH_ENABLE_DOUBLE_BRACKET */
+
 /* Executes the value of the specified variable.
  * The variable value is parsed as commands.
  * If the `varname' names an array, every element of the array is executed (but
@@ -1755,7 +2621,7 @@ bool autoload_completion_function_file(
     set_positional_parameters((void *[]) { (void *) cmdname, NULL });
 
     le_compdebug("executing file \"%s\" (autoload)", path);
-    exec_input(fd, mbsfilename, 0);
+    exec_input(fd, mbsfilename, XIO_CACHE);
     le_compdebug("finished executing file \"%s\"", path);
 
     close_current_environment();
@@ -1876,6 +2742,8 @@ int return_builtin(int argc, void **argv)
     } else {
 	status = (savelaststatus >= 0) ? savelaststatus : laststatus;
     }
+    if (exception == E_EXIT)  /* aborted by `special_builtin_error' */
+	return status;
     if (!noreturn) {
 	if (execstate.noreturn && is_interactive_now) {
 	    xerror(0, Ngt("cannot be used in the interactive mode"));
@@ -2123,7 +2991,8 @@ int dot_builtin(int argc, void **argv)
     bool saveser = suppresserrreturn;
     suppresserrreturn = false;
 
-    exec_input(fd, mbsfilename, enable_alias ? XIO_SUBST_ALIAS : 0);
+    exec_input(fd, mbsfilename,
+	    (enable_alias ? XIO_SUBST_ALIAS : 0) | XIO_CACHE);
 
     cancel_return();
     suppresserrreturn = saveser;
@@ -2269,7 +3138,7 @@ int exec_builtin_2(int argc, void **argv, const wchar_t *as, bool clear)
 	}
 	envs = (char **) pl_toary(&list);
     } else {
-	envs = environ;
+	envs = flush_environment();
     }
 
     exec_external_program(commandpath, argc, mbsargv0, argv, envs);
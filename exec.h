@@ -56,6 +56,7 @@ extern void disable_return(void);
 extern void cancel_return(void);
 extern _Bool need_break(void)
     __attribute__((pure));
+extern void exit_subshell_with_status(int status);
 
 struct and_or_T;
 struct embedcmd_T;
@@ -63,6 +63,8 @@ static inline void fill_ccbuf(
 	charcategory_T c)
     __attribute__((nonnull));
 
+static bool is_literal_word(const wordunit_T *w)
+    __attribute__((pure));
 static wchar_t *expand_tilde(const wchar_t **ss,
 	bool hasnextwordunit, tildetype_T tt)
     __attribute__((nonnull,malloc,warn_unused_result));
@@ -543,7 +545,7 @@ default_:
 	case WT_ARITH:
 	    s = expand_single(w->wu_arith, TT_NONE, Q_INDQ, ES_NONE);
 	    if (s != NULL)
-		s = evaluate_arithmetic(s);
+		s = evaluate_arithmetic(s, is_literal_word(w->wu_arith));
 cat_s:
 	    if (s == NULL)
 		goto failure;
@@ -574,6 +576,18 @@ failure:
     return e;
 }
 
+/* Returns true if the specified word contains no parameter expansion, command
+ * substitution, or arithmetic expansion. A leading tilde is not checked, so the
+ * word expands to the same string every time only if it is not subject to
+ * tilde expansion. */
+bool is_literal_word(const wordunit_T *w)
+{
+    for (; w != NULL; w = w->next)
+	if (w->wu_type != WT_STRING)
+	    return false;
+    return true;
+}
+
 /* Appends to `e->ccbuf' as many `c's as needed to match the length with
  * `e->valuebuf'. */
 void fill_ccbuf(const xwcsbuf_T *restrict valuebuf, xstrbuf_T *restrict ccbuf,
@@ -657,13 +671,24 @@ struct expand_four_T expand_param(const paramexp_T *p, bool indq)
     /* parse indices first */
     ssize_t startindex, endindex;
     enum indextype_T indextype;
+    wchar_t *assockey = NULL;  /* key of an associative array element */
     if (p->pe_start == NULL) {
 	startindex = 0, endindex = SSIZE_MAX, indextype = IDX_NONE;
     } else {
 	wchar_t *start = expand_single(p->pe_start, TT_NONE, Q_WORD, ES_NONE);
 	if (start == NULL)
 	    goto failure1;
-	indextype = parse_indextype(start);
+	bool assoc = !(p->pe_type & PT_NEST) && p->pe_symbol != NULL
+	    && is_associative_array(p->pe_symbol);
+	/* For an associative array, "@", "*" and "#" resulting from an
+	 * expansion are keys. */
+	if (!assoc)
+	    indextype = parse_indextype(start);
+	else if (p->pe_start->next == NULL
+		&& p->pe_start->wu_type == WT_STRING)
+	    indextype = parse_indextype(p->pe_start->wu_string);
+	else
+	    indextype = IDX_NONE;
 	if (indextype != IDX_NONE) {
 	    startindex = 0, endindex = SSIZE_MAX;
 	    free(start);
@@ -671,7 +696,17 @@ struct expand_four_T expand_param(const paramexp_T *p, bool indq)
 		xerror(0, Ngt("the parameter index is invalid"));
 		goto failure1;
 	    }
-	} else if (!evaluate_index(start, &startindex)) {
+	} else if (assoc) {
+	    /* the index is a key rather than an arithmetic expression */
+	    if (p->pe_end != NULL) {
+		free(start);
+		xerror(0, Ngt("the parameter index is invalid"));
+		goto failure1;
+	    }
+	    startindex = 0, endindex = SSIZE_MAX;
+	    assockey = start;
+	} else if (!evaluate_index(start, is_literal_word(p->pe_start),
+		    &startindex)) {
 	    goto failure1;
 	} else {
 	    if (p->pe_end == NULL) {
@@ -679,7 +714,8 @@ struct expand_four_T expand_param(const paramexp_T *p, bool indq)
 	    } else {
 		wchar_t *end = expand_single(
 			p->pe_end, TT_NONE, Q_WORD, ES_NONE);
-		if (end == NULL || !evaluate_index(end, &endindex))
+		if (end == NULL || !evaluate_index(end,
+			    is_literal_word(p->pe_end), &endindex))
 		    goto failure1;
 	    }
 	    if (startindex == 0)
@@ -705,7 +741,12 @@ struct expand_four_T expand_param(const paramexp_T *p, bool indq)
 	v.freevalues = true;
 	unset = false;
     } else {
-	v = get_variable(p->pe_name);
+	if (assockey != NULL)
+	    v = get_assoc_element(p->pe_symbol, assockey);
+	else if (p->pe_symbol != NULL)
+	    v = get_variable_sym(p->pe_symbol);
+	else
+	    v = get_variable(p->pe_name);
 	if (v.type == GV_NOTFOUND) {
 	    /* if the variable is not set, return empty string */
 	    v.type = GV_SCALAR;
@@ -811,6 +852,7 @@ treat_array:
 	if (unset) {
 subst:
 	    plfree(values, free);
+	    free(assockey);
 	    return expand_four(p->pe_subst, TT_SINGLE, substq,
 		    CC_SOFT_EXPANSION | (indq * CC_QUOTED));
 	}
@@ -837,7 +879,12 @@ subst:
 	    subst = expand_single(p->pe_subst, TT_SINGLE, substq, ES_NONE);
 	    if (subst == NULL)
 		goto failure1;
-	    if (v.type != GV_ARRAY) {
+	    if (assockey != NULL) {
+		if (!set_assoc_element(p->pe_name, assockey, xwcsdup(subst))) {
+		    free(subst);
+		    goto failure1;
+		}
+	    } else if (v.type != GV_ARRAY) {
 		assert(v.type == GV_NOTFOUND || v.type == GV_SCALAR);
 		if (!set_variable(
 			    p->pe_name, xwcsdup(subst), SCOPE_GLOBAL, false)) {
@@ -864,6 +911,8 @@ subst:
 	}
 	break;
     }
+    free(assockey);
+    assockey = NULL;
 
     if (unset && !shopt_unset) {
 	xerror(0, Ngt("parameter `%ls' is not set"), p->pe_name);
@@ -931,6 +980,7 @@ subst:
 failure2:
     plfree(values, free);
 failure1:
+    free(assockey);
     e.valuelist.contents = e.cclist.contents = NULL;
     return e;
 }
@@ -1993,11 +2043,12 @@ wchar_t *parse_and_expand_string(const wchar_t *s, const char *name, bool esc)
 }
 
 /* This function is called when an expansion error occurred.
- * The shell exits if it is non-interactive. */
+ * The shell exits if it is non-interactive. (A command substitution executed
+ * in the shell process is aborted instead. See `exit_subshell_with_status'.) */
 void maybe_exit_on_error(void)
 {
     if (shell_initialized && !is_interactive_now)
-	exit_shell_with_status(Exit_EXPERROR);
+	exit_subshell_with_status(Exit_EXPERROR);
 }
 
 
@@ -28,35 +28,41 @@
 /* A hashtable is a mapping from keys to values.
  * Keys and values are all of type (void *).
  * NULL is allowed as a value, but not as a key.
- * The capacity of a hashtable is always no less than one. */
+ * The capacity of an initialized hashtable is always a power of two no less
+ * than GROUP_WIDTH. */
 
 /* The hashtable_T structure is defined as follows:
  *   struct hashtable_T {
- *      size_t             capacity;
- *      size_t             count;
- *      hashfunc_T        *hashfunc;
- *      keycmp             keycmp;
- *      size_t             emptyindex;
- *      size_t             tailindex;
- *      size_t            *indices;
- *      struct hash_entry *entries;
+ *      size_t         capacity;
+ *      size_t         count;
+ *      hashfunc_T    *hashfunc;
+ *      keycmp         keycmp;
+ *      size_t         deleted;
+ *      unsigned char *control;
+ *      kvpair_T      *entries;
  *   }
- * `capacity' is the size of array `entries'.
+ * `capacity' is the number of slots in array `entries'.
  * `count' is the number of entries contained in the hashtable.
  * `hashfunc' is a pointer to the hash function.
  * `keycmp' is a pointer to the function that compares keys.
- * `emptyindex' is the index of the first empty entry.
- * `tailindex' is the index of the first tail entry.
- * `indices' is a pointer to the bucket array.
- * `entries' is a pointer to the array of entries.
+ * `deleted' is the number of slots marked CTRL_DELETED.
+ * `control' is a pointer to the array of control bytes.
+ * `entries' is a pointer to the array of slots. The `control' array is
+ * allocated in the same memory block, just after the slots.
  *
- * The collision resolution strategy used in this implementation is a kind of
- * separate chaining, but it differs from normal chaining in that entries are
- * stored in a single array (`entries'). An advantage over normal chaining,
- * which stores entries in linked lists, is spatial locality: entries can be
- * quickly referenced because they are collected in one array. Another advantage
- * is that we don't have to call `malloc' or `free' each time an entry is added
- * or removed. */
+ * The collision resolution strategy used in this implementation is open
+ * addressing. The slots are divided into groups of GROUP_WIDTH slots. Each
+ * slot has a control byte that tells whether the slot is empty, deleted, or
+ * occupied, and, if occupied, contains 7 bits of the hash value of the key.
+ * A lookup scans the control bytes of a whole group at a time (using SSE2
+ * instructions if available) and compares keys only in the slots whose
+ * control byte matches the hash value, so most failed comparisons are avoided
+ * without touching the entries. Groups are probed in a quadratic sequence,
+ * which stops at the first group that has an empty slot.
+ *
+ * The hash value returned from the hash function is mixed before use, so that
+ * weak hash functions like the identity function for integers are acceptable.
+ */
 
 
 //#define DEBUG_HASH 1
@@ -72,107 +78,219 @@ static void print_statistics(const hashtable_T *ht);
 /* The null index */
 #define NOTHING ((size_t) -1)
 
-/* hashtable entry */
-struct hash_entry {
-    size_t next;
-    hashval_T hash;
-    kvpair_T kv;
-};
-/* An entry is occupied iff `.kv.key' is non-NULL.
- * When an entry is unoccupied, the values of the other members of the entry are
- * unspecified. */
+/* The number of slots in a group */
+#define GROUP_WIDTH 16
+
+/* Control byte values. A control byte of an occupied slot is a 7-bit tag
+ * (0x00-0x7F) derived from the hash value of the key. */
+#define CTRL_EMPTY   0x80
+#define CTRL_DELETED 0xFE
+
+/* The maximum number of entries (including deleted ones) in a hashtable of
+ * the specified capacity, that is, 7/8 of the capacity. */
+#define MAX_LOAD(capacity) ((capacity) - (capacity) / 8)
+
+#ifndef HASHTABLE_USE_SSE2
+# ifdef __SSE2__
+#  define HASHTABLE_USE_SSE2 1
+# else
+#  define HASHTABLE_USE_SSE2 0
+# endif
+#endif
+#if HASHTABLE_USE_SSE2
+# include <emmintrin.h>
+#endif
+
+/* A bit set of slots in a group, the n'th bit corresponding to the n'th slot.
+ */
+typedef unsigned groupmask_T;
+
+static inline uint_fast64_t mix_hash(hashval_T hash)
+    __attribute__((const));
+static inline unsigned char hash_tag(uint_fast64_t mixed)
+    __attribute__((const));
+static inline size_t hash_group(const hashtable_T *ht, uint_fast64_t mixed)
+    __attribute__((nonnull,pure));
+static inline groupmask_T match_tag(const unsigned char *control, int tag)
+    __attribute__((nonnull,pure));
+static inline groupmask_T match_empty(const unsigned char *control)
+    __attribute__((nonnull,pure));
+static inline groupmask_T match_free(const unsigned char *control)
+    __attribute__((nonnull,pure));
+static inline unsigned lowest_bit(groupmask_T mask)
+    __attribute__((const));
+static size_t find_slot(
+	const hashtable_T *ht, const void *key, uint_fast64_t mixed)
+    __attribute__((nonnull));
+static size_t find_free_slot(const hashtable_T *ht, uint_fast64_t mixed)
+    __attribute__((nonnull));
+static void allocate_slots(hashtable_T *ht, size_t capacity)
+    __attribute__((nonnull));
+static void rehash(hashtable_T *ht, size_t newcapacity)
+    __attribute__((nonnull));
+
+
+/* Scrambles the specified hash value so that all the bits of the result
+ * depend on all the bits of the hash value. */
+uint_fast64_t mix_hash(hashval_T hash)
+{
+    uint_fast64_t h = (uint_fast64_t) hash * UINT64_C(0x9E3779B97F4A7C15);
+    return h ^ (h >> 32);
+}
 
+/* Returns the control byte for a key of the specified mixed hash value. */
+unsigned char hash_tag(uint_fast64_t mixed)
+{
+    return (unsigned char) (mixed & 0x7F);
+}
 
-/* Initializes a hashtable with the specified capacity.
+/* Returns the index of the group at which probing for a key of the specified
+ * mixed hash value starts. */
+size_t hash_group(const hashtable_T *ht, uint_fast64_t mixed)
+{
+    return (size_t) (mixed >> 7) & (ht->capacity / GROUP_WIDTH - 1);
+}
+
+#if HASHTABLE_USE_SSE2
+
+/* Returns the set of slots in the group whose control byte is `tag'. */
+groupmask_T match_tag(const unsigned char *control, int tag)
+{
+    __m128i group = _mm_loadu_si128((const __m128i *) control);
+    return (groupmask_T) _mm_movemask_epi8(
+	    _mm_cmpeq_epi8(group, _mm_set1_epi8((char) tag)));
+}
+
+/* Returns the set of empty slots in the group. */
+groupmask_T match_empty(const unsigned char *control)
+{
+    return match_tag(control, CTRL_EMPTY);
+}
+
+/* Returns the set of empty or deleted slots in the group. */
+groupmask_T match_free(const unsigned char *control)
+{
+    /* CTRL_EMPTY and CTRL_DELETED are the only values with the highest bit
+     * set. */
+    return (groupmask_T) _mm_movemask_epi8(
+	    _mm_loadu_si128((const __m128i *) control));
+}
+
+#else /* !HASHTABLE_USE_SSE2 */
+
+/* Returns the set of slots in the group whose control byte is `tag'. */
+groupmask_T match_tag(const unsigned char *control, int tag)
+{
+    groupmask_T mask = 0;
+    for (unsigned i = 0; i < GROUP_WIDTH; i++)
+	if (control[i] == tag)
+	    mask |= 1u << i;
+    return mask;
+}
+
+/* Returns the set of empty slots in the group. */
+groupmask_T match_empty(const unsigned char *control)
+{
+    return match_tag(control, CTRL_EMPTY);
+}
+
+/* Returns the set of empty or deleted slots in the group. */
+groupmask_T match_free(const unsigned char *control)
+{
+    groupmask_T mask = 0;
+    for (unsigned i = 0; i < GROUP_WIDTH; i++)
+	if (control[i] & 0x80)
+	    mask |= 1u << i;
+    return mask;
+}
+
+#endif /* HASHTABLE_USE_SSE2 */
+
+/* Returns the index of the lowest set bit in the non-zero mask. */
+unsigned lowest_bit(groupmask_T mask)
+{
+#ifdef __GNUC__
+    return (unsigned) __builtin_ctz(mask);
+#else
+    unsigned index = 0;
+    while (!(mask & 1))
+	mask >>= 1, index++;
+    return index;
+#endif
+}
+
+/* Initializes a hashtable that can contain at least the specified number of
+ * entries without rehashing.
  * `hashfunc' is a hash function to hash keys.
  * `keycmp' is a function that compares two keys. */
 hashtable_T *ht_initwithcapacity(
 	hashtable_T *ht, hashfunc_T *hashfunc, keycmp_T *keycmp,
 	size_t capacity)
 {
-    if (capacity == 0)
-	capacity = 1;
+    size_t slots = GROUP_WIDTH;
+    while (MAX_LOAD(slots) < capacity)
+	slots *= 2;
 
-    ht->capacity = capacity;
     ht->count = 0;
     ht->hashfunc = hashfunc;
     ht->keycmp = keycmp;
-    ht->emptyindex = NOTHING;
-    ht->tailindex = 0;
-    ht->indices = xmallocn(capacity, sizeof *ht->indices);
-    ht->entries = xmallocn(capacity, sizeof *ht->entries);
-
-    for (size_t i = 0; i < capacity; i++) {
-	ht->indices[i] = NOTHING;
-	ht->entries[i].kv.key = NULL;
-    }
-
+    allocate_slots(ht, slots);
     return ht;
 }
 
-/* Changes the capacity of the specified hashtable.
- * If the specified new capacity is smaller than the number of the entries in
- * the hashtable, the capacity is not changed.
- * Note that the capacity cannot be zero. If `newcapacity' is zero, it is
- * assumed to be one. */
-/* Capacity should be an odd integer, especially a prime number. */
-hashtable_T *ht_setcapacity(hashtable_T *ht, size_t newcapacity)
+/* Allocates `capacity' empty slots for the hashtable.
+ * The old slots, if any, are not freed. */
+void allocate_slots(hashtable_T *ht, size_t capacity)
 {
-    if (newcapacity == 0)
-	newcapacity = 1;
-    if (newcapacity < ht->count)
-	newcapacity = ht->count;
+    ht->capacity = capacity;
+    ht->deleted = 0;
+    ht->entries = xmallocn(capacity, sizeof *ht->entries + 1);
+    ht->control = (unsigned char *) &ht->entries[capacity];
+    memset(ht->control, CTRL_EMPTY, capacity);
+}
 
+/* Moves all the entries into `newcapacity' new slots. */
+void rehash(hashtable_T *ht, size_t newcapacity)
+{
     size_t oldcapacity = ht->capacity;
-    size_t *oldindices = ht->indices;
-    size_t *newindices = xmallocn(newcapacity, sizeof *ht->indices);
-    struct hash_entry *oldentries = ht->entries;
-    struct hash_entry *newentries = xmallocn(newcapacity, sizeof *ht->entries);
-    size_t tail = 0;
-
-    for (size_t i = 0; i < newcapacity; i++) {
-	newindices[i] = NOTHING;
-	newentries[i].kv.key = NULL;
-    }
+    unsigned char *oldcontrol = ht->control;
+    kvpair_T *oldentries = ht->entries;
 
-    /* move the data from oldentries to newentries */
+    allocate_slots(ht, newcapacity);
     for (size_t i = 0; i < oldcapacity; i++) {
-	void *key = oldentries[i].kv.key;
-	if (key != NULL) {
-	    hashval_T hash = oldentries[i].hash;
-	    size_t newindex = (size_t) hash % newcapacity;
-	    newentries[tail] = (struct hash_entry) {
-		.next = newindices[newindex],
-		.hash = hash,
-		.kv = oldentries[i].kv,
-	    };
-	    newindices[newindex] = tail;
-	    tail++;
-	}
-    }
+	if (oldcontrol[i] & 0x80)
+	    continue;
 
-    free(oldindices);
+	uint_fast64_t mixed = mix_hash(ht->hashfunc(oldentries[i].key));
+	size_t index = find_free_slot(ht, mixed);
+	ht->control[index] = hash_tag(mixed);
+	ht->entries[index] = oldentries[i];
+    }
     free(oldentries);
-    ht->capacity = newcapacity;
-    ht->emptyindex = NOTHING;
-    ht->tailindex = tail;
-    ht->indices = newindices;
-    ht->entries = newentries;
+}
+
+/* Changes the capacity of the specified hashtable so that it can contain at
+ * least `newcapacity' entries without rehashing.
+ * If the specified new capacity is smaller than the number of the entries in
+ * the hashtable, the capacity is made just enough for the current entries. */
+hashtable_T *ht_setcapacity(hashtable_T *ht, size_t newcapacity)
+{
+    if (newcapacity < ht->count)
+	newcapacity = ht->count;
+
+    size_t slots = GROUP_WIDTH;
+    while (MAX_LOAD(slots) < newcapacity)
+	slots *= 2;
+    rehash(ht, slots);
     return ht;
 }
 
 /* Increases the capacity as large as necessary
- * so that the capacity is no less than the specified. */
+ * so that the hashtable can contain the specified number of entries. */
 hashtable_T *ht_ensurecapacity(hashtable_T *ht, size_t capacity)
 {
-    if (capacity <= ht->capacity)
+    if (capacity <= MAX_LOAD(ht->capacity))
 	return ht;
-
-    size_t cap15 = ht->capacity + (ht->capacity >> 1);
-    if (capacity < cap15)
-	capacity = cap15;
-    if (capacity < ht->capacity + 6)
-	capacity = ht->capacity + 6;
     return ht_setcapacity(ht, capacity);
 }
 
@@ -182,40 +300,65 @@ hashtable_T *ht_ensurecapacity(hashtable_T *ht, size_t capacity)
  * The capacity of the hashtable is not changed. */
 hashtable_T *ht_clear(hashtable_T *ht, void freer(kvpair_T kv))
 {
-    size_t *indices = ht->indices;
-    struct hash_entry *entries = ht->entries;
-
-    if (ht->count == 0)
+    if (ht->count == 0 && ht->deleted == 0)
 	return ht;
 
-    for (size_t i = 0, cap = ht->capacity; i < cap; i++) {
-	indices[i] = NOTHING;
-	if (entries[i].kv.key != NULL) {
-	    if (freer)
-		freer(entries[i].kv);
-	    entries[i].kv.key = NULL;
-	}
-    }
+    if (freer)
+	for (size_t i = 0, cap = ht->capacity; i < cap; i++)
+	    if (!(ht->control[i] & 0x80))
+		freer(ht->entries[i]);
 
+    memset(ht->control, CTRL_EMPTY, ht->capacity);
     ht->count = 0;
-    ht->emptyindex = NOTHING;
-    ht->tailindex = 0;
+    ht->deleted = 0;
     return ht;
 }
 
+/* Returns the index of the slot that contains the specified key, or NOTHING
+ * if not found. `mixed' is the mixed hash value of the key. */
+size_t find_slot(const hashtable_T *ht, const void *key, uint_fast64_t mixed)
+{
+    unsigned char tag = hash_tag(mixed);
+    size_t groupmask = ht->capacity / GROUP_WIDTH - 1;
+    size_t group = hash_group(ht, mixed);
+
+    for (size_t step = 1; ; step++) {
+	const unsigned char *control = &ht->control[group * GROUP_WIDTH];
+	for (groupmask_T m = match_tag(control, tag); m != 0; m &= m - 1) {
+	    size_t index = group * GROUP_WIDTH + lowest_bit(m);
+	    if (ht->keycmp(ht->entries[index].key, key) == 0)
+		return index;
+	}
+	if (match_empty(control) != 0 || step > groupmask)
+	    return NOTHING;
+	group = (group + step) & groupmask;
+    }
+}
+
+/* Returns the index of the first empty or deleted slot in the probe sequence
+ * for the specified mixed hash value. There must be such a slot. */
+size_t find_free_slot(const hashtable_T *ht, uint_fast64_t mixed)
+{
+    size_t groupmask = ht->capacity / GROUP_WIDTH - 1;
+    size_t group = hash_group(ht, mixed);
+
+    for (size_t step = 1; ; step++) {
+	groupmask_T m = match_free(&ht->control[group * GROUP_WIDTH]);
+	if (m != 0)
+	    return group * GROUP_WIDTH + lowest_bit(m);
+	assert(step <= groupmask);
+	group = (group + step) & groupmask;
+    }
+}
+
 /* Returns the entry whose key is equal to the specified `key',
  * or { NULL, NULL } if `key' is NULL or there is no such entry. */
 kvpair_T ht_get(const hashtable_T *ht, const void *key)
 {
     if (key != NULL) {
-	hashval_T hash = ht->hashfunc(key);
-	size_t index = ht->indices[(size_t) hash % ht->capacity];
-	while (index != NOTHING) {
-	    struct hash_entry *entry = &ht->entries[index];
-	    if (entry->hash == hash && ht->keycmp(entry->kv.key, key) == 0)
-		return entry->kv;
-	    index = entry->next;
-	}
+	size_t index = find_slot(ht, key, mix_hash(ht->hashfunc(key)));
+	if (index != NOTHING)
+	    return ht->entries[index];
     }
     return (kvpair_T) { NULL, NULL, };
 }
@@ -228,66 +371,57 @@ kvpair_T ht_set(hashtable_T *ht, const void *key, const void *value)
 {
     assert(key != NULL);
 
-    /* if there is an entry with the specified key, simply replace the value */
-    hashval_T hash = ht->hashfunc(key);
-    size_t mhash = (size_t) hash % ht->capacity;
-    size_t index = ht->indices[mhash];
-    struct hash_entry *entry;
-    while (index != NOTHING) {
-	entry = &ht->entries[index];
-	if (entry->hash == hash && ht->keycmp(entry->kv.key, key) == 0) {
-	    kvpair_T oldkv = entry->kv;
-	    entry->kv = (kvpair_T) { (void *) key, (void *) value, };
-	    DEBUG_PRINT_STATISTICS(ht);
-	    return oldkv;
-	}
-	index = entry->next;
+    /* if there is an entry with the specified key, simply replace it */
+    uint_fast64_t mixed = mix_hash(ht->hashfunc(key));
+    size_t index = find_slot(ht, key, mixed);
+    if (index != NOTHING) {
+	kvpair_T oldkv = ht->entries[index];
+	ht->entries[index] = (kvpair_T) { (void *) key, (void *) value, };
+	DEBUG_PRINT_STATISTICS(ht);
+	return oldkv;
     }
 
     /* No entry with the specified key was found; we add a new entry. */
-    index = ht->emptyindex;
-    if (index != NOTHING) {
-	/* if there is an empty entry, use it */
-	entry = &ht->entries[index];
-	ht->emptyindex = entry->next;
-    } else {
-	/* if there is no empty entry, use a tail entry */
-	ht_ensurecapacity(ht, ht->count + 1);
-	mhash = (size_t) hash % ht->capacity;
-	index = ht->tailindex++;
-	entry = &ht->entries[index];
+    if (ht->count + ht->deleted >= MAX_LOAD(ht->capacity)) {
+	/* If many slots are deleted, rehashing into the same capacity is
+	 * enough to make room. */
+	if (ht->count < MAX_LOAD(ht->capacity) / 2)
+	    rehash(ht, ht->capacity);
+	else
+	    rehash(ht, ht->capacity * 2);
     }
-    *entry = (struct hash_entry) {
-	.next = ht->indices[mhash],
-	.hash = hash,
-	.kv = (kvpair_T) { (void *) key, (void *) value, },
-    };
-    ht->indices[mhash] = index;
+
+    index = find_free_slot(ht, mixed);
+    if (ht->control[index] == CTRL_DELETED)
+	ht->deleted--;
+    ht->control[index] = hash_tag(mixed);
+    ht->entries[index] = (kvpair_T) { (void *) key, (void *) value, };
     ht->count++;
     DEBUG_PRINT_STATISTICS(ht);
     return (kvpair_T) { NULL, NULL, };
 }
 
 /* Removes and returns the entry with the specified key.
- * If `key' is NULL or there is no such entry, { NULL, NULL } is returned. */
+ * If `key' is NULL or there is no such entry, { NULL, NULL } is returned.
+ * Removing an entry does not move any other entries, so entries can be removed
+ * during iteration by `ht_next'. */
 kvpair_T ht_remove(hashtable_T *ht, const void *key)
 {
     if (key != NULL) {
-	hashval_T hash = ht->hashfunc(key);
-	size_t *indexp = &ht->indices[(size_t) hash % ht->capacity];
-	while (*indexp != NOTHING) {
-	    size_t index = *indexp;
-	    struct hash_entry *entry = &ht->entries[index];
-	    if (entry->hash == hash && ht->keycmp(entry->kv.key, key) == 0) {
-		kvpair_T oldkv = entry->kv;
-		*indexp = entry->next;
-		entry->next = ht->emptyindex;
-		ht->emptyindex = index;
-		entry->kv.key = NULL;
-		ht->count--;
-		return oldkv;
+	size_t index = find_slot(ht, key, mix_hash(ht->hashfunc(key)));
+	if (index != NOTHING) {
+	    /* If the group has an empty slot, no probe sequence has passed
+	     * through the group, so the slot can be made empty rather than
+	     * deleted. */
+	    size_t group = index - index % GROUP_WIDTH;
+	    if (match_empty(&ht->control[group]) != 0) {
+		ht->control[index] = CTRL_EMPTY;
+	    } else {
+		ht->control[index] = CTRL_DELETED;
+		ht->deleted++;
 	    }
-	    indexp = &entry->next;
+	    ht->count--;
+	    return ht->entries[index];
 	}
     }
     return (kvpair_T) { NULL, NULL, };
@@ -303,12 +437,9 @@ kvpair_T ht_remove(hashtable_T *ht, const void *key)
  * You must not add or remove any entry inside function `f'. */
 int ht_each(const hashtable_T *ht, int f(kvpair_T kv))
 {
-    struct hash_entry *entries = ht->entries;
-
     for (size_t i = 0, cap = ht->capacity; i < cap; i++) {
-	kvpair_T kv = entries[i].kv;
-	if (kv.key != NULL) {
-	    int r = f(kv);
+	if (!(ht->control[i] & 0x80)) {
+	    int r = f(ht->entries[i]);
 	    if (r != 0)
 		return r;
 	}
@@ -323,16 +454,15 @@ int ht_each(const hashtable_T *ht, int f(kvpair_T kv))
  * Each time this function is called, it updates `*indexp' and returns one
  * entry.
  * You must not change the value of `*indexp' from outside this function or
- * add/remove any entry in the hashtable until the iteration finishes.
+ * add any entry to the hashtable until the iteration finishes.
  * Each entry is returned exactly once, in an unspecified order.
  * If there is no more entry to be iterated, { NULL, NULL } is returned. */
 kvpair_T ht_next(const hashtable_T *restrict ht, size_t *restrict indexp)
 {
     while (*indexp < ht->capacity) {
-	kvpair_T kv = ht->entries[*indexp].kv;
-	(*indexp)++;
-	if (kv.key != NULL)
-	    return kv;
+	size_t index = (*indexp)++;
+	if (!(ht->control[index] & 0x80))
+	    return ht->entries[index];
     }
     return (kvpair_T) { NULL, NULL, };
 }
@@ -346,8 +476,8 @@ kvpair_T *ht_tokvarray(const hashtable_T *ht)
     size_t index = 0;
 
     for (size_t i = 0; i < ht->capacity; i++) {
-	if (ht->entries[i].kv.key != NULL)
-	    array[index++] = ht->entries[i].kv;
+	if (!(ht->control[i] & 0x80))
+	    array[index++] = ht->entries[i];
     }
 
     assert(index == ht->count);
@@ -375,13 +505,23 @@ hashval_T hashstr(const void *s)
  * You can use `htwcscmp' for a corresponding comparison function. */
 hashval_T hashwcs(const void *s)
 {
-    /* The hashing algorithm is a slightly modified version of FNV hash.
-     * Cf. http://www.isthe.com/chongo/tech/comp/fnv/ */
+    /* Two characters are hashed at a time in the style of FNV hash, using a
+     * 64-bit multiplier. The result is folded so that the lower bits depend on
+     * the higher characters too. */
     const wchar_t *c = s;
-    hashval_T h = 0;
-    while (*c != L'\0')
-	h = (h ^ (hashval_T) *c++) * FNVPRIME;
-    return h;
+    uint_fast64_t h = UINT64_C(0xCBF29CE484222325);
+    for (;;) {
+	if (c[0] == L'\0')
+	    break;
+	uint_fast64_t w = (uint_least32_t) c[0];
+	if (c[1] != L'\0')
+	    w |= (uint_fast64_t) (uint_least32_t) c[1] << 32;
+	h = (h ^ w) * UINT64_C(0x100000001B3);
+	if (c[1] == L'\0')
+	    break;
+	c += 2;
+    }
+    return (hashval_T) (h ^ (h >> 32));
 }
 
 /* A comparison function for wide strings.
@@ -438,17 +578,21 @@ void print_statistics(const hashtable_T *ht)
 {
     fprintf(stderr, "DEBUG: id=%p hash->count=%zu, capacity=%zu\n",
 	    (void *) ht, ht->count, ht->capacity);
-    fprintf(stderr, "DEBUG: hash->emptyindex=%zu, tailindex=%zu\n",
-	    ht->emptyindex, ht->tailindex);
-
-    unsigned emptycount = 0, collcount = 0;
-    for (size_t i = ht->emptyindex; i != NOTHING; i = ht->entries[i].next)
-	emptycount++;
-    for (size_t i = 0; i < ht->capacity; i++)
-	if (ht->entries[i].kv.key && ht->entries[i].next != NOTHING)
-	    collcount++;
-    fprintf(stderr, "DEBUG: hash empties=%u collisions=%u\n\n",
-	    emptycount, collcount);
+    fprintf(stderr, "DEBUG: hash->deleted=%zu\n", ht->deleted);
+
+    unsigned fullgroups = 0, displaced = 0;
+    for (size_t g = 0; g < ht->capacity; g += GROUP_WIDTH)
+	if (match_free(&ht->control[g]) == 0)
+	    fullgroups++;
+    for (size_t i = 0; i < ht->capacity; i++) {
+	if (ht->control[i] & 0x80)
+	    continue;
+	uint_fast64_t mixed = mix_hash(ht->hashfunc(ht->entries[i].key));
+	if (hash_group(ht, mixed) != i / GROUP_WIDTH)
+	    displaced++;
+    }
+    fprintf(stderr, "DEBUG: hash full-groups=%u displaced=%u\n\n",
+	    fullgroups, displaced);
 }
 #endif
 
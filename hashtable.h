@@ -42,17 +42,17 @@ typedef hashval_T hashfunc_T(const void *key);
  * Returns zero if two keys are equal, or non-zero if unequal. */
 typedef int keycmp_T(const void *key1, const void *key2);
 
+typedef struct kvpair_T {
+    void *key, *value;
+} kvpair_T;
 typedef struct hashtable_T {
     size_t capacity, count;
     hashfunc_T *hashfunc;
     keycmp_T *keycmp;
-    size_t emptyindex, tailindex;
-    size_t *indices;
-    struct hash_entry *entries;
+    size_t deleted;
+    unsigned char *control;
+    kvpair_T *entries;
 } hashtable_T;
-typedef struct kvpair_T {
-    void *key, *value;
-} kvpair_T;
 
 static inline hashtable_T *ht_init(
 	hashtable_T *ht, hashfunc_T *hashfunc, keycmp_T *keycmp)
@@ -112,7 +112,6 @@ hashtable_T *ht_init(hashtable_T *ht, hashfunc_T *hashfunc, keycmp_T *keycmp)
  * Note that this function doesn't `free' any keys or values. */
 void ht_destroy(hashtable_T *ht)
 {
-    free(ht->indices);
     free(ht->entries);
 }
 
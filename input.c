@@ -21,6 +21,7 @@
 #include <assert.h>
 #include <errno.h>
 #include <fcntl.h>
+#include <limits.h>
 #if HAVE_GETTEXT
 # include <libintl.h>
 #endif
@@ -41,6 +42,7 @@
 #include "mail.h"
 #include "option.h"
 #include "parser.h"
+#include "redir.h"
 #include "sig.h"
 #include "strbuf.h"
 #include "util.h"
@@ -51,15 +53,42 @@
 # include "lineedit/lineedit.h"
 #endif
 
+#if HAVE_TEE
+extern ssize_t tee(int fd_in, int fd_out, size_t len, unsigned int flags);
+#endif
+
 
-static bool is_seekable_file(int fd);
+typedef enum convertresult_T {
+    CONVERT_LINE, CONVERT_MORE, CONVERT_PARTIAL, CONVERT_ERROR,
+} convertresult_T;
+
+static inputresult_T read_input_buffered(
+	struct xwcsbuf_T *buf, struct input_file_info_T *info, _Bool trap,
+	_Bool peek)
+    __attribute__((nonnull));
+static convertresult_T convert_input(
+	struct xwcsbuf_T *restrict buf,
+	struct input_file_info_T *restrict info)
+    __attribute__((nonnull));
+static size_t widen_ascii(
+	wchar_t *restrict out, const char *restrict s, size_t n)
+    __attribute__((nonnull));
+static size_t decode_utf8(
+	wchar_t *restrict out, const char *restrict s, size_t n)
+    __attribute__((nonnull));
 static inputresult_T optimized_read_input(
-	struct xwcsbuf_T *buf, struct input_file_info_T *info, _Bool trap)
+	struct xwcsbuf_T *buf, struct input_file_info_T *info, _Bool trap,
+	_Bool peek)
+    __attribute__((nonnull));
+#if HAVE_TEE
+static ssize_t peek_input(int fd, char *buf, size_t size, size_t *peeked)
+    __attribute__((nonnull));
+#endif
+static _Bool skip_input(int fd, char *buf, size_t size)
     __attribute__((nonnull));
 static wchar_t *expand_prompt_variable(wchar_t num, wchar_t suffix)
     __attribute__((malloc,warn_unused_result));
-static const wchar_t *get_prompt_variable(wchar_t num, wchar_t suffix)
-    __attribute__((pure));
+static const wchar_t *get_prompt_variable(wchar_t num, wchar_t suffix);
 static wchar_t *expand_ps1_posix(wchar_t *s)
     __attribute__((nonnull,malloc,warn_unused_result));
 static inline wchar_t get_euid_marker(void)
@@ -91,6 +120,30 @@ inputresult_T input_wcs(struct xwcsbuf_T *buf, void *inputinfo)
     return isempty ? INPUT_EOF : INPUT_OK;
 }
 
+/* An input function that inputs from a text decoded in advance.
+ * `inputinfo' must be a pointer to a `struct input_text_info_T' that has been
+ * initialized by `read_input_text'.
+ * Reads the next line from `inputinfo->src' and appends it to buffer `buf'.
+ * After the decoded text, input is read from `inputinfo->fileinfo' as in
+ * `input_file'. */
+inputresult_T input_text(struct xwcsbuf_T *buf, void *inputinfo)
+{
+    struct input_text_info_T *info = inputinfo;
+    const wchar_t *src = info->src;
+    size_t rest = (size_t) (info->end - src);
+
+    if (rest > 0) {
+	const wchar_t *newlinep = wmemchr(src, L'\n', rest);
+	const wchar_t *nextlinep = (newlinep != NULL) ? &newlinep[1] : info->end;
+	wb_ncat_force(buf, src, (size_t) (nextlinep - src));
+	info->src = nextlinep;
+	return INPUT_OK;
+    }
+
+    /* The rest of the line, if any, is read from the file by the next call. */
+    return read_input(buf, info->fileinfo, true);
+}
+
 /* An input function that reads input from a file stream.
  * `inputinfo' is a pointer to a `struct input_file_info_T'.
  * Reads one line from `inputinfo->fd' and appends it to the buffer. */
@@ -109,15 +162,49 @@ inputresult_T input_file(struct xwcsbuf_T *buf, void *inputinfo)
 inputresult_T read_input(
 	xwcsbuf_T *buf, struct input_file_info_T *info, bool trap)
 {
-    if (info->bufsize == 1 && is_seekable_file(info->fd))
-	return optimized_read_input(buf, info, trap);
+    if (info->bufsize == 1) {
+	/* The file may be shared with other processes, so we must not consume
+	 * bytes beyond the end of the line. We still read many bytes at once if
+	 * we can give back the extra bytes afterwards. */
+	struct stat st;
+	if (fstat(info->fd, &st) == 0) {
+	    /* The result of lseek for an unseekable FD is
+	     * implementation-defined, so we should not assume such lseek to
+	     * fail. We only assume a regular file is always seekable. */
+	    if (S_ISREG(st.st_mode))
+		return optimized_read_input(buf, info, trap, false);
+#if HAVE_TEE
+	    if (S_ISFIFO(st.st_mode) && info->bufpos >= info->bufmax)
+		return optimized_read_input(buf, info, trap, true);
+#endif
+	}
+    }
+
+    return read_input_buffered(buf, info, trap, false);
+}
 
+/* Reads one line in the same manner as `read_input', using `info->buf' as is.
+ * If `peek' is true, bytes are read from pipe `info->fd' by `peek_input' and
+ * only the bytes that have been converted are removed from the pipe. The other
+ * bytes remain in `info->buf' and in the pipe when this function returns. */
+inputresult_T read_input_buffered(
+	xwcsbuf_T *buf, struct input_file_info_T *info, bool trap, bool peek)
+{
     size_t initlen = buf->length;
     inputresult_T status = INPUT_EOF;
+    size_t peeked = 0;
 
     for (;;) {
 	if (info->bufpos >= info->bufmax) {
 read_input:  /* if there's nothing in the buffer, read the next input */
+	    if (peeked > 0) {
+		/* All the peeked bytes have been converted. */
+		size_t count = peeked;
+		peeked = 0;
+		if (!skip_input(info->fd, info->buf, count))
+		    goto error;
+	    }
+
 	    switch (wait_for_input(info->fd, trap, -1)) {
 		case W_READY:
 		    break;
@@ -134,7 +221,14 @@ read_input:  /* if there's nothing in the buffer, read the next input */
 		    goto end;
 	    }
 
+#if HAVE_TEE
+	    ssize_t readcount = peek
+		? peek_input(info->fd, info->buf, info->bufsize, &peeked)
+		: read(info->fd, info->buf, info->bufsize);
+#else
+	    (void) peek;
 	    ssize_t readcount = read(info->fd, info->buf, info->bufsize);
+#endif
 	    if (readcount < 0) switch (errno) {
 		case EINTR:
 		case EAGAIN:
@@ -145,32 +239,30 @@ read_input:  /* if there's nothing in the buffer, read the next input */
 		default:
 		    goto error;
 	    } else if (readcount == 0) {
+		/* The input ends in an incomplete character. The error is
+		 * reported by the next call if we have read a part of the
+		 * line in this call. */
+		if (!mbsinit(&info->state) && initlen == buf->length) {
+		    errno = EILSEQ;
+		    goto error;
+		}
 		goto end;
 	    }
 	    info->bufpos = 0;
 	    info->bufmax = readcount;
 	}
 
-	/* convert bytes in `info->buf' into a wide character and
-	 * append it to `buf' */
-	wb_ensuremax(buf, add(buf->length, 1));
-	assert(info->bufpos < info->bufmax);
-	size_t convcount = mbrtowc(&buf->contents[buf->length],
-		&info->buf[info->bufpos], info->bufmax - info->bufpos,
-		&info->state);
-	switch (convcount) {
-	    case 0:            /* read null character */
+	/* convert bytes in `info->buf' into wide characters and append them to
+	 * `buf' */
+	switch (convert_input(buf, info)) {
+	    case CONVERT_LINE:  /* read a newline or null character */
 		goto end;
-	    case (size_t) -1:  /* not a valid character */
-		goto error;
-	    case (size_t) -2:  /* needs more input */
-		goto read_input;
-	    default:
-		info->bufpos += convcount;
-		buf->contents[++buf->length] = L'\0';
-		if (buf->contents[buf->length - 1] == L'\n')
-		    goto end;
+	    case CONVERT_MORE:  /* converted all the bytes in `info->buf' */
 		break;
+	    case CONVERT_PARTIAL:  /* needs more input */
+		goto read_input;
+	    case CONVERT_ERROR:  /* not a valid character */
+		goto error;
 	}
     }
 
@@ -178,30 +270,189 @@ error:
     xerror(errno, Ngt("cannot read input"));
     status = INPUT_ERROR;
 end:
+    if (peeked > 0) {
+	/* Remove the converted bytes from the pipe. The rest are left to be
+	 * read later. */
+	if (!skip_input(info->fd, info->buf, info->bufpos)) {
+	    xerror(errno, Ngt("cannot read input"));
+	    status = INPUT_ERROR;
+	}
+    }
+
     if (initlen != buf->length)
 	return INPUT_OK;
     else
 	return status;
 }
 
-/* Checks if the file descriptor is seekable. */
-bool is_seekable_file(int fd)
+/* Converts bytes in `info->buf' starting from `info->bufpos' into wide
+ * characters and appends them to `buf'. The conversion stops after a newline,
+ * just before a null character or an invalid character, or at the end of the
+ * buffer. `info->bufpos' is advanced past the converted bytes.
+ * Characters that are ASCII or, in a UTF-8 locale, valid UTF-8 sequences are
+ * decoded without calling `mbrtowc'.
+ * Returns:
+ *   CONVERT_LINE    if a newline or null character was reached
+ *   CONVERT_MORE    if all the bytes were converted without a newline
+ *   CONVERT_PARTIAL if the buffer ends in an incomplete character, whose bytes
+ *                   are kept in `info->state'
+ *   CONVERT_ERROR   if an invalid character was reached (`errno' is set) */
+convertresult_T convert_input(
+	xwcsbuf_T *restrict buf, struct input_file_info_T *restrict info)
+{
+    const char *s = &info->buf[info->bufpos];
+    const char *end = &info->buf[info->bufmax];
+    bool ascii = is_ascii_compatible_locale();
+    bool utf8 = ascii && is_utf8_locale();
+    convertresult_T result = CONVERT_MORE;
+
+    if (ascii) {
+	/* A newline byte is never part of another character in an
+	 * ASCII-compatible encoding, so we can find the end of the line
+	 * before conversion. */
+	const char *nl = memchr(s, '\n', (size_t) (end - s));
+	if (nl != NULL) {
+	    end = &nl[1];
+	    result = CONVERT_LINE;
+	}
+    }
+
+    /* The result never has more characters than the bytes converted. */
+    wb_ensuremax(buf, add(buf->length, (size_t) (end - s)));
+    wchar_t *out = &buf->contents[buf->length];
+
+    while (s < end) {
+	if (ascii && mbsinit(&info->state)) {
+	    size_t count = widen_ascii(out, s, (size_t) (end - s));
+	    out += count, s += count;
+	    if (s == end)
+		break;
+	    if (utf8) {
+		count = decode_utf8(out, s, (size_t) (end - s));
+		if (count > 0) {
+		    out++, s += count;
+		    continue;
+		}
+	    }
+	}
+
+	size_t count = mbrtowc(out, s, (size_t) (end - s), &info->state);
+	switch (count) {
+	    case 0:            /* read null character */
+		result = CONVERT_LINE;
+		goto done;
+	    case (size_t) -1:  /* not a valid character */
+		result = CONVERT_ERROR;
+		goto done;
+	    case (size_t) -2:  /* needs more input */
+		s = end;
+		result = CONVERT_PARTIAL;
+		goto done;
+	    default:
+		s += count;
+		if (*out++ == L'\n') {
+		    result = CONVERT_LINE;
+		    goto done;
+		}
+		break;
+	}
+    }
+
+done:
+    buf->length = (size_t) (out - buf->contents);
+    buf->contents[buf->length] = L'\0';
+    info->bufpos = (size_t) (s - info->buf);
+    return result;
+}
+
+/* Converts the longest prefix of `s' that consists of bytes in the range of
+ * 0x01-0x7F into wide characters of the same values, storing them in `out'.
+ * At most `n' bytes are converted. Returns the number of converted bytes. */
+size_t widen_ascii(wchar_t *restrict out, const char *restrict s, size_t n)
 {
-    struct stat st;
-    return (fstat(fd, &st) == 0) && S_ISREG(st.st_mode);
-    /* The result of lseek for an unseekable FD is implementation-defined, so we
-     * should not assume such lseek to fail. We only assume a regular file is
-     * always seekable. */
+    /* The bytes are checked a word at a time: a word contains no null byte and
+     * no byte of 0x80 or above iff `(w | (w - ones)) & highs' is zero. */
+    const unsigned long ones = ULONG_MAX / 0xFF, highs = ones << 7;
+    size_t i = 0;
+
+    while (n - i >= sizeof ones) {
+	unsigned long w;
+	memcpy(&w, &s[i], sizeof w);
+	if (((w | (w - ones)) & highs) != 0)
+	    break;
+	for (size_t j = 0; j < sizeof w; j++)
+	    out[i + j] = (wchar_t) s[i + j];
+	i += sizeof w;
+    }
+    while (i < n && (unsigned char) s[i] - 1u < 0x7Fu) {
+	out[i] = (wchar_t) s[i];
+	i++;
+    }
+    return i;
+}
+
+/* Decodes a UTF-8 sequence of two to four bytes at the beginning of `s' into a
+ * wide character, which is stored in `*out'. At most `n' bytes are examined.
+ * Returns the length of the sequence, or zero if `s' does not start with a
+ * complete, valid, non-ASCII sequence. In the latter case, the caller should
+ * convert the bytes by `mbrtowc' to handle the error. */
+size_t decode_utf8(wchar_t *restrict out, const char *restrict s, size_t n)
+{
+    const unsigned char *u = (const unsigned char *) s;
+    if (n < 2)
+	return 0;
+    if (0xC2 <= u[0] && u[0] <= 0xDF) {
+	if ((u[1] & 0xC0) != 0x80)
+	    return 0;
+	*out = (wchar_t) (((u[0] & 0x1F) << 6) | (u[1] & 0x3F));
+	return 2;
+    }
+    if (n < 3 || (u[2] & 0xC0) != 0x80)
+	return 0;
+    if (0xE0 <= u[0] && u[0] <= 0xEF) {
+	unsigned lo = (u[0] == 0xE0) ? 0xA0 : 0x80;
+	unsigned hi = (u[0] == 0xED) ? 0x9F : 0xBF;
+	if (u[1] < lo || hi < u[1])
+	    return 0;
+	*out = (wchar_t) (((u[0] & 0x0F) << 12) | ((u[1] & 0x3F) << 6)
+		| (u[2] & 0x3F));
+	return 3;
+    }
+    if (n < 4 || (u[3] & 0xC0) != 0x80)
+	return 0;
+    if (0xF0 <= u[0] && u[0] <= 0xF4) {
+	unsigned lo = (u[0] == 0xF0) ? 0x90 : 0x80;
+	unsigned hi = (u[0] == 0xF4) ? 0x8F : 0xBF;
+	if (u[1] < lo || hi < u[1])
+	    return 0;
+	*out = (wchar_t) (((u[0] & 0x07) << 18) | ((u[1] & 0x3F) << 12)
+		| ((u[2] & 0x3F) << 6) | (u[3] & 0x3F));
+	return 4;
+    }
+    return 0;
 }
 
+/* A spare input buffer for `optimized_read_input'. */
+static struct input_file_info_T *spare_input_info = NULL;
+
 /* Works like `read_input', but improves performance by reading many bytes at
- * once even if `info->bufsize' is 1. The input file descriptor must be
- * seekable. */
+ * once even if `info->bufsize' is 1.
+ * If `peek' is false, the input file descriptor must be seekable. Extra bytes
+ * are given back by rewinding the FD.
+ * If `peek' is true, the input file descriptor must be a pipe and
+ * `info->buf' must be empty. Bytes are peeked with `tee' so that extra bytes
+ * are not removed from the pipe. */
 inputresult_T optimized_read_input(
-	struct xwcsbuf_T *buf, struct input_file_info_T *info, _Bool trap)
+	struct xwcsbuf_T *buf, struct input_file_info_T *info, _Bool trap,
+	_Bool peek)
 {
-    struct input_file_info_T *tmpinfo =
-	xmallocs(sizeof *tmpinfo, BUFSIZ, sizeof *tmpinfo->buf);
+    /* `spare_input_info' is taken while in use, so that a trap that reads
+     * input while we are waiting for input gets another buffer. */
+    struct input_file_info_T *tmpinfo = spare_input_info;
+    if (tmpinfo != NULL)
+	spare_input_info = NULL;
+    else
+	tmpinfo = xmallocs(sizeof *tmpinfo, BUFSIZ, sizeof *tmpinfo->buf);
     tmpinfo->fd = info->fd;
     tmpinfo->state = info->state;
     tmpinfo->bufpos = tmpinfo->bufmax = 0;
@@ -210,9 +461,9 @@ inputresult_T optimized_read_input(
     while (info->bufpos < info->bufmax)
 	tmpinfo->buf[tmpinfo->bufmax++] = info->buf[info->bufpos++];
 
-    inputresult_T result = read_input(buf, tmpinfo, trap);
+    inputresult_T result = read_input_buffered(buf, tmpinfo, trap, peek);
 
-    if (tmpinfo->bufpos < tmpinfo->bufmax) {
+    if (!peek && tmpinfo->bufpos < tmpinfo->bufmax) {
 	/* rewind the FD to pretend we're not buffering */
 	off_t diff = tmpinfo->bufmax - tmpinfo->bufpos;
 	if (lseek(tmpinfo->fd, -diff, SEEK_CUR) == (off_t) -1) {
@@ -224,10 +475,186 @@ inputresult_T optimized_read_input(
     }
 
     info->state = tmpinfo->state;
-    free(tmpinfo);
+    if (spare_input_info == NULL)
+	spare_input_info = tmpinfo;
+    else
+	free(tmpinfo);
     return result;
 }
 
+#if HAVE_TEE
+
+/* The pipe to which input is copied by `tee' in `peek_input'. */
+static int peek_pipe[2] = { -1, -1, };
+/* True if `peek_pipe' cannot be used. */
+static bool peek_pipe_unavailable = false;
+
+/* Reads at most `size' bytes from pipe `fd' into `buf' without removing them
+ * from the pipe. The number of the peeked bytes is assigned to `*peeked', and
+ * they should be removed from the pipe by `skip_input' after they are used.
+ * If the bytes cannot be peeked, one byte is read and removed from the pipe
+ * as usual, in which case `*peeked' is zero.
+ * Returns the number of bytes stored in `buf', zero at the end of file, or -1
+ * on error with `errno' set. */
+ssize_t peek_input(int fd, char *buf, size_t size, size_t *peeked)
+{
+    *peeked = 0;
+    if (!peek_pipe_unavailable && peek_pipe[PIPE_IN] < 0) {
+	int pipefd[2];
+	if (pipe(pipefd) >= 0) {
+	    peek_pipe[PIPE_IN] = move_to_shellfd(pipefd[PIPE_IN]);
+	    peek_pipe[PIPE_OUT] = move_to_shellfd(pipefd[PIPE_OUT]);
+	}
+	if (peek_pipe[PIPE_IN] < 0 || peek_pipe[PIPE_OUT] < 0) {
+	    close_peek_pipe();
+	    peek_pipe_unavailable = true;
+	}
+    }
+
+    if (!peek_pipe_unavailable) {
+	/* `tee' copies the bytes into `peek_pipe', which is empty here, so it
+	 * does not block as long as `fd' is ready for reading. */
+	ssize_t count = tee(fd, peek_pipe[PIPE_OUT], size, 0);
+	if (count == 0)
+	    return 0;
+	if (count > 0) {
+	    ssize_t readcount = read(peek_pipe[PIPE_IN], buf, (size_t) count);
+	    if (readcount == count) {
+		*peeked = (size_t) count;
+		return count;
+	    }
+	    /* `peek_pipe' may not be empty now, so we never use it again. */
+	    close_peek_pipe();
+	    peek_pipe_unavailable = true;
+	} else if (errno == EINVAL) {
+	    peek_pipe_unavailable = true;
+	}
+    }
+
+    return read(fd, buf, 1);
+}
+
+/* Closes `peek_pipe' if open. */
+void close_peek_pipe(void)
+{
+    for (int i = 0; i < 2; i++) {
+	if (peek_pipe[i] >= 0) {
+	    remove_shellfd(peek_pipe[i]);
+	    xclose(peek_pipe[i]);
+	    peek_pipe[i] = -1;
+	}
+    }
+}
+
+#endif /* HAVE_TEE */
+
+/* Reads and discards `size' bytes from `fd', using `buf' as a scratch area.
+ * The bytes must be already available in `fd', which is the case when they
+ * have been peeked by `peek_input'.
+ * Returns false on error with `errno' set. */
+bool skip_input(int fd, char *buf, size_t size)
+{
+    while (size > 0) {
+	ssize_t count = read(fd, buf, size);
+	if (count < 0) {
+	    if (errno == EINTR)
+		continue;
+	    return false;
+	}
+	if (count == 0)
+	    break;
+	size -= (size_t) count;
+    }
+    return true;
+}
+
+/* The maximum size of a file that `read_input_text' reads at once. */
+#define INPUT_TEXT_SIZE_MAX (8 << 20)
+
+/* Reads the rest of regular file `fd' at once and decodes it into
+ * `info->text' so that the text can be input by `input_text' line by line.
+ * The text ends before a null byte, an invalid character, or an incomplete
+ * character at the end of the file, if any. Such bytes are left unread in the
+ * file, from which `input_text' reads through `info->fileinfo' after the text,
+ * so that errors are reported and bytes appended to the file are read as if
+ * the file were read by `input_file'.
+ * `size' is the current size of the file.
+ * Returns false if the file is too large or cannot be read, in which case the
+ * offset of `fd' is not changed and `info' is not initialized.
+ * If successful, `info' must be freed by `destroy_input_text' after use. */
+bool read_input_text(int fd, off_t size, struct input_text_info_T *info)
+{
+    off_t offset = lseek(fd, 0, SEEK_CUR);
+    if (offset < 0 || size - offset > INPUT_TEXT_SIZE_MAX)
+	return false;
+
+    /* Read one more byte than expected to make sure we reach the end of file
+     * even if the file has grown. */
+    size_t bufsize = (size > offset) ? (size_t) (size - offset) + 1 : 1;
+    struct input_file_info_T *finfo =
+	xmallocs(sizeof *finfo, bufsize, sizeof *finfo->buf);
+    finfo->fd = fd;
+    memset(&finfo->state, 0, sizeof finfo->state);  // initial shift state
+    finfo->bufpos = finfo->bufmax = 0;
+    finfo->bufsize = bufsize;
+
+    for (;;) {
+	if (finfo->bufmax == finfo->bufsize) {
+	    if (finfo->bufsize >= INPUT_TEXT_SIZE_MAX) {
+		free(finfo);
+		lseek(fd, offset, SEEK_SET);
+		return false;
+	    }
+	    finfo->bufsize = mul(finfo->bufsize, 2);
+	    finfo = xreallocs(finfo,
+		    sizeof *finfo, finfo->bufsize, sizeof *finfo->buf);
+	}
+	ssize_t count = read(fd, &finfo->buf[finfo->bufmax],
+		finfo->bufsize - finfo->bufmax);
+	if (count < 0) {
+	    if (errno == EINTR)
+		continue;
+	    free(finfo);
+	    lseek(fd, offset, SEEK_SET);
+	    return false;
+	}
+	if (count == 0)
+	    break;
+	finfo->bufmax += (size_t) count;
+    }
+
+    /* The result never has more characters than the bytes in the file. */
+    xwcsbuf_T text;
+    wb_initwithmax(&text, finfo->bufmax);
+    while (convert_input(&text, finfo) == CONVERT_LINE)
+	if (finfo->bufpos < finfo->bufmax
+		&& finfo->buf[finfo->bufpos] == '\0')
+	    break;  /* null byte */
+    info->text = wb_towcs(&text);
+    info->src = info->text;
+    info->end = &info->text[text.length];
+
+    /* Leave the bytes that have not been converted for `input_text'. They are
+     * kept in memory only if we cannot rewind the file. */
+    size_t rest = finfo->bufmax - finfo->bufpos;
+    if (rest > 0 && lseek(fd, -(off_t) rest, SEEK_CUR) >= 0)
+	rest = 0;
+    memmove(finfo->buf, &finfo->buf[finfo->bufpos], rest);
+    finfo->bufpos = 0;
+    finfo->bufmax = rest;
+    finfo->bufsize = (rest > BUFSIZ) ? rest : BUFSIZ;
+    info->fileinfo = xreallocs(finfo,
+	    sizeof *finfo, finfo->bufsize, sizeof *finfo->buf);
+    return true;
+}
+
+/* Frees the text read by `read_input_text'. */
+void destroy_input_text(struct input_text_info_T *info)
+{
+    free(info->text);
+    free(info->fileinfo);
+}
+
 /* An input function that prints a prompt and reads input.
  * `inputinfo' is a pointer to a `struct input_interactive_info'.
  * `inputinfo->type' must be either 1 or 2, which specifies the prompt type.
@@ -20,6 +20,7 @@
 #define YASH_INPUT_H
 
 #include <stdlib.h>
+#include <sys/types.h>
 #include <wchar.h>
 
 
@@ -56,9 +57,18 @@ typedef enum inputresult_T {
 
 struct xwcsbuf_T;
 struct input_file_info_T;
+struct input_text_info_T;
 extern inputresult_T read_input(
 	struct xwcsbuf_T *buf, struct input_file_info_T *info, _Bool trap)
     __attribute__((nonnull));
+extern _Bool read_input_text(
+	int fd, off_t size, struct input_text_info_T *info)
+    __attribute__((nonnull));
+extern void destroy_input_text(struct input_text_info_T *info)
+    __attribute__((nonnull));
+#if HAVE_TEE
+extern void close_peek_pipe(void);
+#endif
 
 /* The type of input functions.
  * An input function reads input and appends it to buffer `buf'.
@@ -77,6 +87,8 @@ typedef inputresult_T inputfunc_T(struct xwcsbuf_T *buf, void *inputinfo);
 /* input functions */
 extern inputresult_T input_wcs(struct xwcsbuf_T *buf, void *inputinfo)
     __attribute__((nonnull));
+extern inputresult_T input_text(struct xwcsbuf_T *buf, void *inputinfo)
+    __attribute__((nonnull));
 extern inputresult_T input_file(struct xwcsbuf_T *buf, void *inputinfo)
     __attribute__((nonnull));
 extern inputresult_T input_interactive(struct xwcsbuf_T *buf, void *inputinfo)
@@ -87,6 +99,14 @@ struct input_wcs_info_T {
     const wchar_t *src;  /* the input source code */
 };
 
+/* to be used as `inputinfo' for `input_text' */
+struct input_text_info_T {
+    wchar_t *text;        /* the whole text decoded from the input file */
+    const wchar_t *src;   /* the position of the next line in `text' */
+    const wchar_t *end;   /* the end of `text' */
+    struct input_file_info_T *fileinfo;  /* input following `text' */
+};
+
 /* to be used as `inputinfo' for `input_file' */
 struct input_file_info_T {
     int fd;
@@ -35,6 +35,7 @@
 #include <wctype.h>
 #include "builtin.h"
 #include "exec.h"
+#include "hashtable.h"
 #include "option.h"
 #include "plist.h"
 #include "redir.h"
@@ -54,6 +55,16 @@
 static inline job_T *get_job(size_t jobnumber)
     __attribute__((pure));
 static inline void free_job(job_T *job);
+static inline bool is_legacy(const job_T *job)
+    __attribute__((nonnull,pure));
+static void index_job_processes(size_t jobnumber);
+static void unindex_job_processes(size_t jobnumber);
+static hashval_T hashpid(const void *key)
+    __attribute__((const));
+static int htpidcmp(const void *key1, const void *key2)
+    __attribute__((const));
+static void set_job_status(job_T *job, jobstatus_T status)
+    __attribute__((nonnull));
 static void trim_joblist(void);
 static void set_current_jobnumber(size_t jobnumber);
 static size_t find_next_job(size_t numlimit);
@@ -95,12 +106,30 @@ static plist_T joblist;
 /* number of the current/previous jobs. 0 if none. */
 static size_t current_jobnumber, previous_jobnumber;
 
+/* The index of processes in the job list.
+ * The keys are process IDs and the values are the numbers of the jobs that
+ * contain the processes, both cast to (void *). Processes that have not been
+ * `fork'ed (whose `pr_pid' is 0) are not in the index. If a process ID has been
+ * reused, only the newest job containing the ID is indexed; the process in the
+ * older job has already finished anyway. */
+static hashtable_T pidindex;
+
+/* number of jobs whose status is JS_STOPPED in the job list */
+static size_t stopped_jobs;
+
+/* Every job number less than this is used, except for ACTIVE_JOBNO. */
+static size_t free_jobnumber_hint = 1;
+
+/* Incremented when the shell becomes a subshell. See `is_legacy'. */
+static unsigned job_generation;
+
 /* Initializes the job list. */
 void init_job(void)
 {
     assert(joblist.contents == NULL);
     pl_init(&joblist);
     pl_add(&joblist, NULL);
+    ht_init(&pidindex, hashpid, htpidcmp);
 }
 
 /* Sets the active job. */
@@ -109,6 +138,10 @@ void set_active_job(job_T *job)
     assert(ACTIVE_JOBNO < joblist.length);
     assert(joblist.contents[ACTIVE_JOBNO] == NULL);
     joblist.contents[ACTIVE_JOBNO] = job;
+    job->j_generation = job_generation;
+    index_job_processes(ACTIVE_JOBNO);
+    if (job->j_status == JS_STOPPED)
+	stopped_jobs++;
 }
 
 /* Moves the active job into the job list.
@@ -124,7 +157,9 @@ void add_job(bool current)
     joblist.contents[ACTIVE_JOBNO] = NULL;
 
     /* if there is an empty element in the list, use it */
-    for (jobnumber = 1; jobnumber < joblist.length; jobnumber++) {
+    for (jobnumber = free_jobnumber_hint;
+	    jobnumber < joblist.length;
+	    jobnumber++) {
 	if (joblist.contents[jobnumber] == NULL) {
 	    joblist.contents[jobnumber] = job;
 	    goto set_current;
@@ -136,6 +171,8 @@ void add_job(bool current)
 
 set_current:
     assert(joblist.contents[jobnumber] == job);
+    free_jobnumber_hint = jobnumber + 1;
+    index_job_processes(jobnumber);
     if (job->j_status == JS_STOPPED || current)
 	set_current_jobnumber(jobnumber);
     else
@@ -153,8 +190,16 @@ job_T *get_job(size_t jobnumber)
  * (another job is assigned to it). */
 void remove_job(size_t jobnumber)
 {
-    free_job(get_job(jobnumber));
-    joblist.contents[jobnumber] = NULL;
+    job_T *job = get_job(jobnumber);
+    if (job != NULL) {
+	unindex_job_processes(jobnumber);
+	if (job->j_status == JS_STOPPED)
+	    stopped_jobs--;
+	free_job(job);
+	joblist.contents[jobnumber] = NULL;
+	if (jobnumber != ACTIVE_JOBNO && jobnumber < free_jobnumber_hint)
+	    free_jobnumber_hint = jobnumber;
+    }
     trim_joblist();
     set_current_jobnumber(current_jobnumber);
 }
@@ -166,6 +211,9 @@ void remove_all_jobs(void)
 	free_job(joblist.contents[i]);
 	joblist.contents[i] = NULL;
     }
+    ht_clear(&pidindex, NULL);
+    stopped_jobs = 0;
+    free_jobnumber_hint = 1;
     trim_joblist();
     current_jobnumber = previous_jobnumber = 0;
 }
@@ -180,6 +228,45 @@ void free_job(job_T *job)
     }
 }
 
+/* Adds the processes of the job of the specified number to `pidindex'. */
+void index_job_processes(size_t jobnumber)
+{
+    const job_T *job = joblist.contents[jobnumber];
+    for (size_t i = 0; i < job->j_pcount; i++) {
+	pid_t pid = job->j_procs[i].pr_pid;
+	if (pid > 0)
+	    ht_set(&pidindex, (void *) (intptr_t) pid,
+		    (void *) (uintptr_t) jobnumber);
+    }
+}
+
+/* Removes the processes of the job of the specified number from `pidindex'.
+ * A process is not removed if its ID has been reused by another job. */
+void unindex_job_processes(size_t jobnumber)
+{
+    const job_T *job = joblist.contents[jobnumber];
+    for (size_t i = 0; i < job->j_pcount; i++) {
+	pid_t pid = job->j_procs[i].pr_pid;
+	if (pid <= 0)
+	    continue;
+	kvpair_T kv = ht_get(&pidindex, (void *) (intptr_t) pid);
+	if (kv.key != NULL && (size_t) (uintptr_t) kv.value == jobnumber)
+	    ht_remove(&pidindex, kv.key);
+    }
+}
+
+/* Hashes a process ID in `pidindex'. */
+hashval_T hashpid(const void *key)
+{
+    return (hashval_T) (uintptr_t) key;
+}
+
+/* Compares two process IDs in `pidindex'. */
+int htpidcmp(const void *key1, const void *key2)
+{
+    return key1 != key2;
+}
+
 /* Shrink the job list, removing unused elements. */
 void trim_joblist(void)
 {
@@ -195,18 +282,22 @@ void trim_joblist(void)
     }
 }
 
-/* Sets the `j_legacy' flags of all jobs.
- * All the jobs will be no longer job-controlled. */
+/* Makes all the existing jobs legacy.
+ * All the jobs will be no longer job-controlled.
+ * The jobs are not modified in this function so that a subshell with many jobs
+ * does not have to copy the memory of the job list. */
 void neglect_all_jobs(void)
 {
-    for (size_t i = 0; i < joblist.length; i++) {
-	job_T *job = joblist.contents[i];
-	if (job != NULL)
-	    job->j_legacy = true;
-    }
+    job_generation++;
     current_jobnumber = previous_jobnumber = 0;
 }
 
+/* Checks if the specified job was started by a parent shell process. */
+bool is_legacy(const job_T *job)
+{
+    return job->j_generation != job_generation;
+}
+
 /* Current/previous job selection discipline:
  *
  * - When there is one or more stopped jobs, the current job must be one of
@@ -279,17 +370,20 @@ void set_current_jobnumber(size_t jobnumber)
  * If there are more than one stopped jobs, the previous job is preferred. */
 size_t find_next_job(size_t excl)
 {
-    if (previous_jobnumber != excl) {
-	job_T *job = get_job(previous_jobnumber);
-	if (job != NULL && job->j_status == JS_STOPPED)
-	    return previous_jobnumber;
-    }
-    size_t jobnumber = joblist.length;
-    while (--jobnumber > 0) {
-	if (jobnumber != excl) {
-	    job_T *job = get_job(jobnumber);
+    size_t jobnumber;
+    if (stopped_jobs > 0) {
+	if (previous_jobnumber != excl) {
+	    job_T *job = get_job(previous_jobnumber);
 	    if (job != NULL && job->j_status == JS_STOPPED)
-		return jobnumber;
+		return previous_jobnumber;
+	}
+	jobnumber = joblist.length;
+	while (--jobnumber > 0) {
+	    if (jobnumber != excl) {
+		job_T *job = get_job(jobnumber);
+		if (job != NULL && job->j_status == JS_STOPPED)
+		    return jobnumber;
+	    }
 	}
     }
     jobnumber = joblist.length;
@@ -336,13 +430,18 @@ size_t job_count(void)
 /* Counts the number of stopped jobs in the job list. */
 size_t stopped_job_count(void)
 {
-    size_t count = 0;
-    for (size_t i = 0; i < joblist.length; i++) {
-	job_T *job = joblist.contents[i];
-	if (job != NULL && job->j_status == JS_STOPPED)
-	    count++;
-    }
-    return count;
+    return stopped_jobs;
+}
+
+/* Changes the status of the specified job in the job list, updating the count
+ * of stopped jobs. */
+void set_job_status(job_T *job, jobstatus_T status)
+{
+    if (job->j_status == JS_STOPPED)
+	stopped_jobs--;
+    if (status == JS_STOPPED)
+	stopped_jobs++;
+    job->j_status = status;
 }
 
 
@@ -386,17 +485,18 @@ start:
 	return;
     }
 
-    size_t jobnumber, pnumber;
     job_T *job;
     process_T *pr;
 
-    /* determine `jobnumber', `job' and `pr' from `pid' */
-    for (jobnumber = 0; jobnumber < joblist.length; jobnumber++)
-	if ((job = joblist.contents[jobnumber]) != NULL)
-	    for (pnumber = 0; pnumber < job->j_pcount; pnumber++)
-		if ((pr = &job->j_procs[pnumber])->pr_pid == pid &&
-			pr->pr_status != JS_DONE)
-		    goto found;
+    /* determine `job' and `pr' from `pid' */
+    kvpair_T kv = ht_get(&pidindex, (void *) (intptr_t) pid);
+    if (kv.key != NULL) {
+	job = joblist.contents[(size_t) (uintptr_t) kv.value];
+	for (size_t pnumber = 0; pnumber < job->j_pcount; pnumber++)
+	    if ((pr = &job->j_procs[pnumber])->pr_pid == pid &&
+		    pr->pr_status != JS_DONE)
+		goto found;
+    }
 
     /* If `pid' was not found in the job list, we simply ignore it. This may
      * happen on some occasions: e.g. the job has been "disown"ed. */
@@ -430,7 +530,8 @@ found:
 	}
     }
 out_of_loop:
-    job->j_status = anyrunning ? JS_RUNNING : anystopped ? JS_STOPPED : JS_DONE;
+    set_job_status(job,
+	    anyrunning ? JS_RUNNING : anystopped ? JS_STOPPED : JS_DONE);
     if (job->j_status != oldstatus)
 	job->j_statuschanged = true;
 
@@ -456,7 +557,7 @@ int wait_for_job(size_t jobnumber, bool return_on_stop,
     int signum = 0;
     job_T *job = joblist.contents[jobnumber];
 
-    if (!job->j_legacy) {
+    if (!is_legacy(job)) {
 	bool savenonotify = job->j_nonotify;
 	job->j_nonotify = true;
 	for (;;) {
@@ -494,7 +595,6 @@ wchar_t **wait_for_child(pid_t cpid, pid_t cpgid, bool return_on_stop)
     job->j_pgid = cpgid;
     job->j_status = JS_RUNNING;
     job->j_statuschanged = false;
-    job->j_legacy = false;
     job->j_nonotify = false;
     job->j_pcount = 1;
     job->j_procs[0].pr_pid = cpid;
@@ -530,7 +630,7 @@ pid_t get_job_pgid(const wchar_t *jobname)
 	return -1;
     } else if (jobnumber == 0
 	    || (job = joblist.contents[jobnumber]) == NULL
-	    || job->j_legacy) {
+	    || is_legacy(job)) {
 	xerror(0, Ngt("no such job `%ls'"), jobname);
 	return -1;
     } else if (job->j_pgid == 0) {
@@ -926,19 +1026,10 @@ size_t get_jobnumber_from_name(const wchar_t *name)
  * If not found, 0 is returned. */
 size_t get_jobnumber_from_pid(long pid)
 {
-    size_t jobnumber;
-    if (pid == 0)
+    if (pid <= 0 || pid != (pid_t) pid)
 	return 0;
-    for (jobnumber = joblist.length; --jobnumber > 0; ) {
-	job_T *job = joblist.contents[jobnumber];
-	if (job != NULL) {
-	    for (size_t i = 0; i < job->j_pcount; i++)
-		if (job->j_procs[i].pr_pid == pid)
-		    goto found;
-	}
-    }
-found:
-    return jobnumber;
+    kvpair_T kv = ht_get(&pidindex, (void *) (intptr_t) pid);
+    return (kv.key != NULL) ? (size_t) (uintptr_t) kv.value : 0;
 }
 
 #if YASH_ENABLE_LINEEDIT
@@ -1158,7 +1249,7 @@ int fg_builtin(int argc, void **argv)
 			ARGV(xoptind));
 	    } else if (jobnumber == 0
 		    || (job = joblist.contents[jobnumber]) == NULL
-		    || job->j_legacy) {
+		    || is_legacy(job)) {
 		xerror(0, Ngt("no such job `%ls'"), ARGV(xoptind));
 	    } else if (job->j_pgid == 0) {
 		xerror(0, Ngt("`%ls' is not a job-controlled job"),
@@ -1169,7 +1260,7 @@ int fg_builtin(int argc, void **argv)
 	} while (++xoptind < argc);
     } else {
 	if (current_jobnumber == 0 ||
-		(job = joblist.contents[current_jobnumber])->j_legacy) {
+		is_legacy(job = joblist.contents[current_jobnumber])) {
 	    xerror(0, Ngt("there is no current job"));
 	} else if (job->j_pgid == 0) {
 	    xerror(0, Ngt("the current job is not a job-controlled job"));
@@ -1190,7 +1281,7 @@ int fg_builtin(int argc, void **argv)
 int continue_job(size_t jobnumber, job_T *job, bool fg)
 {
     assert(job->j_pgid > 0);
-    assert(!job->j_legacy);
+    assert(!is_legacy(job));
 
     wchar_t *name = get_job_name(job);
     if (fg && posixly_correct)
@@ -1208,7 +1299,7 @@ int continue_job(size_t jobnumber, job_T *job, bool fg)
 	if (fg)
 	    put_foreground(job->j_pgid);
 	if (kill(-job->j_pgid, SIGCONT) >= 0)
-	    job->j_status = JS_RUNNING;
+	    set_job_status(job, JS_RUNNING);
     } else {
 	if (!fg)
 	    xerror(0, Ngt("job %%%zu has already terminated"), jobnumber);
@@ -1341,7 +1432,7 @@ int wait_for_job_by_jobspec(const wchar_t *jobspec)
     job_T *job;
     if (jobnumber == 0
 	    || (job = joblist.contents[jobnumber]) == NULL
-	    || job->j_legacy)
+	    || is_legacy(job))
 	return Exit_NOTFOUND;
 
     int signal = wait_for_job(jobnumber,
@@ -1369,7 +1460,7 @@ bool wait_builtin_has_job(bool jobcontrol)
 	job_T *job = joblist.contents[i];
 	if (jobcontrol && is_interactive_now && !posixly_correct)
 	    print_job_status(i, true, false, false, stdout);
-	if (job != NULL && (job->j_legacy || job->j_status == JS_DONE))
+	if (job != NULL && (is_legacy(job) || job->j_status == JS_DONE))
 	    remove_job(i);
     }
 
@@ -834,6 +834,7 @@ wordunit_T *cparse_paramexp_raw(le_contexttype_T ctxttype)
 	wu->wu_param = xmalloc(sizeof *wu->wu_param);
 	wu->wu_param->pe_type = PT_MINUS;
 	wu->wu_param->pe_name = xwcsndup(&BUF[INDEX + 1], namelen);
+	wu->wu_param->pe_symbol = NULL;
 	wu->wu_param->pe_start = wu->wu_param->pe_end =
 	wu->wu_param->pe_match = wu->wu_param->pe_subst = NULL;
     }
@@ -854,6 +855,7 @@ wordunit_T *cparse_paramexp_in_brace(le_contexttype_T ctxttype)
     paramexp_T *pe = xmalloc(sizeof *pe);
     pe->pe_type = 0;
     pe->pe_name = NULL;
+    pe->pe_symbol = NULL;
     pe->pe_start = pe->pe_end = pe->pe_match = pe->pe_subst = NULL;
 
     const size_t origindex = INDEX;
@@ -1033,6 +1035,7 @@ check_closing_paren:
 	    paramexp_T *pe2 = xmalloc(sizeof *pe2);
 	    pe2->pe_type = PT_MINUS;
 	    pe2->pe_name = pe->pe_name;
+	    pe2->pe_symbol = pe->pe_symbol;
 	    pe2->pe_start = pe2->pe_end = pe2->pe_match = pe2->pe_subst = NULL;
 
 	    wordunit_T *nest = xmalloc(sizeof *nest);
@@ -42,8 +42,7 @@
 static void reader_init(bool trap);
 static void reader_finalize(void);
 static void read_next(void);
-static int get_read_timeout(void)
-    __attribute__((pure));
+static int get_read_timeout(void);
 static char pop_prebuffer(void);
 static inline bool has_meta_bit(char c)
     __attribute__((pure));
@@ -91,6 +91,10 @@ bool shopt_allexport = false;
 bool shopt_hashondef = false;
 /* If set, the 'for' loop iteration variable will be made local. */
 bool shopt_forlocal = true;
+/* If set, the commands parsed from a file read by the dot built-in are cached
+ * and reused while the file is not modified. Corresponds to the --parsecache
+ * option. */
+bool shopt_parsecache = true;
 
 /* If set, when a command returns a non-zero status, the shell exits.
  * Corresponds to the -e/--errexit option. */
@@ -252,6 +256,7 @@ static const struct option_T shell_options[] = {
     { 0,    0,    L"notifyle",       &shopt_notifyle,       true, },
 #endif
     { 0,    0,    L"nullglob",       &shopt_nullglob,       true, },
+    { 0,    0,    L"parsecache",     &shopt_parsecache,     true, },
     { 0,    0,    L"pipefail",       &shopt_pipefail,       true, },
     { 0,    0,    L"posixlycorrect", &posixly_correct,      true, },
     { L's', 0,    L"stdin",          &shopt_stdin,          false, },
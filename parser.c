@@ -40,6 +40,8 @@
 #include "plist.h"
 #include "strbuf.h"
 #include "util.h"
+#include "variable.h"
+#include "xfnmatch.h"
 #if YASH_ENABLE_DOUBLE_BRACKET
 # include "builtins/test.h"
 #endif
@@ -48,6 +50,169 @@
 #endif
 
 
+/********** Arenas for Parse Trees **********/
+
+/* Unit of memory allocated in an arena. Every allocation is rounded up to a
+ * multiple of the size of this union so that any parse tree element is
+ * properly aligned. */
+typedef union arenaunit_T {
+    void *pointer;
+    long number;
+    double floating;
+} arenaunit_T;
+
+/* chunk of memory from which allocations in an arena are taken */
+struct arenachunk_T {
+    struct arenachunk_T *prev;
+    arenaunit_T data[];
+};
+
+/* element of a list of objects that must be finalized when an arena is freed */
+struct arenaref_T {
+    struct arenaref_T *next;
+    void *object;
+};
+
+/* Sizes of chunks, including the header. The first chunk, which also contains
+ * the arena itself, is small so that a short command does not waste much
+ * memory when the parse tree is kept for a long time. The parser sets
+ * `chunksize' of the arena to a size between the minimum and maximum before
+ * the next chunk is allocated. Otherwise, each following chunk is twice as
+ * large as the previous, up to the maximum. */
+#define ARENA_FIRST_CHUNK_SIZE 512
+#define ARENA_MIN_CHUNK_SIZE   256
+#define ARENA_MAX_CHUNK_SIZE   65536
+
+static parsearena_T *new_arena(void)
+    __attribute__((malloc,warn_unused_result));
+static void *arena_alloc(parsearena_T *arena, size_t size)
+    __attribute__((nonnull,malloc,warn_unused_result));
+static void *arena_alloc_new_chunk(parsearena_T *arena, size_t size)
+    __attribute__((nonnull,malloc,warn_unused_result));
+static void arena_free_last(parsearena_T *arena, void *p, size_t size)
+    __attribute__((nonnull));
+static void arena_add_ref(
+	parsearena_T *arena, struct arenaref_T **listp, void *object)
+    __attribute__((nonnull(1,2)));
+static void arenafree(parsearena_T *arena)
+    __attribute__((nonnull));
+static void casepatternsfree(caseitem_T *ci)
+    __attribute__((nonnull));
+
+/* Creates a new empty arena whose reference count is one. */
+parsearena_T *new_arena(void)
+{
+    struct arenachunk_T *chunk = xmalloc(ARENA_FIRST_CHUNK_SIZE);
+    chunk->prev = NULL;
+
+    size_t headersize = (sizeof (parsearena_T) + sizeof (arenaunit_T) - 1)
+	/ sizeof (arenaunit_T) * sizeof (arenaunit_T);
+    parsearena_T *arena = (parsearena_T *) chunk->data;
+    arena->refcount = 1;
+    arena->chunks = chunk;
+    arena->next = (char *) chunk->data + headersize;
+    arena->end = (char *) chunk + ARENA_FIRST_CHUNK_SIZE;
+    arena->chunksize = 2 * ARENA_FIRST_CHUNK_SIZE;
+    arena->symbols = NULL;
+    arena->caseitems = NULL;
+    return arena;
+}
+
+/* Rounds up the size to a multiple of the size of `arenaunit_T'. */
+#define ARENA_ROUNDUP(size) \
+    (add(size, sizeof (arenaunit_T) - 1) \
+     / sizeof (arenaunit_T) * sizeof (arenaunit_T))
+
+/* Allocates a memory block of the specified size in the arena.
+ * The block is valid until the arena is freed. */
+void *arena_alloc(parsearena_T *arena, size_t size)
+{
+    size = ARENA_ROUNDUP(size);
+    if (size > (size_t) (arena->end - arena->next))
+	return arena_alloc_new_chunk(arena, size);
+
+    void *result = arena->next;
+    arena->next += size;
+    return result;
+}
+
+/* Allocates a new chunk and a memory block of the specified size in it.
+ * `size' must be a multiple of the size of `arenaunit_T'. */
+void *arena_alloc_new_chunk(parsearena_T *arena, size_t size)
+{
+    size_t chunksize = arena->chunksize;
+    if (chunksize - sizeof (struct arenachunk_T) < size)
+	chunksize = add(size, sizeof (struct arenachunk_T));
+    else if (arena->chunksize < ARENA_MAX_CHUNK_SIZE)
+	arena->chunksize *= 2;
+
+    struct arenachunk_T *chunk = xmalloc(chunksize);
+    chunk->prev = arena->chunks;
+    arena->chunks = chunk;
+
+    char *result = (char *) chunk->data;
+    arena->next = result + size;
+    arena->end = (char *) chunk + chunksize;
+    return result;
+}
+
+/* Frees the memory block of the specified size if it is the last block
+ * allocated in the arena. Otherwise, does nothing. */
+void arena_free_last(parsearena_T *arena, void *p, size_t size)
+{
+    if ((char *) p + ARENA_ROUNDUP(size) == arena->next)
+	arena->next = p;
+}
+
+/* Adds the object to the list that is processed when the arena is freed. */
+void arena_add_ref(parsearena_T *arena, struct arenaref_T **listp, void *object)
+{
+    if (object == NULL)
+	return;
+
+    struct arenaref_T *ref = arena_alloc(arena, sizeof *ref);
+    ref->next = *listp;
+    ref->object = object;
+    *listp = ref;
+}
+
+/* Decrements the reference count of the arena and, if it reaches zero, frees
+ * the arena and everything allocated in it. */
+void arenafree(parsearena_T *arena)
+{
+    if (!refcount_decrement(&arena->refcount))
+	return;
+
+    for (struct arenaref_T *ref = arena->symbols; ref != NULL; ref = ref->next)
+	release_variable_name(ref->object);
+    for (struct arenaref_T *ref = arena->caseitems; ref != NULL;
+	    ref = ref->next)
+	casepatternsfree(ref->object);
+
+    /* The first chunk contains the arena itself, so it is freed last. */
+    struct arenachunk_T *chunk = arena->chunks;
+    while (chunk != NULL) {
+	struct arenachunk_T *prev = chunk->prev;
+	free(chunk);
+	chunk = prev;
+    }
+}
+
+/* Frees the compiled patterns cached in the case item, if any. */
+void casepatternsfree(caseitem_T *ci)
+{
+    if (ci->ci_compiled != NULL) {
+	casepattern_T *cp = ci->ci_compiled;
+	for (void **pats = ci->ci_patterns; *pats != NULL; pats++, cp++) {
+	    free(cp->cp_text);
+	    xfnm_free(cp->cp_xfnm);
+	}
+	free(ci->ci_compiled);
+	ci->ci_compiled = NULL;
+    }
+}
+
+
 /********** Functions That Free Parse Trees **********/
 
 static void pipesfree(pipeline_T *p);
@@ -65,6 +230,11 @@ static void embedcmdfree(embedcmd_T c);
 
 void andorsfree(and_or_T *a)
 {
+    if (a != NULL && a->ao_arena != NULL) {
+	arenafree(a->ao_arena);
+	return;
+    }
+
     while (a != NULL) {
 	pipesfree(a->ao_pipelines);
 
@@ -87,6 +257,11 @@ void pipesfree(pipeline_T *p)
 
 void comsfree(command_T *c)
 {
+    if (c != NULL && c->c_arena != NULL) {
+	arenafree(c->c_arena);
+	return;
+    }
+
     while (c != NULL) {
 	if (!refcount_decrement(&c->refcount))
 	    break;
@@ -149,6 +324,7 @@ void ifcmdsfree(ifcommand_T *i)
 void caseitemsfree(caseitem_T *i)
 {
     while (i != NULL) {
+	casepatternsfree(i);
 	plfree(i->ci_patterns, wordfree_vp);
 	andorsfree(i->ci_commands);
 
@@ -219,10 +395,12 @@ void wordfree_vp(void *w)
 void paramfree(paramexp_T *p)
 {
     if (p != NULL) {
-	if (p->pe_type & PT_NEST)
+	if (p->pe_type & PT_NEST) {
 	    wordfree(p->pe_nest);
-	else
+	} else {
 	    free(p->pe_name);
+	    release_variable_name(p->pe_symbol);
+	}
 	wordfree(p->pe_start);
 	wordfree(p->pe_end);
 	wordfree(p->pe_match);
@@ -235,6 +413,7 @@ void assignsfree(assign_T *a)
 {
     while (a != NULL) {
 	free(a->a_name);
+	release_variable_name(a->a_symbol);
 	switch (a->a_type) {
 	    case A_SCALAR:
 		wordfree(a->a_scalar);
@@ -561,8 +740,35 @@ typedef struct parsestate_T {
     /* record of alias substitutions that are responsible for the current
      * `index' */
     struct aliaslist_T *aliases;
+    /* the arena in which the parse tree is allocated (may be NULL) */
+    parsearena_T *arena;
 } parsestate_T;
 
+static void *palloc(parsestate_T *ps, size_t size)
+    __attribute__((nonnull,malloc,warn_unused_result));
+static wchar_t *pwcsndup(parsestate_T *restrict ps, const wchar_t *restrict s,
+	size_t len)
+    __attribute__((nonnull,malloc,warn_unused_result));
+static wchar_t *pwcs(parsestate_T *ps, wchar_t *s)
+    __attribute__((nonnull,malloc,warn_unused_result));
+static void **ptoary(parsestate_T *ps, plist_T *list)
+    __attribute__((nonnull,malloc,warn_unused_result));
+static struct varsymbol_T *psymbol(
+	parsestate_T *ps, struct varsymbol_T *symbol)
+    __attribute__((nonnull(1)));
+static void pcaseitem(parsestate_T *ps, caseitem_T *ci)
+    __attribute__((nonnull));
+static void pfree(parsestate_T *ps, void *p)
+    __attribute__((nonnull(1)));
+static void pandorsfree(parsestate_T *ps, and_or_T *a)
+    __attribute__((nonnull(1)));
+static void pcomsfree(parsestate_T *ps, command_T *c)
+    __attribute__((nonnull(1)));
+static void pwordunitfree(parsestate_T *ps, wordunit_T *wu)
+    __attribute__((nonnull));
+static void pwordfree(parsestate_T *ps, wordunit_T *w)
+    __attribute__((nonnull(1)));
+
 static void serror(parsestate_T *restrict ps, const char *restrict format, ...)
     __attribute__((nonnull(1,2),format(printf,2,3)));
 static void print_errmsg_token(parsestate_T *ps, const char *message)
@@ -597,6 +803,8 @@ static wordunit_T *tryparse_paramexp_raw(parsestate_T *ps)
     __attribute__((nonnull,malloc,warn_unused_result));
 static wordunit_T *parse_paramexp_in_brace(parsestate_T *ps)
     __attribute__((nonnull,malloc,warn_unused_result));
+static struct varsymbol_T *intern_parameter_name(const wchar_t *name)
+    __attribute__((nonnull,warn_unused_result));
 static wordunit_T *parse_cmdsubst_in_paren(parsestate_T *ps)
     __attribute__((nonnull,malloc,warn_unused_result));
 static embedcmd_T extract_command_in_paren(parsestate_T *ps)
@@ -747,6 +955,7 @@ parseresult_T read_and_parse(parseparam_T *info, and_or_T **restrict resultp)
 	.enable_alias = info->enable_alias,
 	.reparse = false,
 	.aliases = NULL,
+	.arena = new_arena(),
     };
 
     if (ps.info->interactive) {
@@ -766,28 +975,29 @@ parseresult_T read_and_parse(parseparam_T *info, and_or_T **restrict resultp)
     wb_destroy(&ps.src);
     pl_destroy(&ps.pending_heredocs);
     destroy_aliaslist(ps.aliases);
-    wordfree(ps.token);
 
     switch (ps.info->lastinputresult) {
 	case INPUT_OK:
 	case INPUT_EOF:
 	    if (ps.error) {
-		andorsfree(r);
+		arenafree(ps.arena);
 		return PR_SYNTAX_ERROR;
 	    } else if (length == 0) {
-		andorsfree(r);
+		arenafree(ps.arena);
 		return PR_EOF;
 	    } else {
 		assert(ps.index == length);
+		if (r == NULL)
+		    arenafree(ps.arena);
 		*resultp = r;
 		return PR_OK;
 	    }
 	case INPUT_INTERRUPTED:
-	    andorsfree(r);
+	    arenafree(ps.arena);
 	    *resultp = NULL;
 	    return PR_OK;
 	case INPUT_ERROR:
-	    andorsfree(r);
+	    arenafree(ps.arena);
 	    return PR_INPUT_ERROR;
     }
     assert(false);
@@ -813,6 +1023,7 @@ bool parse_string(parseparam_T *info, wordunit_T **restrict resultp)
 	.enable_alias = false,
 	.reparse = false,
 	.aliases = NULL,
+	.arena = NULL,
     };
     wb_init(&ps.src);
 
@@ -837,6 +1048,131 @@ bool parse_string(parseparam_T *info, wordunit_T **restrict resultp)
     }
 }
 
+/***** Memory allocation *****/
+
+/* The following functions allocate and free parse tree elements in the arena
+ * if `ps->arena' is non-NULL or in the heap otherwise. In an arena, elements
+ * are never freed individually: an element discarded during parsing remains
+ * in the arena until the whole arena is freed. */
+
+/* The estimated number of bytes of parse tree elements per character of
+ * source code. When the current chunk of the arena is exhausted, the next chunk
+ * is sized for the source code that has been read but not yet parsed. */
+#define ARENA_BYTES_PER_CHAR 24
+
+/* Allocates a parse tree element. */
+void *palloc(parsestate_T *ps, size_t size)
+{
+    parsearena_T *arena = ps->arena;
+    if (arena == NULL)
+	return xmalloc(size);
+
+    if (size > (size_t) (arena->end - arena->next)) {
+	size_t rest = ps->src.length - ps->index;
+	if (rest > ARENA_MAX_CHUNK_SIZE / ARENA_BYTES_PER_CHAR)
+	    arena->chunksize = ARENA_MAX_CHUNK_SIZE;
+	else if (rest > ARENA_MIN_CHUNK_SIZE / ARENA_BYTES_PER_CHAR)
+	    arena->chunksize = rest * ARENA_BYTES_PER_CHAR;
+	else
+	    arena->chunksize = ARENA_MIN_CHUNK_SIZE;
+    }
+    return arena_alloc(arena, size);
+}
+
+/* Returns a copy of the first `len' characters of the string. */
+wchar_t *pwcsndup(parsestate_T *restrict ps, const wchar_t *restrict s,
+	size_t len)
+{
+    if (ps->arena == NULL)
+	return xwcsndup(s, len);
+
+    wchar_t *result = palloc(ps, mul(add(len, 1), sizeof *result));
+    wmemcpy(result, s, len);
+    result[len] = L'\0';
+    return result;
+}
+
+/* Returns the specified malloced string as a parse tree element.
+ * In an arena, the string is copied and the original is freed. */
+wchar_t *pwcs(parsestate_T *ps, wchar_t *s)
+{
+    if (ps->arena == NULL)
+	return s;
+
+    wchar_t *result = pwcsndup(ps, s, wcslen(s));
+    free(s);
+    return result;
+}
+
+/* Converts the pointer list to a NULL-terminated array of pointers.
+ * The list is destroyed in this function. */
+void **ptoary(parsestate_T *ps, plist_T *list)
+{
+    if (ps->arena == NULL)
+	return pl_toary(list);
+
+    void **result = palloc(ps, mul(add(list->length, 1), sizeof *result));
+    memcpy(result, list->contents, (list->length + 1) * sizeof *result);
+    pl_destroy(list);
+    return result;
+}
+
+/* Returns the interned symbol, which will be released when the parse tree is
+ * freed. */
+struct varsymbol_T *psymbol(parsestate_T *ps, struct varsymbol_T *symbol)
+{
+    if (ps->arena != NULL)
+	arena_add_ref(ps->arena, &ps->arena->symbols, symbol);
+    return symbol;
+}
+
+/* Makes sure the cached patterns of the case item are freed when the parse
+ * tree is freed. */
+void pcaseitem(parsestate_T *ps, caseitem_T *ci)
+{
+    if (ps->arena != NULL)
+	arena_add_ref(ps->arena, &ps->arena->caseitems, ci);
+}
+
+void pfree(parsestate_T *ps, void *p)
+{
+    if (ps->arena == NULL)
+	free(p);
+}
+
+void pandorsfree(parsestate_T *ps, and_or_T *a)
+{
+    if (ps->arena == NULL)
+	andorsfree(a);
+}
+
+void pcomsfree(parsestate_T *ps, command_T *c)
+{
+    if (ps->arena == NULL)
+	comsfree(c);
+}
+
+void pwordunitfree(parsestate_T *ps, wordunit_T *wu)
+{
+    if (ps->arena == NULL)
+	wordunitfree(wu);
+}
+
+/* In an arena, a word that consists of a single string unit is reclaimed if it
+ * is the last element allocated. This applies to most keyword tokens, which
+ * are discarded right after they have been parsed. */
+void pwordfree(parsestate_T *ps, wordunit_T *w)
+{
+    if (ps->arena == NULL) {
+	wordfree(w);
+    } else if (w != NULL && w->next == NULL && w->wu_type == WT_STRING
+	    && w->wu_string != NULL) {
+	arena_free_last(ps->arena, w->wu_string,
+		(wcslen(w->wu_string) + 1) * sizeof *w->wu_string);
+	arena_free_last(ps->arena, w, sizeof *w);
+    }
+}
+
 /***** Error message utility *****/
 
 /* Prints the specified error message to the standard error.
@@ -1019,7 +1355,7 @@ size_t count_name_length(parsestate_T *ps, bool isnamechar(wchar_t c))
  * The existing `token' is freed. */
 void next_token(parsestate_T *ps)
 {
-    wordfree(ps->token);
+    pwordfree(ps, ps->token);
     ps->token = NULL;
 
     size_t index = ps->next_index;
@@ -1120,7 +1456,7 @@ skip_blanks:
 	    wordunit_T *token = parse_word(ps, is_token_delimiter_char);
 	    index = ps->index;
 
-	    wordfree(ps->token);
+	    pwordfree(ps, ps->token);
 	    ps->token = token;
 
 	    /* Is this an IO_NUMBER token? */
@@ -1159,10 +1495,11 @@ wordunit_T *parse_word(parsestate_T *ps, bool testfunc(wchar_t c))
     do {                                                                 \
 	size_t len = ps->index - startindex;                             \
         if (len > 0) {                                                   \
-            wordunit_T *w = xmalloc(sizeof *w);                          \
+            wordunit_T *w = palloc(ps, sizeof *w);                       \
             w->next = NULL;                                              \
             w->wu_type = WT_STRING;                                      \
-            w->wu_string = xwcsndup(&ps->src.contents[startindex], len); \
+            w->wu_string =                                               \
+                pwcsndup(ps, &ps->src.contents[startindex], len);        \
             *lastp = w;                                                  \
             lastp = &w->next;                                            \
         }                                                                \
@@ -1307,12 +1644,13 @@ wordunit_T *tryparse_paramexp_raw(parsestate_T *ps)
 	namelen = count_name_length(ps, is_portable_name_char);
 
 success:;
-    paramexp_T *pe = xmalloc(sizeof *pe);
+    paramexp_T *pe = palloc(ps, sizeof *pe);
     pe->pe_type = PT_NONE;
-    pe->pe_name = xwcsndup(&ps->src.contents[ps->index], namelen);
+    pe->pe_name = pwcsndup(ps, &ps->src.contents[ps->index], namelen);
+    pe->pe_symbol = psymbol(ps, intern_parameter_name(pe->pe_name));
     pe->pe_start = pe->pe_end = pe->pe_match = pe->pe_subst = NULL;
 
-    wordunit_T *result = xmalloc(sizeof *result);
+    wordunit_T *result = palloc(ps, sizeof *result);
     result->next = NULL;
     result->wu_type = WT_PARAM;
     result->wu_param = pe;
@@ -1325,14 +1663,23 @@ error:
     return NULL;
 }
 
+/* Returns the interned symbol for the specified parameter name so that the
+ * expansion need not look up the variable by name every time it is performed.
+ * Returns NULL for special and positional parameters. */
+struct varsymbol_T *intern_parameter_name(const wchar_t *name)
+{
+    return is_name(name) ? intern_variable_name(name) : NULL;
+}
+
 /* Parses a parameter expansion that starts with "${".
  * The current position must be at the opening brace L'{' when this function is
  * called and the position is advanced to the closing brace L'}'. */
 wordunit_T *parse_paramexp_in_brace(parsestate_T *ps)
 {
-    paramexp_T *pe = xmalloc(sizeof *pe);
+    paramexp_T *pe = palloc(ps, sizeof *pe);
     pe->pe_type = 0;
     pe->pe_name = NULL;
+    pe->pe_symbol = NULL;
     pe->pe_start = pe->pe_end = pe->pe_match = pe->pe_subst = NULL;
 
     assert(ps->src.contents[ps->index] == L'{');
@@ -1395,7 +1742,8 @@ parse_name:;
 	    serror(ps, Ngt("the parameter name is missing or invalid"));
 	    goto end;
 	}
-	pe->pe_name = xwcsndup(&ps->src.contents[namestartindex], namelen);
+	pe->pe_name = pwcsndup(ps, &ps->src.contents[namestartindex], namelen);
+	pe->pe_symbol = psymbol(ps, intern_parameter_name(pe->pe_name));
     }
 
     /* parse indices */
@@ -1508,7 +1856,7 @@ check_closing_brace:
 		(wint_t) L'#');
 
 end:;
-    wordunit_T *result = xmalloc(sizeof *result);
+    wordunit_T *result = palloc(ps, sizeof *result);
     result->next = NULL;
     result->wu_type = WT_PARAM;
     result->wu_param = pe;
@@ -1529,7 +1877,7 @@ wordunit_T *parse_cmdsubst_in_paren(parsestate_T *ps)
     else
 	serror(ps, Ngt("`%ls' is missing"), L")");
 
-    wordunit_T *result = xmalloc(sizeof *result);
+    wordunit_T *result = palloc(ps, sizeof *result);
     result->next = NULL;
     result->wu_type = WT_CMDSUB;
     result->wu_cmdsub = cmd;
@@ -1576,10 +1924,10 @@ wchar_t *extract_command_in_paren_unparsed(parsestate_T *ps)
 
     size_t startindex = ps->next_index;
     next_token(ps);
-    andorsfree(parse_compound_list(ps));
+    pandorsfree(ps, parse_compound_list(ps));
     assert(startindex <= ps->index);
 
-    wchar_t *result = xwcsndup(
+    wchar_t *result = pwcsndup(ps,
 	    &ps->src.contents[startindex], ps->index - startindex);
 
     ps->enable_alias = save_enable_alias;
@@ -1631,11 +1979,11 @@ wordunit_T *parse_cmdsubst_in_backquote(parsestate_T *ps, bool bsdq)
 	}
     }
 end:;
-    wordunit_T *result = xmalloc(sizeof *result);
+    wordunit_T *result = palloc(ps, sizeof *result);
     result->next = NULL;
     result->wu_type = WT_CMDSUB;
     result->wu_cmdsub.is_preparsed = false;
-    result->wu_cmdsub.value.unparsed = wb_towcs(&buf);
+    result->wu_cmdsub.value.unparsed = pwcs(ps, wb_towcs(&buf));
     return result;
 }
 
@@ -1709,14 +2057,14 @@ wordunit_T *tryparse_arith(parsestate_T *ps)
 	ps->index++;
     }
 end:;
-    wordunit_T *result = xmalloc(sizeof *result);
+    wordunit_T *result = palloc(ps, sizeof *result);
     result->next = NULL;
     result->wu_type = WT_ARITH;
     result->wu_arith = first;
     return result;
 
 not_arithmetic_expansion:
-    wordfree(first);
+    pwordfree(ps, first);
     rewind_index(ps, saveindex);
     return NULL;
 }
@@ -1736,7 +2084,7 @@ void next_line(parsestate_T *ps)
 	read_heredoc_contents(ps, ps->pending_heredocs.contents[i]);
     pl_truncate(&ps->pending_heredocs, 0);
 
-    wordfree(ps->token);
+    pwordfree(ps, ps->token);
     ps->token = NULL;
     ps->tokentype = TT_UNKNOWN;
     ps->next_index = ps->index;
@@ -1843,7 +2191,7 @@ and_or_T *parse_command_list(parsestate_T *ps, bool toeol)
 		    next_token(ps);
 		    continue;
 		}
-		wordfree(ps->token);
+		pwordfree(ps, ps->token);
 		ps->token = NULL;
 		ps->index = ps->next_index;
 		ps->tokentype = TT_END_OF_INPUT;
@@ -1907,9 +2255,10 @@ and_or_T *parse_and_or_list(parsestate_T *ps)
 	return NULL;
     }
 
-    and_or_T *result = xmalloc(sizeof *result);
+    and_or_T *result = palloc(ps, sizeof *result);
     result->next = NULL;
     result->ao_pipelines = p;
+    result->ao_arena = ps->arena;
     result->ao_async = (ps->tokentype == TT_AMP);
     return result;
 }
@@ -1983,7 +2332,7 @@ parse_after_bang:
 	}
     }
 
-    pipeline_T *result = xmalloc(sizeof *result);
+    pipeline_T *result = palloc(ps, sizeof *result);
     result->next = NULL;
     result->pl_commands = c;
     result->pl_neg = neg;
@@ -2049,20 +2398,22 @@ command_T *parse_command(parsestate_T *ps)
     }
 
     /* parse as a simple command */
-    result = xmalloc(sizeof *result);
+    result = palloc(ps, sizeof *result);
     result->next = NULL;
     result->refcount = 1;
+    result->c_arena = ps->arena;
     result->c_lineno = ps->info->lineno;
     result->c_type = CT_SIMPLE;
     result->c_assigns = NULL;
     result->c_redirs = NULL;
+    result->c_tailcall = false;
     result->c_words = parse_simple_command_tokens(
 	    ps, &result->c_assigns, &result->c_redirs);
 
     if (result->c_words[0] == NULL && result->c_assigns == NULL &&
 	    result->c_redirs == NULL) {
 	/* an empty command */
-	comsfree(result);
+	pcomsfree(ps, result);
 	if (ps->tokentype == TT_END_OF_INPUT || ps->tokentype == TT_NEWLINE)
 	    serror(ps, Ngt("a command is missing at the end of input"));
 	else
@@ -2118,7 +2469,7 @@ next:
 	goto next;
     }
 
-    return pl_toary(&words);
+    return ptoary(ps, &words);
 }
 
 /* Parses words.
@@ -2141,7 +2492,7 @@ void **parse_words(parsestate_T *ps, bool skip_newlines)
 	pl_add(&wordlist, ps->token), ps->token = NULL;
 	next_token(ps);
     }
-    return pl_toary(&wordlist);
+    return ptoary(ps, &wordlist);
 }
 
 /* Parses as many redirections as possible.
@@ -2176,9 +2527,10 @@ assign_T *tryparse_assignment(parsestate_T *ps)
     if (namelen == 0 || *nameend != L'=')
 	return NULL;
 
-    assign_T *result = xmalloc(sizeof *result);
+    assign_T *result = palloc(ps, sizeof *result);
     result->next = NULL;
-    result->a_name = xwcsndup(ps->token->wu_string, namelen);
+    result->a_name = pwcsndup(ps, ps->token->wu_string, namelen);
+    result->a_symbol = psymbol(ps, intern_variable_name(result->a_name));
 
     /* remove the name and '=' from the token */
     size_t index_after_first_token = ps->next_index;
@@ -2187,7 +2539,7 @@ assign_T *tryparse_assignment(parsestate_T *ps)
     wmemmove(first_token->wu_string, &nameend[1], wcslen(&nameend[1]) + 1);
     if (first_token->wu_string[0] == L'\0') {
 	wordunit_T *wu = first_token->next;
-	wordunitfree(first_token);
+	pwordunitfree(ps, first_token);
 	first_token = wu;
     }
 
@@ -2241,7 +2593,7 @@ redir_T *tryparse_redirect(parsestate_T *ps)
 	return NULL;
     }
 
-    redir_T *result = xmalloc(sizeof *result);
+    redir_T *result = palloc(ps, sizeof *result);
     result->next = NULL;
     result->rd_fd = fd;
     switch (ps->tokentype) {
@@ -2308,7 +2660,7 @@ parse_here_document_tag:
     next_token(ps);
     validate_redir_operand(ps);
     result->rd_hereend =
-	xwcsndup(&ps->src.contents[ps->index], ps->next_index - ps->index);
+	pwcsndup(ps, &ps->src.contents[ps->index], ps->next_index - ps->index);
     result->rd_herecontent = NULL;
     if (ps->token == NULL) {
 	serror(ps, Ngt("the end-of-here-document indicator is missing"));
@@ -2435,9 +2787,10 @@ command_T *parse_group(parsestate_T *ps)
     else
 	print_errmsg_token_missing(ps, ends);
 
-    command_T *result = xmalloc(sizeof *result);
+    command_T *result = palloc(ps, sizeof *result);
     result->next = NULL;
     result->refcount = 1;
+    result->c_arena = ps->arena;
     result->c_type = type;
     result->c_lineno = lineno;
     result->c_redirs = NULL;
@@ -2452,9 +2805,10 @@ command_T *parse_if(parsestate_T *ps)
     assert(ps->tokentype == TT_IF);
     next_token(ps);
 
-    command_T *result = xmalloc(sizeof *result);
+    command_T *result = palloc(ps, sizeof *result);
     result->next = NULL;
     result->refcount = 1;
+    result->c_arena = ps->arena;
     result->c_type = CT_IF;
     result->c_lineno = ps->info->lineno;
     result->c_redirs = NULL;
@@ -2463,7 +2817,7 @@ command_T *parse_if(parsestate_T *ps)
     ifcommand_T **lastp = &result->c_ifcmds;
     bool after_else = false;
     while (!ps->error) {
-	ifcommand_T *ic = xmalloc(sizeof *ic);
+	ifcommand_T *ic = palloc(ps, sizeof *ic);
 	*lastp = ic;
 	lastp = &ic->next;
 	ic->next = NULL;
@@ -2508,15 +2862,16 @@ command_T *parse_for(parsestate_T *ps)
     next_token(ps);
     psubstitute_alias_recursive(ps, 0);
 
-    command_T *result = xmalloc(sizeof *result);
+    command_T *result = palloc(ps, sizeof *result);
     result->next = NULL;
     result->refcount = 1;
+    result->c_arena = ps->arena;
     result->c_type = CT_FOR;
     result->c_lineno = ps->info->lineno;
     result->c_redirs = NULL;
 
     result->c_forname =
-	xwcsndup(&ps->src.contents[ps->index], ps->next_index - ps->index);
+	pwcsndup(ps, &ps->src.contents[ps->index], ps->next_index - ps->index);
     if (!is_name_word(ps->token)) {
 	if (ps->token == NULL)
 	    serror(ps, Ngt("an identifier is required after `for'"));
@@ -2581,9 +2936,10 @@ command_T *parse_while(parsestate_T *ps)
     }
     next_token(ps);
 
-    command_T *result = xmalloc(sizeof *result);
+    command_T *result = palloc(ps, sizeof *result);
     result->next = NULL;
     result->refcount = 1;
+    result->c_arena = ps->arena;
     result->c_type = CT_WHILE;
     result->c_lineno = ps->info->lineno;
     result->c_redirs = NULL;
@@ -2620,9 +2976,10 @@ command_T *parse_case(parsestate_T *ps)
     next_token(ps);
     psubstitute_alias_recursive(ps, 0);
 
-    command_T *result = xmalloc(sizeof *result);
+    command_T *result = palloc(ps, sizeof *result);
     result->next = NULL;
     result->refcount = 1;
+    result->c_arena = ps->arena;
     result->c_type = CT_CASE;
     result->c_lineno = ps->info->lineno;
     result->c_redirs = NULL;
@@ -2665,12 +3022,14 @@ caseitem_T *parse_case_list(parsestate_T *ps)
 	if (psubstitute_alias(ps, 0))
 	    continue;
 
-	caseitem_T *ci = xmalloc(sizeof *ci);
+	caseitem_T *ci = palloc(ps, sizeof *ci);
 	*lastp = ci;
 	lastp = &ci->next;
 	ci->next = NULL;
 	ci->ci_patterns = parse_case_patterns(ps);
 	ci->ci_commands = parse_compound_list(ps);
+	ci->ci_compiled = NULL;
+	pcaseitem(ps, ci);
 	/* `ci_commands' may be NULL unlike for and while commands */
 	if (ps->tokentype == TT_DOUBLE_SEMICOLON)
 	    next_token(ps);
@@ -2728,7 +3087,7 @@ void **parse_case_patterns(parsestate_T *ps)
 	psubstitute_alias_recursive(ps, 0);
     } while (!ps->error);
 
-    return pl_toary(&wordlist);
+    return ptoary(ps, &wordlist);
 }
 
 #if YASH_ENABLE_DOUBLE_BRACKET
@@ -2747,9 +3106,10 @@ command_T *parse_double_bracket(parsestate_T *ps)
     next_token(ps);
     psubstitute_alias_recursive(ps, 0);
 
-    command_T *result = xmalloc(sizeof *result);
+    command_T *result = palloc(ps, sizeof *result);
     result->next = NULL;
     result->refcount = 1;
+    result->c_arena = ps->arena;
     result->c_type = CT_BRACKET;
     result->c_lineno = ps->info->lineno;
     result->c_redirs = NULL;
@@ -2780,7 +3140,7 @@ dbexp_T *parse_double_bracket_ors(parsestate_T *ps)
     next_token(ps);
     psubstitute_alias_recursive(ps, 0);
 
-    dbexp_T *result = xmalloc(sizeof *result);
+    dbexp_T *result = palloc(ps, sizeof *result);
     result->type = DBE_OR;
     result->operator = NULL;
     result->lhs.subexp = lhs;
@@ -2798,7 +3158,7 @@ dbexp_T *parse_double_bracket_ands(parsestate_T *ps)
     next_token(ps);
     psubstitute_alias_recursive(ps, 0);
 
-    dbexp_T *result = xmalloc(sizeof *result);
+    dbexp_T *result = palloc(ps, sizeof *result);
     result->type = DBE_AND;
     result->operator = NULL;
     result->lhs.subexp = lhs;
@@ -2815,7 +3175,7 @@ dbexp_T *parse_double_bracket_nots(parsestate_T *ps)
     next_token(ps);
     psubstitute_alias_recursive(ps, 0);
 
-    dbexp_T *result = xmalloc(sizeof *result);
+    dbexp_T *result = palloc(ps, sizeof *result);
     result->type = DBE_NOT;
     result->operator = NULL;
     result->lhs.subexp = NULL;
@@ -2866,7 +3226,8 @@ dbexp_T *parse_double_bracket_primary(parsestate_T *ps)
 
     if (ps->tokentype == TT_LESS || ps->tokentype == TT_GREATER) {
 	type = DBE_BINARY;
-	op = xwcsndup(&ps->src.contents[ps->index], ps->next_index - ps->index);
+	op = pwcsndup(ps,
+		&ps->src.contents[ps->index], ps->next_index - ps->index);
     } else if (is_single_string_word(ps->token) &&
 	    is_binary_primary(ps->token->wu_string)) {
 	type = DBE_BINARY;
@@ -2889,7 +3250,7 @@ parse_primary_operator:
 	rhs = parse_double_bracket_operand(ps);
 
 return_result:;
-    dbexp_T *result = xmalloc(sizeof *result);
+    dbexp_T *result = palloc(ps, sizeof *result);
     result->type = type;
     result->operator = op;
     result->lhs.word = lhs;
@@ -3025,7 +3386,7 @@ end:;
     MAKE_WORDUNIT_STRING;
     ps->next_index = ps->index;
     ps->index = grandstartindex;
-    wordfree(ps->token), ps->token = token;
+    pwordfree(ps, ps->token), ps->token = token;
     ps->tokentype = TT_WORD;
     return parse_double_bracket_operand(ps);
 }
@@ -3043,9 +3404,10 @@ command_T *parse_function(parsestate_T *ps)
     next_token(ps);
     psubstitute_alias_recursive(ps, 0);
 
-    command_T *result = xmalloc(sizeof *result);
+    command_T *result = palloc(ps, sizeof *result);
     result->next = NULL;
     result->refcount = 1;
+    result->c_arena = ps->arena;
     result->c_type = CT_FUNCDEF;
     result->c_lineno = ps->info->lineno;
     result->c_redirs = NULL;
@@ -3127,7 +3489,7 @@ command_T *try_reparse_as_function(parsestate_T *ps, command_T *c)
     }
     next_token(ps);
 
-    free(c->c_words);
+    pfree(ps, c->c_words);
     c->c_type = CT_FUNCDEF;
     c->c_funcname = name;
 
@@ -3195,10 +3557,10 @@ void read_heredoc_contents_without_expansion(parsestate_T *ps, redir_T *r)
     }
     free(eoc);
     
-    wordunit_T *wu = xmalloc(sizeof *wu);
+    wordunit_T *wu = palloc(ps, sizeof *wu);
     wu->next = NULL;
     wu->wu_type = WT_STRING;
-    wu->wu_string = escape(buf.contents, L"\\");
+    wu->wu_string = pwcs(ps, escape(buf.contents, L"\\"));
     r->rd_herecontent = wu;
 
     wb_destroy(&buf);
@@ -4045,4 +4407,716 @@ void trim_end_of_buffer(xwcsbuf_T *buf)
 }
 
 
+/********** Functions That Serialize Parse Trees **********/
+
+/* A parse tree is serialized into a sequence of bytes that can be loaded into
+ * an equivalent tree without parsing the source code again.
+ * Integers are encoded in the unsigned LEB128 format. A string is encoded as
+ * its length plus one (zero for a null pointer) followed by the values of the
+ * wide characters as integers, so the serialized form does not depend on the
+ * byte order or the size of `wchar_t'. A linked list of nodes is
+ * encoded as the number of the nodes followed by the nodes, and a
+ * NULL-terminated array of words as the number of the words plus one (zero
+ * for a null pointer) followed by the words.
+ * Caches attached to the tree, such as compiled case patterns, are not
+ * serialized. */
+
+static void dump_uint(xstrbuf_T *buf, uintmax_t value)
+    __attribute__((nonnull));
+static void dump_wcs(xstrbuf_T *restrict buf, const wchar_t *restrict s)
+    __attribute__((nonnull(1)));
+static void dump_pipelines(xstrbuf_T *restrict buf, const pipeline_T *p)
+    __attribute__((nonnull(1)));
+static void dump_commands(xstrbuf_T *restrict buf, const command_T *c)
+    __attribute__((nonnull(1)));
+static void dump_ifcmds(xstrbuf_T *restrict buf, const ifcommand_T *i)
+    __attribute__((nonnull(1)));
+static void dump_caseitems(xstrbuf_T *restrict buf, const caseitem_T *i)
+    __attribute__((nonnull(1)));
+#if YASH_ENABLE_DOUBLE_BRACKET
+static void dump_dbexp(xstrbuf_T *restrict buf, const dbexp_T *e)
+    __attribute__((nonnull(1)));
+#endif
+static void dump_words(xstrbuf_T *restrict buf, void *const *words)
+    __attribute__((nonnull(1)));
+static void dump_word(xstrbuf_T *restrict buf, const wordunit_T *w)
+    __attribute__((nonnull(1)));
+static void dump_param(xstrbuf_T *restrict buf, const paramexp_T *p)
+    __attribute__((nonnull));
+static void dump_assigns(xstrbuf_T *restrict buf, const assign_T *a)
+    __attribute__((nonnull(1)));
+static void dump_redirs(xstrbuf_T *restrict buf, const redir_T *r)
+    __attribute__((nonnull(1)));
+static void dump_embedcmd(xstrbuf_T *buf, embedcmd_T c)
+    __attribute__((nonnull));
+
+/* Appends the serialized form of the and/or lists to the buffer. */
+void dump_and_or_lists(xstrbuf_T *restrict buf, const and_or_T *a)
+{
+    size_t count = 0;
+    for (const and_or_T *aa = a; aa != NULL; aa = aa->next)
+	count++;
+    dump_uint(buf, count);
+    for (; a != NULL; a = a->next) {
+	dump_uint(buf, a->ao_async);
+	dump_pipelines(buf, a->ao_pipelines);
+    }
+}
+
+void dump_uint(xstrbuf_T *buf, uintmax_t value)
+{
+    while (value >= 0x80) {
+	sb_ccat(buf, (char) ((value & 0x7F) | 0x80));
+	value >>= 7;
+    }
+    sb_ccat(buf, (char) value);
+}
+
+void dump_wcs(xstrbuf_T *restrict buf, const wchar_t *restrict s)
+{
+    if (s == NULL) {
+	dump_uint(buf, 0);
+	return;
+    }
+    dump_uint(buf, (uintmax_t) wcslen(s) + 1);
+    for (; *s != L'\0'; s++)
+	dump_uint(buf, (uintmax_t) *s);
+}
+
+void dump_pipelines(xstrbuf_T *restrict buf, const pipeline_T *p)
+{
+    size_t count = 0;
+    for (const pipeline_T *pp = p; pp != NULL; pp = pp->next)
+	count++;
+    dump_uint(buf, count);
+    for (; p != NULL; p = p->next) {
+	dump_uint(buf, p->pl_neg);
+	dump_uint(buf, p->pl_cond);
+	dump_commands(buf, p->pl_commands);
+    }
+}
+
+void dump_commands(xstrbuf_T *restrict buf, const command_T *c)
+{
+    size_t count = 0;
+    for (const command_T *cc = c; cc != NULL; cc = cc->next)
+	count++;
+    dump_uint(buf, count);
+    for (; c != NULL; c = c->next) {
+	dump_uint(buf, c->c_type);
+	dump_uint(buf, c->c_lineno);
+	dump_redirs(buf, c->c_redirs);
+	switch (c->c_type) {
+	    case CT_SIMPLE:
+		dump_assigns(buf, c->c_assigns);
+		dump_words(buf, c->c_words);
+		dump_uint(buf, c->c_tailcall);
+		break;
+	    case CT_GROUP:
+	    case CT_SUBSHELL:
+		dump_and_or_lists(buf, c->c_subcmds);
+		break;
+	    case CT_IF:
+		dump_ifcmds(buf, c->c_ifcmds);
+		break;
+	    case CT_FOR:
+		dump_wcs(buf, c->c_forname);
+		dump_words(buf, c->c_forwords);
+		dump_and_or_lists(buf, c->c_forcmds);
+		break;
+	    case CT_WHILE:
+		dump_uint(buf, c->c_whltype);
+		dump_and_or_lists(buf, c->c_whlcond);
+		dump_and_or_lists(buf, c->c_whlcmds);
+		break;
+	    case CT_CASE:
+		dump_word(buf, c->c_casword);
+		dump_caseitems(buf, c->c_casitems);
+		break;
+#if YASH_ENABLE_DOUBLE_BRACKET
+	    case CT_BRACKET:
+		dump_dbexp(buf, c->c_dbexp);
+		break;
+#endif /* YASH_ENABLE_DOUBLE_BRACKET */
+	    case CT_FUNCDEF:
+		dump_word(buf, c->c_funcname);
+		dump_commands(buf, c->c_funcbody);
+		break;
+	}
+    }
+}
+
+void dump_ifcmds(xstrbuf_T *restrict buf, const ifcommand_T *i)
+{
+    size_t count = 0;
+    for (const ifcommand_T *ii = i; ii != NULL; ii = ii->next)
+	count++;
+    dump_uint(buf, count);
+    for (; i != NULL; i = i->next) {
+	dump_and_or_lists(buf, i->ic_condition);
+	dump_and_or_lists(buf, i->ic_commands);
+    }
+}
+
+void dump_caseitems(xstrbuf_T *restrict buf, const caseitem_T *i)
+{
+    size_t count = 0;
+    for (const caseitem_T *ii = i; ii != NULL; ii = ii->next)
+	count++;
+    dump_uint(buf, count);
+    for (; i != NULL; i = i->next) {
+	dump_words(buf, i->ci_patterns);
+	dump_and_or_lists(buf, i->ci_commands);
+    }
+}
+
+#if YASH_ENABLE_DOUBLE_BRACKET
+void dump_dbexp(xstrbuf_T *restrict buf, const dbexp_T *e)
+{
+    if (e == NULL) {
+	dump_uint(buf, 0);
+	return;
+    }
+    dump_uint(buf, (uintmax_t) e->type + 1);
+    dump_wcs(buf, e->operator);
+    switch (e->type) {
+	case DBE_OR:
+	case DBE_AND:
+	case DBE_NOT:
+	    dump_dbexp(buf, e->lhs.subexp);
+	    dump_dbexp(buf, e->rhs.subexp);
+	    break;
+	case DBE_UNARY:
+	case DBE_BINARY:
+	case DBE_STRING:
+	    dump_word(buf, e->lhs.word);
+	    dump_word(buf, e->rhs.word);
+	    break;
+    }
+}
+#endif /* YASH_ENABLE_DOUBLE_BRACKET */
+
+void dump_words(xstrbuf_T *restrict buf, void *const *words)
+{
+    if (words == NULL) {
+	dump_uint(buf, 0);
+	return;
+    }
+    dump_uint(buf, (uintmax_t) plcount(words) + 1);
+    for (; *words != NULL; words++)
+	dump_word(buf, *words);
+}
+
+void dump_word(xstrbuf_T *restrict buf, const wordunit_T *w)
+{
+    size_t count = 0;
+    for (const wordunit_T *ww = w; ww != NULL; ww = ww->next)
+	count++;
+    dump_uint(buf, count);
+    for (; w != NULL; w = w->next) {
+	dump_uint(buf, w->wu_type);
+	switch (w->wu_type) {
+	    case WT_STRING:
+		dump_wcs(buf, w->wu_string);
+		break;
+	    case WT_PARAM:
+		dump_param(buf, w->wu_param);
+		break;
+	    case WT_CMDSUB:
+		dump_embedcmd(buf, w->wu_cmdsub);
+		break;
+	    case WT_ARITH:
+		dump_word(buf, w->wu_arith);
+		break;
+	}
+    }
+}
+
+void dump_param(xstrbuf_T *restrict buf, const paramexp_T *p)
+{
+    dump_uint(buf, p->pe_type);
+    if (p->pe_type & PT_NEST)
+	dump_word(buf, p->pe_nest);
+    else
+	dump_wcs(buf, p->pe_name);
+    dump_word(buf, p->pe_start);
+    dump_word(buf, p->pe_end);
+    dump_word(buf, p->pe_match);
+    dump_word(buf, p->pe_subst);
+}
+
+void dump_assigns(xstrbuf_T *restrict buf, const assign_T *a)
+{
+    size_t count = 0;
+    for (const assign_T *aa = a; aa != NULL; aa = aa->next)
+	count++;
+    dump_uint(buf, count);
+    for (; a != NULL; a = a->next) {
+	dump_uint(buf, a->a_type);
+	dump_wcs(buf, a->a_name);
+	switch (a->a_type) {
+	    case A_SCALAR:
+		dump_word(buf, a->a_scalar);
+		break;
+	    case A_ARRAY:
+		dump_words(buf, a->a_array);
+		break;
+	}
+    }
+}
+
+void dump_redirs(xstrbuf_T *restrict buf, const redir_T *r)
+{
+    size_t count = 0;
+    for (const redir_T *rr = r; rr != NULL; rr = rr->next)
+	count++;
+    dump_uint(buf, count);
+    for (; r != NULL; r = r->next) {
+	dump_uint(buf, r->rd_type);
+	dump_uint(buf, (unsigned) r->rd_fd);
+	switch (r->rd_type) {
+	    case RT_INPUT:  case RT_OUTPUT:  case RT_CLOBBER:  case RT_APPEND:
+	    case RT_INOUT:  case RT_DUPIN:   case RT_DUPOUT:   case RT_PIPE:
+	    case RT_HERESTR:
+		dump_word(buf, r->rd_filename);
+		break;
+	    case RT_HERE:  case RT_HERERT:
+		dump_wcs(buf, r->rd_hereend);
+		dump_word(buf, r->rd_herecontent);
+		break;
+	    case RT_PROCIN:  case RT_PROCOUT:
+		dump_embedcmd(buf, r->rd_command);
+		break;
+	}
+    }
+}
+
+void dump_embedcmd(xstrbuf_T *buf, embedcmd_T c)
+{
+    dump_uint(buf, c.is_preparsed);
+    if (c.is_preparsed)
+	dump_and_or_lists(buf, c.value.preparsed);
+    else
+	dump_wcs(buf, c.value.unparsed);
+}
+
+/* state of loading a serialized parse tree */
+struct load {
+    const char *next, *end;  /* range of bytes not yet loaded */
+    bool error;              /* true if the bytes are malformed */
+    parsearena_T *arena;     /* arena in which the tree is allocated */
+};
+/* When the bytes are found malformed, `error' is set and the rest of the
+ * loading functions return empty values without reading any more bytes, so
+ * that the partially loaded tree can be freed with the arena. */
+
+static uintmax_t load_uint(struct load *ld)
+    __attribute__((nonnull));
+static uintmax_t load_enum(struct load *ld, uintmax_t max)
+    __attribute__((nonnull));
+static size_t load_count(struct load *ld)
+    __attribute__((nonnull));
+static wchar_t *load_wcs(struct load *ld)
+    __attribute__((nonnull,malloc,warn_unused_result));
+static wchar_t *load_nonnull_wcs(struct load *ld)
+    __attribute__((nonnull,malloc,warn_unused_result));
+static and_or_T *load_and_ors(struct load *ld)
+    __attribute__((nonnull,malloc,warn_unused_result));
+static pipeline_T *load_pipelines(struct load *ld)
+    __attribute__((nonnull,malloc,warn_unused_result));
+static command_T *load_commands(struct load *ld)
+    __attribute__((nonnull,malloc,warn_unused_result));
+static ifcommand_T *load_ifcmds(struct load *ld)
+    __attribute__((nonnull,malloc,warn_unused_result));
+static caseitem_T *load_caseitems(struct load *ld)
+    __attribute__((nonnull,malloc,warn_unused_result));
+#if YASH_ENABLE_DOUBLE_BRACKET
+static dbexp_T *load_dbexp(struct load *ld)
+    __attribute__((nonnull,malloc,warn_unused_result));
+#endif
+static void **load_words(struct load *ld)
+    __attribute__((nonnull,malloc,warn_unused_result));
+static wordunit_T *load_word(struct load *ld)
+    __attribute__((nonnull,malloc,warn_unused_result));
+static paramexp_T *load_param(struct load *ld)
+    __attribute__((nonnull,malloc,warn_unused_result));
+static assign_T *load_assigns(struct load *ld)
+    __attribute__((nonnull,malloc,warn_unused_result));
+static redir_T *load_redirs(struct load *ld)
+    __attribute__((nonnull,malloc,warn_unused_result));
+static embedcmd_T load_embedcmd(struct load *ld)
+    __attribute__((nonnull));
+
+/* Loads and/or lists serialized by `dump_and_or_lists'.
+ * `*nextp' must point to the first byte of the serialized form and `end' to
+ * the end of the available bytes. On success, the loaded lists are assigned
+ * to `*resultp', `*nextp' is advanced past the serialized form, and true is
+ * returned. If the bytes are malformed, false is returned. */
+bool load_and_or_lists(const char **restrict nextp, const char *end,
+	and_or_T **restrict resultp)
+{
+    struct load ld = {
+	.next = *nextp, .end = end, .error = false, .arena = new_arena(),
+    };
+    and_or_T *result = load_and_ors(&ld);
+    if (ld.error || result == NULL)
+	arenafree(ld.arena);
+    if (ld.error)
+	return false;
+    *nextp = ld.next;
+    *resultp = result;
+    return true;
+}
+
+uintmax_t load_uint(struct load *ld)
+{
+    uintmax_t value = 0;
+    for (unsigned shift = 0; !ld->error; shift += 7) {
+	if (ld->next == ld->end || shift >= sizeof value * CHAR_BIT)
+	    break;
+	unsigned char c = (unsigned char) *ld->next++;
+	value |= (uintmax_t) (c & 0x7F) << shift;
+	if (!(c & 0x80))
+	    return value;
+    }
+    ld->error = true;
+    return 0;
+}
+
+/* Loads an integer that must not be greater than `max'. */
+uintmax_t load_enum(struct load *ld, uintmax_t max)
+{
+    uintmax_t value = load_uint(ld);
+    if (value > max) {
+	ld->error = true;
+	return 0;
+    }
+    return value;
+}
+
+/* Loads the number of elements of a list. Since every element occupies at
+ * least one byte, a number greater than the number of the remaining bytes is
+ * rejected before anything is allocated for the elements. */
+size_t load_count(struct load *ld)
+{
+    uintmax_t count = load_uint(ld);
+    if (count > (uintmax_t) (ld->end - ld->next)) {
+	ld->error = true;
+	return 0;
+    }
+    return count;
+}
+
+wchar_t *load_wcs(struct load *ld)
+{
+    uintmax_t length = load_uint(ld);
+    if (length-- == 0)
+	return NULL;
+    if (length > (uintmax_t) (ld->end - ld->next)) {
+	ld->error = true;
+	return NULL;
+    }
+
+    wchar_t *s = arena_alloc(ld->arena, (length + 1) * sizeof *s);
+    for (size_t i = 0; i < length; i++) {
+	s[i] = (wchar_t) load_enum(ld, WCHAR_MAX);
+	if (s[i] == L'\0')
+	    ld->error = true;
+    }
+    s[length] = L'\0';
+    return s;
+}
+
+wchar_t *load_nonnull_wcs(struct load *ld)
+{
+    wchar_t *s = load_wcs(ld);
+    if (s == NULL) {
+	ld->error = true;
+	s = arena_alloc(ld->arena, sizeof *s);
+	s[0] = L'\0';
+    }
+    return s;
+}
+
+and_or_T *load_and_ors(struct load *ld)
+{
+    and_or_T *first = NULL, **lastp = &first;
+    for (size_t count = load_count(ld); count > 0; count--) {
+	and_or_T *a = arena_alloc(ld->arena, sizeof *a);
+	a->next = NULL;
+	a->ao_arena = ld->arena;
+	a->ao_async = load_enum(ld, 1);
+	a->ao_pipelines = load_pipelines(ld);
+	*lastp = a;
+	lastp = &a->next;
+    }
+    return first;
+}
+
+pipeline_T *load_pipelines(struct load *ld)
+{
+    pipeline_T *first = NULL, **lastp = &first;
+    for (size_t count = load_count(ld); count > 0; count--) {
+	pipeline_T *p = arena_alloc(ld->arena, sizeof *p);
+	p->next = NULL;
+	p->pl_neg = load_enum(ld, 1);
+	p->pl_cond = load_enum(ld, 1);
+	p->pl_commands = load_commands(ld);
+	*lastp = p;
+	lastp = &p->next;
+    }
+    return first;
+}
+
+command_T *load_commands(struct load *ld)
+{
+    command_T *first = NULL, **lastp = &first;
+    for (size_t count = load_count(ld); count > 0; count--) {
+	command_T *c = arena_alloc(ld->arena, sizeof *c);
+	c->next = NULL;
+	c->refcount = 1;
+	c->c_arena = ld->arena;
+	c->c_type = load_enum(ld, CT_FUNCDEF);
+	c->c_lineno = load_enum(ld, ULONG_MAX);
+	c->c_redirs = load_redirs(ld);
+	switch (c->c_type) {
+	    case CT_SIMPLE:
+		c->c_assigns = load_assigns(ld);
+		c->c_words = load_words(ld);
+		c->c_tailcall = load_enum(ld, 1);
+		break;
+	    case CT_GROUP:
+	    case CT_SUBSHELL:
+		c->c_subcmds = load_and_ors(ld);
+		break;
+	    case CT_IF:
+		c->c_ifcmds = load_ifcmds(ld);
+		break;
+	    case CT_FOR:
+		c->c_forname = load_nonnull_wcs(ld);
+		c->c_forwords = load_words(ld);
+		c->c_forcmds = load_and_ors(ld);
+		break;
+	    case CT_WHILE:
+		c->c_whltype = load_enum(ld, 1);
+		c->c_whlcond = load_and_ors(ld);
+		c->c_whlcmds = load_and_ors(ld);
+		break;
+	    case CT_CASE:
+		c->c_casword = load_word(ld);
+		c->c_casitems = load_caseitems(ld);
+		break;
+#if YASH_ENABLE_DOUBLE_BRACKET
+	    case CT_BRACKET:
+		c->c_dbexp = load_dbexp(ld);
+		break;
+#endif /* YASH_ENABLE_DOUBLE_BRACKET */
+	    case CT_FUNCDEF:
+		c->c_funcname = load_word(ld);
+		c->c_funcbody = load_commands(ld);
+		if (c->c_funcbody == NULL || c->c_funcbody->next != NULL)
+		    ld->error = true;
+		break;
+	}
+	*lastp = c;
+	lastp = &c->next;
+    }
+    return first;
+}
+
+ifcommand_T *load_ifcmds(struct load *ld)
+{
+    ifcommand_T *first = NULL, **lastp = &first;
+    for (size_t count = load_count(ld); count > 0; count--) {
+	ifcommand_T *i = arena_alloc(ld->arena, sizeof *i);
+	i->next = NULL;
+	i->ic_condition = load_and_ors(ld);
+	i->ic_commands = load_and_ors(ld);
+	*lastp = i;
+	lastp = &i->next;
+    }
+    return first;
+}
+
+caseitem_T *load_caseitems(struct load *ld)
+{
+    caseitem_T *first = NULL, **lastp = &first;
+    for (size_t count = load_count(ld); count > 0; count--) {
+	caseitem_T *i = arena_alloc(ld->arena, sizeof *i);
+	i->next = NULL;
+	i->ci_patterns = load_words(ld);
+	i->ci_commands = load_and_ors(ld);
+	i->ci_compiled = NULL;
+	arena_add_ref(ld->arena, &ld->arena->caseitems, i);
+	if (i->ci_patterns == NULL) {
+	    ld->error = true;
+	    i->ci_patterns = arena_alloc(ld->arena, sizeof *i->ci_patterns);
+	    i->ci_patterns[0] = NULL;
+	}
+	*lastp = i;
+	lastp = &i->next;
+    }
+    return first;
+}
+
+#if YASH_ENABLE_DOUBLE_BRACKET
+dbexp_T *load_dbexp(struct load *ld)
+{
+    uintmax_t type = load_enum(ld, (uintmax_t) DBE_STRING + 1);
+    if (type == 0)
+	return NULL;
+
+    dbexp_T *e = arena_alloc(ld->arena, sizeof *e);
+    e->type = type - 1;
+    e->operator = load_wcs(ld);
+    switch (e->type) {
+	case DBE_OR:
+	case DBE_AND:
+	case DBE_NOT:
+	    e->lhs.subexp = load_dbexp(ld);
+	    e->rhs.subexp = load_dbexp(ld);
+	    break;
+	case DBE_UNARY:
+	case DBE_BINARY:
+	case DBE_STRING:
+	    e->lhs.word = load_word(ld);
+	    e->rhs.word = load_word(ld);
+	    break;
+    }
+    return e;
+}
+#endif /* YASH_ENABLE_DOUBLE_BRACKET */
+
+void **load_words(struct load *ld)
+{
+    size_t count = load_count(ld);
+    if (count-- == 0)
+	return NULL;
+
+    void **words = arena_alloc(ld->arena, mul(count + 1, sizeof *words));
+    for (size_t i = 0; i < count; i++)
+	words[i] = load_word(ld);
+    words[count] = NULL;
+
+    /* A null element would terminate the array early. */
+    for (size_t i = 0; i < count; i++)
+	if (words[i] == NULL)
+	    ld->error = true;
+    return words;
+}
+
+wordunit_T *load_word(struct load *ld)
+{
+    wordunit_T *first = NULL, **lastp = &first;
+    for (size_t count = load_count(ld); count > 0; count--) {
+	wordunit_T *w = arena_alloc(ld->arena, sizeof *w);
+	w->next = NULL;
+	w->wu_type = load_enum(ld, WT_ARITH);
+	switch (w->wu_type) {
+	    case WT_STRING:
+		w->wu_string = load_nonnull_wcs(ld);
+		break;
+	    case WT_PARAM:
+		w->wu_param = load_param(ld);
+		break;
+	    case WT_CMDSUB:
+		w->wu_cmdsub = load_embedcmd(ld);
+		break;
+	    case WT_ARITH:
+		w->wu_arith = load_word(ld);
+		break;
+	}
+	*lastp = w;
+	lastp = &w->next;
+    }
+    return first;
+}
+
+paramexp_T *load_param(struct load *ld)
+{
+    paramexp_T *p = arena_alloc(ld->arena, sizeof *p);
+    p->pe_type = load_enum(ld, (PT_NEST << 1) - 1);
+    if ((p->pe_type & PT_MASK) > PT_SUBST) {
+	ld->error = true;
+	p->pe_type = PT_NONE;
+    }
+    if (p->pe_type & PT_NEST) {
+	p->pe_nest = load_word(ld);
+	p->pe_symbol = NULL;
+    } else {
+	p->pe_name = load_nonnull_wcs(ld);
+	p->pe_symbol = intern_parameter_name(p->pe_name);
+	arena_add_ref(ld->arena, &ld->arena->symbols, p->pe_symbol);
+    }
+    p->pe_start = load_word(ld);
+    p->pe_end = load_word(ld);
+    p->pe_match = load_word(ld);
+    p->pe_subst = load_word(ld);
+    return p;
+}
+
+assign_T *load_assigns(struct load *ld)
+{
+    assign_T *first = NULL, **lastp = &first;
+    for (size_t count = load_count(ld); count > 0; count--) {
+	assign_T *a = arena_alloc(ld->arena, sizeof *a);
+	a->next = NULL;
+	a->a_type = load_enum(ld, A_ARRAY);
+	a->a_name = load_nonnull_wcs(ld);
+	a->a_symbol = intern_variable_name(a->a_name);
+	arena_add_ref(ld->arena, &ld->arena->symbols, a->a_symbol);
+	switch (a->a_type) {
+	    case A_SCALAR:
+		a->a_scalar = load_word(ld);
+		break;
+	    case A_ARRAY:
+		a->a_array = load_words(ld);
+		break;
+	}
+	*lastp = a;
+	lastp = &a->next;
+    }
+    return first;
+}
+
+redir_T *load_redirs(struct load *ld)
+{
+    redir_T *first = NULL, **lastp = &first;
+    for (size_t count = load_count(ld); count > 0; count--) {
+	redir_T *r = arena_alloc(ld->arena, sizeof *r);
+	r->next = NULL;
+	r->rd_type = load_enum(ld, RT_PROCOUT);
+	r->rd_fd = load_enum(ld, INT_MAX);
+	switch (r->rd_type) {
+	    case RT_INPUT:  case RT_OUTPUT:  case RT_CLOBBER:  case RT_APPEND:
+	    case RT_INOUT:  case RT_DUPIN:   case RT_DUPOUT:   case RT_PIPE:
+	    case RT_HERESTR:
+		r->rd_filename = load_word(ld);
+		break;
+	    case RT_HERE:  case RT_HERERT:
+		r->rd_hereend = load_nonnull_wcs(ld);
+		r->rd_herecontent = load_word(ld);
+		break;
+	    case RT_PROCIN:  case RT_PROCOUT:
+		r->rd_command = load_embedcmd(ld);
+		break;
+	}
+	*lastp = r;
+	lastp = &r->next;
+    }
+    return first;
+}
+
+embedcmd_T load_embedcmd(struct load *ld)
+{
+    embedcmd_T c;
+    c.is_preparsed = load_enum(ld, 1);
+    if (c.is_preparsed)
+	c.value.preparsed = load_and_ors(ld);
+    else
+	c.value.unparsed = load_nonnull_wcs(ld);
+    return c;
+}
+
+
 /* vim: set ts=8 sts=4 sw=4 noet tw=80: */
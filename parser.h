@@ -33,14 +33,33 @@
 /* Basically, parse tree structure elements constitute linked lists.
  * For each element, the `next' member points to the next element. */
 
+/* memory region in which the elements of parse trees are allocated */
+typedef struct parsearena_T {
+    refcount_T           refcount;
+    struct arenachunk_T *chunks;     /* allocated chunks, newest first */
+    char                *next;       /* start of the unused part of chunk */
+    char                *end;        /* end of the newest chunk */
+    size_t               chunksize;  /* size of the next chunk allocated */
+    struct arenaref_T   *symbols;    /* interned symbols to be released */
+    struct arenaref_T   *caseitems;  /* case items that may have a cache */
+} parsearena_T;
+/* The parse trees returned from `read_and_parse' and `load_and_or_lists' are
+ * allocated in an arena, which is freed as a whole when the last reference to
+ * the trees is dropped. The `refcount' of the arena is the number of references
+ * to any of the trees in it. Trees returned from `parse_string' are not in an
+ * arena; each element is malloced separately. */
+
 /* and/or list */
 typedef struct and_or_T {
-    struct and_or_T   *next;
-    struct pipeline_T *ao_pipelines;  /* pipelines in this and/or list */
-    _Bool              ao_async;
+    struct and_or_T     *next;
+    struct pipeline_T   *ao_pipelines;  /* pipelines in this and/or list */
+    struct parsearena_T *ao_arena;      /* arena containing this list */
+    _Bool                ao_async;
 } and_or_T;
-/* ao_async: indicates this and/or list is postfixed by "&", which means the
- * list is executed asynchronously. */
+/* ao_arena: the arena in which this and/or list is allocated, or NULL if not
+ *           allocated in an arena.
+ * ao_async: indicates this and/or list is postfixed by "&", which means the
+ *           list is executed asynchronously. */
 
 /* pipeline */
 typedef struct pipeline_T {
@@ -71,7 +90,8 @@ typedef enum {
 /* command in a pipeline */
 typedef struct command_T {
     struct command_T *next;
-    refcount_T        refcount;
+    refcount_T        refcount;   /* unused if `c_arena' is non-NULL */
+    struct parsearena_T *c_arena; /* arena containing this command */
     commandtype_T     c_type;
     unsigned long     c_lineno;   /* line number */
     struct redir_T   *c_redirs;   /* redirections */
@@ -79,6 +99,7 @@ typedef struct command_T {
 	struct {
 	    struct assign_T *assigns;  /* assignments */
 	    void           **words;    /* command name and arguments */
+	    _Bool            tailcall; /* in tail position of function body */
 	} simplecommand;
 	struct and_or_T     *subcmds;  /* contents of command group */
 	struct ifcommand_T  *ifcmds;   /* contents of if command */
@@ -105,6 +126,7 @@ typedef struct command_T {
 } command_T;
 #define c_assigns  c_content.simplecommand.assigns
 #define c_words    c_content.simplecommand.words
+#define c_tailcall c_content.simplecommand.tailcall
 #define c_subcmds  c_content.subcmds
 #define c_ifcmds   c_content.ifcmds
 #define c_forname  c_content.forloop.forname
@@ -118,10 +140,14 @@ typedef struct command_T {
 #define c_dbexp    c_content.dbexp
 #define c_funcname c_content.funcdef.funcname
 #define c_funcbody c_content.funcdef.funcbody
-/* `c_words' and `c_forwords' are NULL-terminated arrays of pointers to
+/* `c_arena' is NULL if the command is not allocated in an arena, in which
+ * case `refcount' counts the references to the command.
+ * `c_words' and `c_forwords' are NULL-terminated arrays of pointers to
  * `wordunit_T' that are cast to `void *'.
  * If `c_forwords' is NULL, the for loop doesn't have the "in" clause.
- * If `c_forwords[0]' is NULL, the "in" clause exists and is empty. */
+ * If `c_forwords[0]' is NULL, the "in" clause exists and is empty.
+ * `c_tailcall' is false when the command is parsed. It is set by the executor
+ * when the function whose body contains the command is defined. */
 
 /* condition and commands of an if command */
 typedef struct ifcommand_T {
@@ -131,14 +157,29 @@ typedef struct ifcommand_T {
 } ifcommand_T;
 /* For an "else" clause, `next' and `ic_condition' are NULL. */
 
+/* compiled case pattern cached in a case item */
+typedef struct casepattern_T {
+    wchar_t            *cp_text;        /* expanded pattern */
+    struct xfnmatch_T  *cp_xfnm;        /* compiled pattern */
+    unsigned long       cp_generation;  /* locale generation of `cp_xfnm' */
+    _Bool               cp_constant;    /* true if pattern has no expansion */
+} casepattern_T;
+/* `cp_text' is NULL until the pattern is first expanded. `cp_xfnm' may be NULL
+ * if the pattern cannot be compiled, in which case the pattern matches
+ * nothing. `cp_generation' is compared with `xfnm_locale_generation' to detect
+ * a compiled pattern that is out of date. */
+
 /* patterns and commands of a case command */
 typedef struct caseitem_T {
     struct caseitem_T *next;
     void             **ci_patterns;  /* patterns to do matching */
     struct and_or_T   *ci_commands;  /* commands executed if match succeeds */
+    casepattern_T     *ci_compiled;  /* cache of compiled patterns */
 } caseitem_T;
 /* `ci_patterns' is a NULL-terminated array of pointers to `wordunit_T' that are
- * cast to `void *'. */
+ * cast to `void *'.
+ * `ci_compiled' is NULL until the case command is first executed. It then
+ * points to an array of as many `casepattern_T's as `ci_patterns'. */
 
 /* type of dbexp_T */
 typedef enum {
@@ -246,6 +287,7 @@ typedef struct paramexp_T {
 	wchar_t           *name;
 	struct wordunit_T *nest;
     } pe_value;
+    struct varsymbol_T *pe_symbol;
     struct wordunit_T *pe_start, *pe_end;
     struct wordunit_T *pe_match, *pe_subst;
 } paramexp_T;
@@ -253,6 +295,8 @@ typedef struct paramexp_T {
 #define pe_nest pe_value.nest
 /* pe_name:  name of parameter
  * pe_nest:  nested parameter expansion
+ * pe_symbol: interned variable name (see `intern_variable_name'), or NULL if
+ *           the expansion is nested or `pe_name' is not a valid identifier
  * pe_start: index of the first element in the range
  * pe_end:   index of the last element in the range
  * pe_match: word to be matched with the value of the parameter
@@ -270,6 +314,7 @@ typedef struct assign_T {
     struct assign_T *next;
     assigntype_T a_type;
     wchar_t *a_name;
+    struct varsymbol_T *a_symbol;  /* interned `a_name' */
     union {
 	struct wordunit_T *scalar;
 	void **array;          
@@ -377,6 +422,17 @@ extern wchar_t *command_to_wcs(const command_T *command, _Bool multiline)
     __attribute__((malloc,warn_unused_result));
 
 
+/********** Functions That Serialize Parse Trees **********/
+
+struct xstrbuf_T;
+extern void dump_and_or_lists(
+	struct xstrbuf_T *restrict buf, const and_or_T *andors)
+    __attribute__((nonnull(1)));
+extern _Bool load_and_or_lists(const char **restrict nextp, const char *end,
+	and_or_T **restrict resultp)
+    __attribute__((nonnull,warn_unused_result));
+
+
 /********** Functions That Free/Duplicate Parse Trees **********/
 
 extern void andorsfree(and_or_T *a);
@@ -389,7 +445,10 @@ extern void paramfree(paramexp_T *p);
 /* Duplicates the specified command (virtually). */
 command_T *comsdup(command_T *c)
 {
-    refcount_increment(&c->refcount);
+    if (c->c_arena != NULL)
+	refcount_increment(&c->c_arena->refcount);
+    else
+	refcount_increment(&c->refcount);
     return c;
 }
 
@@ -50,6 +50,10 @@
 #include "util.h"
 #include "yash.h"
 
+#if HAVE_MEMFD_CREATE
+extern int memfd_create(const char *name, unsigned int flags);
+#endif
+
 
 /********** Utilities **********/
 
@@ -307,6 +311,16 @@ static int parse_and_exec_pipe(int outputfd, char *num, savefd_T **save)
 static int open_heredocument(const struct wordunit_T *content);
 static int open_herestring(char *s, bool appendnewline)
     __attribute__((nonnull));
+static int open_herestring_pipe(const char *s, size_t len)
+    __attribute__((nonnull));
+#if HAVE_MEMFD_CREATE
+static int open_herestring_memfd(const char *s, size_t len)
+    __attribute__((nonnull));
+#endif
+static int open_herestring_tempfile(const char *s, size_t len)
+    __attribute__((nonnull));
+static void write_herestring_file(int fd, const char *s, size_t len)
+    __attribute__((nonnull));
 static int open_process_redirection(const embedcmd_T *command, redirtype_T type)
     __attribute__((nonnull));
 
@@ -771,8 +785,11 @@ int open_heredocument(const wordunit_T *contents)
  * If `appendnewline' is true, a newline is appended to the value of `s'.
  * Returns a newly opened file descriptor if successful, or -1 on error.
  * `s' is freed in this function. */
-/* The contents of the here-document is passed either through a pipe or a
- * temporary file. */
+/* The contents of the here-document is passed through a memory file if
+ * `memfd_create' is available. Otherwise, it is passed through a pipe if it is
+ * short enough, or a temporary file. A pipe is not used for longer contents
+ * because the `read' built-in can read a seekable file in blocks but has to
+ * read a pipe byte by byte. */
 int open_herestring(char *s, bool appendnewline)
 {
     int fd;
@@ -790,8 +807,23 @@ int open_herestring(char *s, bool appendnewline)
     if (appendnewline)
 	s[len++] = '\n';
 
+#if HAVE_MEMFD_CREATE
+    fd = open_herestring_memfd(s, len);
+    if (fd < 0)
+#endif
+	fd = open_herestring_pipe(s, len);
+    if (fd < 0)
+	fd = open_herestring_tempfile(s, len);
+    free(s);
+    return fd;
+}
+
+/* Passes the contents of a here-document through a pipe.
+ * Returns the reading end of the pipe, or -1 if the contents is too long to be
+ * written to the pipe at once. */
+int open_herestring_pipe(const char *s, size_t len)
+{
 #ifdef PIPE_BUF
-    /* use a pipe if the contents is short enough */
     if (len <= PIPE_BUF) {
 	int pipefd[2];
 
@@ -802,31 +834,57 @@ int open_herestring(char *s, bool appendnewline)
 		xerror(errno, Ngt("cannot write the here-document contents "
 			    "to the temporary file"));
 	    xclose(pipefd[PIPE_OUT]);
-	    free(s);
 	    return pipefd[PIPE_IN];
 	}
     }
 #endif /* defined(PIPE_BUF) */
+    return -1;
+}
+
+#if HAVE_MEMFD_CREATE
 
+/* Passes the contents of a here-document through a memory file, which does
+ * not reside in any file system.
+ * Returns the file descriptor, or -1 if no memory file can be created. */
+int open_herestring_memfd(const char *s, size_t len)
+{
+    int fd = memfd_create("yash-heredoc", 0);
+    if (fd < 0)
+	return -1;
+    write_herestring_file(fd, s, len);
+    return fd;
+}
+
+#endif /* HAVE_MEMFD_CREATE */
+
+/* Passes the contents of a here-document through a temporary file.
+ * Returns the file descriptor, or -1 on error. */
+int open_herestring_tempfile(const char *s, size_t len)
+{
     char *tempfile;
-    fd = create_temporary_file(&tempfile, "", 0);
+    int fd = create_temporary_file(&tempfile, "", 0);
     if (fd < 0) {
 	xerror(errno,
 		Ngt("cannot create a temporary file for the here-document"));
-	free(s);
 	return -1;
     }
     if (unlink(tempfile) < 0)
 	xerror(errno, Ngt("failed to remove temporary file `%s'"), tempfile);
     free(tempfile);
+    write_herestring_file(fd, s, len);
+    return fd;
+}
+
+/* Writes the contents of a here-document to the specified file and rewinds the
+ * file. Errors are reported but otherwise ignored. */
+void write_herestring_file(int fd, const char *s, size_t len)
+{
     if (!write_all(fd, s, len))
 	xerror(errno, Ngt("cannot write the here-document contents "
 		    "to the temporary file"));
-    free(s);
     if (lseek(fd, 0, SEEK_SET) != 0)
 	xerror(errno,
 		Ngt("cannot seek the temporary file for the here-document"));
-    return fd;
 }
 
 /* Opens process redirection and returns the file descriptor.
@@ -883,6 +941,19 @@ int open_process_redirection(const embedcmd_T *command, redirtype_T type)
     }
 }
 
+/* Makes the standard output a copy of the specified file descriptor.
+ * The original standard output is saved in `*save', which must be passed to
+ * `undo_redirections' to restore the standard output.
+ * Returns true iff successful. */
+bool redirect_stdout(int fd, savefd_T **save)
+{
+    *save = NULL;
+    save_fd(STDOUT_FILENO, save);
+    if (*save == NULL)
+	return false;
+    return xdup2(fd, STDOUT_FILENO) >= 0;
+}
+
 /* Restores the saved file descriptor and frees `save'. */
 void undo_redirections(savefd_T *save)
 {
@@ -34,6 +34,11 @@
 #if HAVE_GETTEXT
 # include <libintl.h>
 #endif
+#if YASH_ENABLE_SIGNALFD
+# include <sys/epoll.h>
+# include <sys/signalfd.h>
+# include <unistd.h>
+#endif
 #include "builtin.h"
 #include "exec.h"
 #include "expand.h"
@@ -76,7 +81,12 @@
  *  - the shell performs pathname expansion.
  *
  * SIGTTOU is blocked in `put_foreground' and unblocked in `ensure_foreground'.
- * All signals are blocked to avoid race conditions when the shell forks. */
+ * All signals are blocked to avoid race conditions when the shell forks.
+ *
+ * If the shell is configured with signalfd, the signals that have the handler
+ * installed are not unblocked while the shell waits for input or a child
+ * process. Instead, they are read from a signalfd that is watched by epoll
+ * together with the input and passed to the handler. */
 
 
 static int parse_signal_number(const wchar_t *number)
@@ -87,7 +97,25 @@ static int xsigaction(int signum, const struct sigaction *restrict newaction,
 static void set_special_handler(int signum, void (*handler)(int signum));
 static void reset_special_handler(
 	int signum, void (*handler)(int signum), bool leave);
+#if HAVE_POSIX_SPAWN
+static bool add_spawn_default_signal(
+	sigset_t *defaults, int signum, void (*handler)(int signum))
+    __attribute__((nonnull(1)));
+#endif
 static void sig_handler(int signum);
+#if YASH_ENABLE_SIGNALFD
+static bool open_event_fds(void);
+static void close_event_fds(void);
+static int wait_for_events(int fd, const sigset_t *ss, int timeout)
+    __attribute__((nonnull));
+static void get_signal_fd_mask(const sigset_t *restrict ss,
+	sigset_t *restrict fdmask, sigset_t *restrict waitmask)
+    __attribute__((nonnull));
+static void add_signal_fd_mask(int signum, const sigset_t *blocked,
+	sigset_t *restrict fdmask, sigset_t *restrict waitmask)
+    __attribute__((nonnull));
+static bool read_signal_fd(void);
+#endif
 static void handle_sigchld(void);
 static void set_trap(int signum, const wchar_t *command);
 static bool is_originally_ignored(int signum);
@@ -242,6 +270,9 @@ static volatile sig_atomic_t any_signal_received = false;
 /* the signal for which trap is currently executed */
 static int handled_signal = -1;
 
+/* If true, trap actions are not executed until this flag is reset. */
+static bool traps_deferred = false;
+
 /* flags to indicate a signal is caught. */
 static volatile sig_atomic_t signal_received[MAXSIGIDX];
 /* commands to be executed when a signal is trapped (caught). */
@@ -295,6 +326,17 @@ static volatile sig_atomic_t sigchld_received, sigint_received;
 static volatile sig_atomic_t sigwinch_received;
 #endif
 
+#if YASH_ENABLE_SIGNALFD
+/* The signalfd and epoll instance used to wait for signals and input.
+ * Both are shell FDs, or -1 if not open. They are opened when first needed and
+ * closed in `restore_signals' so that a subshell does not share the epoll
+ * instance with the parent. */
+static int signal_fd = -1, epoll_fd = -1;
+/* true if the FDs above could not be opened, in which case the shell falls
+ * back on `sigsuspend' and `pselect'. */
+static bool event_fds_unavailable = false;
+#endif
+
 /* true iff SIGCHLD is handled. */
 static bool main_handler_set = false;
 /* true iff SIGTTIN, SIGTTOU, and SIGTSTP are ignored. */
@@ -355,6 +397,9 @@ void set_signals(void)
  * If `leave' is false, the setting for SIGCHLD are not restored. */
 void restore_signals(bool leave)
 {
+#if YASH_ENABLE_SIGNALFD
+    close_event_fds();
+#endif
     if (job_handlers_set) {
 	job_handlers_set = false;
 	reset_special_handler(SIGTTIN, SIG_IGN, leave);
@@ -382,6 +427,64 @@ void restore_signals(bool leave)
     }
 }
 
+#if HAVE_POSIX_SPAWN
+
+/* Computes the signal settings that an external command started by
+ * `posix_spawn' should inherit from the shell. This is the counterpart of
+ * `restore_signals(true)' that does not change the settings of the shell
+ * process itself.
+ * The signals whose handler must be reset to "default" in the command are
+ * assigned to `*defaults' and the signal mask for the command to `*mask'.
+ * `posix_spawn' resets caught signals to "default" in the child, so the
+ * settings cannot be expressed if a signal that is caught by the shell must be
+ * inherited as "ignore". In that case, false is returned and the caller must
+ * fall back on `fork'. */
+bool get_spawn_signal_settings(sigset_t *defaults, sigset_t *mask)
+{
+    sigemptyset(defaults);
+    if (job_handlers_set) {
+	add_spawn_default_signal(defaults, SIGTTIN, SIG_IGN);
+	add_spawn_default_signal(defaults, SIGTTOU, SIG_IGN);
+	add_spawn_default_signal(defaults, SIGTSTP, SIG_IGN);
+    }
+    if (interactive_handlers_set) {
+	if (!add_spawn_default_signal(defaults, SIGINT, sig_handler))
+	    return false;
+	add_spawn_default_signal(defaults, SIGTERM, SIG_IGN);
+	add_spawn_default_signal(defaults, SIGQUIT, SIG_IGN);
+#if YASH_ENABLE_LINEEDIT && defined(SIGWINCH)
+	if (!add_spawn_default_signal(defaults, SIGWINCH, sig_handler))
+	    return false;
+#endif
+    }
+    if (main_handler_set)
+	if (!add_spawn_default_signal(defaults, SIGCHLD, sig_handler))
+	    return false;
+    *mask = official_sigmask;
+    return true;
+}
+
+/* Decides how the handler for signal `signum', which has been set to `handler'
+ * by `set_special_handler', should be passed to a command started by
+ * `posix_spawn'. If the handler has to be reset from "ignore" to "default", the
+ * signal is added to `*defaults'. Returns false if the handler is caught but
+ * has to be inherited as "ignore". */
+bool add_spawn_default_signal(
+	sigset_t *defaults, int signum, void (*handler)(int signum))
+{
+    if (sigismember(&trapped_signals, signum))
+	return true;  /* reset to "default" during exec */
+
+    if (sigismember(&officially_ignored_signals, signum))
+	return handler == SIG_IGN;
+
+    if (handler == SIG_IGN)
+	sigaddset(defaults, signum);
+    return true;
+}
+
+#endif /* HAVE_POSIX_SPAWN */
+
 /* Re-sets the signal handler for SIGTTIN, SIGTTOU, and SIGTSTP according to the
  * current `doing_job_control_now' and `job_handlers_set'. */
 void reset_job_signals(void)
@@ -578,6 +681,17 @@ void handle_signals(void)
     handle_traps();
 }
 
+/* Sets whether trap actions are deferred and returns the previous setting.
+ * While traps are deferred, caught signals are remembered but their trap
+ * actions are not executed until `handle_traps' is called after the deferral
+ * is cancelled. */
+bool defer_traps(bool defer)
+{
+    bool previous = traps_deferred;
+    traps_deferred = defer;
+    return previous;
+}
+
 /* Waits for SIGCHLD to be caught and call `handle_sigchld'.
  * If SIGCHLD is already caught, this function doesn't wait.
  * If `interruptible' is true, this function can be canceled by SIGINT.
@@ -600,6 +714,15 @@ int wait_for_sigchld(bool interruptible, bool return_on_trap)
 	    break;
 	if (sigchld_received)
 	    break;
+#if YASH_ENABLE_SIGNALFD
+	if (open_event_fds()) {
+	    if (wait_for_events(-1, &ss, -1) < 0 && errno != EINTR) {
+		xerror(errno, "epoll_pwait");
+		break;
+	    }
+	    continue;
+	}
+#endif
 	if (sigsuspend(&ss) < 0) {
 	    if (errno != EINTR) {
 		xerror(errno, "sigsuspend");
@@ -633,7 +756,12 @@ enum wait_for_input_T wait_for_input(int fd, bool trap, int timeout)
     struct timespec *top;
 
     assert(fd >= 0);
+#if YASH_ENABLE_SIGNALFD
+    bool use_epoll = open_event_fds();
+    if (!use_epoll && fd >= FD_SETSIZE) {
+#else
     if (fd >= FD_SETSIZE) {
+#endif
 	xerror(0, Ngt("too many files are opened for yash to handle"));
 	return W_ERROR;
     }
@@ -670,6 +798,26 @@ enum wait_for_input_T wait_for_input(int fd, bool trap, int timeout)
 	    return W_INTERRUPTED;
 	}
 
+#if YASH_ENABLE_SIGNALFD
+	if (use_epoll) {
+	    int count = wait_for_events(fd, &ss, timeout);
+
+	    if (trap && sigint_received) {
+		sigint_received = false;
+		return W_INTERRUPTED;
+	    }
+
+	    if (count >= 0)
+		return (count > 0) ? W_READY : W_TIMED_OUT;
+
+	    if (errno != EINTR) {
+		xerror(errno, "epoll_pwait");
+		return W_ERROR;
+	    }
+	    continue;
+	}
+#endif
+
 	fd_set fdset;
 	FD_ZERO(&fdset);
 	FD_SET(fd, &fdset);
@@ -691,6 +839,173 @@ enum wait_for_input_T wait_for_input(int fd, bool trap, int timeout)
     }
 }
 
+#if YASH_ENABLE_SIGNALFD
+
+/* Opens `signal_fd' and `epoll_fd' if not yet open.
+ * Returns true if they are available. */
+bool open_event_fds(void)
+{
+    if (epoll_fd >= 0)
+	return true;
+    if (event_fds_unavailable)
+	return false;
+
+    sigset_t ss;
+    sigemptyset(&ss);
+    signal_fd = move_to_shellfd(signalfd(-1, &ss, SFD_NONBLOCK | SFD_CLOEXEC));
+    if (signal_fd < 0)
+	goto fail;
+    epoll_fd = move_to_shellfd(epoll_create1(EPOLL_CLOEXEC));
+    if (epoll_fd < 0)
+	goto fail;
+
+    struct epoll_event ev = { .events = EPOLLIN, .data.fd = signal_fd, };
+    if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, signal_fd, &ev) < 0)
+	goto fail;
+    return true;
+
+fail:
+    close_event_fds();
+    event_fds_unavailable = true;
+    return false;
+}
+
+/* Closes `signal_fd' and `epoll_fd' if open. */
+void close_event_fds(void)
+{
+    if (signal_fd >= 0) {
+	remove_shellfd(signal_fd);
+	xclose(signal_fd);
+	signal_fd = -1;
+    }
+    if (epoll_fd >= 0) {
+	remove_shellfd(epoll_fd);
+	xclose(epoll_fd);
+	epoll_fd = -1;
+    }
+}
+
+/* Waits for a signal to be caught or, if `fd' is non-negative, for `fd' to be
+ * ready for reading while the signal mask is temporarily replaced with `ss',
+ * in the same way as `pselect'. The signals that would be caught by
+ * `sig_handler' while waiting are kept blocked and read from `signal_fd'.
+ * `open_event_fds' must have succeeded before calling this function.
+ * Returns 1 if `fd' is ready, 0 on timeout, or -1 with `errno' set on error or
+ * when a signal is caught (EINTR). A file that cannot be watched by epoll
+ * (e.g., a regular file) is always ready. */
+int wait_for_events(int fd, const sigset_t *ss, int timeout)
+{
+    sigset_t fdmask, waitmask;
+    get_signal_fd_mask(ss, &fdmask, &waitmask);
+    if (signalfd(signal_fd, &fdmask, 0) < 0)
+	return -1;
+
+    if (fd >= 0) {
+	struct epoll_event ev = { .events = EPOLLIN, .data.fd = fd, };
+	if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &ev) < 0) {
+	    if (errno != EPERM)
+		return -1;
+	    read_signal_fd();
+	    return 1;
+	}
+    }
+
+    struct epoll_event events[2];
+    int count = epoll_pwait(epoll_fd, events, 2, timeout, &waitmask);
+    int saveerrno = errno;
+
+    bool ready = false, caught = false;
+    for (int i = 0; i < count; i++) {
+	if (events[i].data.fd == signal_fd)
+	    caught = read_signal_fd();
+	else
+	    ready = true;
+    }
+
+    if (fd >= 0)
+	epoll_ctl(epoll_fd, EPOLL_CTL_DEL, fd, NULL);
+
+    if (ready)
+	return 1;
+    if (caught) {
+	errno = EINTR;
+	return -1;
+    }
+    if (count < 0) {
+	errno = saveerrno;
+	return -1;
+    }
+    return 0;
+}
+
+/* Computes the set of signals that should be read from `signal_fd' while the
+ * shell waits with the signal mask `ss': the signals that are currently
+ * blocked, are not in `ss', and have `sig_handler' as the handler. The set is
+ * assigned to `*fdmask'. The signal mask that should be used instead of `ss',
+ * which keeps the signals in `*fdmask' blocked so that they are queued to
+ * `signal_fd' rather than interrupting the wait, is assigned to `*waitmask'. */
+void get_signal_fd_mask(const sigset_t *restrict ss,
+	sigset_t *restrict fdmask, sigset_t *restrict waitmask)
+{
+    sigset_t blocked;
+    sigemptyset(&blocked);
+    sigprocmask(SIG_BLOCK, NULL, &blocked);
+
+    sigemptyset(fdmask);
+    *waitmask = *ss;
+    for (const signal_T *s = signals; s->no != 0; s++)
+	add_signal_fd_mask(s->no, &blocked, fdmask, waitmask);
+#if defined SIGRTMIN && defined SIGRTMAX
+    for (int sigrtmin = SIGRTMIN, i = 0;
+	    i < RTSIZE && i <= SIGRTMAX - sigrtmin;
+	    i++)
+	add_signal_fd_mask(sigrtmin + i, &blocked, fdmask, waitmask);
+#endif
+}
+
+/* Adds `signum' to `fdmask' and `waitmask' if the signal should be read from
+ * `signal_fd'. See `get_signal_fd_mask'. */
+void add_signal_fd_mask(int signum, const sigset_t *blocked,
+	sigset_t *restrict fdmask, sigset_t *restrict waitmask)
+{
+    if (!sigismember(blocked, signum) || sigismember(waitmask, signum))
+	return;
+
+    bool caught = sigismember(&trapped_signals, signum);
+    switch (signum) {
+	case SIGCHLD:
+	    caught |= main_handler_set;
+	    break;
+	case SIGINT:
+#if YASH_ENABLE_LINEEDIT && defined(SIGWINCH)
+	case SIGWINCH:
+#endif
+	    caught |= interactive_handlers_set;
+	    break;
+    }
+    if (caught) {
+	sigaddset(fdmask, signum);
+	sigaddset(waitmask, signum);
+    }
+}
+
+/* Reads all the signals queued to `signal_fd' and passes them to
+ * `sig_handler'. Returns true if any signal was read. */
+bool read_signal_fd(void)
+{
+    bool any = false;
+    struct signalfd_siginfo info[8];
+    ssize_t size;
+    while ((size = read(signal_fd, info, sizeof info)) > 0) {
+	for (size_t i = 0; i < (size_t) size / sizeof *info; i++)
+	    sig_handler((int) info[i].ssi_signo);
+	any = true;
+    }
+    return any;
+}
+
+#endif /* YASH_ENABLE_SIGNALFD */
+
 /* Handles SIGCHLD if caught. */
 void handle_sigchld(void)
 {
@@ -699,8 +1014,8 @@ void handle_sigchld(void)
         do_wait();
     }
 
-    if (any_job_status_has_changed()) {
-	/* print job status if the notify option is set */
+    /* print job status if the notify option is set */
+    if ((shopt_notify || shopt_notifyle) && any_job_status_has_changed()) {
 #if YASH_ENABLE_LINEEDIT
 	if (le_state & LE_STATE_ACTIVE) {
 	    if (!(le_state & LE_STATE_COMPLETING)) {
@@ -736,6 +1051,8 @@ int handle_traps(void)
      * The EXIT trap may be executed inside another trap. */
     if (!any_trap_set || !any_signal_received || handled_signal >= 0)
 	return 0;
+    if (traps_deferred)
+	return 0;
 #if YASH_ENABLE_LINEEDIT
     /* Don't handle traps during command line completion. Otherwise, the command
      * line would be messed up! */
@@ -19,6 +19,7 @@
 #ifndef YASH_SIG_H
 #define YASH_SIG_H
 
+#include <signal.h>
 #include <stddef.h>
 #include <sys/types.h>
 #include "xgetopt.h"
@@ -37,6 +38,10 @@ extern _Bool any_trap_set;
 extern void init_signal(void);
 extern void set_signals(void);
 extern void restore_signals(_Bool leave);
+#if HAVE_POSIX_SPAWN
+extern _Bool get_spawn_signal_settings(sigset_t *defaults, sigset_t *mask)
+    __attribute__((nonnull));
+#endif
 extern void reset_job_signals(void);
 extern void set_interruptible_by_sigint(_Bool onoff);
 extern void ignore_sigquit_and_sigint(void);
@@ -53,6 +58,7 @@ enum wait_for_input_T {
 extern enum wait_for_input_T wait_for_input(int fd, _Bool trap, int timeout);
 
 extern int handle_traps(void);
+extern _Bool defer_traps(_Bool defer);
 extern void execute_exit_trap(void);
 extern void clear_exit_trap(void);
 extern void phantomize_traps(void);
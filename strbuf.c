@@ -437,6 +437,51 @@ char *wb_mbscat(xwcsbuf_T *restrict buf, const char *restrict s)
     return (char *) s;
 }
 
+/* Converts the first `n' bytes of multibyte string `s' into a wide string and
+ * appends it to buffer `buf'. The multibyte string is assumed to start in the
+ * initial shift state. Unlike `wb_mbscat', null bytes in `s' are not special:
+ * they are converted to null wide characters and the conversion continues.
+ * Returns NULL if the whole string is converted and appended successfully,
+ * otherwise a pointer to the byte in `s' that starts an invalid or incomplete
+ * multibyte character. In that case, the characters preceding the byte are
+ * left appended in the buffer. */
+const char *wb_mbsncat(
+	xwcsbuf_T *restrict buf, const char *restrict s, size_t n)
+{
+    /* The result never has more characters than the bytes in `s'. */
+    wb_ensuremax(buf, add(buf->length, n));
+
+    bool ascii = is_ascii_compatible_locale();
+    wchar_t *out = &buf->contents[buf->length];
+    const char *end = &s[n];
+    mbstate_t state;
+    memset(&state, 0, sizeof state);  // initialize as the initial shift state
+
+    while (s < end) {
+	if (ascii) {
+	    /* fast path: ASCII characters need no conversion */
+	    while (s < end && (unsigned char) *s < 0x80)
+		*out++ = (wchar_t) *s++;
+	    if (s == end)
+		break;
+	}
+
+	size_t count = mbrtowc(out, s, (size_t) (end - s), &state);
+	if (count == (size_t) -1 || count == (size_t) -2)
+	    goto done;
+	if (count == 0)
+	    count = 1;  // null byte
+	out++;
+	s += count;
+    }
+    s = NULL;
+
+done:
+    buf->length = (size_t) (out - buf->contents);
+    buf->contents[buf->length] = L'\0';
+    return s;
+}
+
 /* Appends the result of `vswprintf' to the specified buffer.
  * `format' and the following arguments must not be part of `buf->contents'.
  * Returns the number of appended characters if successful.
@@ -499,6 +544,76 @@ int wb_wprintf(xwcsbuf_T *restrict buf, const wchar_t *restrict format, ...)
 
 /********** Multibyte-Wide Conversion Utilities **********/
 
+/* 1 if the encoding of the current LC_CTYPE locale is stateless and maps
+ * every ASCII byte to the wide character of the same value, 0 if not, or -1 if
+ * not yet known. */
+static int ascii_compatible_locale = -1;
+/* 1 if the encoding of the current LC_CTYPE locale is UTF-8, 0 if not, or -1
+ * if not yet known. */
+static int utf8_locale = -1;
+
+/* Forgets the cached properties of the current LC_CTYPE locale.
+ * This function must be called whenever the LC_CTYPE locale is changed. */
+void reset_ctype_cache(void)
+{
+    ascii_compatible_locale = -1;
+    utf8_locale = -1;
+}
+
+/* Returns true if the encoding of the current LC_CTYPE locale is stateless and
+ * every byte less than 0x80 is a single-byte character whose wide character
+ * value is the same as the byte value. If true, ASCII bytes can be converted
+ * to wide characters without calling `mbrtowc'. */
+bool is_ascii_compatible_locale(void)
+{
+    if (ascii_compatible_locale < 0) {
+	ascii_compatible_locale = 1;
+	if (mbtowc(NULL, NULL, 0) != 0) {
+	    ascii_compatible_locale = 0;  // state-dependent encoding
+	} else {
+	    for (int c = 0; c < 0x80; c++) {
+		if (btowc(c) != (wint_t) c) {
+		    ascii_compatible_locale = 0;
+		    break;
+		}
+	    }
+	}
+    }
+    return ascii_compatible_locale;
+}
+
+/* Returns true if the encoding of the current LC_CTYPE locale is UTF-8 and
+ * the values of wide characters are Unicode code points. If true, multibyte
+ * characters can be decoded without calling `mbrtowc'. */
+bool is_utf8_locale(void)
+{
+    if (utf8_locale < 0) {
+	utf8_locale = 0;
+#if defined __STDC_ISO_10646__ && WCHAR_MAX >= 0x10FFFF
+	if (is_ascii_compatible_locale()) {
+	    static const struct { const char *s; wchar_t wc; } samples[] = {
+		{ "\xC3\xA9",         0xE9, },
+		{ "\xE3\x81\x82",     0x3042, },
+		{ "\xF0\x9F\x98\x80", 0x1F600, },
+	    };
+	    utf8_locale = 1;
+	    for (size_t i = 0; i < sizeof samples / sizeof *samples; i++) {
+		mbstate_t state;
+		wchar_t wc;
+		size_t len = strlen(samples[i].s);
+		memset(&state, 0, sizeof state);
+		if (mbrtowc(&wc, samples[i].s, len, &state) != len
+			|| wc != samples[i].wc) {
+		    utf8_locale = 0;
+		    break;
+		}
+	    }
+	}
+#endif
+    }
+    return utf8_locale;
+}
+
 /* Converts the specified wide string into a newly malloced multibyte string.
  * Only the first `n' characters of `s' is converted at most.
  * Returns NULL on error.
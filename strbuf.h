@@ -169,6 +169,9 @@ extern xwcsbuf_T *wb_wccat(xwcsbuf_T *buf, wchar_t c)
     __attribute__((nonnull));
 extern char *wb_mbscat(xwcsbuf_T *restrict buf, const char *restrict s)
     __attribute__((nonnull));
+extern const char *wb_mbsncat(
+	xwcsbuf_T *restrict buf, const char *restrict s, size_t n)
+    __attribute__((nonnull));
 extern int wb_vwprintf(
 	xwcsbuf_T *restrict buf, const wchar_t *restrict format, va_list ap)
     __attribute__((nonnull(1,2)));
@@ -176,6 +179,10 @@ extern int wb_wprintf(
 	xwcsbuf_T *restrict buf, const wchar_t *restrict format, ...)
     __attribute__((nonnull(1,2)));
 
+extern void reset_ctype_cache(void);
+extern _Bool is_ascii_compatible_locale(void);
+extern _Bool is_utf8_locale(void);
+
 extern char *malloc_wcsntombs(const wchar_t *s, size_t n)
     __attribute__((nonnull,malloc,warn_unused_result));
 #if HAVE_WCSNRTOMBS
@@ -115,6 +115,39 @@ __IN__
 -2
 __OUT__
 
+test_oE 'variables are read when operators are applied'
+x=1
+for i in 1 2 3; do
+    echo $((x + (x = i * 10))) $((x ? y = x : 0)) $y
+done
+__IN__
+20 10 10
+40 20 20
+60 30 30
+__OUT__
+
+test_Oe -e 2 'prefix ++ applied to non-variable'
+eval 'echoraw $((++1))'
+__IN__
+eval: arithmetic: operator `++' requires a variable
+__ERR__
+#'
+#`
+
+test_oe -e 2 'same expression before and after enabling POSIXly-correct mode'
+f() { eval 'echo $((++x))'; }
+x=1
+f
+set -o posix
+f
+__IN__
+2
+__OUT__
+eval: arithmetic: operator `++' is not supported
+__ERR__
+#'
+#`
+
 # $1 = line no.
 # $2 = arithmetic expression that causes division by zero
 test_division_by_zero() {
@@ -252,6 +252,28 @@ __IN__
 [I][J][1][2  2][3]
 __OUT__
 
+test_oE -e 0 'inserting and removing many array elements at both ends'
+q=()
+i=0
+while [ "$i" -lt 100 ]; do
+    array -i q -1 "t$i"
+    array -i q 0 "h$i"
+    if [ "$((i % 3))" -eq 0 ]; then
+	shift -A q 2
+    fi
+    i=$((i + 1))
+done
+array -i q 70 m
+shift -A q -60
+printf '%s\n' "${q[#]}" "${q[1]}" "${q[70]}" "${q[71]}" "${q[-1]}"
+__IN__
+73
+h97
+t37
+m
+t39
+__OUT__
+
 test_Oe -e n 'inserting array elements (nonexistent array)'
 array -i x 1 ''
 __IN__
@@ -366,6 +388,146 @@ __ERR__
 
 )
 
+test_oE -e 0 'creating associative array (array built-in)'
+array -A m foo 1 'b  r' '2  2'
+bracket "${m[foo]}" "${m[b  r]}" "$m"
+__IN__
+[1][2  2][2  2][1]
+__OUT__
+
+test_oE -e 0 'creating associative array (typeset built-in)'
+typeset -A m
+bracket "${m[#]}" "$m"
+typeset -A m
+array -s m k v
+typeset -A m
+bracket "$m"
+__IN__
+[0]
+[v]
+__OUT__
+
+test_oE -e 0 'expanding associative array elements'
+array -A m a 1 b 22 c 333
+k=b
+bracket "${m[$k]}" "${#m[c]}" "${m[#]}" "${m[@]}" "${m[none]-unset}"
+__IN__
+[22][3][3][1][22][333][unset]
+__OUT__
+
+test_oE -e 0 'associative array keys @, * and # in expanded index'
+array -A m @ at '*' star '#' hash
+for k in @ '*' '#'; do bracket "${m[$k]}"; done
+bracket "${m[#]}"
+__IN__
+[at]
+[star]
+[hash]
+[3]
+__OUT__
+
+test_oE -e 0 'assigning to associative array element in expansion'
+typeset -A m
+bracket "${m[k]=v}" "${m[k]=w}" "$m"
+__IN__
+[v][v][v]
+__OUT__
+
+test_oE -e 0 'setting associative array elements'
+array -A m a 1 b 2
+array -s m b 3
+array -s m c 4
+bracket "$m"
+__IN__
+[1][3][4]
+__OUT__
+
+test_oE -e 0 'deleting associative array elements'
+array -A m a 1 b 2 c 3
+array -d m c a x
+bracket "$m"
+__IN__
+[2]
+__OUT__
+
+test_oE -e 0 'getting associative array keys'
+array -A m 'k 2' 2 'k 1' 1
+array -k m keys
+bracket "$keys"
+__IN__
+[k 1][k 2]
+__OUT__
+
+test_oE -e 0 'printing associative array'
+array -A m 'k 1' 1 k2 "'"
+typeset -p m
+__IN__
+array -A m 'k 1' 1 k2 \'
+typeset m
+__OUT__
+
+test_oE -e 0 'associative array printed by typeset can be restored'
+array -A m 'k 1' 1 k2 "'"
+s=$(typeset -p m)
+unset m
+eval "$s"
+bracket "${m[k 1]}" "${m[k2]}"
+__IN__
+[1][']
+__OUT__
+
+test_oE -e 0 'unsetting associative array'
+array -A m a 1
+unset m
+bracket "${m[a]-unset}"
+__IN__
+[unset]
+__OUT__
+
+test_oE -e 0 'local associative array'
+array -A m a 1
+f() { typeset -A m; array -s m a 2; bracket "$m"; }
+f
+bracket "$m"
+__IN__
+[2]
+[1]
+__OUT__
+
+test_O -d -e n 'associative array with range index'
+array -A m a 1
+echo "${m[a,a]}"
+__IN__
+
+test_Oe -e n 'creating associative array (missing value)'
+array -A m a
+__IN__
+array: the value for key `a' is missing
+__ERR__
+#'
+#`
+
+test_Oe -e n 'setting associative array element (read-only)'
+array -A m a 1
+readonly m
+array -s m a 2
+__IN__
+array: $m is read-only
+__ERR__
+
+test_Oe -e n 'getting keys of non-associative array'
+a=(1)
+array -k a keys
+__IN__
+array: no such associative array $a
+__ERR__
+
+test_Oe -e n 'assigning scalar to associative array by typeset'
+typeset -A m=1
+__IN__
+typeset: associative array $m cannot be assigned a scalar value
+__ERR__
+
 test_Oe -e n 'invalid option'
 array --no-such-option
 __IN__
@@ -163,6 +163,19 @@ a='*' b='|' bb='\|' p='(a|b)'
     ! [[ a =~ "$p" ]]
 __IN__
 
+test_oE 'many distinct regexes with binary primary =~'
+i=0
+while [ "$i" -lt 100 ]; do
+    [[ x$i =~ ^x$i$ ]] && ! [[ x$i =~ ^x$((i+1))$ ]] || echo mismatch $i
+    i=$((i+1))
+done
+[[ x99 =~ ^x99$ ]] && echo x99
+[[ x0 =~ ^x0$ ]] && echo x0
+__IN__
+x99
+x0
+__OUT__
+
 # Note: ksh and zsh behaves differently for some of the below
 test_OE -e 0 'bracket pattern with binary primary =~'
 [[ b =~ [a"-"c] ]] && ! [[ - =~ [a"-"c] ]] &&
@@ -26,6 +26,42 @@ expanded 0
 expanded 1
 __ERR__
 
+test_oE 'patterns are expanded on each execution'
+for p in a 'a*' '[ab]*' '\*'; do
+    for w in abc '*'; do
+        case $w in ($p) echo "$w matched $p"; esac
+    done
+done
+for HOME in /a /b /c; do
+    case /b in (~) echo "matched $HOME"; esac
+done
+__IN__
+abc matched a*
+abc matched [ab]*
+* matched \*
+matched /b
+__OUT__
+
+test_oE 'constant patterns can be matched repeatedly'
+f() {
+    case $1 in
+        (a|b)   echo "$1 1";;
+        ('c'*)  echo "$1 2";;
+        ([d-f]) echo "$1 3";;
+        (*)     echo "$1 4";;
+    esac
+}
+for w in a b c1 e c z a; do f "$w"; done
+__IN__
+a 1
+b 1
+c1 2
+e 3
+c 2
+z 4
+a 1
+__OUT__
+
 # The behavior is unspecified in POSIX, but many existing shells seem to behave
 # this way (with the notable exception of ksh).
 test_OE -e 0 'exit status of case command (matched, empty)'
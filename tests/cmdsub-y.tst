@@ -91,4 +91,65 @@ __ERR__
 #`
 #`
 
+test_oE 'output larger than pipe buffer'
+x="$(i=0; while [ "$i" -lt 10000 ]; do echo 0123456789; i=$((i+1)); done)"
+echo "${#x}"
+__IN__
+109999
+__OUT__
+
+test_oE 'variables assigned in built-in-only command substitution'
+x=1
+y="$(x=2; : $((z=3)); echo "$x")"
+echo "$x $y ${z-unset}"
+__IN__
+1 2 unset
+__OUT__
+
+test_oE 'function in command substitution modifying positional parameters'
+f() { local v=local; shift; echo "$# $v"; }
+set a b c
+echo "$(f "$@")" "$#" "${v-unset}"
+__IN__
+2 local 3 unset
+__OUT__
+
+test_oE 'exit status of built-in-only command substitution'
+x="$(echo foo; return 3)"
+echo "$? $x"
+x="$(exit 5)"
+echo "$?"
+__IN__
+3 foo
+5
+__OUT__
+
+test_oE 'errexit in built-in-only command substitution' -e
+f() { echo in; false; echo not reached; }
+echo "[$(f)]"
+echo done
+__IN__
+[in]
+done
+__OUT__
+
+test_oE 'traps deferred during built-in-only command substitution'
+trap 'echo trapped' USR1
+x="$(kill -s USR1 $$; echo in)"
+echo "$x"
+__IN__
+trapped
+in
+__OUT__
+
+test_oE '$RANDOM in command substitution does not affect the shell'
+RANDOM=123
+a="$(echo "$RANDOM")" b="$(echo "$((RANDOM))")" c="$RANDOM"
+RANDOM=123
+d="$RANDOM"
+[ "$a" = "$d" ] && [ "$b" = "$d" ] && [ "$c" = "$d" ] && echo ok
+__IN__
+ok
+__OUT__
+
 # vim: set ft=sh ts=8 sts=4 sw=4 noet:
@@ -46,6 +46,144 @@ __IN__
 foo
 __OUT__
 
+test_oE 'reading the same file repeatedly'
+echo 'echo "$1"; [ "$1" = 2 ] && return 3; echo end' >repeat
+. ./repeat 1; echo $?
+. ./repeat 2; echo $?
+. ./repeat 3; echo $?
+__IN__
+1
+end
+0
+2
+3
+3
+end
+0
+__OUT__
+
+test_oE 'reading the same file repeatedly while it is modified'
+echo 'echo 1' >modified
+. ./modified
+echo 'echo 22' >modified
+. ./modified
+echo 'echo 333' >modified
+. ./modified
+__IN__
+1
+22
+333
+__OUT__
+
+test_oE 'alias defined while reading the same file repeatedly'
+cat >aliasdef <<\END
+if [ "$1" = define ]; then alias x='echo aliased'; fi
+x
+END
+x() { echo function; }
+. ./aliasdef
+. ./aliasdef define
+. ./aliasdef
+unalias x
+. ./aliasdef
+__IN__
+function
+aliased
+aliased
+function
+__OUT__
+
+test_oE 'cached file evicted while being executed'
+# Reading "large" evicts the entry for "evicted" from the cache, and then
+# "evicted" becomes inapplicable to the current state while being executed.
+awk 'BEGIN { for (i = 0; i < 52427; i++) print "#234567890123456789" }' \
+    >large
+cat >evicted <<\END
+. ./large
+if [ -n "$second" ]; then set -o posixlycorrect; fi
+echo unit3
+END
+. -A ./evicted
+second=1
+. -A ./evicted
+echo end
+__IN__
+unit3
+unit3
+end
+__OUT__
+
+test_oE 'reading the same file repeatedly without parse cache' +o parsecache
+echo 'echo "$1"' >repeat2
+. ./repeat2 1
+. ./repeat2 2
+__IN__
+1
+2
+__OUT__
+
+test_oE 'commands saved in YASH_PARSECACHE_DIR'
+mkdir -m 700 savedcache
+export YASH_PARSECACHE_DIR="$PWD/savedcache"
+cat >saved <<\END
+f() { case $1 in (a) echo "${1}1" $((1+1)) "$(echo x)";; esac <<EOF
+EOF
+}
+f a
+END
+"$TESTEE" -c '. ./saved'
+ls savedcache | wc -l | tr -d ' '
+"$TESTEE" -c '. ./saved; typeset -fp f'
+__IN__
+a1 2 x
+1
+a1 2 x
+f()
+{
+   case ${1} in
+      (a)
+         echo "${1}1" $((1+1)) "$(echo x)"
+         ;;
+   esac 0<<EOF
+EOF
+}
+__OUT__
+
+test_oE 'file modified after commands are saved in YASH_PARSECACHE_DIR'
+mkdir -m 700 modcache
+export YASH_PARSECACHE_DIR="$PWD/modcache"
+echo 'echo foo' >savedmod
+"$TESTEE" -c '. ./savedmod'
+echo 'echo bar' >savedmod
+"$TESTEE" -c '. ./savedmod'
+"$TESTEE" -c '. ./savedmod'
+__IN__
+foo
+bar
+bar
+__OUT__
+
+test_oE 'number of files in YASH_PARSECACHE_DIR is bounded'
+mkdir -m 700 prunecache
+export YASH_PARSECACHE_DIR="$PWD/prunecache"
+i=0
+while [ "$i" -lt 1100 ]; do
+    >"prunecache/0-$i"
+    i=$((i+1))
+done
+>prunecache/other
+echo 'echo pruned' >pruned
+"$TESTEE" -c '. ./pruned'
+ls prunecache | wc -l | tr -d ' '
+ls prunecache/other
+"$TESTEE" -c '. ./pruned'
+__IN__
+pruned
+1025
+prunecache/other
+pruned
+__OUT__
+
 (
 setup 'alias true=false'
 
@@ -53,6 +53,47 @@ __IN__
 A
 __OUT__
 
+test_oE 'environment reflects the last assignment and unset'
+export a=1 b=2 c=3
+a=A
+unset b
+c=C
+c=CC
+sh -c 'echo ${a-unset} ${b-unset} ${c-unset}'
+b=B
+sh -c 'echo ${a-unset} ${b-unset} ${c-unset}'
+export b
+sh -c 'echo ${a-unset} ${b-unset} ${c-unset}'
+__IN__
+A unset CC
+A unset CC
+A B CC
+__OUT__
+
+test_oE 'temporary assignment is not left in environment'
+export a=A
+a=X sh -c 'echo $a'
+b=Y sh -c 'echo ${b-unset}'
+sh -c 'echo $a ${b-unset}'
+__IN__
+X
+Y
+A unset
+__OUT__
+
+test_oE 'inherited variables are passed on, printed and unset'
+export a=1 b=2 c=3 d=4
+"$TESTEE" -c '
+unset b
+c=C
+typeset -p a c
+sh -c "echo \${a-unset} \${b-unset} \${c-unset} \${d-unset}"'
+__IN__
+typeset -x a=1
+typeset -x c=C
+1 unset C 4
+__OUT__
+
 test_O -d -e 1 'assigning to ill-named variable'
 export =A
 __IN__
@@ -228,4 +228,41 @@ __ERR__
 #'
 #`
 
+test_oE 'deep tail recursion'
+count() {
+    if [ "$1" -gt 0 ]; then
+        count "$(($1 - 1))" "$2"
+    else
+        case $2 in
+            (*) echo "$@"; return 3;;
+        esac
+    fi
+}
+count 100000 x
+echo $?
+count 100000 y
+__IN__
+0 x
+3
+0 y
+__OUT__
+
+test_oE 'function called in tail position'
+f() { typeset v="$1"; false; g a "$@"; }
+g() { echo "$?" "$#" "$*" "$v"; }
+f b c
+echo "$?"
+__IN__
+1 3 a b c b
+0
+__OUT__
+
+test_oE 'function called in tail position with redirection'
+f() { { g; } >&2; }
+g() { echo g >&2; echo g; }
+f 2>/dev/null
+__IN__
+__OUT__
+
+
 # vim: set ft=sh ts=8 sts=4 sw=4 noet:
@@ -58,10 +58,14 @@ Syntax:
 	array -d name [index...]
 	array -i name index [value...]
 	array -s name index value
+	array -A name [key value...]
+	array -k name array_name
 
 Options:
+	-A       --associative
 	-d       --delete
 	-i       --insert
+	-k       --keys
 	-s       --set
 	         --help
 
@@ -400,6 +404,7 @@ Syntax:
 Options:
 	-f       --functions
 	-g       --global
+	-A       --associative
 	-p       --print
 	-r       --readonly
 	-x       --export
@@ -588,9 +593,10 @@ __IN__
 local: set or print local variables
 
 Syntax:
-	local [-prxX] [name[=value]...]
+	local [-AprxX] [name[=value]...]
 
 Options:
+	-A       --associative
 	-p       --print
 	-r       --readonly
 	-x       --export
@@ -719,6 +725,7 @@ Syntax:
 Options:
 	-f       --functions
 	-g       --global
+	-A       --associative
 	-p       --print
 	-r       --readonly
 	-x       --export
@@ -796,6 +803,7 @@ Options:
 	-b       -o notify
 	         -o notifyle
 	         -o nullglob
+	         -o parsecache
 	         -o pipefail
 	         -o posixlycorrect
 	-s       -o stdin
@@ -950,11 +958,12 @@ __IN__
 typeset: set or print variables
 
 Syntax:
-	typeset [-fgprxX] [name[=value]...]
+	typeset [-fgAprxX] [name[=value]...]
 
 Options:
 	-f       --functions
 	-g       --global
+	-A       --associative
 	-p       --print
 	-r       --readonly
 	-x       --export
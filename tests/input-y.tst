@@ -0,0 +1,139 @@
+# input-y.tst: yash-specific test of input processing
+
+test_oE 'no input more than needed is read (pipe)'
+cat <<\END | "$TESTEE"
+"$TESTEE" -c 'read -r line && printf "%s\n" "$line"'
+echo - this line is consumed by read and printed by printf
+echo - this line is consumed and executed by shell
+read -r line
+echo - this line is consumed by the read built-in
+printf "%s\n" "$line"
+END
+__IN__
+echo - this line is consumed by read and printed by printf
+- this line is consumed and executed by shell
+echo - this line is consumed by the read built-in
+__OUT__
+
+test_oE 'no input more than needed is read (many lines in pipe)'
+{
+    i=0
+    while [ "$i" -lt 100 ]; do
+	echo "echo $i"
+	i=$((i+1))
+    done
+    echo '"$TESTEE" -c "read -r line && printf \"%s\n\" \"\$line\""'
+    echo 'echo - this line is consumed by read and printed by printf'
+    echo 'echo - this line is consumed and executed by shell'
+} | "$TESTEE" | tail -n 3
+__IN__
+99
+echo - this line is consumed by read and printed by printf
+- this line is consumed and executed by shell
+__OUT__
+
+test_oE 'long line (pipe)'
+{
+    printf 'echo 1'
+    i=0
+    while [ "$i" -lt 1000 ]; do
+	printf '                    '
+	i=$((i+1))
+    done
+    printf '2\n'
+} | "$TESTEE"
+__IN__
+1 2
+__OUT__
+
+test_oE 'last line without newline (pipe)'
+printf 'echo 1\necho 2' | "$TESTEE"
+__IN__
+1
+2
+__OUT__
+
+test_oE 'shell input is line-wise (pipe)'
+printf 'alias false=:\nfalse && echo ok\n' | "$TESTEE"
+__IN__
+ok
+__OUT__
+
+test_oE 'commands after exit in script file are not parsed'
+printf 'echo 1\nexit\necho 2\nfi\n' >exitfile.sh
+"$TESTEE" exitfile.sh
+echo $?
+__IN__
+1
+0
+__OUT__
+
+test_oE 'syntax error in the middle of script file'
+printf 'echo 1\necho 2; fi\necho 3\n' >synerrfile.sh
+"$TESTEE" synerrfile.sh 2>/dev/null
+echo $?
+__IN__
+1
+2
+__OUT__
+
+test_oE 'script file without newline at end'
+printf 'echo 1\necho 2' >nonewline.sh
+"$TESTEE" nonewline.sh
+__IN__
+1
+2
+__OUT__
+
+test_oE 'lines appended to script file while executing'
+printf '%s\n' 'echo 1' 'echo "echo 2" >>appendfile.sh' >appendfile.sh
+"$TESTEE" appendfile.sh
+__IN__
+1
+2
+__OUT__
+
+(
+if ! LC_ALL=C.UTF-8 testee -c 'x=$(printf "\303\251"); [ "${#x}" -eq 1 ]'
+then
+    skip="true"
+fi
+
+printf 'echo 1\necho \303' >incomplete.sh
+
+test_oE 'incomplete character at end of input (file)'
+LC_ALL=C.UTF-8 "$TESTEE" <incomplete.sh 2>incomplete1.err
+echo $?
+grep -c 'cannot read input' incomplete1.err
+__IN__
+1
+
+2
+1
+__OUT__
+
+test_oE 'incomplete character at end of input (pipe)'
+cat incomplete.sh | LC_ALL=C.UTF-8 "$TESTEE" 2>incomplete2.err
+echo $?
+grep -c 'cannot read input' incomplete2.err
+__IN__
+1
+
+2
+1
+__OUT__
+
+test_oE 'incomplete character at end of script file'
+LC_ALL=C.UTF-8 "$TESTEE" incomplete.sh 2>incomplete3.err
+echo $?
+grep -c 'cannot read input' incomplete3.err
+__IN__
+1
+
+2
+1
+__OUT__
+
+)
+
+# vim: set ft=sh ts=8 sts=4 sw=4 noet:
@@ -334,6 +334,18 @@ __IN__
 foo
 __OUT__
 
+test_oE -e 0 'long here-strings'
+s=0123456789abcdef
+s=$s$s$s$s$s$s$s$s s=$s$s$s$s$s$s$s$s s=$s$s$s$s$s$s$s$s s=$s$s$s$s$s$s$s$s
+echo $(wc -c <<<"$s")
+echo $(wc -c <<<"$s$s$s$s$s$s$s$s")
+{ IFS= read -r line && IFS= read -r line; echo $?; } <<<"$s"
+__IN__
+65537
+524289
+1
+__OUT__
+
 test_OE -e 0 'IO_NUMBER can be redirection operand'
 > 1> 2< 2>>3 <<4
 4
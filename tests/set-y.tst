@@ -205,6 +205,7 @@ test_long_option_default_off "$LINENO" markdirs
 # The monitor option cannot be tested here due to dependency on the terminal.
 test_long_option_default_off "$LINENO" notify
 test_long_option_default_off "$LINENO" nullglob
+test_long_option_default_on  "$LINENO" parsecache
 test_long_option_default_off "$LINENO" pipefail
 # This needs a special test (see below)
 #test_long_option_default_off "$LINENO" posixlycorrect
@@ -422,6 +423,7 @@ markdirs        off
 monitor         off
 notify          off
 nullglob        off
+parsecache      on
 pipefail        off
 posixlycorrect  off
 stdin           on
@@ -475,6 +477,7 @@ set +o markdirs
 set +o monitor
 set +o notify
 set +o nullglob
+set -o parsecache
 set +o pipefail
 set +o posixlycorrect
 set -o traceall
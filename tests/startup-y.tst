@@ -574,6 +574,7 @@ Options:
 	-b       -o notify
 	         -o notifyle
 	         -o nullglob
+	         -o parsecache
 	         -o pipefail
 	         -o posixlycorrect
 	-s       -o stdin
@@ -632,6 +633,7 @@ Options:
 	-b       -o notify
 	         -o notifyle
 	         -o nullglob
+	         -o parsecache
 	         -o pipefail
 	         -o posixlycorrect
 	-s       -o stdin
@@ -51,6 +51,22 @@ __IN__
 a=unset b=unset
 __OUT__
 
+test_oE -e 0 'many temporary variables'
+f() { typeset -p a b c d e f2; unset -v c; a=A; typeset -p a e; }
+a=1 b=2 c=3 d=4 e=5 f2=6 f
+echo ${a-unset} ${b-unset} ${c-unset} ${f2-unset}
+__IN__
+typeset -x a=1
+typeset -x b=2
+typeset -x c=3
+typeset -x d=4
+typeset -x e=5
+typeset -x f2=6
+typeset a=A
+typeset -x e=5
+A unset unset unset
+__OUT__
+
 test_oE -e 0 'printing all variables (no option)' -e
 typeset >/dev/null
 typeset | grep -q '^typeset -x PATH='
@@ -66,6 +66,25 @@ wait
 wait $pid
 __IN__
 
+test_oE 'waiting for many jobs by process ID'
+i=0 pids=''
+while [ "$i" -lt 50 ]; do
+    exit "$i" &
+    pids="$pids $!"
+    i=$((i+1))
+done
+sum=0
+for pid in $pids; do
+    wait "$pid"
+    sum=$((sum+$?))
+done
+exit 7 &
+wait "$!"
+echo "$sum $?"
+__IN__
+1225 7
+__OUT__
+
 test_Oe -e 2 'invalid option --xxx'
 wait --no-such=option
 __IN__
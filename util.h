@@ -24,25 +24,6 @@
 #define Size_max ((size_t) -1)  // = SIZE_MAX
 
 
-/********** Miscellaneous Functions **********/
-
-static inline int xunsetenv(const char *name)
-    __attribute__((nonnull));
-
-/* Removes the environment variable of the specified name.
- * This function wraps the `unsetenv' function, which has an incompatible
- * prototype on some old environments. */
-int xunsetenv(const char *name)
-{
-#if UNSETENV_RETURNS_INT
-    return unsetenv(name);
-#else
-    unsetenv(name);
-    return 0;
-#endif
-}
-
-
 /********** Memory Functions **********/
 
 static inline size_t add(size_t a, size_t b)
@@ -36,6 +36,7 @@
 #include <unistd.h>
 #include <wchar.h>
 #include <wctype.h>
+#include "arith.h"
 #include "builtin.h"
 #include "configm.h"
 #include "exec.h"
@@ -65,12 +66,25 @@ static const wchar_t *const path_variables[PA_count] = {
 };
 
 
+/* a variable in a non-global environment */
+typedef struct varentry_T {
+    struct varsymbol_T *sym;
+    struct variable_T *var;
+} varentry_T;
+
+/* number of variables that fit in a non-global environment without
+ * allocating an array */
+#define ENTRIES_INLINE 4
+
 /* variable environment (= set of variables) */
 /* not to be confused with environment variables */
 typedef struct environ_T {
     struct environ_T *parent;      /* parent environment */
     struct hashtable_T contents;   /* hashtable containing variables */
     bool is_temporary;             /* for temporary assignment? */
+    size_t entrycount, entrycap;   /* number and capacity of `entries' */
+    varentry_T *entries;           /* array containing variables */
+    varentry_T inlineentries[ENTRIES_INLINE];
     char **paths[PA_count];
 } environ_T;
 /* `contents' is a hashtable from (wchar_t *) to (variable_T *).
@@ -80,76 +94,208 @@ typedef struct environ_T {
  * The positional parameter is treated as an array whose name is L"=".
  * Note that the number of positional parameters is offset by 1 against the
  * array index.
- * An environment whose `is_temporary' is true is used for temporary variables. 
+ * An environment whose `is_temporary' is true is used for temporary variables.
+ * Only the top-level environment uses `contents'. Other environments, which
+ * are opened for every function call and every simple command with
+ * assignments, leave `contents' uninitialized and keep their variables in
+ * `entries' instead, which initially points to `inlineentries', so that they
+ * can be opened and closed without any hashtable operations.
+ * Variables are not looked up by the environment but by the shadow stacks of
+ * the symbols, so `entries' is only searched linearly when a variable in it is
+ * replaced or removed. Functions such as `env_next' and `env_get' hide the
+ * difference between the two kinds of environments (see `env_has_table').
  * The elements of `paths' are arrays of the pathnames contained in the
  * $PATH, $CDPATH and $YASH_LOADPATH variables. They are NULL if the
  * corresponding variables are not set. */
 #define VAR_positional "="
 
+/* an element of the shadow stack of a variable name (see `varsymbol_T') */
+typedef struct varslot_T {
+    struct varslot_T *next;  /* slot for the same name in an outer environment */
+    environ_T *env;          /* environment that contains the variable */
+    struct variable_T *var;  /* the variable in `env' */
+} varslot_T;
+
+/* interned variable name */
+typedef struct varsymbol_T varsymbol_T;
+struct varsymbol_T {
+    wchar_t *vs_name;       /* the name, which is also the key in `varindex' */
+    varslot_T *vs_slots;    /* the shadow stack of the variables of the name */
+    unsigned vs_refcount;   /* number of references from outside this file */
+};
+/* `vs_slots' is a linked list of `varslot_T's for all the environments in the
+ * chain from `current_env' that contain the name. The first slot is for the
+ * innermost environment, so a variable can be found without walking the chain
+ * however deeply functions are nested. `vs_slots' is NULL if there is no
+ * variable of the name.
+ * Parse trees hold references to symbols (see `intern_variable_name') so that
+ * variables can be looked up without hashing the name at all. A symbol is
+ * freed when it is neither referenced nor used by any variable. */
+
 /* flags for variable attributes */
 typedef enum vartype_T {
     VF_SCALAR,
     VF_ARRAY,
+    VF_ASSOC,
     VF_EXPORT   = 1 << 2,
     VF_READONLY = 1 << 3,
     VF_NODELETE = 1 << 4,
 } vartype_T;
 #define VF_MASK ((1 << 2) - 1)
-/* For any variable, the variable type is either VF_SCALAR or VF_ARRAY,
- * possibly OR'ed with other flags. */
+/* For any variable, the variable type is either VF_SCALAR, VF_ARRAY or
+ * VF_ASSOC, possibly OR'ed with other flags. */
+
+/* compact representation of a scalar value */
+typedef struct cvalue_T {
+    size_t cv_length;         /* number of characters in the value */
+    size_t cv_size;           /* number of bytes in `cv_bytes' */
+    wchar_t *cv_wide;         /* cached wide string, or NULL */
+    unsigned char cv_bytes[]; /* encoded characters, not NULL-terminated */
+} cvalue_T;
+/* If `cv_size' equals `cv_length', every character is less than 0x100 and is
+ * stored in one byte (Latin-1). Otherwise, the characters are encoded in
+ * UTF-8, extended to cover any 32-bit value of wchar_t regardless of the
+ * current locale. A value has exactly one encoding, so two values can be
+ * compared byte by byte.
+ * `cv_wide' is made on demand by `cvalue_wcs' for callers that need a wide
+ * string that lasts as long as the value. It is `free'able. */
 
 /* type of variables */
 typedef struct variable_T {
     vartype_T v_type;
     union {
-	wchar_t *value;
+	cvalue_T *value;
 	struct {
 	    void **vals;
-	    size_t valc;
+	    size_t valc, head, cap;
 	} array;
+	hashtable_T *table;
     } v_contents;
     void (*v_getter)(struct variable_T *var);
 } variable_T;
 #define v_value v_contents.value
 #define v_vals  v_contents.array.vals
 #define v_valc  v_contents.array.valc
+#define v_head  v_contents.array.head
+#define v_cap   v_contents.array.cap
+#define v_table v_contents.table
 /* `v_vals' is a NULL-terminated array of pointers to wide strings.
  * `v_valc' is, of course, the number of elements in `v_vals'.
- * `v_value', `v_vals' and the elements of `v_vals' are `free'able.
+ * `v_value' is freed by `cvalue_free'. The elements of `v_vals' are `free'able.
  * `v_value' is NULL if the variable is declared but not yet assigned.
  * `v_vals' is always non-NULL, but it may contain no elements.
+ * `v_vals' points into a buffer that has `v_head' unused slots before
+ * `v_vals' and `v_cap' slots from `v_vals' on, including the terminating NULL.
+ * The spare slots at both ends allow elements to be added or removed at either
+ * end in amortized constant time (see `array_insert' and `array_remove').
+ * `v_table' is a hashtable that maps the keys of an associative array to its
+ * values. The table, its keys and values are all `free'able.
  * `v_getter' is the setter function, which is reset to NULL on reassignment.*/
 
 /* type of shell functions (defined later) */
 typedef struct function_T function_T;
 
 
+static cvalue_T *new_cvalue(const wchar_t *s)
+    __attribute__((nonnull,malloc,warn_unused_result));
+static cvalue_T *to_cvalue(wchar_t *s)
+    __attribute__((malloc,warn_unused_result));
+static cvalue_T *cvalue_copy(const cvalue_T *cv)
+    __attribute__((nonnull,malloc,warn_unused_result));
+static const wchar_t *cvalue_wcs(cvalue_T *cv)
+    __attribute__((nonnull));
+static wchar_t *cvalue_dup(const cvalue_T *cv)
+    __attribute__((nonnull,malloc,warn_unused_result));
+static wchar_t *cvalue_decode(const cvalue_T *cv, wchar_t *buf)
+    __attribute__((nonnull));
+static bool cvalues_equal(const cvalue_T *cv1, const cvalue_T *cv2)
+    __attribute__((pure));
+static void cvalue_free(cvalue_T *cv);
 static void varvaluefree(variable_T *v)
     __attribute__((nonnull));
+static void array_init(variable_T *var, void **values, size_t count)
+    __attribute__((nonnull));
+static void array_reserve(variable_T *var, size_t front, size_t back)
+    __attribute__((nonnull));
+static void array_insert(variable_T *var,
+	size_t index, size_t count, void *const *values)
+    __attribute__((nonnull));
+static void array_remove(variable_T *var, size_t index, size_t count)
+    __attribute__((nonnull));
 static void varfree(variable_T *v);
 static void varkvfree(kvpair_T kv);
 static void varkvfree_reexport(kvpair_T kv);
 
 static void init_pwd(void);
 
+static varsymbol_T *symbol_of(const wchar_t *name)
+    __attribute__((nonnull,returns_nonnull));
+static varsymbol_T *find_symbol(const wchar_t *name)
+    __attribute__((nonnull));
+static void free_symbol_if_unused(varsymbol_T *sym)
+    __attribute__((nonnull));
+static kvpair_T env_set(environ_T *env, varsymbol_T *sym, variable_T *var)
+    __attribute__((nonnull));
+static kvpair_T env_remove(environ_T *env, varsymbol_T *sym)
+    __attribute__((nonnull));
+static void pop_slot(varsymbol_T *sym)
+    __attribute__((nonnull));
+static inline bool env_has_table(const environ_T *env)
+    __attribute__((nonnull,pure));
+static size_t env_count(const environ_T *env)
+    __attribute__((nonnull,pure));
+static kvpair_T env_next(const environ_T *env, size_t *indexp)
+    __attribute__((nonnull));
+static variable_T *env_get(const environ_T *env, const wchar_t *name)
+    __attribute__((nonnull,pure));
+static environ_T *new_environment(environ_T *parent, bool temp, size_t count)
+    __attribute__((malloc,warn_unused_result));
+static void destroy_environment(environ_T *env, bool reexport)
+    __attribute__((nonnull));
+
 static variable_T *search_variable(const wchar_t *name)
-    __attribute__((pure,nonnull));
-static variable_T *search_array_and_check_if_changeable(const wchar_t *name)
-    __attribute__((pure,nonnull));
+    __attribute__((nonnull));
+static inline variable_T *search_symbol(const varsymbol_T *sym)
+    __attribute__((nonnull));
+static variable_T *search_array_and_check_if_changeable(
+	const wchar_t *name, bool assoc)
+    __attribute__((nonnull));
+static cvalue_T *get_scalar_value(const varsymbol_T *sym)
+    __attribute__((nonnull));
+static hashval_T hashenvname(const void *s)
+    __attribute__((pure));
+static int envnamecmp(const void *s1, const void *s2)
+    __attribute__((pure));
+static void init_envlist(void);
+static void import_variable(varsymbol_T *sym, const char *entry)
+    __attribute__((nonnull));
+static void import_environment(void);
 static void update_environment(const wchar_t *name)
     __attribute__((nonnull));
+static bool affects_shell_itself(const wchar_t *name)
+    __attribute__((nonnull,pure));
+static void apply_environment_change(const wchar_t *name)
+    __attribute__((nonnull));
 static void reset_locale(const wchar_t *name)
     __attribute__((nonnull));
 static void reset_locale_category(const wchar_t *name, int category)
     __attribute__((nonnull));
-static variable_T *new_global(const wchar_t *name)
+static variable_T *new_global(varsymbol_T *sym)
     __attribute__((nonnull));
-static variable_T *new_local(const wchar_t *name)
+static variable_T *new_local(varsymbol_T *sym)
     __attribute__((nonnull));
-static variable_T *new_temporary(const wchar_t *name)
+static variable_T *new_temporary(varsymbol_T *sym)
     __attribute__((nonnull));
-static variable_T *new_variable(const wchar_t *name, scope_T scope)
+static variable_T *new_variable(varsymbol_T *sym, scope_T scope)
+    __attribute__((nonnull));
+static struct get_variable_T get_single_value(wchar_t *value);
+static hashtable_T *new_assoc_table(size_t capacity)
+    __attribute__((malloc,warn_unused_result));
+static variable_T *set_assoc(const wchar_t *name, size_t count,
+	void *const *keysandvalues, scope_T scope)
     __attribute__((nonnull));
+static kvpair_T *sorted_assoc_elements(const variable_T *var)
+    __attribute__((nonnull,malloc,warn_unused_result));
 static void xtrace_variable(const wchar_t *name, const wchar_t *value)
     __attribute__((nonnull));
 static void xtrace_array(const wchar_t *name, void *const *values)
@@ -159,6 +305,16 @@ static size_t make_array_of_all_variables(bool global, kvpair_T **resultp)
 static void get_all_variables_rec(
 	hashtable_T *table, environ_T *env, bool global)
     __attribute__((nonnull));
+static environ_T *copy_environments(const environ_T *env)
+    __attribute__((malloc,warn_unused_result));
+static variable_T *copy_variable(const variable_T *var)
+    __attribute__((nonnull,malloc,warn_unused_result));
+static void collect_changed_variables(
+	plist_T *restrict changed, plist_T *restrict exported,
+	const environ_T *env1, const environ_T *env2, bool missingonly)
+    __attribute__((nonnull));
+static bool variables_equal(const variable_T *v1, const variable_T *v2)
+    __attribute__((nonnull,pure));
 
 static void lineno_getter(variable_T *var)
     __attribute__((nonnull));
@@ -190,12 +346,198 @@ static environ_T *current_env;
 /* the top-level environment (the farthest from the current) */
 static environ_T *first_env;
 
+/* A hashtable that maps variable names (wchar_t *) to the symbols
+ * (varsymbol_T *) for them.
+ * The contents of an environment must be modified only via `env_set' and
+ * `env_remove', which keep the shadow stacks of the symbols up to date. */
+static hashtable_T varindex;
+
+/* The array of environment variables passed to external programs.
+ * The elements are strings of the form "name=value", and `environ' points to
+ * the array after `flush_environment' is called. */
+static plist_T envlist;
+/* A hashtable that maps each element of `envlist' (char *) to its index.
+ * Keys are compared only up to the first '=', so the hashtable can be looked up
+ * by a bare variable name as well.
+ * The index is shifted left by one bit, and the lowest bit is set iff the
+ * element is `free'able. Elements that were inherited from the invoker of the
+ * shell are not copied, and they are not `free'able. */
+static hashtable_T envindex;
+#define ENVINDEX(index, owned) ((void *) (uintptr_t) ((index) << 1 | (owned)))
+#define ENVINDEX_INDEX(value)  ((size_t) ((uintptr_t) (value) >> 1))
+#define ENVINDEX_OWNED(value)  ((bool) ((uintptr_t) (value) & 1))
+/* A hashtable that maps the names (wchar_t *) of inherited environment
+ * variables that have not yet been imported as shell variables to the
+ * elements of `envlist' (char *) for them. An environment variable is imported
+ * when a symbol is made for its name (see `symbol_of') or when all variables
+ * are enumerated (see `import_environment'), so a large environment costs
+ * nothing at startup. The keys are `free'able. */
+static hashtable_T envimport;
+/* A hashtable containing the names (wchar_t *) of the variables whose
+ * exported values may differ from the elements of `envlist'. The values of the
+ * hashtable are not used. */
+static hashtable_T envdirty;
+
 /* whether $RANDOM is functioning as a random number */
 static bool random_active;
 
 /* hashtable from function names (wchar_t *) to functions (function_T *). */
 static hashtable_T functions;
 
+/* closed environments kept for reuse, linked by `parent' */
+static environ_T *spare_envs;
+static size_t spare_env_count;
+#define SPARE_ENVS_MAX 16
+
+
+/* Converts the specified wide string into a newly-malloced compact value. */
+cvalue_T *new_cvalue(const wchar_t *s)
+{
+    size_t length = 0, size = 0;
+    bool latin1 = true;
+    for (const wchar_t *p = s; *p != L'\0'; p++) {
+	uint_least32_t c = (uint_least32_t) *p;
+	length++;
+	size += c < 0x80 ? 1 : c < 0x800 ? 2 : c < 0x10000 ? 3 :
+	        c < 0x200000 ? 4 : c < 0x4000000 ? 5 : c < 0x80000000 ? 6 : 7;
+	if (c >= 0x100)
+	    latin1 = false;
+    }
+    if (latin1)
+	size = length;
+
+    cvalue_T *cv = xmallocs(sizeof *cv, size, sizeof *cv->cv_bytes);
+    cv->cv_length = length;
+    cv->cv_size = size;
+    cv->cv_wide = NULL;
+
+    unsigned char *b = cv->cv_bytes;
+    if (latin1) {
+	for (const wchar_t *p = s; *p != L'\0'; p++)
+	    *b++ = (unsigned char) *p;
+    } else {
+	for (const wchar_t *p = s; *p != L'\0'; p++) {
+	    uint_least32_t c = (uint_least32_t) *p;
+	    if (c < 0x80) {
+		*b++ = (unsigned char) c;
+		continue;
+	    }
+
+	    int n;  /* number of continuation bytes */
+	    unsigned char lead;
+	    if      (c < 0x800)      n = 1, lead = 0xC0;
+	    else if (c < 0x10000)    n = 2, lead = 0xE0;
+	    else if (c < 0x200000)   n = 3, lead = 0xF0;
+	    else if (c < 0x4000000)  n = 4, lead = 0xF8;
+	    else if (c < 0x80000000) n = 5, lead = 0xFC;
+	    else                     n = 6, lead = 0xFE;
+	    *b++ = lead | (unsigned char) (c >> (6 * n));
+	    while (--n >= 0)
+		*b++ = 0x80 | (unsigned char) ((c >> (6 * n)) & 0x3F);
+	}
+    }
+    assert(b == &cv->cv_bytes[size]);
+    return cv;
+}
+
+/* Converts the specified wide string into a compact value and frees the
+ * string. Returns NULL if `s' is NULL. */
+cvalue_T *to_cvalue(wchar_t *s)
+{
+    if (s == NULL)
+	return NULL;
+
+    cvalue_T *cv = new_cvalue(s);
+    free(s);
+    return cv;
+}
+
+/* Returns a newly-malloced copy of the specified compact value.
+ * The cached wide string is not copied. */
+cvalue_T *cvalue_copy(const cvalue_T *cv)
+{
+    cvalue_T *copy = xmallocs(sizeof *cv, cv->cv_size, sizeof *cv->cv_bytes);
+    copy->cv_length = cv->cv_length;
+    copy->cv_size = cv->cv_size;
+    copy->cv_wide = NULL;
+    memcpy(copy->cv_bytes, cv->cv_bytes, cv->cv_size);
+    return copy;
+}
+
+/* Returns the value as a wide string.
+ * The string is decoded on the first call and cached in the value, so the
+ * result must not be modified or `free'd and is valid while the value is.
+ * Since the cache doubles the memory for the value, this function is used only
+ * for the values the shell itself reads repeatedly (see `getvar'). */
+const wchar_t *cvalue_wcs(cvalue_T *cv)
+{
+    if (cv->cv_wide == NULL)
+	cv->cv_wide = cvalue_dup(cv);
+    return cv->cv_wide;
+}
+
+/* Returns the value as a newly-malloced wide string. */
+wchar_t *cvalue_dup(const cvalue_T *cv)
+{
+    if (cv->cv_wide != NULL)
+	return xwcsdup(cv->cv_wide);
+    return cvalue_decode(cv,
+	    xmallocn(add(cv->cv_length, 1), sizeof (wchar_t)));
+}
+
+/* Decodes the value into `buf', which must be large enough to hold
+ * `cv->cv_length + 1' characters. Returns `buf'. */
+wchar_t *cvalue_decode(const cvalue_T *cv, wchar_t *buf)
+{
+    const unsigned char *b = cv->cv_bytes, *end = &cv->cv_bytes[cv->cv_size];
+    wchar_t *w = buf;
+    if (cv->cv_size == cv->cv_length) {
+	while (b < end)
+	    *w++ = (wchar_t) *b++;
+    } else {
+	while (b < end) {
+	    unsigned char lead = *b++;
+	    if (lead < 0x80) {
+		*w++ = (wchar_t) lead;
+		continue;
+	    }
+
+	    int n;  /* number of continuation bytes */
+	    uint_least32_t c;
+	    if      (lead < 0xE0) n = 1, c = lead & 0x1F;
+	    else if (lead < 0xF0) n = 2, c = lead & 0x0F;
+	    else if (lead < 0xF8) n = 3, c = lead & 0x07;
+	    else if (lead < 0xFC) n = 4, c = lead & 0x03;
+	    else if (lead < 0xFE) n = 5, c = lead & 0x01;
+	    else                  n = 6, c = 0;
+	    while (--n >= 0)
+		c = (c << 6) | (*b++ & 0x3F);
+	    *w++ = (wchar_t) c;
+	}
+    }
+    assert(w == &buf[cv->cv_length]);
+    *w = L'\0';
+    return buf;
+}
+
+/* Checks if the two values are equal. Either may be NULL. */
+bool cvalues_equal(const cvalue_T *cv1, const cvalue_T *cv2)
+{
+    if (cv1 == NULL || cv2 == NULL)
+	return cv1 == cv2;
+    return cv1->cv_length == cv2->cv_length
+	&& cv1->cv_size == cv2->cv_size
+	&& memcmp(cv1->cv_bytes, cv2->cv_bytes, cv1->cv_size) == 0;
+}
+
+/* Frees the specified compact value. */
+void cvalue_free(cvalue_T *cv)
+{
+    if (cv != NULL) {
+	free(cv->cv_wide);
+	free(cv);
+    }
+}
 
 /* Frees the value of the specified variable (but not the variable itself). */
 /* This function does not change the value of `*v'. */
@@ -203,14 +545,115 @@ void varvaluefree(variable_T *v)
 {
     switch (v->v_type & VF_MASK) {
 	case VF_SCALAR:
-	    free(v->v_value);
+	    cvalue_free(v->v_value);
 	    break;
 	case VF_ARRAY:
-	    plfree(v->v_vals, free);
+	    for (size_t i = 0; i < v->v_valc; i++)
+		free(v->v_vals[i]);
+	    free(v->v_vals - v->v_head);
+	    break;
+	case VF_ASSOC:
+	    ht_clear(v->v_table, kvfree);
+	    ht_destroy(v->v_table);
+	    free(v->v_table);
 	    break;
     }
 }
 
+/* Sets the contents of the specified array variable.
+ * `values' must be a `free'able NULL-terminated array of `count' pointers to
+ * `free'able wide strings. The array is used as the buffer of the variable. */
+void array_init(variable_T *var, void **values, size_t count)
+{
+    assert(values[count] == NULL);
+    var->v_vals = values;
+    var->v_valc = count;
+    var->v_head = 0;
+    var->v_cap = count + 1;
+}
+
+/* Makes sure that the buffer of the specified array variable has at least
+ * `front' unused slots before the first element and at least `back' unused
+ * slots after the terminating NULL.
+ * When the buffer is reallocated or its contents are moved, as many spare
+ * slots as the elements are left on the side that needed more slots, so that
+ * adding elements at either end takes amortized constant time. */
+void array_reserve(variable_T *var, size_t front, size_t back)
+{
+    size_t valc = var->v_valc;
+    if (var->v_head >= front && var->v_cap - (valc + 1) >= back)
+	return;
+
+    void **base = var->v_vals - var->v_head;
+    size_t total = var->v_head + var->v_cap;
+    size_t needed = add(add(front, back), add(valc, 1));
+    size_t newtotal = add(needed, valc);
+    if (newtotal < total)
+	newtotal = total;
+    size_t spare = newtotal - needed;
+    size_t newhead = (front > 0 && back == 0) ? front + spare : front;
+
+    if (newtotal > total && var->v_head == 0 && newhead == 0) {
+	base = xreallocn(base, newtotal, sizeof *base);
+    } else if (newtotal > total) {
+	void **newbase = xmallocn(newtotal, sizeof *newbase);
+	memcpy(&newbase[newhead], var->v_vals, (valc + 1) * sizeof *newbase);
+	free(base);
+	base = newbase;
+    } else {
+	memmove(&base[newhead], var->v_vals, (valc + 1) * sizeof *base);
+    }
+    var->v_vals = &base[newhead];
+    var->v_head = newhead;
+    var->v_cap = newtotal - newhead;
+}
+
+/* Inserts `count' elements of `values' into the specified array variable at
+ * `index', which must not be greater than `var->v_valc'.
+ * The elements of `values' must be `free'able wide strings, which are used as
+ * the array elements without being copied.
+ * The elements before or after `index', whichever are fewer, are moved. */
+void array_insert(variable_T *var,
+	size_t index, size_t count, void *const *values)
+{
+    assert(index <= var->v_valc);
+    if (index < var->v_valc / 2) {
+	array_reserve(var, count, 0);
+	var->v_vals -= count;
+	var->v_head -= count;
+	var->v_cap += count;
+	memmove(var->v_vals, &var->v_vals[count], index * sizeof *var->v_vals);
+    } else {
+	array_reserve(var, 0, count);
+	memmove(&var->v_vals[index + count], &var->v_vals[index],
+		(var->v_valc - index + 1) * sizeof *var->v_vals);
+    }
+    memcpy(&var->v_vals[index], values, count * sizeof *values);
+    var->v_valc += count;
+}
+
+/* Frees and removes `count' elements of the specified array variable starting
+ * at `index'. The range must be within the array.
+ * The elements before or after the range, whichever are fewer, are moved. */
+void array_remove(variable_T *var, size_t index, size_t count)
+{
+    assert(index <= var->v_valc && count <= var->v_valc - index);
+    for (size_t i = 0; i < count; i++)
+	free(var->v_vals[index + i]);
+
+    size_t after = var->v_valc - index - count;
+    if (index < after) {
+	memmove(&var->v_vals[count], var->v_vals, index * sizeof *var->v_vals);
+	var->v_vals += count;
+	var->v_head += count;
+	var->v_cap -= count;
+    } else {
+	memmove(&var->v_vals[index], &var->v_vals[index + count],
+		(after + 1) * sizeof *var->v_vals);
+    }
+    var->v_valc -= count;
+}
+
 /* Frees the specified variable. */
 void varfree(variable_T *v)
 {
@@ -246,32 +689,14 @@ void varkvfree_reexport(kvpair_T kv)
 void init_environment(void)
 {
     assert(first_env == NULL && current_env == NULL);
-    first_env = current_env = xmalloc(sizeof *current_env);
-    current_env->parent = NULL;
-    current_env->is_temporary = false;
-    ht_init(&current_env->contents, hashwcs, htwcscmp);
-//    for (size_t i = 0; i < PA_count; i++)
-//	current_env->paths[i] = NULL;
+    ht_init(&varindex, hashwcs, htwcscmp);
+    first_env = current_env =
+	new_environment(NULL, false, HASHTABLE_DEFAULT_INIT_CAPACITY);
 
     ht_init(&functions, hashwcs, htwcscmp);
 
-    /* add all the existing environment variables to the variable environment */
-    for (char **e = environ; *e != NULL; e++) {
-	wchar_t *we = malloc_mbstowcs(*e);
-	if (we == NULL)
-	    continue;
-
-	wchar_t *eqp = wcschr(we, L'=');
-	variable_T *v = xmalloc(sizeof *v);
-	v->v_type = VF_SCALAR | VF_EXPORT;
-	v->v_value = (eqp != NULL) ? xwcsdup(&eqp[1]) : NULL;
-	v->v_getter = NULL;
-	if (eqp != NULL) {
-	    *eqp = L'\0';
-	    we = xreallocn(we, eqp - we + 1, sizeof *we);
-	}
-	varkvfree(ht_set(&current_env->contents, we, v));
-    }
+    /* The existing environment variables are imported on demand. */
+    init_envlist();
 
     /* initialize path according to $PATH etc. */
     for (size_t i = 0; i < PA_count; i++)
@@ -287,7 +712,7 @@ void init_variables(void)
 
     /* set $LINENO */
     {
-	variable_T *v = new_variable(L VAR_LINENO, SCOPE_GLOBAL);
+	variable_T *v = new_variable(symbol_of(L VAR_LINENO), SCOPE_GLOBAL);
 	assert(v != NULL);
 	v->v_type = VF_SCALAR | (v->v_type & VF_EXPORT);
 	v->v_value = NULL;
@@ -314,7 +739,7 @@ void init_variables(void)
 
     /* export $OLDPWD */
     {
-	variable_T *v = new_global(L VAR_OLDPWD);
+	variable_T *v = new_global(symbol_of(L VAR_OLDPWD));
 	assert(v != NULL);
 	v->v_type |= VF_EXPORT;
 	variable_set(L VAR_OLDPWD, v);
@@ -329,7 +754,7 @@ void init_variables(void)
 
     /* set $RANDOM */
     if (!posixly_correct) {
-	variable_T *v = new_variable(L VAR_RANDOM, SCOPE_GLOBAL);
+	variable_T *v = new_variable(symbol_of(L VAR_RANDOM), SCOPE_GLOBAL);
 	assert(v != NULL);
 	v->v_type = VF_SCALAR;
 	v->v_value = NULL;
@@ -381,24 +806,311 @@ set:
     set_variable(L VAR_PWD, wnewpwd, SCOPE_GLOBAL, true);
 }
 
+/* Returns the symbol for the specified variable name, creating it if there is
+ * none. The returned symbol is not referenced: it is freed when the last
+ * variable of the name is removed unless `intern_variable_name' is called. */
+varsymbol_T *symbol_of(const wchar_t *name)
+{
+    varsymbol_T *sym = ht_get(&varindex, name).value;
+    if (sym == NULL) {
+	sym = xmalloc(sizeof *sym);
+	sym->vs_name = xwcsdup(name);
+	sym->vs_slots = NULL;
+	sym->vs_refcount = 0;
+	ht_set(&varindex, sym->vs_name, sym);
+
+	if (envimport.count > 0) {
+	    kvpair_T kv = ht_remove(&envimport, name);
+	    if (kv.key != NULL) {
+		free(kv.key);
+		import_variable(sym, kv.value);
+	    }
+	}
+    }
+    return sym;
+}
+
+/* Returns the symbol for the specified variable name, or NULL if there is no
+ * symbol for the name. If the name is of an environment variable that has not
+ * been imported yet, the symbol is made and the variable is imported. */
+varsymbol_T *find_symbol(const wchar_t *name)
+{
+    varsymbol_T *sym = ht_get(&varindex, name).value;
+    if (sym == NULL && envimport.count > 0
+	    && ht_get(&envimport, name).key != NULL)
+	sym = symbol_of(name);
+    return sym;
+}
+
+/* Frees the specified symbol if it is neither referenced nor used by any
+ * variable. */
+void free_symbol_if_unused(varsymbol_T *sym)
+{
+    if (sym->vs_slots == NULL && sym->vs_refcount == 0) {
+	ht_remove(&varindex, sym->vs_name);
+	free(sym->vs_name);
+	free(sym);
+    }
+}
+
+/* Returns the symbol for the specified variable name with its reference count
+ * incremented. The symbol can be passed to `getvar_sym', `get_variable_sym'
+ * and `set_variable_sym' to access the variable without hashing the name.
+ * The caller must call `release_variable_name' when the symbol is no longer
+ * needed. */
+varsymbol_T *intern_variable_name(const wchar_t *name)
+{
+    varsymbol_T *sym = symbol_of(name);
+    sym->vs_refcount++;
+    return sym;
+}
+
+/* Decrements the reference count of the specified symbol. */
+void release_variable_name(varsymbol_T *sym)
+{
+    if (sym != NULL) {
+	assert(sym->vs_refcount > 0);
+	sym->vs_refcount--;
+	free_symbol_if_unused(sym);
+    }
+}
+
+/* Returns the name of the specified symbol. */
+const wchar_t *symbol_name(const varsymbol_T *sym)
+{
+    return sym->vs_name;
+}
+
+/* Adds the specified variable to environment `env'.
+ * `env' must be the innermost environment that contains a variable of the
+ * symbol after this function returns. The existing variable of the same name in
+ * `env', if any, is replaced and the key-value pair for it is returned. */
+kvpair_T env_set(environ_T *env, varsymbol_T *sym, variable_T *var)
+{
+    varslot_T *slot = sym->vs_slots;
+    if (slot != NULL && slot->env == env) {
+	slot->var = var;
+	if (env_has_table(env))
+	    return ht_set(&env->contents, xwcsdup(sym->vs_name), var);
+
+	for (size_t i = 0; ; i++) {
+	    assert(i < env->entrycount);
+	    if (env->entries[i].sym == sym) {
+		variable_T *oldvar = env->entries[i].var;
+		env->entries[i].var = var;
+		return (kvpair_T) { xwcsdup(sym->vs_name), oldvar, };
+	    }
+	}
+    }
+
+    varslot_T *newslot = xmalloc(sizeof *newslot);
+    newslot->next = slot;
+    newslot->env = env;
+    newslot->var = var;
+    sym->vs_slots = newslot;
+    if (env_has_table(env))
+	return ht_set(&env->contents, xwcsdup(sym->vs_name), var);
+
+    if (env->entrycount == env->entrycap) {
+	env->entrycap *= 2;
+	if (env->entries == env->inlineentries) {
+	    env->entries = xmallocn(env->entrycap, sizeof *env->entries);
+	    memcpy(env->entries, env->inlineentries, sizeof env->inlineentries);
+	} else {
+	    env->entries =
+		xreallocn(env->entries, env->entrycap, sizeof *env->entries);
+	}
+    }
+    env->entries[env->entrycount++] = (varentry_T) { sym, var, };
+    return (kvpair_T) { NULL, NULL, };
+}
+
+/* Removes the variable of the specified symbol from environment `env' and
+ * returns the key-value pair for it. If there is no such variable, a pair of
+ * NULLs is returned. The symbol may be freed in this function. */
+kvpair_T env_remove(environ_T *env, varsymbol_T *sym)
+{
+    kvpair_T kv;
+    if (env_has_table(env)) {
+	kv = ht_remove(&env->contents, sym->vs_name);
+    } else {
+	kv = (kvpair_T) { NULL, NULL, };
+	for (size_t i = 0; i < env->entrycount; i++) {
+	    if (env->entries[i].sym == sym) {
+		kv.key = xwcsdup(sym->vs_name);
+		kv.value = env->entries[i].var;
+		env->entries[i] = env->entries[--env->entrycount];
+		break;
+	    }
+	}
+    }
+    if (kv.key != NULL) {
+	varslot_T **slotp = &sym->vs_slots;
+	while ((*slotp)->env != env)
+	    slotp = &(*slotp)->next;
+
+	varslot_T *slot = *slotp;
+	*slotp = slot->next;
+	free(slot);
+	free_symbol_if_unused(sym);
+    }
+    return kv;
+}
+
+/* Removes the first slot of the specified symbol.
+ * The symbol may be freed in this function. */
+void pop_slot(varsymbol_T *sym)
+{
+    varslot_T *slot = sym->vs_slots;
+    sym->vs_slots = slot->next;
+    free(slot);
+    free_symbol_if_unused(sym);
+}
+
+/* Returns true iff the specified environment keeps its variables in
+ * `contents' rather than `entries'. */
+bool env_has_table(const environ_T *env)
+{
+    return env->parent == NULL;
+}
+
+/* Returns the number of variables in the specified environment. */
+size_t env_count(const environ_T *env)
+{
+    return env_has_table(env) ? env->contents.count : env->entrycount;
+}
+
+/* Iterates the variables in the specified environment like `ht_next'.
+ * The keys of the returned pairs are the names of the variables (wchar_t *)
+ * and the values are the variables (variable_T *). */
+kvpair_T env_next(const environ_T *env, size_t *indexp)
+{
+    if (env_has_table(env))
+	return ht_next(&env->contents, indexp);
+    if (*indexp >= env->entrycount)
+	return (kvpair_T) { NULL, NULL, };
+
+    const varentry_T *e = &env->entries[(*indexp)++];
+    return (kvpair_T) { e->sym->vs_name, e->var, };
+}
+
+/* Returns the variable of the specified name in the specified environment, or
+ * NULL if the environment does not contain the variable. */
+variable_T *env_get(const environ_T *env, const wchar_t *name)
+{
+    if (env_has_table(env))
+	return ht_get(&env->contents, name).value;
+    for (size_t i = 0; i < env->entrycount; i++)
+	if (wcscmp(env->entries[i].sym->vs_name, name) == 0)
+	    return env->entries[i].var;
+    return NULL;
+}
+
+/* Returns a new empty environment whose parent is `parent'.
+ * `count' is the expected number of variables in the environment, which is
+ * used only for the top-level environment. */
+environ_T *new_environment(environ_T *parent, bool temp, size_t count)
+{
+    environ_T *env;
+    if (spare_envs != NULL) {
+	env = spare_envs;
+	spare_envs = env->parent;
+	spare_env_count--;
+    } else {
+	env = xmalloc(sizeof *env);
+    }
+
+    env->parent = parent;
+    env->is_temporary = temp;
+    if (env_has_table(env))
+	ht_initwithcapacity(&env->contents, hashwcs, htwcscmp, count);
+    env->entrycount = 0;
+    env->entrycap = ENTRIES_INLINE;
+    env->entries = env->inlineentries;
+    for (size_t i = 0; i < PA_count; i++)
+	env->paths[i] = NULL;
+    return env;
+}
+
+/* Removes all the variables in the specified environment and frees it.
+ * If `reexport' is true, `variable_set' and `update_environment' are called
+ * for the removed variables.
+ * The variables must be at the top of the shadow stacks of their symbols. */
+void destroy_environment(environ_T *env, bool reexport)
+{
+    if (env_has_table(env)) {
+	/* pop the variables off the shadow stacks before the side effects of
+	 * removing them are applied */
+	size_t i = 0;
+	kvpair_T kv;
+	while ((kv = ht_next(&env->contents, &i)).key != NULL) {
+	    varsymbol_T *sym = ht_get(&varindex, kv.key).value;
+	    assert(sym != NULL && sym->vs_slots->env == env);
+	    pop_slot(sym);
+	}
+	ht_clear(&env->contents, reexport ? varkvfree_reexport : varkvfree);
+	ht_destroy(&env->contents);
+    } else {
+	/* The symbols are kept during the side effects since the names of the
+	 * variables are those of the symbols. */
+	for (size_t i = 0; i < env->entrycount; i++) {
+	    varsymbol_T *sym = env->entries[i].sym;
+	    assert(sym->vs_slots->env == env);
+	    sym->vs_refcount++;
+	    pop_slot(sym);
+	}
+	for (size_t i = 0; i < env->entrycount; i++) {
+	    varsymbol_T *sym = env->entries[i].sym;
+	    variable_T *var = env->entries[i].var;
+	    if (reexport) {
+		variable_set(sym->vs_name, NULL);
+		if (var->v_type & VF_EXPORT)
+		    update_environment(sym->vs_name);
+	    }
+	    varfree(var);
+	    sym->vs_refcount--;
+	    free_symbol_if_unused(sym);
+	}
+	if (env->entries != env->inlineentries)
+	    free(env->entries);
+    }
+
+    for (size_t i = 0; i < PA_count; i++)
+	plfree((void **) env->paths[i], free);
+
+    if (spare_env_count < SPARE_ENVS_MAX) {
+	env->parent = spare_envs;
+	spare_envs = env;
+	spare_env_count++;
+    } else {
+	free(env);
+    }
+}
+
 /* Searches for a variable with the specified name.
  * Returns NULL if none was found. */
 variable_T *search_variable(const wchar_t *name)
 {
-    for (environ_T *env = current_env; env != NULL; env = env->parent) {
-	variable_T *var = ht_get(&env->contents, name).value;
-	if (var != NULL)
-	    return var;
-    }
-    return NULL;
+    varsymbol_T *sym = find_symbol(name);
+    return (sym != NULL) ? search_symbol(sym) : NULL;
+}
+
+/* Searches for a variable of the specified symbol.
+ * Returns NULL if none was found. */
+variable_T *search_symbol(const varsymbol_T *sym)
+{
+    return (sym->vs_slots != NULL) ? sym->vs_slots->var : NULL;
 }
 
 /* Searches for an array with the specified name and checks if it is not read-
- * only. If unsuccessful, prints an error message and returns NULL. */
-variable_T *search_array_and_check_if_changeable(const wchar_t *name)
+ * only. If `assoc' is true, an associative array is also accepted.
+ * If unsuccessful, prints an error message and returns NULL. */
+variable_T *search_array_and_check_if_changeable(
+	const wchar_t *name, bool assoc)
 {
     variable_T *array = search_variable(name);
-    if (array == NULL || (array->v_type & VF_MASK) != VF_ARRAY) {
+    if (array == NULL || ((array->v_type & VF_MASK) != VF_ARRAY
+		&& (!assoc || (array->v_type & VF_MASK) != VF_ASSOC))) {
 	xerror(0, Ngt("no such array $%ls"), name);
 	return NULL;
     } else if (array->v_type & VF_READONLY) {
@@ -408,26 +1120,209 @@ variable_T *search_array_and_check_if_changeable(const wchar_t *name)
     return array;
 }
 
-/* Update the value in `environ' for the variable with the specified name.
- * `name' must not contain '='. */
+/* A hash function for an element of `envlist'.
+ * Only the part before the first '=' is hashed. */
+hashval_T hashenvname(const void *s)
+{
+    /* The hashing algorithm is FNV hash, as in `hashstr'. */
+    const unsigned char *c = s;
+    hashval_T h = 0;
+    while (*c != '\0' && *c != '=')
+	h = (h ^ (hashval_T) *c++) * FNVPRIME;
+    return h;
+}
+
+/* Compares the names of two elements of `envlist'.
+ * Only the parts before the first '=' are compared. */
+int envnamecmp(const void *s1, const void *s2)
+{
+    const unsigned char *c1 = s1, *c2 = s2;
+    while (*c1 != '\0' && *c1 != '=' && *c1 == *c2)
+	c1++, c2++;
+    int d1 = (*c1 == '=') ? '\0' : *c1;
+    int d2 = (*c2 == '=') ? '\0' : *c2;
+    return d1 - d2;
+}
+
+/* Copies the current `environ' into `envlist' and makes `envimport'.
+ * The strings in `environ' are shared rather than copied. */
+void init_envlist(void)
+{
+    pl_init(&envlist);
+    ht_init(&envindex, hashenvname, envnamecmp);
+    ht_init(&envdirty, hashwcs, htwcscmp);
+    ht_init(&envimport, hashwcs, htwcscmp);
+
+    for (char **e = environ; *e != NULL; e++) {
+	if (ht_get(&envindex, *e).key != NULL)
+	    continue;  /* ignore duplicates */
+	ht_set(&envindex, *e, ENVINDEX(envlist.length, false));
+	pl_add(&envlist, *e);
+
+	xwcsbuf_T name;
+	wb_init(&name);
+	if (wb_mbsncat(&name, *e, strcspn(*e, "=")) != NULL
+		|| ht_get(&envimport, name.contents).key != NULL) {
+	    wb_destroy(&name);
+	    continue;
+	}
+	ht_set(&envimport, wb_towcs(&name), *e);
+    }
+    environ = (char **) envlist.contents;
+}
+
+/* Makes a shell variable from the specified environment variable entry of the
+ * form "name=value". The variable is added to the top-level environment for
+ * the specified symbol, which must not have any variable yet. If the value
+ * cannot be converted to a wide string, no variable is made. */
+void import_variable(varsymbol_T *sym, const char *entry)
+{
+    assert(sym->vs_slots == NULL);
+
+    cvalue_T *value = NULL;
+    const char *eqp = strchr(entry, '=');
+    if (eqp != NULL) {
+	value = to_cvalue(malloc_mbstowcs(&eqp[1]));
+	if (value == NULL)
+	    return;
+    }
+
+    variable_T *v = xmalloc(sizeof *v);
+    v->v_type = VF_SCALAR | VF_EXPORT;
+    v->v_value = value;
+    v->v_getter = NULL;
+    env_set(first_env, sym, v);
+}
+
+/* Imports all the environment variables that have not yet been imported.
+ * This function must be called before enumerating variables or copying the
+ * environments. */
+void import_environment(void)
+{
+    if (envimport.count == 0)
+	return;
+
+    kvpair_T *kvs = ht_tokvarray(&envimport);
+    ht_clear(&envimport, NULL);
+    for (kvpair_T *kv = kvs; kv->key != NULL; kv++) {
+	assert(ht_get(&varindex, kv->key).key == NULL);
+	import_variable(symbol_of(kv->key), kv->value);
+	free(kv->key);
+    }
+    free(kvs);
+}
+
+/* Marks the environment variable for the specified variable as out of date.
+ * The change is applied to `environ' when `flush_environment' is called next,
+ * so repeatedly assigning to an exported variable costs nothing until an
+ * external program is executed. Variables that may affect library functions
+ * the shell itself calls are applied immediately. */
 void update_environment(const wchar_t *name)
+{
+    if (name[0] == L'\0' || wcschr(name, L'=') != NULL) {
+	/* such a name cannot be in the environment */
+	char *mname = malloc_wcstombs(name);
+	char *value = get_exported_value(name);
+	if (mname != NULL) {
+	    if (value == NULL)
+		xerror(EINVAL, Ngt("failed to unset environment variable $%s"),
+			mname);
+	    else
+		xerror(EINVAL, Ngt("failed to set environment variable $%s"),
+			mname);
+	}
+	free(mname);
+	free(value);
+	return;
+    }
+    if (affects_shell_itself(name)) {
+	apply_environment_change(name);
+	ht_remove(&envdirty, name);
+	environ = (char **) envlist.contents;
+	return;
+    }
+    if (ht_get(&envdirty, name).key == NULL)
+	ht_set(&envdirty, xwcsdup(name), NULL);
+}
+
+/* Returns true if the environment variable with the specified name may be
+ * consulted by the locale, message catalog, time zone, or terminfo functions
+ * of the library. */
+bool affects_shell_itself(const wchar_t *name)
+{
+    switch (name[0]) {
+	case L'C':
+	    return wcscmp(name, L VAR_COLUMNS) == 0;
+	case L'L':
+	    return wcscmp(name, L VAR_LANG) == 0
+		|| wcscmp(name, L"LANGUAGE") == 0
+		|| wcscmp(name, L VAR_LINES) == 0
+		|| wcsncmp(name, L"LC_", 3) == 0;
+	case L'N':
+	    return wcscmp(name, L VAR_NLSPATH) == 0;
+	case L'T':
+	    return wcscmp(name, L"TZ") == 0
+		|| wcsncmp(name, L VAR_TERM, 4) == 0;
+	default:
+	    return false;
+    }
+}
+
+/* Applies all pending changes of exported variables to `envlist' and returns
+ * the updated `environ', which is suitable for passing to `execve'. */
+char **flush_environment(void)
+{
+    if (envdirty.count > 0) {
+	size_t index = 0;
+	kvpair_T kv;
+	while ((kv = ht_next(&envdirty, &index)).key != NULL)
+	    apply_environment_change(kv.key);
+	ht_clear(&envdirty, kfree);
+    }
+    return environ = (char **) envlist.contents;
+}
+
+/* Updates the element of `envlist' for the variable with the specified name.
+ * `environ' must be updated after this function returns since `envlist' may
+ * have been reallocated. */
+void apply_environment_change(const wchar_t *name)
 {
     char *mname = malloc_wcstombs(name);
     if (mname == NULL)
 	return;
 
     char *value = get_exported_value(name);
-    if (value == NULL) {
-	if (xunsetenv(mname) < 0)
-	    xerror(errno, Ngt("failed to unset environment variable $%s"),
-		    mname);
-    } else {
-	if (setenv(mname, value, true) < 0)
-	    xerror(errno, Ngt("failed to set environment variable $%s"), mname);
+    kvpair_T kv = ht_get(&envindex, mname);
+    if (value != NULL) {
+	char *entry = malloc_printf("%s=%s", mname, value);
+	free(value);
+	if (kv.key != NULL) {
+	    /* replace the existing element in place */
+	    size_t i = ENVINDEX_INDEX(kv.value);
+	    ht_set(&envindex, entry, ENVINDEX(i, true));
+	    if (ENVINDEX_OWNED(kv.value))
+		free(envlist.contents[i]);
+	    envlist.contents[i] = entry;
+	} else {
+	    ht_set(&envindex, entry, ENVINDEX(envlist.length, true));
+	    pl_add(&envlist, entry);
+	}
+    } else if (kv.key != NULL) {
+	/* move the last element to the place of the removed one */
+	size_t i = ENVINDEX_INDEX(kv.value), last = envlist.length - 1;
+	ht_remove(&envindex, mname);
+	if (ENVINDEX_OWNED(kv.value))
+	    free(envlist.contents[i]);
+	if (i != last) {
+	    void *lastvalue = ht_get(&envindex, envlist.contents[last]).value;
+	    envlist.contents[i] = envlist.contents[last];
+	    ht_set(&envindex, envlist.contents[i],
+		    ENVINDEX(i, ENVINDEX_OWNED(lastvalue)));
+	}
+	pl_truncate(&envlist, last);
     }
 
     free(mname);
-    free(value);
 }
 
 /* Returns the value of variable `name' that should be exported.
@@ -435,16 +1330,22 @@ void update_environment(const wchar_t *name)
  * a multibyte string, NULL is returned. */
 char *get_exported_value(const wchar_t *name)
 {
-    for (environ_T *env = current_env; env != NULL; env = env->parent) {
-	const variable_T *var = ht_get(&env->contents, name).value;
-	if (var != NULL && (var->v_type & VF_EXPORT)) {
+    varsymbol_T *sym = find_symbol(name);
+    if (sym == NULL)
+	return NULL;
+    for (varslot_T *slot = sym->vs_slots; slot != NULL; slot = slot->next) {
+	const variable_T *var = slot->var;
+	if (var->v_type & VF_EXPORT) {
 	    switch (var->v_type & VF_MASK) {
 		case VF_SCALAR:
 		    if (var->v_value == NULL)
 			continue;
-		    return malloc_wcstombs(var->v_value);
+		    return realloc_wcstombs(cvalue_dup(var->v_value));
 		case VF_ARRAY:
 		    return realloc_wcstombs(joinwcsarray(var->v_vals, L":"));
+		case VF_ASSOC:
+		    /* associative arrays cannot be exported */
+		    return NULL;
 		default:
 		    assert(false);
 	    }
@@ -493,6 +1394,11 @@ reset_locale_all:
  * `name' must be one of the `LC_*' constants except LC_ALL. */
 void reset_locale_category(const wchar_t *name, int category)
 {
+    /* Import the environment while its values can still be decoded in the
+     * current encoding. */
+    if (category == LC_CTYPE)
+	import_environment();
+
     const wchar_t *locale = getvar(L VAR_LC_ALL);
     if (locale == NULL) {
 	locale = getvar(name);
@@ -506,54 +1412,64 @@ void reset_locale_category(const wchar_t *name, int category)
     if (wlocale != NULL) {
 	setlocale(category, wlocale);
 	free(wlocale);
+	if (category == LC_CTYPE) {
+	    reset_ctype_cache();
+	    reset_arith_cache();
+	}
+	if (category == LC_COLLATE || category == LC_CTYPE)
+	    xfnm_reset_locale();
     }
 }
 
 /* Creates a new scalar variable that has no value.
  * If the variable already exists, it is returned without change. So the return
  * value may be an array variable or it may be a scalar variable with a value.
- * Temporary variables with the `name' are cleared if any. */
-variable_T *new_global(const wchar_t *name)
+ * Temporary variables with the name are cleared if any. */
+variable_T *new_global(varsymbol_T *sym)
 {
-    variable_T *var;
-    for (environ_T *env = current_env; env != NULL; env = env->parent) {
-	var = ht_get(&env->contents, name).value;
-	if (var != NULL) {
-	    if (env->is_temporary) {
-		assert(!(var->v_type & VF_NODELETE));
-		varkvfree_reexport(ht_remove(&env->contents, name));
-		continue;
-	    }
-	    return var;
-	}
+    variable_T *var;
+    varslot_T *slot;
+    sym->vs_refcount++;  /* keep `sym' while removing temporary variables */
+    while ((slot = sym->vs_slots) != NULL) {
+	var = slot->var;
+	if (!slot->env->is_temporary)
+	    goto done;
+	assert(!(var->v_type & VF_NODELETE));
+	varkvfree_reexport(env_remove(slot->env, sym));
     }
     var = xmalloc(sizeof *var);
     var->v_type = VF_SCALAR;
     var->v_value = NULL;
     var->v_getter = NULL;
-    ht_set(&first_env->contents, xwcsdup(name), var);
+    env_set(first_env, sym, var);
+done:
+    sym->vs_refcount--;
     return var;
 }
 
 /* Creates a new scalar variable that has no value.
  * If the variable already exists, it is returned without change. So the return
  * value may be an array variable or it may be a scalar variable with a value.
- * Temporary variables with the `name' are cleared if any. */
-variable_T *new_local(const wchar_t *name)
+ * Temporary variables with the name are cleared if any. */
+variable_T *new_local(varsymbol_T *sym)
 {
     environ_T *env = current_env;
+    variable_T *var;
+    sym->vs_refcount++;  /* keep `sym' while removing temporary variables */
     while (env->is_temporary) {
-	varkvfree_reexport(ht_remove(&env->contents, name));
+	varkvfree_reexport(env_remove(env, sym));
 	env = env->parent;
     }
-    variable_T *var = ht_get(&env->contents, name).value;
-    if (var != NULL)
-	return var;
-    var = xmalloc(sizeof *var);
-    var->v_type = VF_SCALAR;
-    var->v_value = NULL;
-    var->v_getter = NULL;
-    ht_set(&env->contents, xwcsdup(name), var);
+    if (sym->vs_slots != NULL && sym->vs_slots->env == env) {
+	var = sym->vs_slots->var;
+    } else {
+	var = xmalloc(sizeof *var);
+	var->v_type = VF_SCALAR;
+	var->v_value = NULL;
+	var->v_getter = NULL;
+	env_set(env, sym, var);
+    }
+    sym->vs_refcount--;
     return var;
 }
 
@@ -563,24 +1479,23 @@ variable_T *new_local(const wchar_t *name)
  * The current environment must be a temporary environment.
  * If there is a read-only non-temporary variable with the specified name, it is
  * returned (no new temporary variable is created). */
-variable_T *new_temporary(const wchar_t *name)
+variable_T *new_temporary(varsymbol_T *sym)
 {
     environ_T *env = current_env;
     assert(env->is_temporary);
 
     /* check if read-only */
-    variable_T *var = search_variable(name);
+    variable_T *var = search_symbol(sym);
     if (var != NULL && (var->v_type & VF_READONLY))
 	return var;
 
-    var = ht_get(&env->contents, name).value;
-    if (var != NULL)
-	return var;
+    if (sym->vs_slots != NULL && sym->vs_slots->env == env)
+	return sym->vs_slots->var;
     var = xmalloc(sizeof *var);
     var->v_type = VF_SCALAR;
     var->v_value = NULL;
     var->v_getter = NULL;
-    ht_set(&env->contents, xwcsdup(name), var);
+    env_set(env, sym, var);
     return var;
 }
 
@@ -593,18 +1508,18 @@ variable_T *new_temporary(const wchar_t *name)
  * members of the variable (including `v_type') must be initialized by the
  * caller. If `v_type' of the return value includes the VF_EXPORT flag, the
  * caller must call `update_environment'. */
-variable_T *new_variable(const wchar_t *name, scope_T scope)
+variable_T *new_variable(varsymbol_T *sym, scope_T scope)
 {
     variable_T *var;
 
     switch (scope) {
-	case SCOPE_GLOBAL:  var = new_global(name);     break;
-	case SCOPE_LOCAL:   var = new_local(name);      break;
-	case SCOPE_TEMP:    var = new_temporary(name);  break;
+	case SCOPE_GLOBAL:  var = new_global(sym);     break;
+	case SCOPE_LOCAL:   var = new_local(sym);      break;
+	case SCOPE_TEMP:    var = new_temporary(sym);  break;
 	default:            assert(false);
     }
     if (var->v_type & VF_READONLY) {
-	xerror(0, Ngt("$%ls is read-only"), name);
+	xerror(0, Ngt("$%ls is read-only"), sym->vs_name);
 	return NULL;
     } else {
 	varvaluefree(var);
@@ -624,10 +1539,18 @@ variable_T *new_variable(const wchar_t *name, scope_T scope)
 bool set_variable(
 	const wchar_t *name, wchar_t *value, scope_T scope, bool export)
 {
+    return set_variable_sym(symbol_of(name), value, scope, export);
+}
+
+/* Like `set_variable', but the variable is specified by a symbol. */
+bool set_variable_sym(
+	varsymbol_T *sym, wchar_t *value, scope_T scope, bool export)
+{
+    const wchar_t *name = sym->vs_name;
     if (shopt_allexport && name[0] != '=')
 	export = true;
 
-    variable_T *var = new_variable(name, scope);
+    variable_T *var = new_variable(sym, scope);
     if (var == NULL) {
 	free(value);
 	return false;
@@ -636,7 +1559,7 @@ bool set_variable(
     var->v_type = VF_SCALAR
 	| (var->v_type & (VF_EXPORT | VF_NODELETE))
 	| (export ? VF_EXPORT : 0);
-    var->v_value = value;
+    var->v_value = to_cvalue(value);
     var->v_getter = NULL;
 
     variable_set(name, var);
@@ -664,7 +1587,7 @@ variable_T *set_array(const wchar_t *name, size_t count, void **values,
     if (shopt_allexport && name[0] != '=')
 	export = true;
 
-    variable_T *var = new_variable(name, scope);
+    variable_T *var = new_variable(symbol_of(name), scope);
     if (var == NULL) {
 	plfree(values, free);
 	return NULL;
@@ -673,8 +1596,7 @@ variable_T *set_array(const wchar_t *name, size_t count, void **values,
     var->v_type = VF_ARRAY
 	| (var->v_type & (VF_EXPORT | VF_NODELETE))
 	| (export ? VF_EXPORT : 0);
-    var->v_vals = values;
-    var->v_valc = (count != 0) ? count : plcount(var->v_vals);
+    array_init(var, values, (count != 0) ? count : plcount(values));
     var->v_getter = NULL;
 
     variable_set(name, var);
@@ -692,7 +1614,7 @@ variable_T *set_array(const wchar_t *name, size_t count, void **values,
  * Returns true iff successful. An error message is printed on failure. */
 bool set_array_element(const wchar_t *name, size_t index, wchar_t *value)
 {
-    variable_T *array = search_array_and_check_if_changeable(name);
+    variable_T *array = search_array_and_check_if_changeable(name, false);
     if (array == NULL)
 	goto fail;
     if (array->v_valc <= index)
@@ -714,6 +1636,66 @@ fail:
     return false;
 }
 
+/* Creates an associative array variable with the specified name.
+ * `keysandvalues' is an array of pointers to wide strings, which are the keys
+ * and values of the elements in turn. `count' is the number of strings in
+ * `keysandvalues', which must be even. The strings are copied.
+ * Returns the set array iff successful. On error, an error message is printed
+ * to the standard error and NULL is returned. */
+variable_T *set_assoc(const wchar_t *name, size_t count,
+	void *const *keysandvalues, scope_T scope)
+{
+    assert(count % 2 == 0);
+
+    variable_T *var = new_variable(symbol_of(name), scope);
+    if (var == NULL)
+	return NULL;
+
+    var->v_type = VF_ASSOC | (var->v_type & (VF_EXPORT | VF_NODELETE));
+    var->v_table = new_assoc_table(count / 2);
+    var->v_getter = NULL;
+    for (size_t i = 0; i < count; i += 2)
+	kvfree(ht_set(var->v_table,
+		    xwcsdup(keysandvalues[i]), xwcsdup(keysandvalues[i + 1])));
+
+    variable_set(name, var);
+    if (var->v_type & VF_EXPORT)
+	update_environment(name);
+    return var;
+}
+
+/* Changes the value of the specified element of an associative array.
+ * `name' must be the name of an existing associative array.
+ * `key' is the key of the element, which is added if not yet existing.
+ * `value' is the new value, which must be a `free'able string. Since `value' is
+ * used as the contents of the element, you must not modify or free `value'
+ * after this function returned (whether successful or not).
+ * Returns true iff successful. An error message is printed on failure. */
+bool set_assoc_element(const wchar_t *name, const wchar_t *key, wchar_t *value)
+{
+    variable_T *var = search_variable(name);
+    if (var == NULL || (var->v_type & VF_MASK) != VF_ASSOC) {
+	xerror(0, Ngt("no such associative array $%ls"), name);
+	goto fail;
+    } else if (var->v_type & VF_READONLY) {
+	xerror(0, Ngt("$%ls is read-only"), name);
+	goto fail;
+    }
+
+    kvpair_T kv = ht_get(var->v_table, key);
+    if (kv.key != NULL) {
+	ht_set(var->v_table, kv.key, value);
+	free(kv.value);
+    } else {
+	ht_set(var->v_table, xwcsdup(key), value);
+    }
+    return true;
+
+fail:
+    free(value);
+    return false;
+}
+
 /* Sets the positional parameters of the current environment.
  * The existent parameters are cleared.
  * `values' is an NULL-terminated array of pointers to wide strings.
@@ -726,6 +1708,19 @@ void set_positional_parameters(void *const *values)
 	    SCOPE_LOCAL, false);
 }
 
+/* Like `set_positional_parameters', but the strings in `values' are moved into
+ * the positional parameters rather than copied. `values[0]' is set to NULL, so
+ * the array that contains `values' can still be freed by `plfree', which stops
+ * at the NULL, without freeing the moved strings. */
+void move_positional_parameters(void **values)
+{
+    size_t count = plcount(values);
+    void **newvalues = xmallocn(count + 1, sizeof *newvalues);
+    memcpy(newvalues, values, (count + 1) * sizeof *newvalues);
+    values[0] = NULL;
+    set_array(L VAR_positional, count, newvalues, SCOPE_LOCAL, false);
+}
+
 /* Performs the specified assignments.
  * If `shopt_xtrace' is true, traces are printed to the standard error.
  * If `temp' is true, the variables are assigned in the current environment,
@@ -755,7 +1750,7 @@ bool do_assignments(const assign_T *assign, bool temp, bool export)
 		    return false;
 		if (shopt_xtrace)
 		    xtrace_variable(assign->a_name, value);
-		if (!set_variable(assign->a_name, value, scope, export))
+		if (!set_variable_sym(assign->a_symbol, value, scope, export))
 		    return false;
 		break;
 	    case A_ARRAY:
@@ -805,10 +1800,43 @@ void xtrace_array(const wchar_t *name, void *const *values)
  * Cannot be used for special parameters such as $$ and $@.
  * Returns the value of the variable, or NULL if not found.
  * The return value must not be modified or `free'ed by the caller and
- * is valid until the variable is re-assigned or unset. */
+ * is valid until the variable is re-assigned or unset.
+ * The value is kept in the variable in both the compact and wide forms, so
+ * this function should be used only for the variables the shell itself reads
+ * repeatedly, such as $IFS and $PATH. Use `getvar_dup' for other variables. */
 const wchar_t *getvar(const wchar_t *name)
 {
-    variable_T *var = search_variable(name);
+    varsymbol_T *sym = find_symbol(name);
+    return (sym != NULL) ? getvar_sym(sym) : NULL;
+}
+
+/* Like `getvar', but the variable is specified by a symbol. */
+const wchar_t *getvar_sym(const varsymbol_T *sym)
+{
+    cvalue_T *value = get_scalar_value(sym);
+    return (value != NULL) ? cvalue_wcs(value) : NULL;
+}
+
+/* Like `getvar', but returns a newly-malloced copy of the value, which must be
+ * freed by the caller. The value is not kept in the wide form. */
+wchar_t *getvar_dup(const wchar_t *name)
+{
+    varsymbol_T *sym = find_symbol(name);
+    return (sym != NULL) ? getvar_sym_dup(sym) : NULL;
+}
+
+/* Like `getvar_dup', but the variable is specified by a symbol. */
+wchar_t *getvar_sym_dup(const varsymbol_T *sym)
+{
+    cvalue_T *value = get_scalar_value(sym);
+    return (value != NULL) ? cvalue_dup(value) : NULL;
+}
+
+/* Returns the value of the scalar variable of the specified symbol, or NULL
+ * if the variable is not a set scalar. */
+cvalue_T *get_scalar_value(const varsymbol_T *sym)
+{
+    variable_T *var = search_symbol(sym);
     if (var != NULL && (var->v_type & VF_MASK) == VF_SCALAR) {
 	if (var->v_getter) {
 	    var->v_getter(var);
@@ -898,37 +1926,114 @@ positional_parameters:
     }
 
     /* now it should be a normal variable */
-    var = search_variable(name);
+    varsymbol_T *sym = find_symbol(name);
+    if (sym != NULL)
+	return get_variable_sym(sym);
+    goto not_found;
+
+return_single:  /* return a scalar as a one-element array */
+    return get_single_value(value);
+
+not_found:
+    return (struct get_variable_T) { .type = GV_NOTFOUND };
+}
+
+/* Like `get_variable', but the variable is specified by a symbol.
+ * Special parameters cannot be specified by a symbol. */
+struct get_variable_T get_variable_sym(const varsymbol_T *sym)
+{
+    variable_T *var = search_symbol(sym);
     if (var != NULL) {
 	if (var->v_getter)
 	    var->v_getter(var);
 	switch (var->v_type & VF_MASK) {
 	    case VF_SCALAR:
-		value = var->v_value ? xwcsdup(var->v_value) : NULL;
-		goto return_single;
+		return get_single_value(
+			var->v_value ? cvalue_dup(var->v_value) : NULL);
 	    case VF_ARRAY:
-		result.type = GV_ARRAY;
-		result.count = var->v_valc;
-		result.values = var->v_vals;
-		result.freevalues = false;
-		return result;
+		return (struct get_variable_T) {
+		    .type = GV_ARRAY,
+		    .count = var->v_valc,
+		    .values = var->v_vals,
+		    .freevalues = false,
+		};
+	    case VF_ASSOC:;
+		/* the values are returned in the order of the keys */
+		size_t count = var->v_table->count;
+		kvpair_T *kvs = sorted_assoc_elements(var);
+		void **values = xmallocn(count + 1, sizeof *values);
+		for (size_t i = 0; i < count; i++)
+		    values[i] = xwcsdup(kvs[i].value);
+		values[count] = NULL;
+		free(kvs);
+		return (struct get_variable_T) {
+		    .type = GV_ARRAY,
+		    .count = count,
+		    .values = values,
+		    .freevalues = true,
+		};
 	}
     }
-    goto not_found;
+    return (struct get_variable_T) { .type = GV_NOTFOUND };
+}
 
-return_single:  /* return a scalar as a one-element array */
-    if (value != NULL) {
-	result.type = GV_SCALAR;
-	result.count = 1;
-	result.values = xmallocn(2, sizeof *result.values);
-	result.values[0] = value;
-	result.values[1] = NULL;
-	result.freevalues = true;
-	return result;
-    }
+/* Returns true iff the variable of the specified symbol is an associative
+ * array. */
+bool is_associative_array(const varsymbol_T *sym)
+{
+    variable_T *var = search_symbol(sym);
+    return var != NULL && (var->v_type & VF_MASK) == VF_ASSOC;
+}
 
-not_found:
-    return (struct get_variable_T) { .type = GV_NOTFOUND };
+/* Returns the value of the specified element of an associative array in the
+ * same manner as `get_variable'. The variable of the symbol must be an
+ * associative array. If the array has no element of the key, the result is
+ * GV_NOTFOUND. The element is looked up in constant time on average. */
+struct get_variable_T get_assoc_element(
+	const varsymbol_T *sym, const wchar_t *key)
+{
+    variable_T *var = search_symbol(sym);
+    assert(var != NULL && (var->v_type & VF_MASK) == VF_ASSOC);
+
+    const wchar_t *value = ht_get(var->v_table, key).value;
+    return get_single_value((value != NULL) ? xwcsdup(value) : NULL);
+}
+
+/* Returns the specified scalar value as a `get_variable_T'.
+ * `value' must be a newly-malloced string or NULL. */
+struct get_variable_T get_single_value(wchar_t *value)
+{
+    if (value == NULL)
+	return (struct get_variable_T) { .type = GV_NOTFOUND };
+
+    struct get_variable_T result;
+    result.type = GV_SCALAR;
+    result.count = 1;
+    result.values = xmallocn(2, sizeof *result.values);
+    result.values[0] = value;
+    result.values[1] = NULL;
+    result.freevalues = true;
+    return result;
+}
+
+/* Returns a newly-malloced empty hashtable for the contents of an associative
+ * array. The hashtable maps keys (wchar_t *) to values (wchar_t *). */
+hashtable_T *new_assoc_table(size_t capacity)
+{
+    hashtable_T *table = xmalloc(sizeof *table);
+    return ht_initwithcapacity(table, hashwcs, htwcscmp, capacity);
+}
+
+/* Returns a newly-malloced array of the key-value pairs of the specified
+ * associative array, sorted by key. The number of the pairs is
+ * `var->v_table->count'. The keys and values must not be modified or freed. */
+kvpair_T *sorted_assoc_elements(const variable_T *var)
+{
+    assert((var->v_type & VF_MASK) == VF_ASSOC);
+
+    kvpair_T *kvs = ht_tokvarray(var->v_table);
+    qsort(kvs, var->v_table->count, sizeof *kvs, keywcscoll);
+    return kvs;
 }
 
 /* If `gv->freevalues' is false, substitutes `gv->values' with a newly-malloced
@@ -950,7 +2055,8 @@ void save_get_variable_values(struct get_variable_T *gv)
  * pairs is returned. The array contents must not be modified or freed. */
 size_t make_array_of_all_variables(bool global, kvpair_T **resultp)
 {
-    if (current_env->parent == NULL || (!global && current_env->is_temporary)) {
+    import_environment();
+    if (current_env->parent == NULL) {
 	*resultp = ht_tokvarray(&current_env->contents);
 	return current_env->contents.count;
     } else {
@@ -980,7 +2086,7 @@ void get_all_variables_rec(hashtable_T *table, environ_T *env, bool global)
     size_t i = 0;
     kvpair_T kv;
 
-    while ((kv = ht_next(&env->contents, &i)).key != NULL)
+    while ((kv = env_next(env, &i)).key != NULL)
 	ht_set(table, kv.key, kv.value);
 }
 
@@ -990,14 +2096,8 @@ void get_all_variables_rec(hashtable_T *table, environ_T *env, bool global)
 /* Don't forget to call `set_positional_parameters'! */
 void open_new_environment(bool temp)
 {
-    environ_T *newenv = xmalloc(sizeof *newenv);
-
-    newenv->parent = current_env;
-    newenv->is_temporary = temp;
-    ht_init(&newenv->contents, hashwcs, htwcscmp);
-    for (size_t i = 0; i < PA_count; i++)
-	newenv->paths[i] = NULL;
-    current_env = newenv;
+    current_env = new_environment(
+	    current_env, temp, HASHTABLE_DEFAULT_INIT_CAPACITY);
 }
 
 /* Destroys the current variable environment.
@@ -1008,11 +2108,209 @@ void close_current_environment(void)
 
     assert(oldenv != first_env);
     current_env = oldenv->parent;
-    ht_clear(&oldenv->contents, varkvfree_reexport);
-    ht_destroy(&oldenv->contents);
+    destroy_environment(oldenv, true);
+}
+
+/* Returns true if the current environment contains any variables other than
+ * the positional parameters. */
+bool has_local_variables(void)
+{
+    assert(!current_env->is_temporary);
+    return env_count(current_env) > 1;
+}
+
+/* saved variable environments (see `save_variables') */
+struct varsave_T {
+    environ_T *current_env, *first_env;
+    plist_T slots;
+    bool random_active;
+};
+/* `slots' contains pairs of a symbol and its saved `vs_slots'. */
+
+/* Saves all the current variables and replaces them with copies of them.
+ * Until `restore_variables' is called with the return value, variables are
+ * set, unset and changed in the copies while the saved originals remain
+ * intact. This is used to execute commands in the shell process as if they
+ * were executed in a subshell. */
+struct varsave_T *save_variables(void)
+{
+    struct varsave_T *save = xmalloc(sizeof *save);
+    save->current_env = current_env;
+    save->first_env = first_env;
+    save->random_active = random_active;
+
+    /* The pending environment variables must be imported before copying, or
+     * they would be lost when the copies are discarded. */
+    import_environment();
+
+    /* detach the shadow stacks from the symbols */
+    pl_init(&save->slots);
+    size_t i = 0;
+    kvpair_T kv;
+    while ((kv = ht_next(&varindex, &i)).key != NULL) {
+	varsymbol_T *sym = kv.value;
+	if (sym->vs_slots != NULL) {
+	    pl_add(pl_add(&save->slots, sym), sym->vs_slots);
+	    sym->vs_slots = NULL;
+	    sym->vs_refcount++;  /* keep the symbol until restored */
+	}
+    }
+
+    current_env = copy_environments(current_env);
+    for (first_env = current_env; first_env->parent != NULL; )
+	first_env = first_env->parent;
     for (size_t i = 0; i < PA_count; i++)
-	plfree((void **) oldenv->paths[i], free);
-    free(oldenv);
+	reset_path(i, NULL);
+    return save;
+}
+
+/* Discards the current variables and restores the variables saved by
+ * `save_variables'. `save' is freed in this function.
+ * All the environments opened after `save_variables' must have been closed.
+ * For variables that have been changed in the meantime, side effects such as
+ * resetting the locale or updating the environment variables are redone
+ * according to the restored values. */
+void restore_variables(struct varsave_T *save)
+{
+    plist_T changed, exported;
+    pl_init(&changed);
+    pl_init(&exported);
+
+    environ_T *copy = current_env, *orig = save->current_env;
+    while (copy != NULL) {
+	assert(orig != NULL);
+	collect_changed_variables(&changed, &exported, copy, orig, false);
+	collect_changed_variables(&changed, &exported, orig, copy, true);
+
+	environ_T *parent = copy->parent;
+	destroy_environment(copy, false);
+
+	copy = parent, orig = orig->parent;
+    }
+    assert(orig == NULL);
+
+    current_env = save->current_env;
+    first_env = save->first_env;
+
+    /* re-attach the shadow stacks to the symbols */
+    for (size_t i = 0; i < save->slots.length; i += 2) {
+	varsymbol_T *sym = save->slots.contents[i];
+	assert(sym->vs_slots == NULL);
+	sym->vs_slots = save->slots.contents[i + 1];
+	sym->vs_refcount--;
+    }
+    pl_destroy(&save->slots);
+
+    /* $RANDOM is not reseeded by `variable_set' while `random_active' is
+     * false. */
+    random_active = false;
+    for (size_t i = 0; i < changed.length; i++) {
+	const wchar_t *name = changed.contents[i];
+	variable_set(name, search_variable(name));
+    }
+    random_active = save->random_active;
+    for (size_t i = 0; i < exported.length; i++)
+	update_environment(exported.contents[i]);
+
+    pl_destroy(pl_clear(&changed, free));
+    pl_destroy(pl_clear(&exported, free));
+    free(save);
+}
+
+/* Copies the specified environment and its ancestors.
+ * The `paths' member of the copies are left NULL. */
+environ_T *copy_environments(const environ_T *env)
+{
+    if (env == NULL)
+	return NULL;
+
+    environ_T *newenv = new_environment(copy_environments(env->parent),
+	    env->is_temporary, env_count(env));
+
+    size_t i = 0;
+    kvpair_T kv;
+    while ((kv = env_next(env, &i)).key != NULL)
+	env_set(newenv, symbol_of(kv.key), copy_variable(kv.value));
+    return newenv;
+}
+
+/* Returns a newly-malloced copy of the specified variable. */
+variable_T *copy_variable(const variable_T *var)
+{
+    variable_T *newvar = xmalloc(sizeof *newvar);
+    newvar->v_type = var->v_type;
+    switch (var->v_type & VF_MASK) {
+	case VF_SCALAR:
+	    newvar->v_value =
+		(var->v_value != NULL) ? cvalue_copy(var->v_value) : NULL;
+	    break;
+	case VF_ARRAY:
+	    array_init(newvar,
+		    plndup(var->v_vals, var->v_valc, copyaswcs), var->v_valc);
+	    break;
+	case VF_ASSOC:
+	    newvar->v_table = new_assoc_table(var->v_table->count);
+	    size_t i = 0;
+	    kvpair_T kv;
+	    while ((kv = ht_next(var->v_table, &i)).key != NULL)
+		ht_set(newvar->v_table, xwcsdup(kv.key), xwcsdup(kv.value));
+	    break;
+    }
+    newvar->v_getter = var->v_getter;
+    return newvar;
+}
+
+/* Adds to `changed' the names of variables in `env1' that do not have the
+ * same value in `env2'. If `missingonly' is true, only variables that are
+ * missing in `env2' are added. The names of exported variables are also
+ * added to `exported'. The added names are newly-malloced. */
+void collect_changed_variables(
+	plist_T *restrict changed, plist_T *restrict exported,
+	const environ_T *env1, const environ_T *env2, bool missingonly)
+{
+    size_t i = 0;
+    kvpair_T kv;
+    while ((kv = env_next(env1, &i)).key != NULL) {
+	const variable_T *var1 = kv.value;
+	const variable_T *var2 = env_get(env2, kv.key);
+	if (var2 != NULL && (missingonly || variables_equal(var1, var2)))
+	    continue;
+
+	pl_add(changed, xwcsdup(kv.key));
+	if ((var1->v_type & VF_EXPORT)
+		|| (var2 != NULL && (var2->v_type & VF_EXPORT)))
+	    pl_add(exported, xwcsdup(kv.key));
+    }
+}
+
+/* Checks if the two variables have the same attributes and value. */
+bool variables_equal(const variable_T *v1, const variable_T *v2)
+{
+    if (v1->v_type != v2->v_type || v1->v_getter != v2->v_getter)
+	return false;
+    switch (v1->v_type & VF_MASK) {
+	case VF_SCALAR:
+	    return cvalues_equal(v1->v_value, v2->v_value);
+	case VF_ARRAY:
+	    if (v1->v_valc != v2->v_valc)
+		return false;
+	    for (size_t i = 0; i < v1->v_valc; i++)
+		if (wcscmp(v1->v_vals[i], v2->v_vals[i]) != 0)
+		    return false;
+	    return true;
+	case VF_ASSOC:
+	    if (v1->v_table->count != v2->v_table->count)
+		return false;
+	    size_t i = 0;
+	    kvpair_T kv;
+	    while ((kv = ht_next(v1->v_table, &i)).key != NULL) {
+		const wchar_t *value2 = ht_get(v2->v_table, kv.key).value;
+		if (value2 == NULL || wcscmp(kv.value, value2) != 0)
+		    return false;
+	    }
+	    return true;
+    }
+    assert(false);
 }
 
 
@@ -1035,12 +2333,18 @@ void update_lineno(unsigned long lineno)
     }
 }
 
+/* Returns the line number of the currently executing command. */
+unsigned long get_lineno(void)
+{
+    return current_lineno;
+}
+
 /* getter for $LINENO */
 void lineno_getter(variable_T *var)
 {
     assert((var->v_type & VF_MASK) == VF_SCALAR);
-    free(var->v_value);
-    var->v_value = malloc_wprintf(L"%lu", current_lineno);
+    cvalue_free(var->v_value);
+    var->v_value = to_cvalue(malloc_wprintf(L"%lu", current_lineno));
     // variable_set(VAR_LINENO, var);
     if (var->v_type & VF_EXPORT)
 	update_environment(L VAR_LINENO);
@@ -1050,8 +2354,8 @@ void lineno_getter(variable_T *var)
 void random_getter(variable_T *var)
 {
     assert((var->v_type & VF_MASK) == VF_SCALAR);
-    free(var->v_value);
-    var->v_value = malloc_wprintf(L"%u", next_random());
+    cvalue_free(var->v_value);
+    var->v_value = to_cvalue(malloc_wprintf(L"%u", next_random()));
     // variable_set(VAR_RANDOM, var);
     if (var->v_type & VF_EXPORT)
 	update_environment(L VAR_RANDOM);
@@ -1109,7 +2413,7 @@ void variable_set(const wchar_t *name, variable_T *var)
 		    && (var->v_type & VF_MASK) == VF_SCALAR
 		    && var->v_value != NULL) {
 		unsigned long seed;
-		if (xwcstoul(var->v_value, 0, &seed)) {
+		if (xwcstoul(cvalue_wcs(var->v_value), 0, &seed)) {
 		    srand((unsigned) seed);
 		    var->v_getter = random_getter;
 		    random_active = true;
@@ -1196,15 +2500,19 @@ void reset_path(path_T name, variable_T *var)
     for (environ_T *env = current_env; env != NULL; env = env->parent) {
 	plfree((void **) env->paths[name], free);
 
-	variable_T *v = ht_get(&env->contents, path_variables[name]).value;
+	variable_T *v = env_get(env, path_variables[name]);
 	if (v != NULL) {
 	    switch (v->v_type & VF_MASK) {
 		case VF_SCALAR:
-		    env->paths[name] = decompose_paths(v->v_value);
+		    env->paths[name] = decompose_paths(
+			    v->v_value != NULL ? cvalue_wcs(v->v_value) : NULL);
 		    break;
 		case VF_ARRAY:
 		    env->paths[name] = convert_path_array(v->v_vals);
 		    break;
+		case VF_ASSOC:
+		    env->paths[name] = NULL;
+		    break;
 	    }
 	    if (v == var)
 		break;
@@ -1368,6 +2676,8 @@ void generate_variable_candidates(const le_compopt_T *compopt)
     if (!le_compile_cpatterns(compopt))
 	return;
 
+    import_environment();
+
     size_t i = 0;
     kvpair_T kv;
     while ((kv = ht_next(&first_env->contents, &i)).key != NULL) {
@@ -1379,6 +2689,7 @@ void generate_variable_candidates(const le_compopt_T *compopt)
 		    continue;
 		break;
 	    case VF_ARRAY:
+	    case VF_ASSOC:
 		if (!(compopt->type & CGT_ARRAY))
 		    continue;
 		break;
@@ -1575,6 +2886,12 @@ static void print_scalar(const wchar_t *name, bool namequote,
 static void print_array(
 	const wchar_t *name, const variable_T *var, const wchar_t *argv0)
     __attribute__((nonnull));
+static void print_assoc(
+	const wchar_t *name, const variable_T *var, const wchar_t *argv0)
+    __attribute__((nonnull));
+static void print_array_attributes(
+	const wchar_t *name, const variable_T *var, const wchar_t *argv0)
+    __attribute__((nonnull));
 static void print_function(
 	const wchar_t *name, const function_T *func,
 	const wchar_t *argv0, bool readonly)
@@ -1594,6 +2911,11 @@ static void array_insert_elements(
 static void array_set_element(const wchar_t *name, variable_T *array,
 	const wchar_t *indexword, const wchar_t *value)
     __attribute__((nonnull));
+static void assoc_remove_elements(
+	variable_T *assoc, size_t count, void *const *keys)
+    __attribute__((nonnull));
+static int assoc_get_keys(const wchar_t *name, const wchar_t *arrayname)
+    __attribute__((nonnull));
 #endif /* YASH_ENABLE_ARRAY */
 static bool unset_function(const wchar_t *name)
     __attribute__((nonnull));
@@ -1623,14 +2945,15 @@ static void assign_array(const wchar_t *name, const plist_T *ranges, size_t i)
 
 /* Options for the "typeset" built-in. */
 const struct xgetopt_T typeset_options[] = {
-    { L'f', L"functions", OPTARG_NONE, false, NULL, },
-    { L'g', L"global",    OPTARG_NONE, false, NULL, },
-    { L'p', L"print",     OPTARG_NONE, true,  NULL, },
-    { L'r', L"readonly",  OPTARG_NONE, false, NULL, },
-    { L'x', L"export",    OPTARG_NONE, false, NULL, },
-    { L'X', L"unexport",  OPTARG_NONE, false, NULL, },
+    { L'f', L"functions",   OPTARG_NONE, false, NULL, },
+    { L'g', L"global",      OPTARG_NONE, false, NULL, },
+    { L'A', L"associative", OPTARG_NONE, false, NULL, },
+    { L'p', L"print",       OPTARG_NONE, true,  NULL, },
+    { L'r', L"readonly",    OPTARG_NONE, false, NULL, },
+    { L'x', L"export",      OPTARG_NONE, false, NULL, },
+    { L'X', L"unexport",    OPTARG_NONE, false, NULL, },
 #if YASH_ENABLE_HELP
-    { L'-', L"help",      OPTARG_NONE, false, NULL, },
+    { L'-', L"help",        OPTARG_NONE, false, NULL, },
 #endif
     { L'\0', NULL, 0, false, NULL, },
 };
@@ -1639,6 +2962,7 @@ const struct xgetopt_T typeset_options[] = {
 /* The "typeset" built-in, which accepts the following options:
  *  -f: affect functions rather than variables
  *  -g: global
+ *  -A: make variables associative arrays
  *  -p: print variables
  *  -r: make variables readonly
  *  -x: export variables
@@ -1650,7 +2974,7 @@ const struct xgetopt_T typeset_options[] = {
  * The "set" built-in without any arguments is redirected to this built-in. */
 int typeset_builtin(int argc, void **argv)
 {
-    bool function = false, global = false, print = false;
+    bool function = false, global = false, assoc = false, print = false;
     bool readonly = false, export = false, unexport = false;
 
     const struct xgetopt_T *options =
@@ -1661,6 +2985,7 @@ int typeset_builtin(int argc, void **argv)
 	switch (opt->shortopt) {
 	    case L'f':  function = true;  break;
 	    case L'g':  global   = true;  break;
+	    case L'A':  assoc    = true;  break;
 	    case L'p':  print    = true;  break;
 	    case L'r':  readonly = true;  break;
 	    case L'x':  export   = true;  break;
@@ -1702,6 +3027,9 @@ int typeset_builtin(int argc, void **argv)
     if (function && global && ARGV(0)[0] == L't' /*typeset*/)
 	return special_builtin_error(
 		mutually_exclusive_option_error(L'f', L'g'));
+    if (function && assoc)
+	return special_builtin_error(
+		mutually_exclusive_option_error(L'f', L'A'));
     if (function && export)
 	return special_builtin_error(
 		mutually_exclusive_option_error(L'f', L'x'));
@@ -1741,16 +3069,32 @@ int typeset_builtin(int argc, void **argv)
 		    *wequal = L'\0';
 		if (wequal != NULL || !print) {
 		    /* create/assign variable */
-		    variable_T *var = global ? new_global(arg) : new_local(arg);
+		    varsymbol_T *sym = symbol_of(arg);
+		    variable_T *var = global ? new_global(sym) : new_local(sym);
 		    vartype_T saveexport = var->v_type & VF_EXPORT;
+		    bool assigned = false;
 		    if (wequal != NULL) {
 			if (var->v_type & VF_READONLY) {
 			    xerror(0, Ngt("$%ls is read-only"), arg);
+			} else if (assoc) {
+			    xerror(0, Ngt("associative array $%ls cannot be "
+					"assigned a scalar value"), arg);
 			} else {
 			    varvaluefree(var);
 			    var->v_type = VF_SCALAR | (var->v_type & ~VF_MASK);
-			    var->v_value = xwcsdup(&wequal[1]);
+			    var->v_value = new_cvalue(&wequal[1]);
+			    var->v_getter = NULL;
+			    assigned = true;
+			}
+		    } else if (assoc && (var->v_type & VF_MASK) != VF_ASSOC) {
+			if (var->v_type & VF_READONLY) {
+			    xerror(0, Ngt("$%ls is read-only"), arg);
+			} else {
+			    varvaluefree(var);
+			    var->v_type = VF_ASSOC | (var->v_type & ~VF_MASK);
+			    var->v_table = new_assoc_table(0);
 			    var->v_getter = NULL;
+			    assigned = true;
 			}
 		    }
 		    if (readonly)
@@ -1761,7 +3105,7 @@ int typeset_builtin(int argc, void **argv)
 			var->v_type &= ~VF_EXPORT;
 		    variable_set(arg, var);
 		    if (saveexport != (var->v_type & VF_EXPORT)
-			    || (wequal != NULL && (var->v_type & VF_EXPORT)))
+			    || (assigned && (var->v_type & VF_EXPORT)))
 			update_environment(arg);
 		} else {
 		    /* print the variable */
@@ -1823,6 +3167,9 @@ void print_variable(
 	case VF_ARRAY:
 	    print_array(name, var, argv0);
 	    break;
+	case VF_ASSOC:
+	    print_assoc(name, var, argv0);
+	    break;
     }
 
     free(qname);
@@ -1840,10 +3187,13 @@ void print_scalar(const wchar_t *name, bool namequote,
     const char *format;
     char *opts;
 
-    if (var->v_value != NULL)
-	quotedvalue = quote_as_word(var->v_value);
-    else
+    if (var->v_value != NULL) {
+	wchar_t *value = cvalue_dup(var->v_value);
+	quotedvalue = quote_as_word(value);
+	free(value);
+    } else {
 	quotedvalue = NULL;
+    }
     switch (argv0[0]) {
 	case L's':
 	    assert(wcscmp(argv0, L"set") == 0);
@@ -1897,6 +3247,46 @@ void print_array(
     }
     if (!xprintf(")\n"))
 	return;
+    print_array_attributes(name, var, argv0);
+}
+
+/* Prints the specified associative array to the standard output.
+ * The elements are printed in the form of an invocation of the array built-in
+ * with the -A option.
+ * An error message is printed to the standard error on error. */
+void print_assoc(
+	const wchar_t *name, const variable_T *var, const wchar_t *argv0)
+{
+    if (!xprintf("array -A %ls", name))
+	return;
+
+    size_t count = var->v_table->count;
+    kvpair_T *kvs = sorted_assoc_elements(var);
+    for (size_t i = 0; i < count; i++) {
+	wchar_t *qkey = quote_as_word(kvs[i].key);
+	wchar_t *qvalue = quote_as_word(kvs[i].value);
+	bool ok = xprintf(" %ls %ls", qkey, qvalue);
+	free(qkey);
+	free(qvalue);
+	if (!ok) {
+	    free(kvs);
+	    return;
+	}
+    }
+    free(kvs);
+
+    if (!xprintf("\n"))
+	return;
+    print_array_attributes(name, var, argv0);
+}
+
+/* Prints a command that restores the attributes of the specified (associative)
+ * array to the standard output. This function is called after the array
+ * elements have been printed.
+ * An error message is printed to the standard error on error. */
+void print_array_attributes(
+	const wchar_t *name, const variable_T *var, const wchar_t *argv0)
+{
     switch (argv0[0]) {
 	case L'a':
 	    assert(wcscmp(argv0, L"array") == 0);
@@ -1986,7 +3376,7 @@ const char typeset_help[] = Ngt(
 "set or print variables"
 );
 const char typeset_syntax[] = Ngt(
-"\ttypeset [-fgprxX] [name[=value]...]\n"
+"\ttypeset [-fgAprxX] [name[=value]...]\n"
 );
 const char export_help[] = Ngt(
 "export variables as environment variables"
@@ -1998,7 +3388,7 @@ const char local_help[] = Ngt(
 "set or print local variables"
 );
 const char local_syntax[] = Ngt(
-"\tlocal [-prxX] [name[=value]...]\n"
+"\tlocal [-AprxX] [name[=value]...]\n"
 );
 const char readonly_help[] = Ngt(
 "make variables read-only"
@@ -2012,18 +3402,22 @@ const char readonly_syntax[] = Ngt(
 
 /* Options for the "array" built-in. */
 const struct xgetopt_T array_options[] = {
-    { L'd', L"delete", OPTARG_NONE, true,  NULL, },
-    { L'i', L"insert", OPTARG_NONE, true,  NULL, },
-    { L's', L"set",    OPTARG_NONE, true,  NULL, },
+    { L'A', L"associative", OPTARG_NONE, true,  NULL, },
+    { L'd', L"delete",      OPTARG_NONE, true,  NULL, },
+    { L'i', L"insert",      OPTARG_NONE, true,  NULL, },
+    { L'k', L"keys",        OPTARG_NONE, true,  NULL, },
+    { L's', L"set",         OPTARG_NONE, true,  NULL, },
 #if YASH_ENABLE_HELP
-    { L'-', L"help",   OPTARG_NONE, false, NULL, },
+    { L'-', L"help",        OPTARG_NONE, false, NULL, },
 #endif
     { L'\0', NULL, 0, false, NULL, },
 };
 
 /* The "array" built-in, which accepts the following options:
+ *  -A: set associative array elements
  *  -d: delete an array element
  *  -i: insert an array element
+ *  -k: get the keys of an associative array
  *  -s: set an array element value */
 int array_builtin(int argc, void **argv)
 {
@@ -2032,14 +3426,18 @@ int array_builtin(int argc, void **argv)
 	DELETE = 1 << 0,
 	INSERT = 1 << 1,
 	SET    = 1 << 2,
+	ASSOC  = 1 << 3,
+	KEYS   = 1 << 4,
     } options = NONE;
 
     const struct xgetopt_T *opt;
     xoptind = 0;
     while ((opt = xgetopt(argv, array_options, XGETOPT_DIGIT)) != NULL) {
 	switch (opt->shortopt) {
+	    case L'A':  options |= ASSOC;   break;
 	    case L'd':  options |= DELETE;  break;
 	    case L'i':  options |= INSERT;  break;
+	    case L'k':  options |= KEYS;    break;
 	    case L's':  options |= SET;     break;
 #if YASH_ENABLE_HELP
 	    case L'-':
@@ -2061,6 +3459,8 @@ int array_builtin(int argc, void **argv)
 	case DELETE:  min = 1;  max = SIZE_MAX;  break;
 	case INSERT:  min = 2;  max = SIZE_MAX;  break;
 	case SET:     min = 3;  max = 3;         break;
+	case ASSOC:   min = 1;  max = SIZE_MAX;  break;
+	case KEYS:    min = 2;  max = 2;         break;
 	default:      assert(false);
     }
     if (!validate_operand_count(argc - xoptind, min, max))
@@ -2078,20 +3478,39 @@ int array_builtin(int argc, void **argv)
     if (options == 0) {
 	set_array(name, argc - xoptind, pldup(&argv[xoptind], copyaswcs),
 		SCOPE_GLOBAL, false);
+    } else if (options == ASSOC) {
+	if ((argc - xoptind) % 2 != 0) {
+	    xerror(0, Ngt("the value for key `%ls' is missing"), ARGV(argc - 1));
+	    return Exit_ERROR;
+	}
+	set_assoc(name, argc - xoptind, &argv[xoptind], SCOPE_GLOBAL);
+    } else if (options == KEYS) {
+	return assoc_get_keys(name, ARGV(xoptind));
     } else {
-	variable_T *array = search_array_and_check_if_changeable(name);
+	variable_T *array =
+	    search_array_and_check_if_changeable(name, options != INSERT);
 	if (array == NULL)
 	    return Exit_FAILURE;
+	bool assoc = (array->v_type & VF_MASK) == VF_ASSOC;
 	switch (options) {
 	    case DELETE:
-		array_remove_elements(array, argc - xoptind, &argv[xoptind]);
+		if (assoc)
+		    assoc_remove_elements(
+			    array, argc - xoptind, &argv[xoptind]);
+		else
+		    array_remove_elements(
+			    array, argc - xoptind, &argv[xoptind]);
 		break;
 	    case INSERT:
 		array_insert_elements(array, argc - xoptind, &argv[xoptind]);
 		break;
 	    case SET:
-		array_set_element(
-			name, array, ARGV(xoptind), ARGV(xoptind + 1));
+		if (assoc)
+		    set_assoc_element(name, ARGV(xoptind),
+			    xwcsdup(ARGV(xoptind + 1)));
+		else
+		    array_set_element(
+			    name, array, ARGV(xoptind), ARGV(xoptind + 1));
 		break;
 	    default:
 		assert(false);
@@ -2117,7 +3536,7 @@ int array_dump_all(const wchar_t *argv0)
     qsort(kvs, count, sizeof *kvs, keywcscoll);
     for (size_t i = 0; yash_error_message_count == 0 && i < count; i++) {
 	variable_T *var = kvs[i].value;
-	if ((var->v_type & VF_MASK) == VF_ARRAY)
+	if ((var->v_type & VF_MASK) != VF_SCALAR)
 	    print_variable(kvs[i].key, var, argv0, false, false);
     }
     free(kvs);
@@ -2160,23 +3579,18 @@ void array_remove_elements(
     /* sort all the indices. */
     qsort(indices, count, sizeof *indices, compare_long);
 
-    /* remove elements in descending order so that an earlier removal does not
-     * affect the indices for later removals. */
-    plist_T list;
-    long lastindex = LONG_MIN;
-    pl_initwith(&list, array->v_vals, array->v_valc);
-    for (size_t i = count; i-- != 0; ) {
-	long index = indices[i];
-	if (index == lastindex)
-	    continue;
-	if (0 <= index && LONG_LT_SIZE(index, list.length)) {
-	    free(list.contents[index]);
-	    pl_remove(&list, index, 1);
-	}
-	lastindex = index;
+    /* remove the elements and close up the remaining ones in one pass */
+    size_t j = 0, newcount = 0;
+    for (size_t i = 0; i < array->v_valc; i++) {
+	while (j < count && (indices[j] < 0 || (unsigned long) indices[j] < i))
+	    j++;
+	if (j < count && (unsigned long) indices[j] == i)
+	    free(array->v_vals[i]);
+	else
+	    array->v_vals[newcount++] = array->v_vals[i];
     }
-    array->v_valc = list.length;
-    array->v_vals = pl_toary(&list);
+    array->v_vals[newcount] = NULL;
+    array->v_valc = newcount;
 }
 
 int compare_long(const void *lp1, const void *lp2)
@@ -2222,13 +3636,9 @@ void array_insert_elements(
     else
 	uindex = array->v_valc;
 
-    plist_T list;
-    pl_initwith(&list, array->v_vals, array->v_valc);
-    pl_insert(&list, uindex, values);
+    array_insert(array, uindex, count, values);
     for (size_t i = 0; i < count; i++)
-	list.contents[uindex + i] = xwcsdup(list.contents[uindex + i]);
-    array->v_valc = list.length;
-    array->v_vals = pl_toary(&list);
+	array->v_vals[uindex + i] = xwcsdup(array->v_vals[uindex + i]);
 }
 
 /* Sets the value of the specified element of the array.
@@ -2271,6 +3681,47 @@ invalid_index:
 	    indexword, name, array->v_valc);
 }
 
+/* Removes the elements of the specified keys from associative array `assoc'.
+ * `keys' is an NULL-terminated array of pointers to wide strings.
+ * `count' is the number of elements in `keys'.
+ * Keys that are not in the array are silently ignored. */
+void assoc_remove_elements(
+	variable_T *assoc, size_t count, void *const *keys)
+{
+    assert((assoc->v_type & VF_MASK) == VF_ASSOC);
+
+    for (size_t i = 0; i < count; i++)
+	kvfree(ht_remove(assoc->v_table, keys[i]));
+}
+
+/* Assigns the keys of associative array `name' to array `arrayname'.
+ * The keys are sorted in the same order as the values are expanded.
+ * Returns an exit status to be returned by the array built-in. */
+int assoc_get_keys(const wchar_t *name, const wchar_t *arrayname)
+{
+    variable_T *var = search_variable(name);
+    if (var == NULL || (var->v_type & VF_MASK) != VF_ASSOC) {
+	xerror(0, Ngt("no such associative array $%ls"), name);
+	return Exit_FAILURE;
+    }
+    if (wcschr(arrayname, L'=') != NULL) {
+	xerror(0, Ngt("`%ls' is not a valid array name"), arrayname);
+	return Exit_FAILURE;
+    }
+
+    size_t count = var->v_table->count;
+    kvpair_T *kvs = sorted_assoc_elements(var);
+    void **keys = xmallocn(count + 1, sizeof *keys);
+    for (size_t i = 0; i < count; i++)
+	keys[i] = xwcsdup(kvs[i].key);
+    keys[count] = NULL;
+    free(kvs);
+
+    if (set_array(arrayname, count, keys, SCOPE_GLOBAL, false) == NULL)
+	return Exit_FAILURE;
+    return Exit_SUCCESS;
+}
+
 #if YASH_ENABLE_HELP
 const char array_help[] = Ngt(
 "manipulate an array"
@@ -2281,6 +3732,8 @@ const char array_syntax[] = Ngt(
 "\tarray -d name [index...]\n"
 "\tarray -i name index [value...]\n"
 "\tarray -s name index value\n"
+"\tarray -A name [key value...]\n"
+"\tarray -k name array_name\n"
 );
 #endif
 
@@ -2360,24 +3813,21 @@ bool unset_function(const wchar_t *name)
  * returned. */
 bool unset_variable(const wchar_t *name)
 {
-    for (environ_T *env = current_env; env != NULL; env = env->parent) {
-	kvpair_T kv = ht_remove(&env->contents, name);
-	variable_T *var = kv.value;
-	if (var != NULL) {
-	    if (!(var->v_type & VF_NODELETE)) {
-		bool exported = var->v_type & VF_EXPORT;
-		varkvfree(kv);
-		variable_set(name, NULL);
-		if (exported)
-		    update_environment(name);
-		return false;
-	    } else {
-		xerror(0, Ngt("$%ls is read-only"), name);
-		ht_set(&env->contents, kv.key, kv.value);
-		return true;
-	    }
-	}
+    varsymbol_T *sym = find_symbol(name);
+    if (sym == NULL || sym->vs_slots == NULL)
+	return false;
+
+    variable_T *var = sym->vs_slots->var;
+    if (var->v_type & VF_NODELETE) {
+	xerror(0, Ngt("$%ls is read-only"), name);
+	return true;
     }
+
+    bool exported = var->v_type & VF_EXPORT;
+    varkvfree(env_remove(sym->vs_slots->env, sym));
+    variable_set(name, NULL);
+    if (exported)
+	update_environment(name);
     return false;
 }
 
@@ -2479,13 +3929,7 @@ int shift_builtin(int argc, void **argv)
     }
 
     size_t from = (count >= 0) ? 0 : (var->v_valc - (size_t) abscount);
-    plist_T list;
-    pl_initwith(&list, var->v_vals, var->v_valc);
-    for (size_t i = 0; i < (size_t) abscount; i++)
-	free(list.contents[from + i]);
-    pl_remove(&list, from, (size_t) abscount);
-    var->v_valc = list.length;
-    var->v_vals = pl_toary(&list);
+    array_remove(var, from, (size_t) abscount);
 
     return Exit_SUCCESS;
 }
@@ -3150,10 +4594,8 @@ variable_T *get_dirstack(void)
  * modify or free `value' after calling this function. */
 void push_dirstack(variable_T *var, wchar_t *value)
 {
-    size_t index = var->v_valc++;
-    var->v_vals = xrealloce(var->v_vals, index, 2, sizeof *var->v_vals);
-    var->v_vals[index] = value;
-    var->v_vals[index + 1] = NULL;
+    void *element = value;
+    array_insert(var, var->v_valc, 1, &element);
 }
 
 /* Removes the directory stack entry specified by `index'.
@@ -3162,10 +4604,7 @@ void push_dirstack(variable_T *var, wchar_t *value)
 void remove_dirstack_entry_at(variable_T *var, size_t index)
 {
     assert(index < var->v_valc);
-    free(var->v_vals[index]);
-    memmove(&var->v_vals[index], &var->v_vals[index + 1],
-	    (var->v_valc - index) * sizeof *var->v_vals);
-    var->v_valc--;
+    array_remove(var, index, 1);
 }
 
 /* Removes directory stack entries that are the same as the current working
@@ -70,10 +70,13 @@ extern char **environ;
 #define VAR_YASH_AFTER_CD             "YASH_AFTER_CD"
 #define VAR_YASH_LE_TIMEOUT           "YASH_LE_TIMEOUT"
 #define VAR_YASH_LOADPATH             "YASH_LOADPATH"
+#define VAR_YASH_PARSECACHE_DIR       "YASH_PARSECACHE_DIR"
 #define VAR_YASH_VERSION              "YASH_VERSION"
 #define L                             L""
 
 struct variable_T;
+struct varsymbol_T;
+struct varsave_T;
 struct assign_T;
 struct command_T;
 
@@ -85,8 +88,15 @@ typedef enum path_T {
 extern void init_environment(void);
 extern void init_variables(void);
 
+extern struct varsymbol_T *intern_variable_name(const wchar_t *name)
+    __attribute__((nonnull,warn_unused_result));
+extern void release_variable_name(struct varsymbol_T *sym);
+extern const wchar_t *symbol_name(const struct varsymbol_T *sym)
+    __attribute__((pure,nonnull));
+
 extern char *get_exported_value(const wchar_t *name)
     __attribute__((nonnull,malloc,warn_unused_result));
+extern char **flush_environment(void);
 
 typedef enum scope_T {
     SCOPE_GLOBAL, SCOPE_LOCAL, SCOPE_TEMP,
@@ -94,6 +104,9 @@ typedef enum scope_T {
 extern _Bool set_variable(
 	const wchar_t *name, wchar_t *value, scope_T scope, _Bool export)
     __attribute__((nonnull(1)));
+extern _Bool set_variable_sym(
+	struct varsymbol_T *sym, wchar_t *value, scope_T scope, _Bool export)
+    __attribute__((nonnull(1)));
 extern struct variable_T *set_array(
 	const wchar_t *name, size_t count, void **values,
 	scope_T scope, _Bool export)
@@ -101,8 +114,13 @@ extern struct variable_T *set_array(
 extern _Bool set_array_element(
 	const wchar_t *name, size_t index, wchar_t *value)
     __attribute__((nonnull));
+extern _Bool set_assoc_element(
+	const wchar_t *name, const wchar_t *key, wchar_t *value)
+    __attribute__((nonnull));
 extern void set_positional_parameters(void *const *values)
     __attribute__((nonnull));
+extern void move_positional_parameters(void **values)
+    __attribute__((nonnull));
 extern _Bool do_assignments(
 	const struct assign_T *assigns, _Bool temp, _Bool export);
 
@@ -113,16 +131,37 @@ struct get_variable_T {
     _Bool freevalues;
 };
 extern const wchar_t *getvar(const wchar_t *name)
-    __attribute__((pure,nonnull));
+    __attribute__((nonnull));
+extern const wchar_t *getvar_sym(const struct varsymbol_T *sym)
+    __attribute__((nonnull));
+extern wchar_t *getvar_dup(const wchar_t *name)
+    __attribute__((nonnull,malloc,warn_unused_result));
+extern wchar_t *getvar_sym_dup(const struct varsymbol_T *sym)
+    __attribute__((nonnull,malloc,warn_unused_result));
 extern struct get_variable_T get_variable(const wchar_t *name)
     __attribute__((nonnull,warn_unused_result));
+extern struct get_variable_T get_variable_sym(const struct varsymbol_T *sym)
+    __attribute__((nonnull,warn_unused_result));
+extern _Bool is_associative_array(const struct varsymbol_T *sym)
+    __attribute__((pure,nonnull));
+extern struct get_variable_T get_assoc_element(
+	const struct varsymbol_T *sym, const wchar_t *key)
+    __attribute__((nonnull,warn_unused_result));
 extern void save_get_variable_values(struct get_variable_T *gv)
     __attribute__((nonnull));
 
 extern void open_new_environment(_Bool temp);
 extern void close_current_environment(void);
+extern _Bool has_local_variables(void)
+    __attribute__((pure));
+extern struct varsave_T *save_variables(void)
+    __attribute__((malloc,warn_unused_result));
+extern void restore_variables(struct varsave_T *save)
+    __attribute__((nonnull));
 
 extern void update_lineno(unsigned long lineno);
+extern unsigned long get_lineno(void)
+    __attribute__((pure));
 
 extern char **decompose_paths(const wchar_t *paths)
     __attribute__((malloc,warn_unused_result));
@@ -24,12 +24,14 @@
 #include <stdlib.h>
 #include <string.h>
 #include <wchar.h>
+#include "hashtable.h"
 #include "strbuf.h"
 #include "util.h"
 
 
 struct xfnmatch_T {
     xfnmflags_T flags;
+    unsigned refcount;
     union {
 	regex_t regex;
 	xwcsbuf_T literal;
@@ -42,6 +44,7 @@ struct xfnmatch_T {
  *  XFNM_PERIOD:    don't match with a string that starts with a period
  *  XFNM_CASEFOLD:  ignore case while matching
  *  XFNM_compiled:  use `regex' rather than `literal'
+ *  XFNM_extended:  `regex' is an extended regular expression
  * When XFNM_SHORTEST is specified, either (but not both) of XFNM_HEADONLY and
  * XFNM_TAILONLY must be also specified. When XFNM_PERIOD is specified,
  * XFNM_HEADONLY must be also specified. */
@@ -49,10 +52,48 @@ struct xfnmatch_T {
 #define XFNM_HEADTAIL (XFNM_HEADONLY | XFNM_TAILONLY)
 #define MISMATCH ((xfnmresult_T) { (size_t) -1, (size_t) -1, })
 
+/* The `refcount' member is the number of references to the structure. A
+ * compiled regular expression may be shared between the caller of
+ * `xfnm_compile' and the regex cache below, so the structure is freed only
+ * when the last reference is dropped in `xfnm_free'. */
+
+/* An entry of the regex cache. */
+typedef struct regexcache_T {
+    struct regexcache_T *prev, *next;
+    wchar_t *key;
+    xfnmatch_T *xfnm;
+} regexcache_T;
+/* The key is the pattern prefixed with a character representing the flags.
+ * Entries are linked in the order of recent use: `regexcache_head.next' is the
+ * most recently used and `regexcache_head.prev' is the least recently used. */
+
+/* The maximum number of entries in the regex cache. */
+#define REGEX_CACHE_MAX 64
+
+/* A hashtable that maps cache keys to `regexcache_T' entries. */
+static hashtable_T regexcache;
+/* The sentinel of the list of cache entries. */
+static regexcache_T regexcache_head = {
+    .prev = &regexcache_head, .next = &regexcache_head,
+};
+
+/* The number of times the locale has been changed.
+ * A compiled pattern depends on the LC_COLLATE and LC_CTYPE locales at the time
+ * of compilation, so callers that cache compiled patterns compare this number
+ * with the one at the time of compilation to find out-of-date ones. */
+unsigned long xfnm_locale_generation = 0;
+
 static bool is_matching_pattern_bracket(const wchar_t *pat)
     __attribute__((nonnull,pure));
 static xfnmatch_T *try_compile_literal(const wchar_t *pat, xfnmflags_T flags)
     __attribute__((malloc,warn_unused_result,nonnull));
+static xfnmatch_T *compile_regex_cached(
+	const wchar_t *pat, xfnmflags_T flags)
+    __attribute__((nonnull));
+static void unlink_regex_cache(regexcache_T *e)
+    __attribute__((nonnull));
+static void remove_regex_cache(regexcache_T *e)
+    __attribute__((nonnull));
 static xfnmatch_T *try_compile_regex(const wchar_t *pat, xfnmflags_T flags)
     __attribute__((malloc,warn_unused_result,nonnull));
 static void encode_pattern(const wchar_t *restrict pat, xstrbuf_T *restrict buf)
@@ -185,8 +226,8 @@ bool is_pathname_matching_pattern(const wchar_t *pat)
  * XFNM_TAILONLY must be also specified. When XFNM_PERIOD is specified,
  * XFNM_HEADONLY must be also specified.
  * Returns NULL on failure. */
-/* Argument `flags' must not contain XFNM_compiled, XFNM_headstar, or
- * XFNM_tailstar, which are for internal use only */
+/* Argument `flags' must not contain XFNM_compiled, XFNM_headstar,
+ * XFNM_tailstar, or XFNM_extended, which are for internal use only */
 xfnmatch_T *xfnm_compile(const wchar_t *pat, xfnmflags_T flags)
 {
     if (flags & XFNM_SHORTEST) {
@@ -207,7 +248,7 @@ xfnmatch_T *xfnm_compile(const wchar_t *pat, xfnmflags_T flags)
 	    return result;
     }
 
-    return try_compile_regex(pat, flags);
+    return compile_regex_cached(pat, flags);
 }
 
 /* Checks if the specified pattern is a literal pattern and if so compiles it.
@@ -217,6 +258,7 @@ xfnmatch_T *try_compile_literal(const wchar_t *pat, xfnmflags_T flags)
     xfnmflags_T oldflags = flags;
     xfnmatch_T *xfnm = xmalloc(sizeof *xfnm);
 
+    xfnm->refcount = 1;
     wb_init(&xfnm->value.literal);
     while (*pat == L'*') {
 	flags &= ~XFNM_HEADONLY;
@@ -271,27 +313,97 @@ fail:
     return NULL;
 }
 
+/* Compiles the specified pattern, reusing the result of a previous compilation
+ * if it is in the regex cache. A newly compiled pattern is added to the cache,
+ * possibly discarding the least recently used entry.
+ * Returns NULL on error. */
+xfnmatch_T *compile_regex_cached(const wchar_t *pat, xfnmflags_T flags)
+{
+    if (regexcache.capacity == 0)
+	ht_init(&regexcache, hashwcs, htwcscmp);
+
+    xwcsbuf_T key;
+    wb_init(&key);
+    wb_wccat(&key, L'0' + (wchar_t) flags);
+    wb_cat(&key, pat);
+
+    regexcache_T *e = ht_get(&regexcache, key.contents).value;
+    if (e != NULL) {
+	wb_destroy(&key);
+	unlink_regex_cache(e);
+    } else {
+	xfnmatch_T *xfnm = try_compile_regex(pat, flags);
+	if (xfnm == NULL) {
+	    wb_destroy(&key);
+	    return NULL;
+	}
+	if (regexcache.count >= REGEX_CACHE_MAX)
+	    remove_regex_cache(regexcache_head.prev);
+
+	e = xmalloc(sizeof *e);
+	e->key = wb_towcs(&key);
+	e->xfnm = xfnm;
+	ht_set(&regexcache, e->key, e);
+    }
+
+    /* move the entry to the head of the list */
+    e->prev = &regexcache_head;
+    e->next = regexcache_head.next;
+    e->next->prev = e;
+    regexcache_head.next = e;
+
+    e->xfnm->refcount++;
+    return e->xfnm;
+}
+
+/* Removes the specified entry from the list of cache entries. */
+void unlink_regex_cache(regexcache_T *e)
+{
+    e->prev->next = e->next;
+    e->next->prev = e->prev;
+}
+
+/* Removes the specified entry from the regex cache and frees it. */
+void remove_regex_cache(regexcache_T *e)
+{
+    unlink_regex_cache(e);
+    ht_remove(&regexcache, e->key);
+    free(e->key);
+    xfnm_free(e->xfnm);
+    free(e);
+}
+
 /* Compiles the specified pattern.
+ * If `flags' contains XFNM_extended, `pat' is an extended regular expression.
+ * Otherwise, `pat' is a pathname matching pattern.
  * Returns NULL on error. */
 xfnmatch_T *try_compile_regex(const wchar_t *pat, xfnmflags_T flags)
 {
     xstrbuf_T buf;
+    int regexflags = 0;
 
-    sb_init(&buf);
-    if (flags & XFNM_HEADONLY)
-	sb_ccat(&buf, '^');
-    encode_pattern(pat, &buf);
-    if (flags & XFNM_TAILONLY)
-	sb_ccat(&buf, '$');
+    if (flags & XFNM_extended) {
+	char *mbs = malloc_wcstombs(pat);
+	if (mbs == NULL)
+	    return NULL;
+	sb_initwith(&buf, mbs);
+	regexflags |= REG_EXTENDED | REG_NOSUB;
+    } else {
+	sb_init(&buf);
+	if (flags & XFNM_HEADONLY)
+	    sb_ccat(&buf, '^');
+	encode_pattern(pat, &buf);
+	if (flags & XFNM_TAILONLY)
+	    sb_ccat(&buf, '$');
+	if ((flags & XFNM_HEADTAIL) == XFNM_HEADTAIL)
+	    regexflags |= REG_NOSUB;
+    }
+    if (flags & XFNM_CASEFOLD)
+	regexflags |= REG_ICASE;
 
     xfnmatch_T *xfnm = xmalloc(sizeof *xfnm);
     xfnm->flags = flags | XFNM_compiled;
-
-    int regexflags = 0;
-    if (flags & XFNM_CASEFOLD)
-	regexflags |= REG_ICASE;
-    if ((flags & XFNM_HEADTAIL) == XFNM_HEADTAIL)
-	regexflags |= REG_NOSUB;
+    xfnm->refcount = 1;
 
     int err = regcomp(&xfnm->value.regex, buf.contents, regexflags);
 
@@ -720,10 +832,23 @@ wchar_t *xfnm_subst(const xfnmatch_T *restrict xfnm, const wchar_t *restrict s,
     return wb_towcs(wb_cat(&buf, &s[i]));
 }
 
-/* Frees the specified compiled pattern. */
+/* Makes all cached compiled patterns out of date and removes all entries from
+ * the regex cache.
+ * This function must be called whenever the LC_COLLATE or LC_CTYPE locale is
+ * changed. Compiled patterns that are still in use by callers are not freed
+ * until they are passed to `xfnm_free'. */
+void xfnm_reset_locale(void)
+{
+    xfnm_locale_generation++;
+    while (regexcache_head.next != &regexcache_head)
+	remove_regex_cache(regexcache_head.next);
+}
+
+/* Releases the specified compiled pattern.
+ * The pattern is freed when it is no longer referenced by the regex cache. */
 void xfnm_free(xfnmatch_T *xfnm)
 {
-    if (xfnm != NULL) {
+    if (xfnm != NULL && --xfnm->refcount == 0) {
 	if (xfnm->flags & XFNM_compiled)
 	    regfree(&xfnm->value.regex);
 	else
@@ -748,19 +873,15 @@ bool match_pattern(const wchar_t *s, const wchar_t *pattern)
 /* Tests if extended regular expression `regex' matches string `s'. */
 bool match_regex(const wchar_t *s, const wchar_t *regex)
 {
-    regex_t compiled_regex;
-    char *mbs_regex = malloc_wcstombs(regex);
-    int err = regcomp(&compiled_regex, mbs_regex, REG_EXTENDED | REG_NOSUB);
-    free(mbs_regex);
-
-    if (err != 0)
+    xfnmatch_T *xfnm = compile_regex_cached(regex, XFNM_extended);
+    if (xfnm == NULL)
 	return false;
 
     char *mbs_s = malloc_wcstombs(s);
-    err = regexec(&compiled_regex, mbs_s, 0, NULL, 0);
+    int err = regexec(&xfnm->value.regex, mbs_s, 0, NULL, 0);
     free(mbs_s);
 
-    regfree(&compiled_regex);
+    xfnm_free(xfnm);
 
     return err == 0;
 }
@@ -31,6 +31,7 @@ typedef enum {
     XFNM_compiled = 1 << 5,
     XFNM_headstar = 1 << 6,
     XFNM_tailstar = 1 << 7,
+    XFNM_extended = 1 << 8,
 } xfnmflags_T;
 typedef struct {
     size_t start, end;
@@ -42,7 +43,7 @@ extern _Bool is_pathname_matching_pattern(const wchar_t *pat)
     __attribute__((pure,nonnull));
 
 extern xfnmatch_T *xfnm_compile(const wchar_t *pat, xfnmflags_T flags)
-    __attribute__((malloc,warn_unused_result,nonnull));
+    __attribute__((warn_unused_result,nonnull));
 extern int xfnm_match(
 	const xfnmatch_T *restrict xfnm, const char *restrict s)
     __attribute__((nonnull));
@@ -55,6 +56,9 @@ extern wchar_t *xfnm_subst(
     __attribute__((malloc,warn_unused_result,nonnull));
 extern void xfnm_free(xfnmatch_T *xfnm);
 
+extern unsigned long xfnm_locale_generation;
+extern void xfnm_reset_locale(void);
+
 extern _Bool match_pattern(const wchar_t *s, const wchar_t *pattern)
     __attribute__((nonnull));
 #if YASH_ENABLE_TEST
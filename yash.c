@@ -19,16 +19,20 @@
 #include "common.h"
 #include "yash.h"
 #include <assert.h>
+#include <dirent.h>
 #include <errno.h>
 #include <fcntl.h>
 #if HAVE_GETTEXT
 # include <libintl.h>
 #endif
+#include <limits.h>
 #include <locale.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/stat.h>
 #include <unistd.h>
 #include <wchar.h>
 #include "alias.h"
@@ -36,6 +40,7 @@
 #include "configm.h"
 #include "exec.h"
 #include "expand.h"
+#include "hashtable.h"
 #if YASH_ENABLE_HISTORY
 # include "history.h"
 #endif
@@ -44,11 +49,13 @@
 #include "option.h"
 #include "parser.h"
 #include "path.h"
+#include "plist.h"
 #include "redir.h"
 #include "sig.h"
 #include "strbuf.h"
 #include "util.h"
 #include "variable.h"
+#include "xfnmatch.h"
 
 
 extern int main(int argc, char **argv)
@@ -64,8 +71,68 @@ static bool execute_file_mbs(const char *path);
 static void print_help(void);
 static void print_version(void);
 
-static void parse_and_exec(struct parseparam_T *pinfo, bool finally_exit)
+struct parsecache_T;
+static void parse_and_exec(struct parseparam_T *pinfo, bool finally_exit,
+	struct parsecache_T *record)
     __attribute__((nonnull(1)));
+
+static hashval_T hash_file_identity(const void *pc)
+    __attribute__((nonnull,pure));
+static int compare_file_identity(const void *pc1, const void *pc2)
+    __attribute__((nonnull,pure));
+static bool is_same_file_version(
+	const struct stat *restrict st1, const struct stat *restrict st2)
+    __attribute__((nonnull,pure));
+static struct parsecache_T *new_parse_cache(
+	const struct stat *st, bool enable_alias)
+    __attribute__((nonnull,malloc,warn_unused_result));
+static void append_parse_cache(struct parsecache_T *pc,
+	and_or_T *commands, unsigned long nextlineno)
+    __attribute__((nonnull));
+static void release_parse_cache(struct parsecache_T *pc)
+    __attribute__((nonnull));
+static bool parse_cache_is_current(const struct parsecache_T *pc)
+    __attribute__((nonnull,pure));
+static struct parsecache_T *find_parse_cache(
+	const struct stat *st, bool enable_alias)
+    __attribute__((nonnull));
+static void add_parse_cache(struct parsecache_T *pc)
+    __attribute__((nonnull));
+static void remove_parse_cache(struct parsecache_T *pc)
+    __attribute__((nonnull));
+static unsigned long exec_parse_cache(struct parsecache_T *pc)
+    __attribute__((nonnull));
+static bool skip_lines(int fd, unsigned long count);
+static char *saved_parse_cache_path(const struct stat *st, bool enable_alias)
+    __attribute__((nonnull,malloc,warn_unused_result));
+static uint_fast64_t hash_bytes(
+	uint_fast64_t hash, const char *data, size_t size)
+    __attribute__((nonnull,pure));
+static bool hash_file_contents(int fd, uint_fast64_t *hashp)
+    __attribute__((nonnull));
+static void encode_uint64(char *p, uint_fast64_t value)
+    __attribute__((nonnull));
+static uint_fast64_t decode_uint64(const char *p)
+    __attribute__((nonnull,pure));
+static void dump_parse_cache_header(xstrbuf_T *buf,
+	const struct stat *st, uint_fast64_t hash, bool enable_alias)
+    __attribute__((nonnull));
+static struct parsecache_T *load_parse_cache(const char *path,
+	const xstrbuf_T *header, const struct stat *st, bool enable_alias)
+    __attribute__((nonnull,warn_unused_result));
+static struct parsecache_T *find_saved_parse_cache(int fd,
+	const struct stat *st, bool enable_alias,
+	char **restrict pathp, xstrbuf_T *restrict header)
+    __attribute__((nonnull,warn_unused_result));
+static void save_parse_cache(const struct parsecache_T *pc,
+	const char *path, const xstrbuf_T *header)
+    __attribute__((nonnull));
+static bool is_saved_parse_cache_name(const char *name)
+    __attribute__((nonnull,pure));
+static int compare_saved_parse_cache_mtime(const void *p1, const void *p2)
+    __attribute__((nonnull,pure));
+static void prune_saved_parse_caches(const char *path)
+    __attribute__((nonnull));
 static bool input_is_interactive_terminal(const parseparam_T *pinfo)
     __attribute__((nonnull));
 
@@ -340,7 +407,7 @@ bool execute_file_mbs(const char *path)
     if (fd < 0)
 	return false;
 
-    exec_input(fd, path, XIO_SUBST_ALIAS);
+    exec_input(fd, path, XIO_SUBST_ALIAS | XIO_CACHE);
     cancel_return();
     remove_shellfd(fd);
     xclose(fd);
@@ -441,6 +508,629 @@ void print_version(void)
 }
 
 
+/********** Cache of Parsed Files **********/
+
+/* The maximum total size of the files whose parsed commands are cached. */
+#define PARSE_CACHE_SIZE_MAX (1 << 20)
+/* The version of the format of the files in $YASH_PARSECACHE_DIR. This must be
+ * incremented whenever the parse tree structures are changed. */
+#define PARSE_CACHE_FORMAT 2
+/* The maximum size of a file in $YASH_PARSECACHE_DIR. */
+#define PARSE_CACHE_FILE_SIZE_MAX (16 << 20)
+/* The maximum number of files in $YASH_PARSECACHE_DIR. */
+#define PARSE_CACHE_DIR_COUNT_MAX 1024
+/* The maximum total size of the files in $YASH_PARSECACHE_DIR. */
+#define PARSE_CACHE_DIR_SIZE_MAX (64 << 20)
+/* The size of an integer encoded by `encode_uint64'. */
+#define UINT64_SIZE 8
+
+/* commands parsed in one call to `read_and_parse' */
+typedef struct parsedunit_T {
+    and_or_T *commands;
+    unsigned long nextlineno;  /* number of the line following the commands */
+} parsedunit_T;
+
+/* commands parsed from a file, executed again without parsing while the file
+ * remains unmodified */
+typedef struct parsecache_T {
+    struct stat st;           /* status of the file when parsed */
+    bool enable_alias;        /* true if aliases were substituted */
+    bool posix;               /* value of `posixly_correct' when parsed */
+    unsigned long aliasgen;   /* value of `alias_generation' when parsed */
+    unsigned long localegen;  /* `xfnm_locale_generation' when parsed */
+    bool consistent;          /* false if the above changed while parsing */
+    bool complete;            /* true if the file was parsed to the end */
+    unsigned long lastuse;    /* value of `parse_cache_clock' when last used */
+    refcount_T refcount;
+    size_t count, capacity;
+    parsedunit_T *units;
+} parsecache_T;
+/* An entry in the `parse_cache' is referenced by the cache itself and by each
+ * execution of its commands in progress, so that the commands are not freed
+ * while being executed even if the entry is removed from the cache. */
+
+/* Hashtable mapping the device and i-node numbers of files to `parsecache_T's.
+ * Each entry is both the key and the value. */
+static hashtable_T parse_cache;
+/* total size of the files in `parse_cache' */
+static off_t parse_cache_size = 0;
+/* incremented each time an entry of `parse_cache' is used */
+static unsigned long parse_cache_clock = 0;
+
+/* Hashes the device and i-node numbers of a `parsecache_T'. */
+hashval_T hash_file_identity(const void *pc)
+{
+    const parsecache_T *c = pc;
+    return (hashval_T) c->st.st_ino * 31 + (hashval_T) c->st.st_dev;
+}
+
+/* Compares the device and i-node numbers of two `parsecache_T's.
+ * Returns zero iff they are the same. */
+int compare_file_identity(const void *pc1, const void *pc2)
+{
+    const parsecache_T *c1 = pc1, *c2 = pc2;
+    return c1->st.st_dev != c2->st.st_dev || c1->st.st_ino != c2->st.st_ino;
+}
+
+/* Returns true iff the two `stat' results have the same size, modification
+ * time, and status change time. */
+bool is_same_file_version(
+	const struct stat *restrict st1, const struct stat *restrict st2)
+{
+    return st1->st_size == st2->st_size
+	&& st1->st_mtime == st2->st_mtime
+	&& st1->st_ctime == st2->st_ctime
+#if HAVE_ST_MTIM
+	&& st1->st_mtim.tv_nsec == st2->st_mtim.tv_nsec
+#elif HAVE_ST_MTIMESPEC
+	&& st1->st_mtimespec.tv_nsec == st2->st_mtimespec.tv_nsec
+#elif HAVE_ST_MTIMENSEC
+	&& st1->st_mtimensec == st2->st_mtimensec
+#elif HAVE___ST_MTIMENSEC
+	&& st1->__st_mtimensec == st2->__st_mtimensec
+#endif
+	;
+}
+
+/* Creates a new empty cache entry for the file of the specified status, which
+ * is to be filled by `parse_and_exec'. */
+parsecache_T *new_parse_cache(const struct stat *st, bool enable_alias)
+{
+    parsecache_T *pc = xmalloc(sizeof *pc);
+    pc->st = *st;
+    pc->enable_alias = enable_alias;
+    pc->posix = posixly_correct;
+    pc->aliasgen = alias_generation;
+    pc->localegen = xfnm_locale_generation;
+    pc->consistent = true;
+    pc->complete = false;
+    pc->lastuse = 0;
+    pc->refcount = 1;
+    pc->count = pc->capacity = 0;
+    pc->units = NULL;
+    return pc;
+}
+
+/* Appends parsed commands to the cache entry. */
+void append_parse_cache(
+	parsecache_T *pc, and_or_T *commands, unsigned long nextlineno)
+{
+    if (pc->count == pc->capacity) {
+	pc->capacity = (pc->capacity == 0) ? 8 : mul(pc->capacity, 2);
+	pc->units = xreallocn(pc->units, pc->capacity, sizeof *pc->units);
+    }
+    pc->units[pc->count++] = (parsedunit_T) {
+	.commands = commands,
+	.nextlineno = nextlineno,
+    };
+}
+
+/* Decreases the reference count of the cache entry and, if it becomes zero,
+ * frees the entry and the commands in it. */
+void release_parse_cache(parsecache_T *pc)
+{
+    if (!refcount_decrement(&pc->refcount))
+	return;
+    for (size_t i = 0; i < pc->count; i++)
+	andorsfree(pc->units[i].commands);
+    free(pc->units);
+    free(pc);
+}
+
+/* Returns true iff the current state of the shell that affects parsing is the
+ * same as when the commands in the cache entry were parsed. */
+bool parse_cache_is_current(const parsecache_T *pc)
+{
+    return pc->posix == posixly_correct
+	&& pc->localegen == xfnm_locale_generation
+	&& (!pc->enable_alias || pc->aliasgen == alias_generation);
+}
+
+/* Returns the cache entry for the file of the specified status if it is
+ * applicable to the current state of the shell. Otherwise, returns NULL,
+ * removing the entry for the file, if any, from the cache. */
+parsecache_T *find_parse_cache(const struct stat *st, bool enable_alias)
+{
+    if (parse_cache.capacity == 0)
+	return NULL;
+
+    parsecache_T key = { .st = *st };
+    parsecache_T *pc = ht_get(&parse_cache, &key).value;
+    if (pc == NULL)
+	return NULL;
+    if (!is_same_file_version(&pc->st, st) || pc->enable_alias != enable_alias
+	    || !parse_cache_is_current(pc)) {
+	remove_parse_cache(pc);
+	return NULL;
+    }
+    pc->lastuse = ++parse_cache_clock;
+    return pc;
+}
+
+/* Adds the completely parsed cache entry to the cache, replacing the existing
+ * entry for the same file. Least recently used entries are removed so that the
+ * total size of the cached files does not exceed PARSE_CACHE_SIZE_MAX. */
+void add_parse_cache(parsecache_T *pc)
+{
+    assert(pc->complete);
+    assert(pc->st.st_size <= PARSE_CACHE_SIZE_MAX);
+
+    if (parse_cache.capacity == 0) {
+	ht_init(&parse_cache, hash_file_identity, compare_file_identity);
+    } else {
+	parsecache_T *old = ht_get(&parse_cache, pc).value;
+	if (old != NULL)
+	    remove_parse_cache(old);
+    }
+
+    while (parse_cache_size + pc->st.st_size > PARSE_CACHE_SIZE_MAX) {
+	parsecache_T *oldest = NULL;
+	size_t i = 0;
+	kvpair_T kv;
+	while ((kv = ht_next(&parse_cache, &i)).key != NULL) {
+	    parsecache_T *c = kv.value;
+	    if (oldest == NULL || c->lastuse < oldest->lastuse)
+		oldest = c;
+	}
+	assert(oldest != NULL);
+	remove_parse_cache(oldest);
+    }
+
+    pc->lastuse = ++parse_cache_clock;
+    parse_cache_size += pc->st.st_size;
+    ht_set(&parse_cache, pc, pc);
+}
+
+/* Removes the entry from the cache. */
+void remove_parse_cache(parsecache_T *pc)
+{
+    ht_remove(&parse_cache, pc);
+    parse_cache_size -= pc->st.st_size;
+    release_parse_cache(pc);
+}
+
+/* Executes the commands in the cache entry in the same way as
+ * `parse_and_exec'.
+ * If the state of the shell that affects parsing changes during execution, the
+ * entry is removed from the cache (if it is still in it) and the rest of the
+ * commands are not executed. In this case, the number of the line from which
+ * the file should be parsed to execute the rest of the commands is returned.
+ * Otherwise, the result is zero. */
+unsigned long exec_parse_cache(parsecache_T *pc)
+{
+    unsigned long lineno = 0;
+    bool executed = false;
+
+    refcount_increment(&pc->refcount);
+    for (size_t i = 0; i < pc->count; i++) {
+	if (need_break())
+	    goto done;
+	if (!parse_cache_is_current(pc)) {
+	    assert(i > 0);
+	    lineno = pc->units[i - 1].nextlineno;
+	    /* The entry may have been removed from the cache or replaced with
+	     * another during execution. */
+	    if (ht_get(&parse_cache, pc).value == pc)
+		remove_parse_cache(pc);
+	    goto done;
+	}
+	if (shopt_exec || is_interactive) {
+	    exec_and_or_lists(pc->units[i].commands, false);
+	    executed = true;
+	}
+    }
+    if (!executed)
+	laststatus = Exit_SUCCESS;
+done:
+    release_parse_cache(pc);
+    return lineno;
+}
+
+/* Moves the offset of the file descriptor, which must refer to a regular file,
+ * to the beginning of the line following the first `count' lines of the file.
+ * Returns false on error. */
+bool skip_lines(int fd, unsigned long count)
+{
+    char buf[BUFSIZ];
+    off_t offset = 0;
+
+    if (lseek(fd, 0, SEEK_SET) < 0)
+	return false;
+    while (count > 0) {
+	ssize_t size = read(fd, buf, sizeof buf);
+	if (size < 0) {
+	    if (errno == EINTR)
+		continue;
+	    return false;
+	}
+	if (size == 0)
+	    break;
+	for (ssize_t i = 0; i < size; i++) {
+	    if (buf[i] == '\n' && --count == 0) {
+		offset += i + 1;
+		return lseek(fd, offset, SEEK_SET) >= 0;
+	    }
+	}
+	offset += size;
+    }
+    return true;
+}
+
+/* Returns the pathname of the file in $YASH_PARSECACHE_DIR to which the
+ * commands parsed from the file of the specified status are saved. Returns
+ * NULL if the variable is not set to an absolute pathname or if saved commands
+ * are not applicable because aliases are defined. The result must be freed by
+ * the caller. */
+char *saved_parse_cache_path(const struct stat *st, bool enable_alias)
+{
+    /* Aliases defined in another process are not known when the commands are
+     * saved, so the commands are saved and loaded only if there are no
+     * aliases. Aliases defined in the file itself are detected by
+     * `parse_cache_is_current'. */
+    if (enable_alias && have_aliases())
+	return NULL;
+
+    const wchar_t *dir = getvar(L VAR_YASH_PARSECACHE_DIR);
+    if (dir == NULL || dir[0] != L'/')
+	return NULL;
+
+    char *mbsdir = malloc_wcstombs(dir);
+    if (mbsdir == NULL)
+	return NULL;
+    char *path = malloc_printf("%s/%jx-%jx", mbsdir,
+	    (uintmax_t) st->st_dev, (uintmax_t) st->st_ino);
+    free(mbsdir);
+    return path;
+}
+
+/* The initial value for `hash_bytes'. */
+#define HASH_BYTES_INIT UINT64_C(0xCBF29CE484222325)
+
+/* Updates the FNV-1a hash with the specified bytes. */
+uint_fast64_t hash_bytes(uint_fast64_t hash, const char *data, size_t size)
+{
+    for (size_t i = 0; i < size; i++) {
+	hash ^= (unsigned char) data[i];
+	hash = (hash * UINT64_C(0x100000001B3)) & UINT64_C(0xFFFFFFFFFFFFFFFF);
+    }
+    return hash;
+}
+
+/* Computes the hash of the contents of the regular file. The file offset is
+ * left at the beginning of the file. Returns false on error. */
+bool hash_file_contents(int fd, uint_fast64_t *hashp)
+{
+    char buf[BUFSIZ];
+    uint_fast64_t hash = HASH_BYTES_INIT;
+
+    if (lseek(fd, 0, SEEK_SET) < 0)
+	return false;
+    for (;;) {
+	ssize_t size = read(fd, buf, sizeof buf);
+	if (size < 0) {
+	    if (errno == EINTR)
+		continue;
+	    return false;
+	}
+	if (size == 0)
+	    break;
+	hash = hash_bytes(hash, buf, (size_t) size);
+    }
+    *hashp = hash;
+    return lseek(fd, 0, SEEK_SET) >= 0;
+}
+
+/* Stores the integer in the UINT64_SIZE bytes at `p' in little-endian byte
+ * order, so that the saved commands do not depend on the byte order or the
+ * size of integer types. */
+void encode_uint64(char *p, uint_fast64_t value)
+{
+    for (int i = 0; i < UINT64_SIZE; i++) {
+	p[i] = (char) (value & 0xFF);
+	value >>= 8;
+    }
+}
+
+/* Returns the integer stored by `encode_uint64' at `p'. */
+uint_fast64_t decode_uint64(const char *p)
+{
+    uint_fast64_t value = 0;
+    for (int i = UINT64_SIZE; --i >= 0; )
+	value = (value << 8) | (unsigned char) p[i];
+    return value;
+}
+
+/* Appends the header of the file in $YASH_PARSECACHE_DIR for the source file of
+ * the specified status and contents hash. The header describes everything the
+ * saved commands depend on, so a saved file is used only if its header exactly
+ * matches the one expected for the current source file and shell. */
+void dump_parse_cache_header(xstrbuf_T *buf,
+	const struct stat *st, uint_fast64_t hash, bool enable_alias)
+{
+    sb_printf(buf, "yash %s parse cache %d\n",
+	    PACKAGE_VERSION, PARSE_CACHE_FORMAT);
+    sb_printf(buf, "wchar=%zu dbracket=%d posix=%d alias=%d ctype=%s\n",
+	    sizeof (wchar_t),
+#if YASH_ENABLE_DOUBLE_BRACKET
+	    1,
+#else
+	    0,
+#endif
+	    (int) posixly_correct, (int) enable_alias,
+	    setlocale(LC_CTYPE, NULL));
+    sb_printf(buf, "size=%jd hash=%016jx\n",
+	    (intmax_t) st->st_size, (uintmax_t) hash);
+}
+
+/* Loads the commands saved by `save_parse_cache' in the file at `path'.
+ * Returns a new complete cache entry for the source file of the specified
+ * status, or NULL if the saved file cannot be read, is not owned by the user,
+ * or does not start with the expected `header'. */
+parsecache_T *load_parse_cache(const char *path,
+	const xstrbuf_T *header, const struct stat *st, bool enable_alias)
+{
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+	return NULL;
+
+    parsecache_T *pc = NULL;
+    char *contents = NULL;
+    struct stat fst;
+    if (fstat(fd, &fst) < 0 || !S_ISREG(fst.st_mode)
+	    || fst.st_uid != geteuid() || (fst.st_mode & (S_IWGRP | S_IWOTH))
+	    || fst.st_size > PARSE_CACHE_FILE_SIZE_MAX
+	    || (size_t) fst.st_size < header->length)
+	goto done;
+
+    /* read the whole file at once */
+    size_t size = (size_t) fst.st_size, length = 0;
+    contents = xmalloc(size);
+    while (length < size) {
+	ssize_t s = read(fd, contents + length, size - length);
+	if (s < 0) {
+	    if (errno == EINTR)
+		continue;
+	    goto done;
+	}
+	if (s == 0)
+	    goto done;
+	length += s;
+    }
+    if (memcmp(contents, header->contents, header->length) != 0)
+	goto done;
+
+    /* The header is followed by the hash of the rest of the file. */
+    const char *next = contents + header->length, *end = contents + size;
+    if (end - next < UINT64_SIZE)
+	goto done;
+    uint_fast64_t hash = decode_uint64(next);
+    next += UINT64_SIZE;
+    if (hash != hash_bytes(HASH_BYTES_INIT, next, (size_t) (end - next)))
+	goto done;
+
+    pc = new_parse_cache(st, enable_alias);
+    while (next != end) {
+	and_or_T *commands;
+	if (end - next < UINT64_SIZE)
+	    goto fail;
+	uint_fast64_t nextlineno = decode_uint64(next);
+	next += UINT64_SIZE;
+	if (nextlineno > ULONG_MAX)
+	    goto fail;
+	if (!load_and_or_lists(&next, end, &commands))
+	    goto fail;
+	if (commands == NULL)
+	    goto fail;
+	append_parse_cache(pc, commands, nextlineno);
+    }
+    pc->complete = true;
+    goto done;
+
+fail:
+    release_parse_cache(pc);
+    pc = NULL;
+done:
+    free(contents);
+    close(fd);
+    return pc;
+}
+
+/* Looks up $YASH_PARSECACHE_DIR for the commands saved for the regular file
+ * `fd' of the specified status. If the saved commands are found and
+ * applicable, they are added to the cache and the new cache entry is returned.
+ * Otherwise, NULL is returned and, if the commands parsed from the file can be
+ * saved, the pathname and the header of the file to save them to are assigned
+ * to `*pathp' and `*header', which must be freed by the caller. If they cannot
+ * be saved, NULL is assigned to `*pathp'. */
+parsecache_T *find_saved_parse_cache(int fd, const struct stat *st,
+	bool enable_alias, char **restrict pathp, xstrbuf_T *restrict header)
+{
+    uint_fast64_t hash;
+
+    *pathp = saved_parse_cache_path(st, enable_alias);
+    if (*pathp == NULL)
+	return NULL;
+    if (!hash_file_contents(fd, &hash)) {
+	free(*pathp);
+	*pathp = NULL;
+	return NULL;
+    }
+
+    dump_parse_cache_header(sb_init(header), st, hash, enable_alias);
+    parsecache_T *pc = load_parse_cache(*pathp, header, st, enable_alias);
+    if (pc != NULL) {
+	add_parse_cache(pc);
+	sb_destroy(header);
+	free(*pathp);
+	*pathp = NULL;
+    }
+    return pc;
+}
+
+/* Saves the commands in the complete cache entry to the file at `path', which
+ * is replaced atomically. Errors are silently ignored. */
+void save_parse_cache(
+	const parsecache_T *pc, const char *path, const xstrbuf_T *header)
+{
+    assert(pc->complete);
+
+    char *temppath = malloc_printf("%s.XXXXXX", path);
+    int fd = mkstemp(temppath);
+    if (fd < 0) {
+	free(temppath);
+	return;
+    }
+
+    xstrbuf_T buf;
+    sb_initwithmax(&buf, header->length + (size_t) pc->st.st_size * 4);
+    sb_ncat_force(&buf, header->contents, header->length);
+    char bytes[UINT64_SIZE] = { 0 };
+    size_t hashindex = buf.length;
+    sb_ncat_force(&buf, bytes, UINT64_SIZE);
+    for (size_t i = 0; i < pc->count; i++) {
+	encode_uint64(bytes, pc->units[i].nextlineno);
+	sb_ncat_force(&buf, bytes, UINT64_SIZE);
+	dump_and_or_lists(&buf, pc->units[i].commands);
+    }
+    size_t payloadindex = hashindex + UINT64_SIZE;
+    encode_uint64(&buf.contents[hashindex], hash_bytes(HASH_BYTES_INIT,
+		&buf.contents[payloadindex], buf.length - payloadindex));
+
+    bool ok = buf.length <= PARSE_CACHE_FILE_SIZE_MAX
+	&& write_all(fd, buf.contents, buf.length);
+    ok &= close(fd) >= 0;
+    if (!ok || rename(temppath, path) < 0)
+	unlink(temppath);
+    else
+	prune_saved_parse_caches(path);
+    sb_destroy(&buf);
+    free(temppath);
+}
+
+/* Returns true iff the name is of the form of the files created by
+ * `saved_parse_cache_path'. */
+bool is_saved_parse_cache_name(const char *name)
+{
+    static const char xdigits[] = "0123456789abcdef";
+    size_t n = strspn(name, xdigits);
+    if (n == 0 || name[n] != '-')
+	return false;
+    name += n + 1;
+    n = strspn(name, xdigits);
+    return n > 0 && name[n] == '\0';
+}
+
+/* a file in $YASH_PARSECACHE_DIR examined in `prune_saved_parse_caches' */
+typedef struct savedfile_T {
+    time_t mtime;
+    off_t size;
+    char name[];
+} savedfile_T;
+
+/* Compares the modification times of two `savedfile_T's. */
+int compare_saved_parse_cache_mtime(const void *p1, const void *p2)
+{
+    const savedfile_T *f1 = *(const savedfile_T *const *) p1;
+    const savedfile_T *f2 = *(const savedfile_T *const *) p2;
+    return (f1->mtime > f2->mtime) - (f1->mtime < f2->mtime);
+}
+
+/* Removes the least recently saved files from the directory containing the
+ * file at `path', which has just been saved, until the number and the total
+ * size of the files in the directory do not exceed PARSE_CACHE_DIR_COUNT_MAX
+ * and PARSE_CACHE_DIR_SIZE_MAX. Without this, a file saved for a source file
+ * that has been replaced with a new one (having a different i-node number)
+ * would remain forever. Only the files that are named by
+ * `saved_parse_cache_path' and owned by the user are counted and removed, and
+ * the file at `path' is never removed. Errors are silently ignored. */
+void prune_saved_parse_caches(const char *path)
+{
+    const char *slash = strrchr(path, '/');
+    assert(slash != NULL);
+    const char *savedname = slash + 1;
+    xstrbuf_T buf;
+    char *dirpath = sb_tostr(sb_ncat_force(
+		sb_init(&buf), path, (size_t) (slash - path)));
+    DIR *dir = opendir(dirpath[0] == '\0' ? "/" : dirpath);
+    if (dir == NULL) {
+	free(dirpath);
+	return;
+    }
+
+    plist_T files;
+    uintmax_t totalsize = 0;
+    struct dirent *de;
+    pl_init(&files);
+    while ((de = readdir(dir)) != NULL) {
+	if (!is_saved_parse_cache_name(de->d_name))
+	    continue;
+
+	struct stat st;
+	char *filepath = malloc_printf("%s/%s", dirpath, de->d_name);
+	bool ok = lstat(filepath, &st) >= 0
+	    && S_ISREG(st.st_mode) && st.st_uid == geteuid();
+	free(filepath);
+	if (!ok)
+	    continue;
+
+	size_t namelen = strlen(de->d_name);
+	savedfile_T *f = xmallocs(sizeof *f, namelen + 1, sizeof *f->name);
+	f->mtime = st.st_mtime;
+	f->size = st.st_size;
+	memcpy(f->name, de->d_name, namelen + 1);
+	pl_add(&files, f);
+	totalsize += (uintmax_t) st.st_size;
+    }
+    closedir(dir);
+
+    size_t count = files.length;
+    if (count > PARSE_CACHE_DIR_COUNT_MAX
+	    || totalsize > PARSE_CACHE_DIR_SIZE_MAX) {
+	qsort(files.contents, files.length, sizeof *files.contents,
+		compare_saved_parse_cache_mtime);
+	for (size_t i = 0; i < files.length; i++) {
+	    if (count <= PARSE_CACHE_DIR_COUNT_MAX
+		    && totalsize <= PARSE_CACHE_DIR_SIZE_MAX)
+		break;
+
+	    const savedfile_T *f = files.contents[i];
+	    if (strcmp(f->name, savedname) == 0)
+		continue;
+
+	    char *filepath = malloc_printf("%s/%s", dirpath, f->name);
+	    if (unlink(filepath) >= 0) {
+		count--;
+		totalsize -= (uintmax_t) f->size;
+	    }
+	    free(filepath);
+	}
+    }
+
+    plfree(pl_toary(&files), free);
+    free(dirpath);
+}
+
+
 /********** Functions to Execute Commands **********/
 
 /* Parses the specified wide string and executes it as commands.
@@ -462,7 +1152,7 @@ void exec_wcs(const wchar_t *code, const char *name, bool finally_exit)
 	.interactive = false,
     };
 
-    parse_and_exec(&pinfo, finally_exit);
+    parse_and_exec(&pinfo, finally_exit, NULL);
 }
 
 /* Parses the input from the specified file descriptor and executes commands.
@@ -470,6 +1160,9 @@ void exec_wcs(const wchar_t *code, const char *name, bool finally_exit)
  * descriptor is STDIN_FILENO, XIO_FINALLY_EXIT must be specified in `options'.
  * If `name' is non-NULL, it is printed in an error message on syntax error.
  * If XIO_INTERACTIVE is specified, the input is considered interactive.
+ * If XIO_CACHE is specified and the file descriptor refers to a regular file,
+ * the parsed commands are cached so that they are executed without being
+ * parsed again when the same unmodified file is input next time.
  * If there are no commands in the input, `laststatus' is set to zero. */
 void exec_input(int fd, const char *name, exec_input_options_T options)
 {
@@ -482,31 +1175,93 @@ void exec_input(int fd, const char *name, exec_input_options_T options)
 	.interactive = options & XIO_INTERACTIVE,
     };
     struct input_interactive_info_T intrinfo;
-    struct input_file_info_T *inputinfo;
+    struct input_file_info_T *inputinfo = NULL;
+    struct input_text_info_T textinfo;
+    struct parsecache_T *record = NULL;
+    char *savepath = NULL;
+    xstrbuf_T saveheader;
+
+    struct stat st;
+    bool regular = fstat(fd, &st) >= 0 && S_ISREG(st.st_mode);
+    if ((options & XIO_CACHE) && shopt_parsecache && !shopt_verbose
+	    && regular) {
+	struct parsecache_T *pc = find_parse_cache(&st, pinfo.enable_alias);
+	if (pc == NULL && st.st_size <= PARSE_CACHE_SIZE_MAX)
+	    pc = find_saved_parse_cache(fd, &st, pinfo.enable_alias,
+		    &savepath, &saveheader);
+	if (pc != NULL) {
+	    /* The rest of the file is parsed as usual if the cached commands
+	     * have become inapplicable during execution. */
+	    pinfo.lineno = exec_parse_cache(pc);
+	    if (pinfo.lineno == 0)
+		return;
+	    if (!skip_lines(fd, pinfo.lineno - 1)) {
+		xerror(errno, Ngt("cannot read input"));
+		laststatus = Exit_ERROR;
+		return;
+	    }
+	} else if (st.st_size <= PARSE_CACHE_SIZE_MAX) {
+	    record = new_parse_cache(&st, pinfo.enable_alias);
+	}
+    }
 
-    if (fd == STDIN_FILENO)
-	inputinfo = stdin_input_file_info;
-    else
-	inputinfo = new_input_file_info(fd, BUFSIZ);
+    /* A non-interactive regular file other than the standard input is not
+     * shared with other processes, so we read and decode it at once. It is
+     * still parsed and executed line by line. */
+    if (!pinfo.interactive && fd != STDIN_FILENO && regular
+	    && read_input_text(fd, st.st_size, &textinfo)) {
+	pinfo.input = input_text;
+	pinfo.inputinfo = &textinfo;
+    } else {
+	if (fd == STDIN_FILENO)
+	    inputinfo = stdin_input_file_info;
+	else
+	    inputinfo = new_input_file_info(fd, BUFSIZ);
+
+	if (pinfo.interactive) {
+	    intrinfo.fileinfo = inputinfo;
+	    intrinfo.prompttype = 1;
+	    pinfo.input = input_interactive;
+	    pinfo.inputinfo = &intrinfo;
+	} else {
+	    pinfo.input = input_file;
+	    pinfo.inputinfo = inputinfo;
+	}
+    }
+    parse_and_exec(&pinfo, options & XIO_FINALLY_EXIT, record);
 
-    if (pinfo.interactive) {
-	intrinfo.fileinfo = inputinfo;
-	intrinfo.prompttype = 1;
-	pinfo.input = input_interactive;
-	pinfo.inputinfo = &intrinfo;
+    if (inputinfo == NULL) {
+	destroy_input_text(&textinfo);
     } else {
-	pinfo.input = input_file;
-	pinfo.inputinfo = inputinfo;
+	assert(inputinfo != stdin_input_file_info);
+	free(inputinfo);
     }
-    parse_and_exec(&pinfo, options & XIO_FINALLY_EXIT);
 
-    assert(inputinfo != stdin_input_file_info);
-    free(inputinfo);
+    if (record != NULL) {
+	if (record->complete) {
+	    /* The file must not have been modified since it was hashed. */
+	    struct stat st2;
+	    if (savepath != NULL && fstat(fd, &st2) >= 0
+		    && is_same_file_version(&st, &st2))
+		save_parse_cache(record, savepath, &saveheader);
+	    add_parse_cache(record);
+	} else {
+	    release_parse_cache(record);
+	}
+    }
+    if (savepath != NULL) {
+	sb_destroy(&saveheader);
+	free(savepath);
+    }
 }
 
 /* Parses the input using the specified `parseparam_T' and executes commands.
+ * If `record' is non-NULL, the parsed commands are appended to it rather than
+ * freed, and `record->complete' is set if the input was parsed to the end
+ * without anything changing how it is parsed.
  * If no commands were executed, `laststatus' is set to Exit_SUCCESS. */
-void parse_and_exec(parseparam_T *pinfo, bool finally_exit)
+void parse_and_exec(parseparam_T *pinfo, bool finally_exit,
+	struct parsecache_T *record)
 {
     bool executed = false;
 
@@ -528,16 +1283,24 @@ void parse_and_exec(parseparam_T *pinfo, bool finally_exit)
 	switch (read_and_parse(pinfo, &commands)) {
 	    case PR_OK:
 		if (commands != NULL) {
+		    if (record != NULL) {
+			if (!parse_cache_is_current(record))
+			    record->consistent = false;
+			append_parse_cache(record, commands, pinfo->lineno);
+		    }
 		    if (shopt_exec || is_interactive) {
 			exec_and_or_lists(commands,
 				finally_exit && !pinfo->interactive &&
 				pinfo->lastinputresult == INPUT_EOF);
 			executed = true;
 		    }
-		    andorsfree(commands);
+		    if (record == NULL)
+			andorsfree(commands);
 		}
 		break;
 	    case PR_EOF:
+		if (record != NULL)
+		    record->complete = record->consistent;
 		if (!executed)
 		    laststatus = Exit_SUCCESS;
 		if (!finally_exit)